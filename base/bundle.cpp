@@ -7,13 +7,19 @@
 #include "base/map_util.hpp"
 #include "base/status.hpp"
 
-#if !PRINCIPIA_COMPILER_CLANG
-
 namespace principia {
 namespace base {
 
 thread_local std::function<bool()> AbortRequested = [] { return false; };
 
+}  // namespace base
+}  // namespace principia
+
+#if !PRINCIPIA_COMPILER_CLANG
+
+namespace principia {
+namespace base {
+
 Bundle::Bundle(int const workers)
     : max_workers_(workers),
       master_abort_(&AbortRequested) {
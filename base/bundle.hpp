@@ -1,12 +1,14 @@
 ﻿
 #pragma once
 
+#include <condition_variable>
 #include <experimental/optional>
 #include <functional>
 #include <queue>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <thread>
 #include <vector>
 
 #include "base/macros.hpp"
@@ -14,8 +16,6 @@
 #include "base/not_null.hpp"
 #include "base/status.hpp"
 
-#if !PRINCIPIA_COMPILER_CLANG
-
 namespace principia {
 namespace base {
 
@@ -23,6 +23,14 @@ namespace base {
 // when appropriate.  The function is thread-safe.
 extern thread_local std::function<bool()> AbortRequested;
 
+}  // namespace base
+}  // namespace principia
+
+#if !PRINCIPIA_COMPILER_CLANG
+
+namespace principia {
+namespace base {
+
 // A thread pool with cooperative aborting (but no cooperative scheduling).
 // We refer to the thread on which the |Bundle| is created as its master thread.
 // The |Bundle| itself cooperatively aborts if |AbortRequested()| on its master
@@ -7,6 +7,17 @@
 
 namespace principia {
 namespace base {
+namespace internal_hexadecimal {
+
+// The implementations of the functions below, from the fastest to the slowest.
+// The fastest one supported by the processor is selected at runtime.
+enum class InstructionSet {
+  AVX2,
+  SSSE3,
+  Scalar,
+};
+
+}  // namespace internal_hexadecimal
 
 // The result is upper-case.  Either |input.data <= &output.data[1]| or
 // |&output.data[input.size << 1] <= input.data| must hold, in particular,
@@ -3,10 +3,16 @@
 
 #include <cstdint>
 #include <cstring>
+#include <immintrin.h>
 
 #include "base/hexadecimal.hpp"
+#include "base/macros.hpp"
 #include "glog/logging.h"
 
+#if PRINCIPIA_COMPILER_MSVC || PRINCIPIA_COMPILER_CLANG_CL
+#include <intrin.h>
+#endif
+
 namespace principia {
 namespace base {
 
@@ -36,6 +42,244 @@ static std::uint8_t const hexadecimal_digits_to_nibble[256] = {
 #undef SKIP_48
 #endif
 
+namespace internal_hexadecimal {
+
+inline InstructionSet DetectInstructionSet() {
+#if PRINCIPIA_COMPILER_MSVC || PRINCIPIA_COMPILER_CLANG_CL
+  int registers[4];  // EAX, EBX, ECX, EDX.
+  __cpuid(registers, 0);
+  int const highest_function = registers[0];
+  __cpuid(registers, 1);
+  bool const ssse3 = registers[2] & (1 << 9);
+  // AVX2 also requires the operating system to save the YMM registers.
+  bool const osxsave = registers[2] & (1 << 27);
+  bool const avx = registers[2] & (1 << 28);
+  bool avx2 = false;
+  if (highest_function >= 7 && osxsave && avx &&
+      (_xgetbv(0) & 0b110) == 0b110) {
+    __cpuidex(registers, 7, 0);
+    avx2 = registers[1] & (1 << 5);
+  }
+#else
+  // |__builtin_cpu_supports| takes the operating system support into account.
+  __builtin_cpu_init();
+  bool const ssse3 = __builtin_cpu_supports("ssse3");
+  bool const avx2 = __builtin_cpu_supports("avx2");
+#endif
+  if (avx2) {
+    return InstructionSet::AVX2;
+  } else if (ssse3) {
+    return InstructionSet::SSSE3;
+  } else {
+    return InstructionSet::Scalar;
+  }
+}
+
+inline InstructionSet SupportedInstructionSet() {
+  static InstructionSet const instruction_set = DetectInstructionSet();
+  return instruction_set;
+}
+
+// The implementations below do not check their arguments.  The encoders
+// iterate backward and the decoders forward, and each block of input is loaded
+// before the corresponding output is stored, so they support the same
+// overlaps as the functions declared in hexadecimal.hpp.  |digit_count| is
+// even.
+
+inline void EncodeScalar(std::uint8_t const* const input,
+                         std::int64_t const byte_count,
+                         std::uint8_t* const output) {
+  for (std::int64_t i = byte_count - 1; i >= 0; --i) {
+    std::memcpy(&output[i << 1], &byte_to_hexadecimal_digits[input[i] << 1], 2);
+  }
+}
+
+inline void DecodeScalar(std::uint8_t const* const input,
+                         std::int64_t const digit_count,
+                         std::uint8_t* const output) {
+  for (std::int64_t i = 0; i < digit_count; i += 2) {
+    output[i >> 1] = (hexadecimal_digits_to_nibble[input[i]] << 4) |
+                     hexadecimal_digits_to_nibble[input[i + 1]];
+  }
+}
+
+// The nibbles of the bytes of |bytes| are looked up in a 16-entry table by
+// |pshufb|, and the resulting digits are interleaved, high nibble first.
+TARGET("ssse3")
+inline void EncodeSSSE3(std::uint8_t const* const input,
+                        std::int64_t const byte_count,
+                        std::uint8_t* const output) {
+  constexpr std::int64_t block = sizeof(__m128i);
+  std::int64_t const vectorized_count = byte_count - byte_count % block;
+  EncodeScalar(&input[vectorized_count],
+               byte_count - vectorized_count,
+               &output[vectorized_count << 1]);
+  __m128i const digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+  __m128i const low_nibble_mask = _mm_set1_epi8(0x0F);
+  for (std::int64_t i = vectorized_count - block; i >= 0; i -= block) {
+    __m128i const bytes =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(&input[i]));
+    __m128i const high_digits = _mm_shuffle_epi8(
+        digits, _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble_mask));
+    __m128i const low_digits =
+        _mm_shuffle_epi8(digits, _mm_and_si128(bytes, low_nibble_mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&output[i << 1]),
+                     _mm_unpacklo_epi8(high_digits, low_digits));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&output[(i << 1) + block]),
+                     _mm_unpackhi_epi8(high_digits, low_digits));
+  }
+}
+
+TARGET("avx2")
+inline void EncodeAVX2(std::uint8_t const* const input,
+                       std::int64_t const byte_count,
+                       std::uint8_t* const output) {
+  constexpr std::int64_t block = sizeof(__m256i);
+  std::int64_t const vectorized_count = byte_count - byte_count % block;
+  EncodeScalar(&input[vectorized_count],
+               byte_count - vectorized_count,
+               &output[vectorized_count << 1]);
+  __m256i const digits = _mm256_setr_epi8(
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'A', 'B', 'C', 'D', 'E', 'F',
+      '0', '1', '2', '3', '4', '5', '6', '7',
+      '8', '9', 'A', 'B', 'C', 'D', 'E', 'F');
+  __m256i const low_nibble_mask = _mm256_set1_epi8(0x0F);
+  for (std::int64_t i = vectorized_count - block; i >= 0; i -= block) {
+    __m256i const bytes =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&input[i]));
+    __m256i const high_digits = _mm256_shuffle_epi8(
+        digits,
+        _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble_mask));
+    __m256i const low_digits =
+        _mm256_shuffle_epi8(digits, _mm256_and_si256(bytes, low_nibble_mask));
+    // The unpacking operates within each 128-bit lane, so the lanes must be
+    // reordered.
+    __m256i const low = _mm256_unpacklo_epi8(high_digits, low_digits);
+    __m256i const high = _mm256_unpackhi_epi8(high_digits, low_digits);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&output[i << 1]),
+                        _mm256_permute2x128_si256(low, high, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(&output[(i << 1) + block]),
+                        _mm256_permute2x128_si256(low, high, 0x31));
+  }
+}
+
+// Returns the nibbles corresponding to the digits, with the same semantics as
+// |hexadecimal_digits_to_nibble|: setting bit 5 maps upper-case letters to
+// lower-case ones and leaves the decimal digits unchanged, and the digits and
+// letters are detected using unsigned comparisons.
+TARGET("ssse3")
+inline __m128i DigitsToNibblesSSSE3(__m128i const digits) {
+  __m128i const decimal = _mm_sub_epi8(digits, _mm_set1_epi8('0'));
+  __m128i const is_decimal =
+      _mm_cmpeq_epi8(_mm_min_epu8(decimal, _mm_set1_epi8(9)), decimal);
+  __m128i const letter = _mm_sub_epi8(
+      _mm_or_si128(digits, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+  __m128i const is_letter =
+      _mm_cmpeq_epi8(_mm_min_epu8(letter, _mm_set1_epi8(5)), letter);
+  return _mm_or_si128(
+      _mm_and_si128(is_decimal, decimal),
+      _mm_and_si128(is_letter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+TARGET("avx2")
+inline __m256i DigitsToNibblesAVX2(__m256i const digits) {
+  __m256i const decimal = _mm256_sub_epi8(digits, _mm256_set1_epi8('0'));
+  __m256i const is_decimal = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(decimal, _mm256_set1_epi8(9)), decimal);
+  __m256i const letter = _mm256_sub_epi8(
+      _mm256_or_si256(digits, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+  __m256i const is_letter = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(letter, _mm256_set1_epi8(5)), letter);
+  return _mm256_or_si256(
+      _mm256_and_si256(is_decimal, decimal),
+      _mm256_and_si256(is_letter,
+                       _mm256_add_epi8(letter, _mm256_set1_epi8(10))));
+}
+
+// The pairs of nibbles are combined by |pmaddubsw| as 16 * high + low, and the
+// resulting 16-bit words are packed into bytes.
+TARGET("ssse3")
+inline void DecodeSSSE3(std::uint8_t const* const input,
+                        std::int64_t const digit_count,
+                        std::uint8_t* const output) {
+  constexpr std::int64_t block = 2 * sizeof(__m128i);
+  std::int64_t const vectorized_count = digit_count - digit_count % block;
+  __m128i const weights = _mm_set1_epi16(0x0110);
+  for (std::int64_t i = 0; i < vectorized_count; i += block) {
+    __m128i const digits0 =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(&input[i]));
+    __m128i const digits1 = _mm_loadu_si128(
+        reinterpret_cast<__m128i const*>(&input[i + sizeof(__m128i)]));
+    __m128i const words0 =
+        _mm_maddubs_epi16(DigitsToNibblesSSSE3(digits0), weights);
+    __m128i const words1 =
+        _mm_maddubs_epi16(DigitsToNibblesSSSE3(digits1), weights);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&output[i >> 1]),
+                     _mm_packus_epi16(words0, words1));
+  }
+  DecodeScalar(&input[vectorized_count],
+               digit_count - vectorized_count,
+               &output[vectorized_count >> 1]);
+}
+
+TARGET("avx2")
+inline void DecodeAVX2(std::uint8_t const* const input,
+                       std::int64_t const digit_count,
+                       std::uint8_t* const output) {
+  constexpr std::int64_t block = 2 * sizeof(__m256i);
+  std::int64_t const vectorized_count = digit_count - digit_count % block;
+  __m256i const weights = _mm256_set1_epi16(0x0110);
+  for (std::int64_t i = 0; i < vectorized_count; i += block) {
+    __m256i const digits0 =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&input[i]));
+    __m256i const digits1 = _mm256_loadu_si256(
+        reinterpret_cast<__m256i const*>(&input[i + sizeof(__m256i)]));
+    __m256i const words0 =
+        _mm256_maddubs_epi16(DigitsToNibblesAVX2(digits0), weights);
+    __m256i const words1 =
+        _mm256_maddubs_epi16(DigitsToNibblesAVX2(digits1), weights);
+    // The packing operates within each 128-bit lane, so the 64-bit quadwords
+    // must be reordered.
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&output[i >> 1]),
+        _mm256_permute4x64_epi64(_mm256_packus_epi16(words0, words1),
+                                 0b11011000));
+  }
+  DecodeScalar(&input[vectorized_count],
+               digit_count - vectorized_count,
+               &output[vectorized_count >> 1]);
+}
+
+inline void Encode(std::uint8_t const* const input,
+                   std::int64_t const byte_count,
+                   std::uint8_t* const output) {
+  switch (SupportedInstructionSet()) {
+    case InstructionSet::AVX2:
+      return EncodeAVX2(input, byte_count, output);
+    case InstructionSet::SSSE3:
+      return EncodeSSSE3(input, byte_count, output);
+    case InstructionSet::Scalar:
+      return EncodeScalar(input, byte_count, output);
+  }
+}
+
+inline void Decode(std::uint8_t const* const input,
+                   std::int64_t const digit_count,
+                   std::uint8_t* const output) {
+  switch (SupportedInstructionSet()) {
+    case InstructionSet::AVX2:
+      return DecodeAVX2(input, digit_count, output);
+    case InstructionSet::SSSE3:
+      return DecodeSSSE3(input, digit_count, output);
+    case InstructionSet::Scalar:
+      return DecodeScalar(input, digit_count, output);
+  }
+}
+
+}  // namespace internal_hexadecimal
+
 void HexadecimalEncode(Array<std::uint8_t const> input,
                        Array<std::uint8_t> output) {
   CHECK_NOTNULL(input.data);
@@ -49,14 +293,7 @@ void HexadecimalEncode(Array<std::uint8_t const> input,
   CHECK(input.data <= &output.data[1] ||
         &output.data[input.size << 1] <= input.data) << "bad overlap";
   CHECK_GE(output.size, input.size << 1) << "output too small";
-  // We want the result to start at |output.data[0]|.
-  output.data = output.data + ((input.size - 1) << 1);
-  input.data = input.data + input.size - 1;
-  for (std::uint8_t const* const input_rend = input.data - input.size;
-       input.data != input_rend;
-       --input.data, output.data -= 2) {
-    std::memcpy(output.data, &byte_to_hexadecimal_digits[*input.data << 1], 2);
-  }
+  internal_hexadecimal::Encode(input.data, input.size, output.data);
 }
 
 void HexadecimalDecode(Array<std::uint8_t const> input,
@@ -72,12 +309,7 @@ void HexadecimalDecode(Array<std::uint8_t const> input,
   CHECK(output.data <= &input.data[1] ||
         &input.data[input.size] <= output.data) << "bad overlap";
   CHECK_GE(output.size, input.size / 2) << "output too small";
-  for (std::uint8_t const* const input_end = input.data + input.size;
-       input.data != input_end;
-       input.data += 2, ++output.data) {
-    *output.data = (hexadecimal_digits_to_nibble[*input.data] << 4) |
-                   hexadecimal_digits_to_nibble[*(input.data + 1)];
-  }
+  internal_hexadecimal::Decode(input.data, input.size, output.data);
 }
 
 }  // namespace base
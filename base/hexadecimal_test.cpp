@@ -1,7 +1,9 @@
 ﻿
 #include "base/hexadecimal.hpp"
 
+#include <functional>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -11,6 +13,7 @@
 
 using testing::Each;
 using testing::ElementsAre;
+using testing::ElementsAreArray;
 
 namespace principia {
 namespace base {
@@ -154,5 +157,83 @@ TEST_F(HexadecimalTest, Invalid) {
   EXPECT_THAT(bytes, ElementsAre('\x0A', '\x0C', '\xDE'));
 }
 
+// Checks that the vectorized implementations supported by this processor
+// agree with the scalar one, for all the sizes that exercise both the blocks
+// and the remainders, for all the bytes, and for arbitrary characters on
+// decode.
+TEST_F(HexadecimalTest, Vectorized) {
+  using Implementation = std::function<void(std::uint8_t const* input,
+                                            std::int64_t size,
+                                            std::uint8_t* output)>;
+  std::vector<Implementation> encoders;
+  std::vector<Implementation> decoders;
+  switch (internal_hexadecimal::SupportedInstructionSet()) {
+    case internal_hexadecimal::InstructionSet::AVX2:
+      encoders.push_back(&internal_hexadecimal::EncodeAVX2);
+      decoders.push_back(&internal_hexadecimal::DecodeAVX2);
+      [[fallthrough]];
+    case internal_hexadecimal::InstructionSet::SSSE3:
+      encoders.push_back(&internal_hexadecimal::EncodeSSSE3);
+      decoders.push_back(&internal_hexadecimal::DecodeSSSE3);
+      [[fallthrough]];
+    case internal_hexadecimal::InstructionSet::Scalar:
+      break;
+  }
+
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  for (std::int64_t byte_count = 0; byte_count <= 300; ++byte_count) {
+    std::vector<std::uint8_t> bytes(byte_count);
+    for (std::int64_t i = 0; i < byte_count; ++i) {
+      // Make sure that all the bytes are seen.
+      bytes[i] = byte_count == 256 ? i : byte_distribution(random);
+    }
+    std::vector<std::uint8_t> expected_digits(byte_count << 1);
+    internal_hexadecimal::EncodeScalar(
+        bytes.data(), byte_count, expected_digits.data());
+    // Characters that are digits in either case, with some invalid ones.
+    std::vector<std::uint8_t> characters(byte_count << 1);
+    for (auto& character : characters) {
+      character = byte_distribution(random) < 32
+                      ? byte_distribution(random)
+                      : "0123456789ABCDEFabcdef"[byte_distribution(random) %
+                                                  22];
+    }
+    std::vector<std::uint8_t> expected_bytes(byte_count);
+    internal_hexadecimal::DecodeScalar(
+        characters.data(), byte_count << 1, expected_bytes.data());
+
+    for (auto const& encode : encoders) {
+      std::vector<std::uint8_t> digits(byte_count << 1);
+      encode(bytes.data(), byte_count, digits.data());
+      EXPECT_THAT(digits, ElementsAreArray(expected_digits)) << byte_count;
+      // In place, with the input at |&output[0]| and |&output[1]|.
+      for (int offset : {0, 1}) {
+        std::vector<std::uint8_t> buffer((byte_count << 1) + 1);
+        std::copy(bytes.begin(), bytes.end(), buffer.begin() + offset);
+        encode(&buffer[offset], byte_count, &buffer[0]);
+        EXPECT_THAT(std::vector<std::uint8_t>(
+                        buffer.begin(), buffer.begin() + (byte_count << 1)),
+                    ElementsAreArray(expected_digits)) << byte_count;
+      }
+    }
+    for (auto const& decode : decoders) {
+      std::vector<std::uint8_t> decoded(byte_count);
+      decode(characters.data(), byte_count << 1, decoded.data());
+      EXPECT_THAT(decoded, ElementsAreArray(expected_bytes)) << byte_count;
+      // In place, with the output at |&input[0]| and |&input[1]|.
+      for (int offset : {0, 1}) {
+        std::vector<std::uint8_t> buffer = characters;
+        buffer.push_back(0);
+        decode(&buffer[0], byte_count << 1, &buffer[offset]);
+        EXPECT_THAT(std::vector<std::uint8_t>(
+                        buffer.begin() + offset,
+                        buffer.begin() + offset + byte_count),
+                    ElementsAreArray(expected_bytes)) << byte_count;
+      }
+    }
+  }
+}
+
 }  // namespace base
 }  // namespace principia
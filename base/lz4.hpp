@@ -0,0 +1,42 @@
+﻿
+#pragma once
+
+#include <cstdint>
+
+#include "base/array.hpp"
+
+namespace principia {
+namespace base {
+namespace internal_lz4 {
+
+// A compressor and decompressor for the LZ4 block format, see
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md.  The
+// compressor is a simple greedy one which favours speed over compression
+// ratio.  The data of the arrays passed to these functions may only be null if
+// their size is 0.
+
+// An upper bound on the size of the compression of |size| bytes.
+constexpr std::int64_t LZ4CompressedSizeBound(std::int64_t size);
+
+// Compresses |input| into |output| and returns the size of the compressed
+// data.  |output.size| must be at least |LZ4CompressedSizeBound(input.size)|.
+// |input.size| must be less than 2^31.  The input and output must not overlap.
+inline std::int64_t LZ4Compress(Array<std::uint8_t const> input,
+                                Array<std::uint8_t> output);
+
+// Decompresses |input| into |output| and returns the size of the decompressed
+// data.  Fails if |input| is malformed or if |output| is too small.  The input
+// and output must not overlap.
+inline std::int64_t LZ4Decompress(Array<std::uint8_t const> input,
+                                  Array<std::uint8_t> output);
+
+}  // namespace internal_lz4
+
+using internal_lz4::LZ4CompressedSizeBound;
+using internal_lz4::LZ4Compress;
+using internal_lz4::LZ4Decompress;
+
+}  // namespace base
+}  // namespace principia
+
+#include "base/lz4_body.hpp"
@@ -0,0 +1,198 @@
+﻿
+#pragma once
+
+#include "base/lz4.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+namespace internal_lz4 {
+
+// The parameters of the format.
+constexpr std::int64_t min_match = 4;
+constexpr std::int64_t max_offset = (1 << 16) - 1;
+// The last literals of a block, and the last bytes before the end of a block
+// where a match may start.
+constexpr std::int64_t last_literals = 5;
+constexpr std::int64_t match_start_limit = 12;
+// The maximal value of each of the lengths stored in a token.
+constexpr int token_length_mask = 0xF;
+
+// The parameters of the compressor: the number of entries of the hash table,
+// and how fast the search accelerates when no match is found.
+constexpr int hash_log = 12;
+constexpr int skip_log = 6;
+
+inline std::uint32_t Read32(std::uint8_t const* const p) {
+  std::uint32_t result;
+  std::memcpy(&result, p, sizeof(result));
+  return result;
+}
+
+inline int Hash(std::uint32_t const sequence) {
+  return (sequence * 2654435761u) >> (32 - hash_log);
+}
+
+// Writes the part of a length that doesn't fit in a token.
+inline std::uint8_t* WriteLength(std::int64_t length, std::uint8_t* output) {
+  for (; length >= 0xFF; length -= 0xFF) {
+    *output++ = 0xFF;
+  }
+  *output++ = static_cast<std::uint8_t>(length);
+  return output;
+}
+
+// Reads the part of a length that doesn't fit in a token and adds it to
+// |length|.
+inline std::int64_t ReadLength(Array<std::uint8_t const> const input,
+                               std::int64_t& position,
+                               std::int64_t length) {
+  std::uint8_t byte;
+  do {
+    CHECK_LT(position, input.size) << "truncated length";
+    byte = input.data[position++];
+    length += byte;
+  } while (byte == 0xFF);
+  return length;
+}
+
+// Writes a sequence made of the literals [literals, match[ and, unless
+// |match_length| is 0, of a match of |match_length| bytes at |offset|.
+inline std::uint8_t* WriteSequence(std::uint8_t const* const literals,
+                                   std::uint8_t const* const match,
+                                   std::int64_t const offset,
+                                   std::int64_t const match_length,
+                                   std::uint8_t* output) {
+  std::int64_t const literal_length = match - literals;
+  std::uint8_t* const token = output++;
+  *token = std::min<std::int64_t>(literal_length, token_length_mask) << 4;
+  if (literal_length >= token_length_mask) {
+    output = WriteLength(literal_length - token_length_mask, output);
+  }
+  if (literal_length > 0) {
+    std::memcpy(output, literals, literal_length);
+    output += literal_length;
+  }
+  if (match_length > 0) {
+    *output++ = static_cast<std::uint8_t>(offset);
+    *output++ = static_cast<std::uint8_t>(offset >> 8);
+    std::int64_t const stored_length = match_length - min_match;
+    *token |= std::min<std::int64_t>(stored_length, token_length_mask);
+    if (stored_length >= token_length_mask) {
+      output = WriteLength(stored_length - token_length_mask, output);
+    }
+  }
+  return output;
+}
+
+constexpr std::int64_t LZ4CompressedSizeBound(std::int64_t const size) {
+  return size + size / 255 + 16;
+}
+
+std::int64_t LZ4Compress(Array<std::uint8_t const> const input,
+                         Array<std::uint8_t> const output) {
+  CHECK(input.data != nullptr || input.size == 0);
+  CHECK(output.data != nullptr || output.size == 0);
+  CHECK_LT(input.size, std::int64_t{1} << 31);
+  CHECK_GE(output.size, LZ4CompressedSizeBound(input.size))
+      << "output too small";
+
+  std::uint8_t const* const begin = input.data;
+  std::uint8_t const* const end = input.data + input.size;
+  std::uint8_t const* anchor = begin;
+  std::uint8_t* out = output.data;
+
+  if (input.size > match_start_limit) {
+    // The positions, relative to |begin|, of the last sequences of
+    // |min_match| bytes having a given hash, or -1.
+    std::array<std::int32_t, 1 << hash_log> positions;
+    positions.fill(-1);
+    std::uint8_t const* const match_start_end = end - match_start_limit;
+    std::uint8_t const* const match_end_limit = end - last_literals;
+    std::uint8_t const* p = begin;
+    while (p <= match_start_end) {
+      std::uint32_t const sequence = Read32(p);
+      std::int32_t& position = positions[Hash(sequence)];
+      std::uint8_t const* const candidate =
+          position >= 0 ? begin + position : nullptr;
+      position = static_cast<std::int32_t>(p - begin);
+      if (candidate == nullptr ||
+          p - candidate > max_offset ||
+          Read32(candidate) != sequence) {
+        p += 1 + ((p - anchor) >> skip_log);
+        continue;
+      }
+      std::uint8_t const* match_end = p + min_match;
+      std::uint8_t const* candidate_end = candidate + min_match;
+      while (match_end < match_end_limit && *match_end == *candidate_end) {
+        ++match_end;
+        ++candidate_end;
+      }
+      out = WriteSequence(anchor, p, p - candidate, match_end - p, out);
+      p = anchor = match_end;
+    }
+  }
+  out = WriteSequence(anchor, end, /*offset=*/0, /*match_length=*/0, out);
+  return out - output.data;
+}
+
+std::int64_t LZ4Decompress(Array<std::uint8_t const> const input,
+                           Array<std::uint8_t> const output) {
+  CHECK(input.data != nullptr || input.size == 0);
+  CHECK(output.data != nullptr || output.size == 0);
+  std::int64_t in = 0;
+  std::int64_t out = 0;
+  for (;;) {
+    CHECK_LT(in, input.size) << "truncated sequence";
+    std::uint8_t const token = input.data[in++];
+
+    std::int64_t literal_length = token >> 4;
+    if (literal_length == token_length_mask) {
+      literal_length = ReadLength(input, in, literal_length);
+    }
+    CHECK_LE(literal_length, input.size - in) << "truncated literals";
+    CHECK_LE(literal_length, output.size - out) << "output too small";
+    if (literal_length > 0) {
+      std::memcpy(&output.data[out], &input.data[in], literal_length);
+      in += literal_length;
+      out += literal_length;
+    }
+    // The last sequence has no match.
+    if (in == input.size) {
+      return out;
+    }
+
+    CHECK_LE(2, input.size - in) << "truncated offset";
+    std::int64_t const offset = input.data[in] | (input.data[in + 1] << 8);
+    in += 2;
+    CHECK_LT(0, offset) << "bad offset";
+    CHECK_LE(offset, out) << "bad offset";
+    std::int64_t match_length = token & token_length_mask;
+    if (match_length == token_length_mask) {
+      match_length = ReadLength(input, in, match_length);
+    }
+    match_length += min_match;
+    CHECK_LE(match_length, output.size - out) << "output too small";
+    // The match may overlap the bytes being written, in which case it must be
+    // copied byte by byte to repeat them.
+    if (offset >= match_length) {
+      std::memcpy(&output.data[out], &output.data[out - offset], match_length);
+      out += match_length;
+    } else {
+      for (std::int64_t const match_end = out + match_length;
+           out != match_end;
+           ++out) {
+        output.data[out] = output.data[out - offset];
+      }
+    }
+  }
+}
+
+}  // namespace internal_lz4
+}  // namespace base
+}  // namespace principia
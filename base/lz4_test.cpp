@@ -0,0 +1,117 @@
+﻿
+#include "base/lz4.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace principia {
+namespace base {
+
+using ::testing::ElementsAreArray;
+
+class LZ4Test : public ::testing::Test {
+ protected:
+  // Compresses and decompresses |bytes|, checks that the result is |bytes|,
+  // and returns the compressed size.
+  std::int64_t RoundTrip(std::vector<std::uint8_t> const& bytes) {
+    std::vector<std::uint8_t> compressed(LZ4CompressedSizeBound(bytes.size()));
+    std::int64_t const compressed_size =
+        LZ4Compress({bytes.data(), bytes.size()},
+                    {compressed.data(), compressed.size()});
+    EXPECT_LE(compressed_size, LZ4CompressedSizeBound(bytes.size()));
+    std::vector<std::uint8_t> decompressed(bytes.size());
+    EXPECT_EQ(bytes.size(),
+              LZ4Decompress({compressed.data(), compressed_size},
+                            {decompressed.data(), decompressed.size()}));
+    EXPECT_THAT(decompressed, ElementsAreArray(bytes));
+    return compressed_size;
+  }
+};
+
+using LZ4DeathTest = LZ4Test;
+
+TEST_F(LZ4Test, Empty) {
+  // The data of an empty vector may be null.
+  EXPECT_EQ(1, RoundTrip({}));
+}
+
+TEST_F(LZ4Test, Small) {
+  for (int size = 1; size <= 20; ++size) {
+    std::vector<std::uint8_t> bytes(size, 'x');
+    RoundTrip(bytes);
+  }
+}
+
+TEST_F(LZ4Test, Redundant) {
+  std::string text;
+  for (int i = 0; i < 1000; ++i) {
+    text += "Principia is a mod for Kerbal Space Program " +
+            std::to_string(i % 17) + "\n";
+  }
+  std::vector<std::uint8_t> const bytes(text.begin(), text.end());
+  EXPECT_GT(bytes.size() / 10, RoundTrip(bytes));
+
+  // Long runs exercise the overlapping matches and the long lengths.
+  std::vector<std::uint8_t> runs(100'000, 0);
+  std::fill(runs.begin() + 50'000, runs.end(), 0xAB);
+  EXPECT_GT(1000, RoundTrip(runs));
+}
+
+TEST_F(LZ4Test, Random) {
+  std::mt19937_64 random(42);
+  std::uniform_int_distribution<int> byte_distribution(0, 255);
+  for (int const size : {13, 100, 1000, 70'000, 200'000}) {
+    std::vector<std::uint8_t> bytes(size);
+    for (auto& byte : bytes) {
+      byte = byte_distribution(random);
+    }
+    RoundTrip(bytes);
+    // Random bytes with repeated blocks, some farther apart than the maximal
+    // offset.
+    for (int i = 1000; i + 100 < size; i += 3000) {
+      std::copy(bytes.begin(), bytes.begin() + 100, bytes.begin() + i);
+    }
+    RoundTrip(bytes);
+  }
+}
+
+// A block written by hand following the specification of the format.
+TEST_F(LZ4Test, Format) {
+  // A literal, a match of 20 bytes at offset 1, and the last literals.
+  std::vector<std::uint8_t> const compressed = {
+      0x1F, 'a', 0x01, 0x00, 0x01, 0x50, 'b', 'c', 'd', 'e', 'f'};
+  std::vector<std::uint8_t> decompressed(26);
+  EXPECT_EQ(26,
+            LZ4Decompress({compressed.data(), compressed.size()},
+                          {decompressed.data(), decompressed.size()}));
+  EXPECT_EQ(std::string(21, 'a') + "bcdef",
+            std::string(decompressed.begin(), decompressed.end()));
+}
+
+TEST_F(LZ4DeathTest, Malformed) {
+  std::vector<std::uint8_t> const bad_offset = {
+      0x1F, 'a', 0x02, 0x00, 0x01, 0x50, 'b', 'c', 'd', 'e', 'f'};
+  std::vector<std::uint8_t> const truncated = {0x1F, 'a', 0x01};
+  std::vector<std::uint8_t> const valid = {
+      0x1F, 'a', 0x01, 0x00, 0x01, 0x50, 'b', 'c', 'd', 'e', 'f'};
+  std::vector<std::uint8_t> decompressed(26);
+  EXPECT_DEATH({
+    LZ4Decompress({bad_offset.data(), bad_offset.size()},
+                  {decompressed.data(), decompressed.size()});
+  }, "bad offset");
+  EXPECT_DEATH({
+    LZ4Decompress({truncated.data(), truncated.size()},
+                  {decompressed.data(), decompressed.size()});
+  }, "truncated offset");
+  EXPECT_DEATH({
+    LZ4Decompress({valid.data(), valid.size()},
+                  {decompressed.data(), decompressed.size() - 1});
+  }, "output too small");
+}
+
+}  // namespace base
+}  // namespace principia
@@ -133,6 +133,20 @@ inline void noreturn() { std::exit(0); }
 #  error "What compiler is this?"
 #endif
 
+// Used to compile a function for an instruction set extension, e.g.,
+// |TARGET("avx2")|, so that it may use the corresponding intrinsics.  Such a
+// function must only be called after checking at runtime that the processor
+// supports the extension.  MSVC accepts the intrinsics in any function.
+#if PRINCIPIA_COMPILER_CLANG    ||  \
+    PRINCIPIA_COMPILER_CLANG_CL ||  \
+    PRINCIPIA_COMPILER_GCC
+#  define TARGET(extension) __attribute__((target(extension)))
+#elif PRINCIPIA_COMPILER_MSVC
+#  define TARGET(extension)
+#else
+#  error "What compiler is this?"
+#endif
+
 // Used to emit the function signature.
 #if PRINCIPIA_COMPILER_CLANG    ||  \
     PRINCIPIA_COMPILER_CLANG_CL ||  \
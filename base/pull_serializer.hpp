@@ -3,21 +3,43 @@
 
 #include <cstdint>
 #include <condition_variable>
+#include <functional>
+#include <future>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <thread>
+#include <vector>
 
 #include "base/array.hpp"
 #include "base/macros.hpp"
 #include "base/not_null.hpp"
 #include "google/protobuf/message.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 
 namespace principia {
 namespace base {
 namespace internal_pull_serializer {
 
+// The first bytes of a compressed serialization, followed by a byte identifying
+// the |Compressor|.  The first byte is not a valid protocol buffer tag (its
+// wire type is 7), so a compressed serialization cannot be mistaken for an
+// uncompressed one.
+constexpr char compressed_serialization_magic[] = "\x8FPRINCIPIA\n";
+
+// How the serialization produced by a |PullSerializer| is compressed.
+enum class Compressor : std::uint8_t {
+  // The serialization is that of the message, with no header.
+  None = 0,
+  // After the header, the serialization is made of frames, each giving the
+  // size of the uncompressed data and the size of the compressed data as
+  // varints, followed by the data compressed in the LZ4 block format.  If both
+  // sizes are equal the data is not compressed.  The last frame has an
+  // uncompressed size of 0 and nothing else.
+  LZ4 = 1,
+};
+
 // An output stream based on an array that delegates to a function the handling
 // of the case where one array is full.  It calls the |on_full| function passed
 // at construction and proceeds with filling the array returned by that
@@ -55,11 +77,21 @@ class DelegatingArrayOutputStream
 // irrespective of the size of the message to serialize.
 class PullSerializer final {
  public:
+  // A part of the message to serialize.  Calling it starts the construction of
+  // the part, which is obtained from the returned future.
+  using Part = std::function<
+      std::future<std::unique_ptr<google::protobuf::Message const>>()>;
+
   // The |size| of the data objects returned by |Pull| are never greater than
   // |chunk_size|.  At most |number_of_chunks| chunks are held in the internal
   // queue.  This class uses at most
-  // |number_of_chunks * (chunk_size + O(1)) + O(1)| bytes.
-  PullSerializer(int chunk_size, int number_of_chunks);
+  // |number_of_chunks * (chunk_size + O(1)) + O(1)| bytes, plus
+  // |2 * chunk_size + O(1)| bytes when compressing.  The compression happens
+  // on the serialization thread, one frame per |chunk_size| bytes of
+  // uncompressed data.
+  PullSerializer(int chunk_size,
+                 int number_of_chunks,
+                 Compressor compressor = Compressor::None);
   ~PullSerializer();
 
   // Starts the serializer, which will proceed to serialize |message|.  This
@@ -67,6 +99,16 @@ class PullSerializer final {
   void Start(
       not_null<std::unique_ptr<google::protobuf::Message const>> message);
 
+  // Starts the serializer, which will proceed to serialize the |parts| in
+  // order, each as soon as it is available, and destroy it once serialized.
+  // At most |max_pending_parts| parts are started but not yet serialized at
+  // any time, so that the parts are constructed no faster than they are
+  // consumed.  The parts must be messages of the same type, and the result is
+  // the serialization of the message obtained by merging them in order.  The
+  // parts need not be initialized.  This method must be called at most once
+  // for each serializer object.
+  void Start(std::vector<Part> parts, int max_pending_parts);
+
   // Obtain the next chunk of data from the serializer.  Blocks if no data is
   // available.  Returns a |Bytes| object of |size| 0 at the end of the
   // serialization.  The returned object may become invalid the next time |Pull|
@@ -79,10 +121,30 @@ class PullSerializer final {
   // underlying |DelegatingArrayOutputStream|.
   Bytes Push(Bytes bytes);
 
+  // Pushes an empty chunk to signal the end of the serialization to |Pull|.
+  void PushEnd();
+
+  // Calls |serialize| to write the serialization to a stream, compresses it if
+  // needed, and signals the end of the serialization.
+  void Serialize(
+      std::function<void(google::protobuf::io::ZeroCopyOutputStream& stream)>
+          const& serialize);
+
+  // Compresses |bytes| and writes the resulting frame to |stream|.
+  void WriteFrame(Bytes bytes,
+                  google::protobuf::io::CodedOutputStream& stream);
+
   std::unique_ptr<google::protobuf::Message const> message_;
+  std::vector<Part> parts_;
 
   int const chunk_size_;
   int const number_of_chunks_;
+  Compressor const compressor_;
+
+  // The uncompressed data of a frame, and its compression.  Only allocated
+  // when compressing.
+  UniqueBytes uncompressed_;
+  UniqueBytes compressed_;
 
   // The array supporting the stream and the stream itself.
   std::unique_ptr<std::uint8_t[]> data_;
@@ -110,6 +172,8 @@ class PullSerializer final {
 
 }  // namespace internal_pull_serializer
 
+using internal_pull_serializer::compressed_serialization_magic;
+using internal_pull_serializer::Compressor;
 using internal_pull_serializer::PullSerializer;
 
 }  // namespace base
@@ -4,6 +4,9 @@
 #include "base/pull_serializer.hpp"
 
 #include <algorithm>
+#include <deque>
+
+#include "base/lz4.hpp"
 
 namespace principia {
 namespace base {
@@ -61,9 +64,11 @@ inline std::int64_t DelegatingArrayOutputStream::ByteCount() const {
 }
 
 inline PullSerializer::PullSerializer(int const chunk_size,
-                                      int const number_of_chunks)
+                                      int const number_of_chunks,
+                                      Compressor const compressor)
     : chunk_size_(chunk_size),
       number_of_chunks_(number_of_chunks),
+      compressor_(compressor),
       data_(std::make_unique<std::uint8_t[]>(chunk_size_ * number_of_chunks_)),
       stream_(Bytes(data_.get(), chunk_size_),
               std::bind(&PullSerializer::Push, this, _1)) {
@@ -74,6 +79,10 @@ inline PullSerializer::PullSerializer(int const chunk_size,
     free_.push(data_.get() + i * chunk_size_);
   }
   queue_.push(Bytes(data_.get() + (number_of_chunks_ - 1) * chunk_size_, 0));
+  if (compressor_ != Compressor::None) {
+    uncompressed_ = UniqueBytes(chunk_size_);
+    compressed_ = UniqueBytes(LZ4CompressedSizeBound(chunk_size_));
+  }
 }
 
 inline PullSerializer::~PullSerializer() {
@@ -87,16 +96,44 @@ inline void PullSerializer::Start(
   CHECK(thread_ == nullptr);
   message_ = std::move(message);
   thread_ = std::make_unique<std::thread>([this](){
-    CHECK(message_->SerializeToZeroCopyStream(&stream_));
-    // Put a sentinel at the end of the serialized stream so that the client
-    // knows that this is the end.
-    Bytes bytes;
-    {
-      std::unique_lock<std::mutex> l(lock_);
-      CHECK(!free_.empty());
-      bytes = Bytes(free_.front(), 0);
-    }
-    Push(bytes);
+    Serialize([this](google::protobuf::io::ZeroCopyOutputStream& stream) {
+      CHECK(message_->SerializeToZeroCopyStream(&stream));
+    });
+  });
+}
+
+inline void PullSerializer::Start(std::vector<Part> parts,
+                                  int const max_pending_parts) {
+  CHECK(thread_ == nullptr);
+  CHECK_LT(0, max_pending_parts);
+  parts_ = std::move(parts);
+  thread_ = std::make_unique<std::thread>([this, max_pending_parts](){
+    Serialize([this, max_pending_parts](
+                  google::protobuf::io::ZeroCopyOutputStream& stream) {
+      // A single coded stream for all the parts, so that the chunks are filled
+      // across the boundaries between parts.
+      google::protobuf::io::CodedOutputStream coded_stream(&stream);
+      // The parts that have been started, in order; a part is started when the
+      // one |max_pending_parts| before it has been serialized.
+      std::deque<std::future<std::unique_ptr<google::protobuf::Message const>>>
+          pending_parts;
+      auto const max_pending_size =
+          static_cast<std::size_t>(max_pending_parts);
+      auto next_part = parts_.begin();
+      while (next_part != parts_.end() || !pending_parts.empty()) {
+        while (next_part != parts_.end() &&
+               pending_parts.size() < max_pending_size) {
+          pending_parts.push_back((*next_part)());
+          *next_part = nullptr;
+          ++next_part;
+        }
+        std::unique_ptr<google::protobuf::Message const> const message =
+            pending_parts.front().get();
+        pending_parts.pop_front();
+        CHECK(message->SerializePartialToCodedStream(&coded_stream));
+      }
+    });
+    parts_.clear();
   });
 }
 
@@ -138,6 +175,66 @@ inline Bytes PullSerializer::Push(Bytes const bytes) {
   return result;
 }
 
+inline void PullSerializer::PushEnd() {
+  // Put a sentinel at the end of the serialized stream so that the client
+  // knows that this is the end.
+  Bytes bytes;
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    CHECK(!free_.empty());
+    bytes = Bytes(free_.front(), 0);
+  }
+  Push(bytes);
+}
+
+inline void PullSerializer::Serialize(
+    std::function<void(google::protobuf::io::ZeroCopyOutputStream& stream)>
+        const& serialize) {
+  switch (compressor_) {
+    case Compressor::None:
+      serialize(stream_);
+      break;
+    case Compressor::LZ4: {
+      google::protobuf::io::CodedOutputStream compressed_stream(&stream_);
+      compressed_stream.WriteRaw(compressed_serialization_magic,
+                                 sizeof(compressed_serialization_magic) - 1);
+      std::uint8_t const compressor = static_cast<std::uint8_t>(compressor_);
+      compressed_stream.WriteRaw(&compressor, sizeof(compressor));
+      {
+        // Each time this stream is full, or at the end of the serialization,
+        // its contents are compressed into a frame.
+        DelegatingArrayOutputStream uncompressed_stream(
+            uncompressed_.get(),
+            [this, &compressed_stream](Bytes const bytes) {
+              WriteFrame(bytes, compressed_stream);
+              return uncompressed_.get();
+            });
+        serialize(uncompressed_stream);
+      }
+      compressed_stream.WriteVarint32(0);
+      CHECK(!compressed_stream.HadError());
+      break;
+    }
+  }
+  PushEnd();
+}
+
+inline void PullSerializer::WriteFrame(
+    Bytes const bytes,
+    google::protobuf::io::CodedOutputStream& stream) {
+  CHECK_LT(0, bytes.size);
+  std::int64_t const compressed_size = LZ4Compress(bytes, compressed_.get());
+  stream.WriteVarint32(bytes.size);
+  if (compressed_size < bytes.size) {
+    stream.WriteVarint32(compressed_size);
+    stream.WriteRaw(compressed_.data.get(), compressed_size);
+  } else {
+    // Incompressible data is stored as is.
+    stream.WriteVarint32(bytes.size);
+    stream.WriteRaw(bytes.data, bytes.size);
+  }
+}
+
 }  // namespace internal_pull_serializer
 }  // namespace base
 }  // namespace principia
@@ -1,12 +1,16 @@
 ﻿
 #include "base/pull_serializer.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <future>
 #include <list>
 #include <string>
 #include <vector>
 
+#include "base/lz4.hpp"
 #include "gmock/gmock.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "serialization/physics.pb.h"
 
 namespace principia {
@@ -118,6 +122,139 @@ TEST_F(PullSerializerTest, SerializationSizes) {
   EXPECT_THAT(actual_sizes, ElementsAreArray(expected_sizes));
 }
 
+TEST_F(PullSerializerTest, SerializationOfParts) {
+  auto const trajectory = BuildTrajectory();
+
+  // Split the trajectory in parts which are built concurrently.
+  std::vector<PullSerializer::Part> parts;
+  for (int i = 0; i < trajectory->timeline_size(); i += 10) {
+    parts.push_back([i, &trajectory]() {
+      return std::async(
+          std::launch::async,
+          [i, &trajectory]()
+              -> std::unique_ptr<google::protobuf::Message const> {
+            auto part = std::make_unique<DiscreteTrajectory>();
+            for (int j = i; j < i + 10; ++j) {
+              *part->add_timeline() = trajectory->timeline(j);
+            }
+            return std::move(part);
+          });
+    });
+  }
+  pull_serializer_->Start(std::move(parts), /*max_pending_parts=*/4);
+
+  std::string serialized_trajectory;
+  std::vector<std::int64_t> actual_sizes;
+  for (;;) {
+    Bytes const bytes = pull_serializer_->Pull();
+    if (bytes.size == 0) {
+      break;
+    }
+    actual_sizes.push_back(bytes.size);
+    serialized_trajectory.append(reinterpret_cast<char const*>(bytes.data),
+                                 static_cast<std::size_t>(bytes.size));
+  }
+
+  // The chunks are filled across the boundaries between parts.
+  std::vector<std::int64_t> expected_sizes(53, chunk_size);
+  expected_sizes.push_back(53);
+  EXPECT_THAT(actual_sizes, ElementsAreArray(expected_sizes));
+  EXPECT_EQ(trajectory->SerializeAsString(), serialized_trajectory);
+}
+
+TEST_F(PullSerializerTest, PendingParts) {
+  auto const trajectory = BuildTrajectory();
+
+  // The parts are built when the serializer waits for them, so a part is
+  // pending from the time it is started until it is serialized.
+  int pending_parts = 0;
+  int max_pending_parts = 0;
+  std::vector<PullSerializer::Part> parts;
+  for (int i = 0; i < trajectory->timeline_size(); i += 10) {
+    parts.push_back([i, &trajectory, &pending_parts, &max_pending_parts]() {
+      max_pending_parts = std::max(max_pending_parts, ++pending_parts);
+      return std::async(
+          std::launch::deferred,
+          [i, &trajectory, &pending_parts]()
+              -> std::unique_ptr<google::protobuf::Message const> {
+            --pending_parts;
+            auto part = std::make_unique<DiscreteTrajectory>();
+            for (int j = i; j < i + 10; ++j) {
+              *part->add_timeline() = trajectory->timeline(j);
+            }
+            return std::move(part);
+          });
+    });
+  }
+  pull_serializer_->Start(std::move(parts), /*max_pending_parts=*/3);
+
+  std::string serialized_trajectory;
+  for (;;) {
+    Bytes const bytes = pull_serializer_->Pull();
+    if (bytes.size == 0) {
+      break;
+    }
+    serialized_trajectory.append(reinterpret_cast<char const*>(bytes.data),
+                                 static_cast<std::size_t>(bytes.size));
+  }
+
+  EXPECT_EQ(3, max_pending_parts);
+  EXPECT_EQ(0, pending_parts);
+  EXPECT_EQ(trajectory->SerializeAsString(), serialized_trajectory);
+}
+
+TEST_F(PullSerializerTest, CompressedSerialization) {
+  auto const trajectory = BuildTrajectory();
+  std::string const uncompressed = trajectory->SerializeAsString();
+  pull_serializer_ = std::make_unique<PullSerializer>(
+      chunk_size, number_of_chunks, Compressor::LZ4);
+  pull_serializer_->Start(BuildTrajectory());
+
+  std::string compressed;
+  for (;;) {
+    Bytes const bytes = pull_serializer_->Pull();
+    if (bytes.size == 0) {
+      break;
+    }
+    EXPECT_GE(chunk_size, bytes.size);
+    compressed.append(reinterpret_cast<char const*>(bytes.data),
+                      static_cast<std::size_t>(bytes.size));
+  }
+  EXPECT_GT(uncompressed.size(), compressed.size());
+
+  // Decode the header and the frames by hand.
+  std::string const header = std::string(compressed_serialization_magic) +
+                             static_cast<char>(Compressor::LZ4);
+  EXPECT_EQ(header, compressed.substr(0, header.size()));
+  google::protobuf::io::CodedInputStream stream(
+      reinterpret_cast<std::uint8_t const*>(compressed.data()),
+      static_cast<int>(compressed.size()));
+  EXPECT_TRUE(stream.Skip(header.size()));
+  std::string decompressed;
+  for (;;) {
+    std::uint32_t uncompressed_size;
+    ASSERT_TRUE(stream.ReadVarint32(&uncompressed_size));
+    if (uncompressed_size == 0) {
+      break;
+    }
+    // Each frame holds one chunk of uncompressed data.
+    EXPECT_GE(chunk_size, uncompressed_size);
+    std::uint32_t compressed_size;
+    ASSERT_TRUE(stream.ReadVarint32(&compressed_size));
+    std::string frame;
+    ASSERT_TRUE(stream.ReadString(&frame, compressed_size));
+    std::vector<std::uint8_t> bytes(uncompressed_size);
+    EXPECT_EQ(uncompressed_size,
+              LZ4Decompress(
+                  {reinterpret_cast<std::uint8_t const*>(frame.data()),
+                   frame.size()},
+                  {bytes.data(), bytes.size()}));
+    decompressed.append(bytes.begin(), bytes.end());
+  }
+  EXPECT_EQ(compressed.size(), stream.CurrentPosition());
+  EXPECT_EQ(uncompressed, decompressed);
+}
+
 TEST_F(PullSerializerTest, SerializationThreading) {
   DiscreteTrajectory read_trajectory;
   auto const trajectory = BuildTrajectory();
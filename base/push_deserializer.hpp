@@ -12,6 +12,7 @@
 #include "base/macros.hpp"
 #include "base/not_null.hpp"
 #include "google/protobuf/message.h"
+#include "google/protobuf/io/coded_stream.h"
 #include "google/protobuf/io/zero_copy_stream.h"
 
 namespace principia {
@@ -49,7 +50,8 @@ class DelegatingArrayInputStream
 // deserialization, and finally destroys the |PushDeserializer|.
 // |PushDeserializer| is intended for use in memory-critical contexts as it
 // bounds the amount of memory used irrespective of the size of the message to
-// deserialize.
+// deserialize.  The data may be compressed by any of the compressors supported
+// by |PullSerializer|, which is detected from its header.
 class PushDeserializer final {
  public:
   // The |size| of the data chunks sent to |Pull| are never greater than
@@ -67,6 +69,19 @@ class PushDeserializer final {
   void Start(not_null<std::unique_ptr<google::protobuf::Message>> message,
              std::function<void(google::protobuf::Message const&)> done);
 
+  // Starts the deserializer, which will proceed to deserialize data into
+  // successive parts, each of them a message of the type of |prototype| where
+  // only one top-level field is set (for a repeated field, only one element of
+  // that field).  |on_part| is called for each part as soon as it has been
+  // parsed, in the order of the serialization, and may move data out of the
+  // part, which is destroyed afterwards.  Thus the entire message is never
+  // materialized by the deserializer.  The |done| callback is called once
+  // deserialization has completed.  This method must be called at most once
+  // for each deserializer object.
+  void Start(not_null<std::unique_ptr<google::protobuf::Message>> prototype,
+             std::function<void(google::protobuf::Message& part)> on_part,
+             std::function<void()> done);
+
   // Pushes in the internal queue chunks of data that will be extracted by
   // |Pull|.  Splits |bytes| into chunks of at most |chunk_size|.  May block to
   // stay within the maximum size of the queue.  The caller must push an object
@@ -82,6 +97,21 @@ class PushDeserializer final {
   // |DelegatingArrayOutputStream|.
   Bytes Pull();
 
+  // Runs the callback of the last chunk, which is pending at the end of the
+  // deserialization.
+  void RunLastChunkCallback();
+
+  // Calls |parse| with a coded stream that yields the serialization of the
+  // message, decompressed if the data has a compression header.
+  void Decode(
+      std::function<void(google::protobuf::io::CodedInputStream& decoder)>
+          const& parse);
+
+  // Reads a frame of compressed data from |compressed| and returns its
+  // decompression, which remains valid until the next call.  Returns an object
+  // of size 0 for the last frame.
+  Bytes DecompressFrame(google::protobuf::io::CodedInputStream& compressed);
+
   std::unique_ptr<google::protobuf::Message> message_;
 
   int const chunk_size_;
@@ -89,6 +119,11 @@ class PushDeserializer final {
   DelegatingArrayInputStream stream_;
   std::unique_ptr<std::thread> thread_;
 
+  // The compressed and uncompressed data of the current frame, grown as
+  // needed.  Only used when decompressing.
+  UniqueBytes compressed_;
+  UniqueBytes uncompressed_;
+
   // Synchronization objects for the |queue_|.
   std::mutex lock_;
   std::condition_variable queue_has_room_;
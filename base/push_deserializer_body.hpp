@@ -4,9 +4,13 @@
 #include "base/push_deserializer.hpp"
 
 #include <algorithm>
+#include <string>
 
+#include "base/lz4.hpp"
+#include "base/pull_serializer.hpp"
 #include "glog/logging.h"
 #include "google/protobuf/io/coded_stream_inl.h"
+#include "google/protobuf/wire_format.h"
 
 namespace principia {
 namespace base {
@@ -97,22 +101,12 @@ inline void PushDeserializer::Start(
   CHECK(thread_ == nullptr);
   message_ = std::move(message);
   thread_ = std::make_unique<std::thread>([this, done]() {
-    // It is a well-known annoyance that, in order to set the total byte limit,
-    // we have to copy code from MessageLite::ParseFromZeroCopyStream.  Blame
-    // Kenton.
-    google::protobuf::io::CodedInputStream decoder(&stream_);
-    decoder.SetTotalBytesLimit(1 << 29, 1<< 29);
-    CHECK(message_->ParseFromCodedStream(&decoder));
-    CHECK(decoder.ConsumedEntireMessage());
-
-    // Run any remainining chunk callback.
-    std::unique_lock<std::mutex> l(lock_);
-    CHECK_EQ(1, done_.size());
-    auto const done_front = done_.front();
-    if (done_front != nullptr) {
-      done_front();
-    }
-    done_.pop();
+    Decode([this](google::protobuf::io::CodedInputStream& decoder) {
+      CHECK(message_->ParseFromCodedStream(&decoder));
+      CHECK(decoder.ConsumedEntireMessage());
+    });
+
+    RunLastChunkCallback();
 
     // Run the final callback.
     if (done != nullptr) {
@@ -121,6 +115,44 @@ inline void PushDeserializer::Start(
   });
 }
 
+inline void PushDeserializer::Start(
+    not_null<std::unique_ptr<google::protobuf::Message>> prototype,
+    std::function<void(google::protobuf::Message& part)> on_part,
+    std::function<void()> done) {
+  CHECK(thread_ == nullptr);
+  message_ = std::move(prototype);
+  thread_ = std::make_unique<std::thread>([this, on_part, done]() {
+    using google::protobuf::internal::WireFormat;
+    using google::protobuf::internal::WireFormatLite;
+    auto const* const descriptor = message_->GetDescriptor();
+    Decode([this, descriptor, &on_part](
+               google::protobuf::io::CodedInputStream& decoder) {
+      // Parse the top-level fields one at a time, each into a fresh part.  An
+      // unknown field yields a part with only unknown fields.
+      for (std::uint32_t tag = decoder.ReadTag();
+           tag != 0;
+           tag = decoder.ReadTag()) {
+        std::unique_ptr<google::protobuf::Message> const part(message_->New());
+        CHECK(WireFormat::ParseAndMergeField(
+            tag,
+            descriptor->FindFieldByNumber(
+                WireFormatLite::GetTagFieldNumber(tag)),
+            part.get(),
+            &decoder)) << "Parse error in field with tag " << tag;
+        on_part(*part);
+      }
+      CHECK(decoder.ConsumedEntireMessage());
+    });
+
+    RunLastChunkCallback();
+
+    // Run the final callback.
+    if (done != nullptr) {
+      done();
+    }
+  });
+}
+
 inline void PushDeserializer::Push(Bytes const bytes,
                                    std::function<void()> done) {
   // Slice the incoming data in chunks of size at most |chunk_size|.  Release
@@ -170,6 +202,92 @@ inline Bytes PushDeserializer::Pull() {
   return result;
 }
 
+inline void PushDeserializer::RunLastChunkCallback() {
+  std::unique_lock<std::mutex> l(lock_);
+  CHECK_EQ(1, done_.size());
+  auto const done_front = done_.front();
+  if (done_front != nullptr) {
+    done_front();
+  }
+  done_.pop();
+}
+
+inline void PushDeserializer::Decode(
+    std::function<void(google::protobuf::io::CodedInputStream& decoder)>
+        const& parse) {
+  // It is a well-known annoyance that, in order to set the total byte limit,
+  // we have to copy code from MessageLite::ParseFromZeroCopyStream.  Blame
+  // Kenton.
+  google::protobuf::io::CodedInputStream decoder(&stream_);
+  decoder.SetTotalBytesLimit(1 << 29, 1 << 29);
+
+  // Peek at the first byte to find if there is a compression header.  An empty
+  // stream is an uncompressed serialization.
+  void const* data;
+  int size;
+  if (!decoder.GetDirectBufferPointer(&data, &size) ||
+      *static_cast<char const*>(data) != compressed_serialization_magic[0]) {
+    parse(decoder);
+    return;
+  }
+
+  std::string magic;
+  CHECK(decoder.ReadString(&magic, sizeof(compressed_serialization_magic) - 1))
+      << "truncated header";
+  CHECK_EQ(compressed_serialization_magic, magic) << "bad header";
+  std::uint8_t compressor;
+  CHECK(decoder.ReadRaw(&compressor, sizeof(compressor))) << "truncated header";
+  CHECK_EQ(static_cast<std::uint8_t>(Compressor::LZ4), compressor)
+      << "unknown compressor";
+
+  bool at_last_frame = false;
+  DelegatingArrayInputStream decompressed_stream(
+      [this, &decoder, &at_last_frame]() {
+        if (at_last_frame) {
+          return Bytes();
+        }
+        Bytes const bytes = DecompressFrame(decoder);
+        at_last_frame = bytes.size == 0;
+        return bytes;
+      });
+  google::protobuf::io::CodedInputStream decompressed_decoder(
+      &decompressed_stream);
+  decompressed_decoder.SetTotalBytesLimit(1 << 29, 1 << 29);
+  parse(decompressed_decoder);
+  CHECK(at_last_frame);
+  // Consume the end of the input, which must follow the last frame.
+  CHECK(!decoder.Skip(1)) << "data after the last frame";
+}
+
+inline Bytes PushDeserializer::DecompressFrame(
+    google::protobuf::io::CodedInputStream& compressed) {
+  std::uint32_t uncompressed_size;
+  std::uint32_t compressed_size;
+  CHECK(compressed.ReadVarint32(&uncompressed_size)) << "truncated frame";
+  if (uncompressed_size == 0) {
+    return Bytes();
+  }
+  CHECK(compressed.ReadVarint32(&compressed_size)) << "truncated frame";
+  CHECK_LE(compressed_size, uncompressed_size) << "bad frame";
+  if (uncompressed_.size < uncompressed_size) {
+    uncompressed_ = UniqueBytes(uncompressed_size);
+  }
+  if (compressed_size == uncompressed_size) {
+    CHECK(compressed.ReadRaw(uncompressed_.data.get(), uncompressed_size))
+        << "truncated frame";
+  } else {
+    if (compressed_.size < compressed_size) {
+      compressed_ = UniqueBytes(compressed_size);
+    }
+    CHECK(compressed.ReadRaw(compressed_.data.get(), compressed_size))
+        << "truncated frame";
+    CHECK_EQ(uncompressed_size,
+             LZ4Decompress(Bytes(compressed_.data.get(), compressed_size),
+                           uncompressed_.get()));
+  }
+  return Bytes(uncompressed_.data.get(), uncompressed_size);
+}
+
 }  // namespace internal_push_deserializer
 }  // namespace base
 }  // namespace principia
@@ -209,6 +209,89 @@ TEST_F(PushDeserializerTest, SerializationDeserialization) {
   }
 }
 
+// The compressed serialization is deserialized like an uncompressed one,
+// whether the message is built as a whole or by parts.
+TEST_F(PushDeserializerTest, CompressedSerializationDeserialization) {
+  std::string const serialized_trajectory =
+      BuildTrajectory()->SerializeAsString();
+  // The uncompressed serialization is 5300 bytes long, so 100 and 5300 give
+  // frames that end exactly at the end of the message.
+  for (int const chunk_size : {7, 99, 100, 5300, 10'000}) {
+    for (bool const by_parts : {false, true}) {
+      pull_serializer_ = std::make_unique<PullSerializer>(
+          chunk_size, number_of_chunks, Compressor::LZ4);
+      push_deserializer_ = std::make_unique<PushDeserializer>(
+          deserializer_chunk_size, number_of_chunks);
+      std::list<std::string> storage;
+
+      DiscreteTrajectory read_trajectory;
+      pull_serializer_->Start(BuildTrajectory());
+      if (by_parts) {
+        push_deserializer_->Start(
+            make_not_null_unique<DiscreteTrajectory>(),
+            [&read_trajectory](google::protobuf::Message& part) {
+              read_trajectory.MergeFrom(part);
+            },
+            /*done=*/nullptr);
+      } else {
+        push_deserializer_->Start(
+            make_not_null_unique<DiscreteTrajectory>(),
+            [&read_trajectory](google::protobuf::Message const& message) {
+              read_trajectory.CopyFrom(message);
+            });
+      }
+      for (;;) {
+        Bytes const bytes = pull_serializer_->Pull();
+        storage.emplace_back(reinterpret_cast<char const*>(bytes.data),
+                             static_cast<std::size_t>(bytes.size));
+        push_deserializer_->Push(
+            Bytes(reinterpret_cast<std::uint8_t*>(&storage.back()[0]),
+                  bytes.size),
+            nullptr);
+        if (bytes.size == 0) {
+          break;
+        }
+      }
+
+      // Destroying the deserializer waits until deserialization is done.
+      pull_serializer_.reset();
+      push_deserializer_.reset();
+      EXPECT_EQ(serialized_trajectory, read_trajectory.SerializeAsString())
+          << chunk_size << " " << by_parts;
+    }
+  }
+}
+
+TEST_F(PushDeserializerTest, DeserializationOfParts) {
+  auto const trajectory = BuildTrajectory();
+  std::string serialized_trajectory = trajectory->SerializeAsString();
+
+  int parts = 0;
+  DiscreteTrajectory read_trajectory;
+  bool done = false;
+  push_deserializer_->Start(
+      make_not_null_unique<DiscreteTrajectory>(),
+      [&parts, &read_trajectory](google::protobuf::Message& part) {
+        // Each part has a single element of the repeated field.
+        auto& trajectory_part = static_cast<DiscreteTrajectory&>(part);
+        EXPECT_EQ(1, trajectory_part.timeline_size());
+        read_trajectory.MergeFrom(trajectory_part);
+        ++parts;
+      },
+      [&done]() { done = true; });
+  push_deserializer_->Push(
+      Bytes(reinterpret_cast<std::uint8_t*>(&serialized_trajectory[0]),
+            serialized_trajectory.size()),
+      nullptr);
+  push_deserializer_->Push(Bytes(), nullptr);
+
+  // Destroying the deserializer waits until deserialization is done.
+  push_deserializer_.reset();
+  EXPECT_TRUE(done);
+  EXPECT_EQ(100, parts);
+  EXPECT_EQ(serialized_trajectory, read_trajectory.SerializeAsString());
+}
+
 // Check that deserialization fails if we stomp on one extra bytes.
 TEST_F(PushDeserializerDeathTest, Stomp) {
   EXPECT_DEATH({
@@ -0,0 +1,223 @@
+﻿
+#include "base/work_stealing_executor.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace base {
+
+namespace {
+
+// The executor and the index of the worker that owns the current thread, if
+// any.
+thread_local WorkStealingExecutor const* current_executor = nullptr;
+thread_local std::int64_t current_worker = -1;
+
+}  // namespace
+
+WorkStealingExecutor::TaskGroup::TaskGroup(
+    not_null<WorkStealingExecutor*> const executor)
+    : executor_(executor) {}
+
+WorkStealingExecutor::TaskGroup::~TaskGroup() {
+  Wait();
+}
+
+void WorkStealingExecutor::TaskGroup::Add(Task task) {
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    ++pending_;
+  }
+  executor_->Push({std::move(task), this});
+}
+
+void WorkStealingExecutor::TaskGroup::Wait() {
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      if (pending_ == 0) {
+        return;
+      }
+    }
+    // Rather than blocking, run the tasks of this group.  Only block if none
+    // of them is queued, in which case they are running on other threads.  The
+    // tasks of other groups are not run here, as they could delay the caller
+    // arbitrarily.
+    if (!executor_->RunPendingJob(this)) {
+      std::unique_lock<std::mutex> l(lock_);
+      all_done_.wait(l, [this]() { return pending_ == 0; });
+      return;
+    }
+  }
+}
+
+void WorkStealingExecutor::TaskGroup::Done() {
+  // The notification must happen while holding the lock: as soon as |Wait|
+  // observes that there are no pending tasks, the group may be destroyed.
+  std::lock_guard<std::mutex> l(lock_);
+  CHECK_LT(0, pending_);
+  if (--pending_ == 0) {
+    all_done_.notify_all();
+  }
+}
+
+WorkStealingExecutor::WorkStealingExecutor(std::int64_t const pool_size) {
+  CHECK_LT(0, pool_size);
+  for (std::int64_t i = 0; i < pool_size; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (std::int64_t i = 0; i < pool_size; ++i) {
+    threads_.emplace_back(&WorkStealingExecutor::Work, this, i);
+  }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+  {
+    std::lock_guard<std::mutex> l(sleep_lock_);
+    shutdown_ = true;
+  }
+  has_jobs_or_shutdown_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::int64_t WorkStealingExecutor::pool_size() const {
+  return workers_.size();
+}
+
+std::future<void> WorkStealingExecutor::Add(Task task) {
+  Job job{std::move(task)};
+  job.promise.emplace();
+  std::future<void> result = job.promise->get_future();
+  Push(std::move(job));
+  return result;
+}
+
+void WorkStealingExecutor::Execute(Task task) {
+  Push({std::move(task)});
+}
+
+void WorkStealingExecutor::ParallelFor(
+    std::int64_t const n,
+    std::function<void(std::int64_t)> const& body) {
+  TaskGroup group(check_not_null(this));
+  for (std::int64_t i = 0; i < n; ++i) {
+    group.Add([&body, i]() { body(i); });
+  }
+  group.Wait();
+}
+
+void WorkStealingExecutor::Push(Job job) {
+  std::int64_t const size = workers_.size();
+  std::int64_t const index =
+      current_executor == this
+          ? current_worker
+          : next_worker_.fetch_add(1, std::memory_order_relaxed) % size;
+  {
+    Worker& worker = *workers_[index];
+    std::lock_guard<std::mutex> l(worker.lock);
+    worker.jobs.push_back(std::move(job));
+  }
+  // This is sequentially consistent with the increment of |sleepers_| in
+  // |Work|: either the sleeper sees the job, or we see the sleeper.
+  ++queued_jobs_;
+  if (sleepers_ > 0) {
+    // Taking the lock ensures that the sleeper is either before the check of
+    // its predicate or waiting on the condition variable.  The notification
+    // happens after releasing the lock, so that the sleeper doesn't wake up
+    // only to block on it.
+    { std::lock_guard<std::mutex> l(sleep_lock_); }
+    has_jobs_or_shutdown_.notify_one();
+  }
+}
+
+bool WorkStealingExecutor::TryPop(std::int64_t const self,
+                                  TaskGroup const* const group,
+                                  Job& job) {
+  auto const is_eligible = [group](Job const& candidate) {
+    return group == nullptr || candidate.group == group;
+  };
+  std::int64_t const size = workers_.size();
+  if (self >= 0) {
+    Worker& worker = *workers_[self];
+    std::lock_guard<std::mutex> l(worker.lock);
+    auto const it = std::find_if(
+        worker.jobs.rbegin(), worker.jobs.rend(), is_eligible);
+    if (it != worker.jobs.rend()) {
+      job = std::move(*it);
+      worker.jobs.erase(std::next(it).base());
+      --queued_jobs_;
+      return true;
+    }
+  }
+  std::int64_t const first_victim =
+      self >= 0 ? self + 1
+                : next_worker_.load(std::memory_order_relaxed);
+  for (std::int64_t i = 0; i < size; ++i) {
+    std::int64_t const victim = (first_victim + i) % size;
+    if (victim == self) {
+      continue;
+    }
+    Worker& worker = *workers_[victim];
+    std::lock_guard<std::mutex> l(worker.lock);
+    auto const it =
+        std::find_if(worker.jobs.begin(), worker.jobs.end(), is_eligible);
+    if (it != worker.jobs.end()) {
+      job = std::move(*it);
+      worker.jobs.erase(it);
+      --queued_jobs_;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingExecutor::RunPendingJob(TaskGroup const* const group) {
+  Job job;
+  if (!TryPop(current_executor == this ? current_worker : -1, group, job)) {
+    return false;
+  }
+  Run(job);
+  return true;
+}
+
+void WorkStealingExecutor::Run(Job& job) {
+  job.task();
+  if (job.group != nullptr) {
+    job.group->Done();
+  }
+  if (job.promise) {
+    job.promise->set_value();
+  }
+}
+
+void WorkStealingExecutor::Work(std::int64_t const self) {
+  current_executor = this;
+  current_worker = self;
+  for (;;) {
+    Job job;
+    if (TryPop(self, /*group=*/nullptr, job)) {
+      Run(job);
+      continue;
+    }
+    std::unique_lock<std::mutex> l(sleep_lock_);
+    ++sleepers_;
+    has_jobs_or_shutdown_.wait(l, [this]() {
+      return shutdown_ || queued_jobs_ > 0;
+    });
+    --sleepers_;
+    // On shutdown, the jobs that are still queued are executed before the
+    // thread terminates.
+    if (shutdown_ && queued_jobs_ == 0) {
+      return;
+    }
+  }
+}
+
+}  // namespace base
+}  // namespace principia
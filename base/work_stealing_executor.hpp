@@ -0,0 +1,138 @@
+﻿
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <experimental/optional>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/macros.hpp"
+#include "base/not_null.hpp"
+
+namespace principia {
+namespace base {
+
+// A pool of threads, each of which owns a deque of tasks.  A worker executes
+// the most recent tasks of its own deque first, and when it runs out of work it
+// steals the oldest tasks of the other workers.  Tasks added from a worker go
+// to the deque of that worker; tasks added from other threads are distributed
+// round-robin.  Contrary to |ThreadPool|, there is no queue shared by all the
+// threads, and fork/join parallelism through |TaskGroup| doesn't allocate a
+// shared state per task.  This class is thread-safe.
+class WorkStealingExecutor final {
+ public:
+  using Task = std::function<void()>;
+
+  // A set of tasks that are forked on an executor and joined together.  The
+  // group only keeps a count of its pending tasks.  The thread that calls
+  // |Wait| helps executing the tasks of the group until it is complete, so it
+  // is fine to use groups from within the tasks of the executor.  It never runs
+  // the tasks of other groups or those added by |Add| or |Execute|.  This class
+  // is thread-safe.
+  class TaskGroup final {
+   public:
+    explicit TaskGroup(not_null<WorkStealingExecutor*> executor);
+
+    // Waits for the completion of the tasks of the group.
+    ~TaskGroup();
+
+    // Forks |task| on the executor.
+    void Add(Task task);
+
+    // Returns when all the tasks added to this group have completed.
+    void Wait();
+
+   private:
+    // Called by the executor once a task of this group has completed.
+    void Done();
+
+    not_null<WorkStealingExecutor*> const executor_;
+    std::mutex lock_;
+    std::condition_variable all_done_;
+    std::int64_t pending_ GUARDED_BY(lock_) = 0;
+
+    friend class WorkStealingExecutor;
+  };
+
+  // Constructs an executor with the given number of threads.
+  explicit WorkStealingExecutor(std::int64_t pool_size);
+
+  // Executes the tasks that are still queued and joins the threads.
+  ~WorkStealingExecutor();
+
+  // The number of threads of this executor.
+  std::int64_t pool_size() const;
+
+  // Adds |task| for asynchronous execution, and returns a future that the
+  // client may use to wait until execution of |task| has completed.  Prefer
+  // |TaskGroup| or |ParallelFor| when the results are awaited together.
+  std::future<void> Add(Task task);
+
+  // Adds |task| for asynchronous execution.  Contrary to |Add|, this doesn't
+  // allocate a shared state, and there is no way to wait for the completion of
+  // |task|.
+  void Execute(Task task);
+
+  // Calls |body(i)| for all |i| in [0, n[ in parallel, and returns when all
+  // the calls have completed.
+  void ParallelFor(std::int64_t n,
+                   std::function<void(std::int64_t)> const& body);
+
+ private:
+  struct Job {
+    Task task;
+    // Null for the jobs created by |Add| and |Execute|.
+    TaskGroup* group = nullptr;
+    // Only engaged for the jobs created by |Add|.
+    std::experimental::optional<std::promise<void>> promise;
+  };
+
+  struct Worker {
+    std::mutex lock;
+    std::deque<Job> jobs GUARDED_BY(lock);
+  };
+
+  // Queues |job| on the deque of the current worker if called from a thread of
+  // this executor, and on the next worker in round-robin order otherwise.
+  void Push(Job job);
+
+  // Pops the most recent job of the deque of worker |self|, if any, or steals
+  // the oldest job of another worker.  |self| is -1 for a thread that doesn't
+  // belong to this executor.  If |group| is not null, only the jobs of that
+  // group are considered.  Returns false if no job was found.
+  bool TryPop(std::int64_t self, TaskGroup const* group, Job& job);
+
+  // Runs one queued job of |group| on the current thread, if any.  Returns
+  // false if there was no such job to run.
+  bool RunPendingJob(TaskGroup const* group);
+
+  // Runs |job| and notifies its group.
+  static void Run(Job& job);
+
+  // The loop executed by the thread of worker |self|.
+  void Work(std::int64_t self);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::int64_t> next_worker_{0};
+
+  // The total number of jobs in the deques.  The |sleep_lock_| is only taken
+  // when going to sleep and, by the producers, when there are |sleepers_| to
+  // wake up.
+  std::atomic<std::int64_t> queued_jobs_{0};
+  std::atomic<std::int64_t> sleepers_{0};
+  std::atomic<bool> shutdown_{false};
+  std::mutex sleep_lock_;
+  std::condition_variable has_jobs_or_shutdown_;
+
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace base
+}  // namespace principia
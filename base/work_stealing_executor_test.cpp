@@ -0,0 +1,147 @@
+﻿
+#include "base/work_stealing_executor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+
+namespace principia {
+namespace base {
+
+class WorkStealingExecutorTest : public ::testing::Test {
+ protected:
+  WorkStealingExecutorTest()
+      : executor_(std::max(1u, std::thread::hardware_concurrency())) {}
+
+  WorkStealingExecutor executor_;
+};
+
+// Check that execution occurs in parallel.  If things were sequential, the
+// integers in |numbers| would be monotonically increasing.
+TEST_F(WorkStealingExecutorTest, ParallelExecution) {
+  static constexpr int number_of_calls = 1'000'000;
+
+  std::mutex lock;
+  std::vector<std::int64_t> numbers;
+  {
+    WorkStealingExecutor::TaskGroup group(check_not_null(&executor_));
+    for (std::int64_t i = 0; i < number_of_calls; ++i) {
+      group.Add([i, &lock, &numbers]() {
+        std::lock_guard<std::mutex> l(lock);
+        numbers.push_back(i);
+      });
+    }
+    group.Wait();
+  }
+  EXPECT_EQ(number_of_calls, numbers.size());
+
+  bool monotonically_increasing = true;
+  for (std::int64_t i = 1; i < numbers.size(); ++i) {
+    if (numbers[i] < numbers[i - 1]) {
+      monotonically_increasing = false;
+    }
+  }
+  if (std::thread::hardware_concurrency() > 1) {
+    EXPECT_FALSE(monotonically_increasing);
+  }
+}
+
+TEST_F(WorkStealingExecutorTest, Future) {
+  std::atomic<int> calls = 0;
+  std::vector<std::future<void>> futures;
+  for (int i = 0; i < 1000; ++i) {
+    futures.push_back(executor_.Add([&calls]() { ++calls; }));
+  }
+  for (auto const& future : futures) {
+    future.wait();
+  }
+  EXPECT_EQ(1000, calls);
+}
+
+TEST_F(WorkStealingExecutorTest, Execute) {
+  std::atomic<int> calls = 0;
+  {
+    // The destructor of the executor runs the tasks that are still queued.
+    WorkStealingExecutor executor(/*pool_size=*/1);
+    for (int i = 0; i < 1000; ++i) {
+      executor.Execute([&calls]() { ++calls; });
+    }
+  }
+  EXPECT_EQ(1000, calls);
+}
+
+// Check that a thread that waits for a group only helps with the tasks of that
+// group.
+TEST_F(WorkStealingExecutorTest, WaitOnlyRunsTheGroup) {
+  WorkStealingExecutor executor(/*pool_size=*/1);
+  std::promise<void> release;
+  std::shared_future<void> const released = release.get_future().share();
+  std::promise<void> start;
+  std::future<void> const started = start.get_future();
+  // Make sure that the only worker is busy before queuing the other tasks.
+  executor.Execute([released, &start]() {
+    start.set_value();
+    released.wait();
+  });
+  started.wait();
+
+  std::atomic<bool> other_task_ran = false;
+  std::future<void> const other_task =
+      executor.Add([&other_task_ran]() { other_task_ran = true; });
+  std::thread::id group_thread;
+  {
+    WorkStealingExecutor::TaskGroup group(check_not_null(&executor));
+    group.Add([&group_thread]() { group_thread = std::this_thread::get_id(); });
+    group.Wait();
+  }
+  EXPECT_EQ(std::this_thread::get_id(), group_thread);
+  EXPECT_FALSE(other_task_ran);
+
+  release.set_value();
+  other_task.wait();
+  EXPECT_TRUE(other_task_ran);
+}
+
+TEST_F(WorkStealingExecutorTest, ParallelFor) {
+  std::vector<std::int64_t> squares(10'000);
+  executor_.ParallelFor(squares.size(),
+                        [&squares](std::int64_t const i) {
+                          squares[i] = i * i;
+                        });
+  for (std::int64_t i = 0; i < squares.size(); ++i) {
+    EXPECT_EQ(i * i, squares[i]);
+  }
+}
+
+// Check that tasks may fork and join subtasks, even when there are fewer
+// threads than nested groups.
+TEST_F(WorkStealingExecutorTest, NestedForkJoin) {
+  WorkStealingExecutor executor(/*pool_size=*/2);
+  std::function<std::int64_t(int)> fibonacci;
+  fibonacci = [&executor, &fibonacci](int const n) -> std::int64_t {
+    if (n < 2) {
+      return n;
+    }
+    std::int64_t f1;
+    std::int64_t f2;
+    WorkStealingExecutor::TaskGroup group(check_not_null(&executor));
+    group.Add([&f1, &fibonacci, n]() { f1 = fibonacci(n - 1); });
+    group.Add([&f2, &fibonacci, n]() { f2 = fibonacci(n - 2); });
+    group.Wait();
+    return f1 + f2;
+  };
+  std::int64_t result;
+  {
+    WorkStealingExecutor::TaskGroup group(check_not_null(&executor));
+    group.Add([&result, &fibonacci]() { result = fibonacci(20); });
+  }
+  EXPECT_EQ(6765, result);
+}
+
+}  // namespace base
+}  // namespace principia
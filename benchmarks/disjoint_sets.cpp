@@ -0,0 +1,157 @@
+﻿
+// .\Release\x64\benchmarks.exe --benchmark_filter=Unite
+
+#include <list>
+#include <vector>
+
+#include "base/disjoint_sets.hpp"
+#include "base/not_null.hpp"
+#include "benchmark/benchmark.h"
+
+namespace principia {
+namespace base {
+
+namespace {
+
+// Stand-ins for the |Part|s of a large number of vessels.  The subsets of
+// |SplicedElement|s maintain the list of their elements by splicing
+// |std::list|s when merging; the subsets of |GatheredElement|s only maintain
+// their cardinality when merging, and their elements are gathered in a
+// |std::vector| once the partition is complete.
+struct SplicedElement;
+struct GatheredElement;
+
+}  // namespace
+
+template<>
+class Subset<SplicedElement>::Properties final {
+ public:
+  explicit Properties(not_null<SplicedElement*> const element) {
+    elements_.push_back(element);
+  }
+
+  void MergeWith(Properties& other) {
+    elements_.splice(elements_.end(), other.elements_);
+  }
+
+ private:
+  std::list<not_null<SplicedElement*>> elements_;
+};
+
+template<>
+class Subset<GatheredElement>::Properties final {
+ public:
+  explicit Properties(not_null<GatheredElement*> const element) {}
+
+  void MergeWith(Properties& other) {
+    size_ += other.size_;
+  }
+
+  void Gather(not_null<GatheredElement*> const element) {
+    if (elements_.empty()) {
+      elements_.reserve(size_);
+    }
+    elements_.push_back(element);
+  }
+
+ private:
+  int size_ = 1;
+  std::vector<not_null<GatheredElement*>> elements_;
+};
+
+namespace {
+
+struct SplicedElement final {
+  Subset<SplicedElement>::Node subset_node;
+};
+
+struct GatheredElement final {
+  Subset<GatheredElement>::Node subset_node;
+};
+
+}  // namespace
+
+template<>
+not_null<Subset<SplicedElement>::Node*> Subset<SplicedElement>::Node::Get(
+    SplicedElement& element) {
+  return &element.subset_node;
+}
+
+template<>
+not_null<Subset<GatheredElement>::Node*> Subset<GatheredElement>::Node::Get(
+    GatheredElement& element) {
+  return &element.subset_node;
+}
+
+namespace {
+
+constexpr int number_of_vessels = 200;
+constexpr int parts_per_vessel = 25;
+
+template<typename Element>
+using Vessels = std::vector<std::vector<Element>>;
+
+// Unites the elements of each vessel with its first element.
+template<typename Element>
+void Unite(Vessels<Element>& vessels) {
+  for (auto& vessel : vessels) {
+    Element& first = vessel.front();
+    for (auto& element : vessel) {
+      Subset<Element>::Unite(Subset<Element>::Find(first),
+                             Subset<Element>::Find(element));
+    }
+  }
+}
+
+template<typename Element>
+void Gather(Vessels<Element>& vessels) {}
+
+template<>
+void Gather(Vessels<GatheredElement>& vessels) {
+  for (auto& vessel : vessels) {
+    for (auto& element : vessel) {
+      Subset<GatheredElement>::Find(element).mutable_properties().Gather(
+          &element);
+    }
+  }
+}
+
+// What the plugin does every frame to collect the pile-ups: all the elements
+// are made singletons, some vessels collide, the vessels are bound, and the
+// elements of the subsets are listed.
+template<typename Element>
+void BM_Unite(benchmark::State& state) {
+  Vessels<Element> vessels(number_of_vessels,
+                           std::vector<Element>(parts_per_vessel));
+  while (state.KeepRunning()) {
+    for (auto& vessel : vessels) {
+      for (auto& element : vessel) {
+        Subset<Element>::MakeSingleton(element, &element);
+      }
+    }
+    for (int i = 0; i + 1 < vessels.size(); i += 10) {
+      Subset<Element>::Unite(Subset<Element>::Find(vessels[i].back()),
+                             Subset<Element>::Find(vessels[i + 1].front()));
+    }
+    Unite(vessels);
+    Gather(vessels);
+  }
+  state.SetItemsProcessed(state.iterations() * number_of_vessels *
+                          parts_per_vessel);
+}
+
+}  // namespace
+
+void BM_UniteSplicing(benchmark::State& state) {
+  BM_Unite<SplicedElement>(state);
+}
+
+void BM_UniteGathering(benchmark::State& state) {
+  BM_Unite<GatheredElement>(state);
+}
+
+BENCHMARK(BM_UniteSplicing);
+BENCHMARK(BM_UniteGathering);
+
+}  // namespace base
+}  // namespace principia
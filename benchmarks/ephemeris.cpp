@@ -10,7 +10,7 @@
 
 #include "astronomy/frames.hpp"
 #include "base/not_null.hpp"
-#include "base/thread_pool.hpp"
+#include "base/work_stealing_executor.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/quaternion.hpp"
 #include "geometry/rotation.hpp"
@@ -38,8 +38,9 @@ namespace principia {
 using astronomy::ICRFJ2000Ecliptic;
 using astronomy::ICRFJ2000Equator;
 using astronomy::ICRFJ200EquatorialToEcliptic;
+using base::check_not_null;
 using base::not_null;
-using base::ThreadPool;
+using base::WorkStealingExecutor;
 using geometry::Displacement;
 using geometry::Instant;
 using geometry::Position;
@@ -307,7 +308,7 @@ void BM_EphemerisMultithreadingBenchmark(benchmark::State& state) {
                       earth_degrees_of_freedom + orbit.StateVectors(epoch));
   }
 
-  ThreadPool<void> pool(/*pool_size=*/state.range_y());
+  WorkStealingExecutor executor(/*pool_size=*/state.range_y());
   static constexpr int warp_factor = 6E6;
   static constexpr Frequency refresh_frequency = 50 * Hertz;
   static constexpr Time step = warp_factor / refresh_frequency;
@@ -328,15 +329,13 @@ void BM_EphemerisMultithreadingBenchmark(benchmark::State& state) {
     final_time += step;
     state.ResumeTiming();
 
-    std::vector<std::future<void>> futures;
+    WorkStealingExecutor::TaskGroup flows(check_not_null(&executor));
     for (auto& instance : instances) {
-      futures.push_back(pool.Add([&ephemeris, &instance, final_time]() {
+      flows.Add([&ephemeris, &instance, final_time]() {
         ephemeris->FlowWithFixedStep(final_time, *instance);
-      }));
-    }
-    for (auto const& future : futures) {
-      future.wait();
+      });
     }
+    flows.Wait();
   }
 
   std::stringstream ss;
@@ -0,0 +1,109 @@
+﻿
+// .\Release\x64\benchmarks.exe --benchmark_filter=Journal --journal=<path> --journal_warm_up=100000  // NOLINT(whitespace/line_length)
+
+#include "benchmarks/journal.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <experimental/filesystem>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "glog/logging.h"
+#include "journal/player.hpp"
+#include "journal/profiles.hpp"
+
+namespace principia {
+namespace journal {
+
+namespace {
+
+std::experimental::filesystem::path journal_path;
+std::int64_t journal_warm_up = 0;
+
+constexpr char journal_flag[] = "--journal=";
+constexpr char journal_warm_up_flag[] = "--journal_warm_up=";
+
+bool ConsumeFlag(char const* const argument,
+                 char const* const flag,
+                 std::string& value) {
+  std::size_t const flag_size = std::strlen(flag);
+  if (std::strncmp(argument, flag, flag_size) != 0) {
+    return false;
+  }
+  value = argument + flag_size;
+  return true;
+}
+
+}  // namespace
+
+void ParseJournalBenchmarkFlags(int& argc, char* argv[]) {
+  int kept = 1;
+  for (int i = 1; i < argc; ++i) {
+    std::string value;
+    if (ConsumeFlag(argv[i], journal_flag, value)) {
+      journal_path = value;
+    } else if (ConsumeFlag(argv[i], journal_warm_up_flag, value)) {
+      journal_warm_up = std::stoll(value);
+      CHECK_LE(0, journal_warm_up) << argv[i];
+    } else {
+      argv[kept++] = argv[i];
+    }
+  }
+  argc = kept;
+}
+
+// Replays the journal, and measures the time spent in the calls to the
+// interface method described by |Profile| after the warm-up.  Each iteration
+// replays the entire journal, so the number of iterations is fixed at 1; use
+// --benchmark_repetitions to get statistics.  The number of items processed is
+// the number of calls to the method.
+template<typename Profile>
+void BM_Journal(benchmark::State& state) {
+  if (journal_path.empty()) {
+    state.SkipWithError("No journal, use --journal=<path>");
+    return;
+  }
+  std::int64_t calls = 0;
+  while (state.KeepRunning()) {
+    Player player(journal_path, /*decode_ahead=*/true);
+    for (std::int64_t i = 0; i < journal_warm_up && player.Play(); ++i) {
+    }
+    std::chrono::nanoseconds duration{};
+    while (player.Play()) {
+      if (player.last_method_in().HasExtension(
+              Profile::Message::extension)) {
+        duration += player.last_method_duration();
+        ++calls;
+      }
+    }
+    state.SetIterationTime(std::chrono::duration<double>(duration).count());
+  }
+  state.SetItemsProcessed(calls);
+}
+
+BENCHMARK_TEMPLATE1(BM_Journal, AdvanceTime)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, CatchUpLaggingVessels)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, FlightPlanRenderedSegment)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, FreeVesselsAndPartsAndCollectPileUps)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, PlanetariumPlotPrediction)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, SerializePlugin)
+    ->Iterations(1)
+    ->UseManualTime();
+BENCHMARK_TEMPLATE1(BM_Journal, UpdatePrediction)
+    ->Iterations(1)
+    ->UseManualTime();
+
+}  // namespace journal
+}  // namespace principia
@@ -0,0 +1,16 @@
+﻿
+#pragma once
+
+namespace principia {
+namespace journal {
+
+// Removes from |argv| the flags that configure the journal benchmarks, and
+// updates |argc| accordingly:
+//   --journal=<path>: the journal to replay;
+//   --journal_warm_up=<n>: the number of methods replayed before the
+//     measurements start, so that steady-state costs are measured.
+// Must be called before the benchmarks are run.
+void ParseJournalBenchmarkFlags(int& argc, char* argv[]);
+
+}  // namespace journal
+}  // namespace principia
@@ -1,7 +1,9 @@
 ﻿
 #include "benchmark/benchmark.h"
+#include "benchmarks/journal.hpp"
 
 int main(int argc, char* argv[]) {
+  principia::journal::ParseJournalBenchmarkFlags(argc, argv);
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
 }
@@ -0,0 +1,136 @@
+// .\Release\x64\benchmarks.exe --benchmark_filter=PartUpdates
+
+#include <experimental/optional>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "geometry/named_quantities.hpp"
+#include "google/protobuf/text_format.h"
+#include "ksp_plugin/frames.hpp"
+#include "ksp_plugin/identification.hpp"
+#include "ksp_plugin/plugin.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "serialization/astronomy.pb.h"
+
+namespace principia {
+namespace ksp_plugin {
+
+using geometry::Displacement;
+using geometry::Vector;
+using geometry::Velocity;
+using physics::DegreesOfFreedom;
+using quantities::Force;
+using quantities::Time;
+using quantities::si::Kilogram;
+using quantities::si::Metre;
+using quantities::si::Milli;
+using quantities::si::Newton;
+using quantities::si::Radian;
+using quantities::si::Second;
+
+namespace {
+
+constexpr int number_of_vessels = 20;
+constexpr int parts_per_vessel = 50;
+
+}  // namespace
+
+// Replays the per-part calls that the adapter makes every frame for loaded
+// vessels: |InsertOrKeepLoadedPart| and |IncrementPartIntrinsicForce|, and the
+// end-of-frame |PrepareToReportCollisions| and
+// |FreeVesselsAndPartsAndCollectPileUps|.  The benchmark only uses the
+// interface of the |Plugin|, so that it may be run unchanged against earlier
+// representations of the part index of the plugin and of the parts of the
+// vessels.
+void BM_PartUpdates(benchmark::State& state) {
+  Index const celestial = 0;
+  Plugin plugin("JD2451545.0", "JD2451545.0", 0 * Radian);
+  serialization::GravityModel::Body gravity_model;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      R"(name                    : "Celestial"
+         gravitational_parameter : "1 m^3/s^2"
+         reference_instant       : "JD2451545.0"
+         mean_radius             : "1 m"
+         axis_right_ascension    : "0 deg"
+         axis_declination        : "90 deg"
+         reference_angle         : "1 rad"
+         angular_frequency       : "1 rad/s")",
+      &gravity_model));
+  serialization::InitialState::Keplerian::Body initial_state;
+  CHECK(google::protobuf::TextFormat::ParseFromString(
+      R"(name : "Celestial")",
+      &initial_state));
+  plugin.InsertCelestialJacobiKeplerian(
+      celestial,
+      /*parent_index=*/std::experimental::nullopt,
+      gravity_model,
+      initial_state);
+  plugin.EndInitialization();
+  // Make sure that the ephemeris covers the start of the frame.
+  plugin.AdvanceTime(plugin.CurrentTime() + 1 * Second, 0 * Radian);
+
+  Time const Δt = 20 * Milli(Second);
+  DegreesOfFreedom<World> const main_body_degrees_of_freedom(
+      World::origin, Velocity<World>());
+  Vector<Force, World> const force({1 * Newton, 0 * Newton, 0 * Newton});
+  std::vector<GUID> vessel_guids;
+  std::vector<std::vector<PartId>> part_ids(number_of_vessels);
+  std::vector<std::vector<DegreesOfFreedom<World>>> part_degrees_of_freedom(
+      number_of_vessels);
+  for (int v = 0; v < number_of_vessels; ++v) {
+    vessel_guids.push_back(std::to_string(v));
+    for (int p = 0; p < parts_per_vessel; ++p) {
+      // Scatter the IDs like KSP's flight IDs.
+      part_ids[v].push_back((v * parts_per_vessel + p) * 2654435761u);
+      part_degrees_of_freedom[v].emplace_back(
+          World::origin +
+              Displacement<World>({(p + 10) * Metre, v * Metre, 0 * Metre}),
+          Velocity<World>());
+    }
+  }
+
+  auto const frame = [&]() {
+    for (int v = 0; v < number_of_vessels; ++v) {
+      bool inserted;
+      plugin.InsertOrKeepVessel(vessel_guids[v],
+                                "vessel",
+                                celestial,
+                                /*loaded=*/true,
+                                inserted);
+      for (int p = 0; p < parts_per_vessel; ++p) {
+        plugin.InsertOrKeepLoadedPart(part_ids[v][p],
+                                      "part",
+                                      1 * Kilogram,
+                                      vessel_guids[v],
+                                      celestial,
+                                      main_body_degrees_of_freedom,
+                                      part_degrees_of_freedom[v][p],
+                                      Δt);
+      }
+    }
+    for (int v = 0; v < number_of_vessels; ++v) {
+      for (PartId const part_id : part_ids[v]) {
+        plugin.IncrementPartIntrinsicForce(part_id, force);
+      }
+    }
+    plugin.PrepareToReportCollisions();
+    plugin.FreeVesselsAndPartsAndCollectPileUps(Δt);
+  };
+
+  // The first frame inserts the vessels and the parts and creates the
+  // pile-ups; the next ones only update them.
+  frame();
+  while (state.KeepRunning()) {
+    frame();
+  }
+  state.SetItemsProcessed(state.iterations() * number_of_vessels *
+                          parts_per_vessel);
+}
+
+BENCHMARK(BM_PartUpdates);
+
+}  // namespace ksp_plugin
+}  // namespace principia
@@ -0,0 +1,103 @@
+﻿
+// .\Release\x64\benchmarks.exe --benchmark_filter=Submission
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "base/thread_pool.hpp"
+#include "base/work_stealing_executor.hpp"
+#include "benchmark/benchmark.h"
+
+namespace principia {
+namespace base {
+
+// The cost of submitting a trivial task and waiting until a worker has run
+// it.  The submitting thread only spins on a flag set by the task: it must not
+// run the task itself, as |TaskGroup::Wait| would.  The argument is the number
+// of threads.
+void BM_ThreadPoolSubmissionLatency(benchmark::State& state) {
+  ThreadPool<void> pool(/*pool_size=*/state.range_x());
+  std::atomic<bool> done;
+  while (state.KeepRunning()) {
+    done = false;
+    std::future<void> const future =
+        pool.Add([&done]() { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void BM_WorkStealingExecutorSubmissionLatency(benchmark::State& state) {
+  WorkStealingExecutor executor(/*pool_size=*/state.range_x());
+  std::atomic<bool> done;
+  while (state.KeepRunning()) {
+    done = false;
+    std::future<void> const future = executor.Add(
+        [&done]() { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+// Same as above, without the shared state of a future.
+void BM_WorkStealingExecutorExecutionLatency(benchmark::State& state) {
+  WorkStealingExecutor executor(/*pool_size=*/state.range_x());
+  std::atomic<bool> done;
+  while (state.KeepRunning()) {
+    done = false;
+    executor.Execute(
+        [&done]() { done.store(true, std::memory_order_release); });
+    while (!done.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+// The cost of forking |state.range_x()| trivial tasks and joining them, as
+// done every frame by the plugin.  The second argument is the number of
+// threads.
+void BM_ThreadPoolSubmissionThroughput(benchmark::State& state) {
+  ThreadPool<void> pool(/*pool_size=*/state.range_y());
+  std::vector<std::future<void>> futures;
+  while (state.KeepRunning()) {
+    futures.clear();
+    for (int i = 0; i < state.range_x(); ++i) {
+      futures.push_back(pool.Add([]() {}));
+    }
+    for (auto const& future : futures) {
+      future.wait();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+void BM_WorkStealingExecutorSubmissionThroughput(benchmark::State& state) {
+  WorkStealingExecutor executor(/*pool_size=*/state.range_y());
+  while (state.KeepRunning()) {
+    WorkStealingExecutor::TaskGroup group(check_not_null(&executor));
+    for (int i = 0; i < state.range_x(); ++i) {
+      group.Add([]() {});
+    }
+    group.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK(BM_ThreadPoolSubmissionLatency)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK(BM_WorkStealingExecutorSubmissionLatency)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK(BM_WorkStealingExecutorExecutionLatency)->Arg(1)->Arg(4)->Arg(8);
+BENCHMARK(BM_ThreadPoolSubmissionThroughput)
+    ->ArgPair(100, 4)
+    ->ArgPair(10'000, 4)
+    ->ArgPair(10'000, 8);
+BENCHMARK(BM_WorkStealingExecutorSubmissionThroughput)
+    ->ArgPair(100, 4)
+    ->ArgPair(10'000, 4)
+    ->ArgPair(10'000, 8);
+
+}  // namespace base
+}  // namespace principia
@@ -0,0 +1,126 @@
+﻿
+// .\Release\x64\benchmarks.exe --benchmark_filter=Trajectory
+
+#include <random>
+#include <vector>
+
+#include "astronomy/epoch.hpp"
+#include "astronomy/frames.hpp"
+#include "base/not_null.hpp"
+#include "geometry/named_quantities.hpp"
+#include "physics/discrete_trajectory.hpp"
+#include "physics/чебышёв_trajectory.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/si.hpp"
+
+// Must come last to avoid conflicts when defining the CHECK macros.
+#include "benchmark/benchmark.h"
+
+namespace principia {
+
+using astronomy::ICRFJ2000Equator;
+using base::make_not_null_unique;
+using base::not_null;
+using geometry::Displacement;
+using geometry::Instant;
+using geometry::Position;
+using geometry::Velocity;
+using quantities::AngularFrequency;
+using quantities::Cos;
+using quantities::Length;
+using quantities::Sin;
+using quantities::Speed;
+using quantities::Time;
+using quantities::si::Kilo;
+using quantities::si::Metre;
+using quantities::si::Radian;
+using quantities::si::Second;
+
+namespace physics {
+
+namespace {
+
+int const evaluations_per_iteration = 1000;
+
+// A circular orbit sampled every 10 s for about 30 periods.
+not_null<std::unique_ptr<DiscreteTrajectory<ICRFJ2000Equator>>>
+NewCircularTrajectory() {
+  auto trajectory =
+      make_not_null_unique<DiscreteTrajectory<ICRFJ2000Equator>>();
+  Instant const t0 = astronomy::J2000;
+  Length const r = 7000 * Kilo(Metre);
+  AngularFrequency const ω = 1.08e-3 * Radian / Second;
+  Speed const v = ω * r / Radian;
+  for (Instant t = t0; t <= t0 + 175'000 * Second; t += 10 * Second) {
+    trajectory->Append(
+        t,
+        DegreesOfFreedom<ICRFJ2000Equator>(
+            ICRFJ2000Equator::origin +
+                Displacement<ICRFJ2000Equator>({r * Cos(ω * (t - t0)),
+                                                r * Sin(ω * (t - t0)),
+                                                0 * Metre}),
+            Velocity<ICRFJ2000Equator>({-v * Sin(ω * (t - t0)),
+                                        v * Cos(ω * (t - t0)),
+                                        0 * Metre / Second})));
+  }
+  return trajectory;
+}
+
+std::vector<Instant> RandomTimes(
+    Trajectory<ICRFJ2000Equator> const& trajectory) {
+  std::mt19937_64 random(42);
+  std::uniform_real_distribution<> distribution(0.0, 1.0);
+  std::vector<Instant> times;
+  for (int i = 0; i < evaluations_per_iteration; ++i) {
+    times.push_back(trajectory.t_min() +
+                    distribution(random) *
+                        (trajectory.t_max() - trajectory.t_min()));
+  }
+  return times;
+}
+
+void EvaluateTrajectory(Trajectory<ICRFJ2000Equator> const& trajectory,
+                        benchmark::State& state) {
+  std::vector<Instant> const times = RandomTimes(trajectory);
+  while (state.KeepRunning()) {
+    for (Instant const& t : times) {
+      benchmark::DoNotOptimize(trajectory.EvaluatePosition(t));
+    }
+  }
+}
+
+}  // namespace
+
+void BM_EvaluateDiscreteTrajectory(benchmark::State& state) {
+  auto const trajectory = NewCircularTrajectory();
+  EvaluateTrajectory(*trajectory, state);
+}
+
+void BM_EvaluateЧебышёвTrajectory(benchmark::State& state) {
+  auto const trajectory = NewCircularTrajectory();
+  ЧебышёвTrajectory<ICRFJ2000Equator> const чебышёв_trajectory(
+      *trajectory,
+      trajectory->t_min(),
+      trajectory->t_max(),
+      /*tolerance=*/1 * Metre);
+  EvaluateTrajectory(чебышёв_trajectory, state);
+}
+
+void BM_FitЧебышёвTrajectory(benchmark::State& state) {
+  auto const trajectory = NewCircularTrajectory();
+  while (state.KeepRunning()) {
+    ЧебышёвTrajectory<ICRFJ2000Equator> const чебышёв_trajectory(
+        *trajectory,
+        trajectory->t_min(),
+        trajectory->t_max(),
+        /*tolerance=*/1 * Metre);
+    benchmark::DoNotOptimize(чебышёв_trajectory.number_of_series());
+  }
+}
+
+BENCHMARK(BM_EvaluateDiscreteTrajectory);
+BENCHMARK(BM_EvaluateЧебышёвTrajectory);
+BENCHMARK(BM_FitЧебышёвTrajectory);
+
+}  // namespace physics
+}  // namespace principia
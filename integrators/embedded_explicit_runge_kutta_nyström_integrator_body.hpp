@@ -9,6 +9,7 @@
 #include <experimental/optional>
 #include <vector>
 
+#include "base/bundle.hpp"
 #include "geometry/sign.hpp"
 #include "glog/logging.h"
 #include "quantities/quantities.hpp"
@@ -17,6 +18,7 @@ namespace principia {
 namespace integrators {
 namespace internal_embedded_explicit_runge_kutta_nyström_integrator {
 
+using base::AbortRequested;
 using base::make_not_null_unique;
 using geometry::Sign;
 using numerics::DoublePrecision;
@@ -278,6 +280,14 @@ Instance::Solve(Instant const& t_final) {
                         "; requested t_final is " + DebugString(t_final) +
                         ".");
     }
+    // The integration may be long, so it is aborted between steps if
+    // requested.
+    if (!at_end && AbortRequested()) {
+      return Status(termination_condition::Cancelled,
+                    "Aborted at time " + DebugString(t.value) +
+                        "; requested t_final is " + DebugString(t_final) +
+                        ".");
+    }
   }
   // The resolution is restartable from the last non-truncated state.
   CHECK(final_state);
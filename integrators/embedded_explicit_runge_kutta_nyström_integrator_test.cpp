@@ -5,6 +5,7 @@
 #include <limits>
 #include <vector>
 
+#include "base/bundle.hpp"
 #include "base/macros.hpp"
 #include "glog/logging.h"
 #include "gmock/gmock.h"
@@ -19,6 +20,7 @@ namespace principia {
 namespace integrators {
 namespace internal_embedded_explicit_runge_kutta_nyström_integrator {
 
+using base::AbortRequested;
 using quantities::Abs;
 using quantities::Acceleration;
 using quantities::AngularFrequency;
@@ -260,6 +262,57 @@ TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, MaxSteps) {
   }
 }
 
+TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, Abort) {
+  AdaptiveStepSizeIntegrator<ODE> const& integrator =
+      DormandElMikkawyPrince1986RKN434FM<Length>();
+  Length const x_initial = 1 * Metre;
+  Speed const v_initial = 0 * Metre / Second;
+  Time const period = 2 * π * Second;
+  Instant const t_initial;
+  Instant const t_final = t_initial + 10 * period;
+  Length const length_tolerance = 1 * Milli(Metre);
+  Speed const speed_tolerance = 1 * Milli(Metre) / Second;
+
+  auto const step_size_callback = [](bool tolerable) {};
+
+  std::vector<ODE::SystemState> solution;
+  ODE harmonic_oscillator;
+  harmonic_oscillator.compute_acceleration =
+      std::bind(ComputeHarmonicOscillatorAcceleration,
+                _1, _2, _3, /*evaluations=*/nullptr);
+  IntegrationProblem<ODE> problem;
+  problem.equation = harmonic_oscillator;
+  problem.initial_state = {{x_initial}, {v_initial}, t_initial};
+  auto const append_state = [&solution](ODE::SystemState const& state) {
+    solution.push_back(state);
+  };
+  AdaptiveStepSizeIntegrator<ODE>::Parameters const parameters(
+      /*first_time_step=*/t_final - t_initial,
+      /*safety_factor=*/0.9,
+      /*max_steps=*/std::numeric_limits<std::int64_t>::max(),
+      /*last_step_is_exact=*/true);
+  auto const tolerance_to_error_ratio =
+      std::bind(HarmonicOscillatorToleranceRatio,
+                _1, _2,
+                length_tolerance,
+                speed_tolerance,
+                step_size_callback);
+
+  // Abort after 10 steps.
+  std::function<bool()> const abort_requested = AbortRequested;
+  AbortRequested = [&solution]() { return solution.size() >= 10; };
+  auto const instance = integrator.NewInstance(problem,
+                                               append_state,
+                                               tolerance_to_error_ratio,
+                                               parameters);
+  auto const outcome = instance->Solve(t_final);
+  AbortRequested = abort_requested;
+
+  EXPECT_EQ(termination_condition::Cancelled, outcome.error());
+  EXPECT_EQ(10, solution.size());
+  EXPECT_THAT(solution.back().time.value, Lt(t_final));
+}
+
 TEST_F(EmbeddedExplicitRungeKuttaNyströmIntegratorTest, Singularity) {
   // Integrating the position of an ideal rocket,
   //   x"(t) = m' I_sp / m(t),
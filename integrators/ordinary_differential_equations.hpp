@@ -24,6 +24,8 @@ constexpr base::Error Done = base::Error::OK;
 constexpr base::Error ReachedMaximalStepCount = base::Error::ABORTED;
 // A singularity.
 constexpr base::Error VanishingStepSize = base::Error::FAILED_PRECONDITION;
+// The integration was cooperatively aborted, see |base::AbortRequested|.
+constexpr base::Error Cancelled = base::Error::CANCELLED;
 }  // namespace termination_condition
 
 namespace internal_ordinary_differential_equations {
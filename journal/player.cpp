@@ -3,6 +3,7 @@
 
 #include <chrono>
 #include <string>
+#include <utility>
 
 #include "base/array.hpp"
 #include "base/get_line.hpp"
@@ -18,9 +19,45 @@ using base::UniqueBytes;
 
 namespace journal {
 
-Player::Player(std::experimental::filesystem::path const& path)
-    : stream_(path, std::ios::in) {
+namespace {
+
+// The number of messages that the decoder may have decoded and not yet
+// replayed.  This limits the memory footprint of the replay when decoding is
+// faster than execution, which it usually is.
+constexpr std::size_t max_decoded_ahead = 10'000;
+
+}  // namespace
+
+Player::Player(std::experimental::filesystem::path const& path,
+               bool const decode_ahead)
+    : stream_(path, std::ios::in | std::ios::binary) {
   CHECK(!stream_.fail());
+  // Opening in binary mode is harmless for a hexadecimal journal, since
+  // |HexadecimalDecode| ignores the trailing carriage return, if any.
+  if (stream_.peek() ==
+      static_cast<unsigned char>(binary_journal_magic[0])) {
+    std::string magic(sizeof(binary_journal_magic) - 1, '\0');
+    stream_.read(&magic[0], magic.size());
+    CHECK_EQ(binary_journal_magic, magic) << path;
+    int const version = stream_.get();
+    CHECK_EQ(binary_journal_version, version)
+        << "Unsupported version of the binary journal " << path;
+    format_ = Recorder::Format::Binary;
+  }
+  if (decode_ahead) {
+    decoder_ = std::thread(&Player::DecodeLoop, this);
+  }
+}
+
+Player::~Player() {
+  if (decoder_.joinable()) {
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      shutdown_ = true;
+    }
+    decoded_not_full_.notify_all();
+    decoder_.join();
+  }
 }
 
 bool Player::Play() {
@@ -40,12 +77,13 @@ bool Player::Play() {
              << method_out_return->ShortDebugString();
 #endif
 
-  auto const before = std::chrono::system_clock::now();
+  auto const before = std::chrono::steady_clock::now();
 
 #include "journal/player.generated.cc"
 
-  auto const after = std::chrono::system_clock::now();
-  if (after - before > std::chrono::milliseconds(100)) {
+  auto const after = std::chrono::steady_clock::now();
+  last_method_duration_ = after - before;
+  if (last_method_duration_ > std::chrono::milliseconds(100)) {
     LOG(ERROR) << "Long method:\n" << method_in->DebugString();
   }
 
@@ -63,23 +101,110 @@ serialization::Method const& Player::last_method_out_return() const {
   return *last_method_out_return_;
 }
 
+std::chrono::nanoseconds Player::last_method_duration() const {
+  return last_method_duration_;
+}
+
 std::unique_ptr<serialization::Method> Player::Read() {
+  if (!decoder_.joinable()) {
+    return ReadFromStream();
+  }
+  std::unique_ptr<serialization::Method> method;
+  {
+    std::unique_lock<std::mutex> l(lock_);
+    decoded_not_empty_.wait(l, [this]() { return !decoded_.empty(); });
+    method = std::move(decoded_.front());
+    // The end-of-stream marker stays in the queue, so that subsequent calls
+    // also return null.
+    if (method != nullptr) {
+      decoded_.pop_front();
+    }
+  }
+  decoded_not_full_.notify_one();
+  return method;
+}
+
+std::unique_ptr<serialization::Method> Player::ReadFromStream() {
+  UniqueBytes bytes;
+  bool read;
+  switch (format_) {
+    case Recorder::Format::Hexadecimal:
+      read = ReadHexadecimal(bytes);
+      break;
+    case Recorder::Format::Binary:
+      read = ReadBinary(bytes);
+      break;
+  }
+  if (!read) {
+    return nullptr;
+  }
+  auto method = std::make_unique<serialization::Method>();
+  CHECK(method->ParseFromArray(bytes.data.get(),
+                               static_cast<int>(bytes.size)));
+
+  return method;
+}
+
+void Player::DecodeLoop() {
+  for (;;) {
+    std::unique_ptr<serialization::Method> method = ReadFromStream();
+    bool const end_of_stream = method == nullptr;
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      decoded_not_full_.wait(l, [this]() {
+        return shutdown_ || decoded_.size() < max_decoded_ahead;
+      });
+      if (shutdown_) {
+        return;
+      }
+      decoded_.push_back(std::move(method));
+    }
+    decoded_not_empty_.notify_one();
+    if (end_of_stream) {
+      return;
+    }
+  }
+}
+
+bool Player::ReadHexadecimal(UniqueBytes& bytes) {
   std::string const line = GetLine(stream_);
   if (line.empty()) {
-    return nullptr;
+    return false;
   }
 
   std::uint8_t const* const hexadecimal =
       reinterpret_cast<std::uint8_t const*>(line.c_str());
   int const hexadecimal_size = strlen(line.c_str());
-  UniqueBytes bytes(hexadecimal_size >> 1);
+  bytes = UniqueBytes(hexadecimal_size >> 1);
   HexadecimalDecode({hexadecimal, hexadecimal_size},
                     {bytes.data.get(), bytes.size});
-  auto method = std::make_unique<serialization::Method>();
-  CHECK(method->ParseFromArray(bytes.data.get(),
-                               static_cast<int>(bytes.size)));
+  return true;
+}
 
-  return method;
+bool Player::ReadBinary(UniqueBytes& bytes) {
+  // The size of the message is a varint, i.e., 7 bits per byte, least
+  // significant group first, with the high bit set on all but the last byte.
+  std::uint32_t size = 0;
+  for (int shift = 0;; shift += 7) {
+    int const byte = stream_.get();
+    if (byte == std::char_traits<char>::eof()) {
+      LOG_IF(ERROR, shift > 0) << "Truncated size at end of journal";
+      return false;
+    }
+    CHECK_LT(shift, 32) << "Invalid size in journal";
+    size |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      break;
+    }
+  }
+  bytes = UniqueBytes(size);
+  stream_.read(reinterpret_cast<char*>(bytes.data.get()), bytes.size);
+  if (stream_.gcount() != bytes.size) {
+    LOG(ERROR) << "Truncated message at end of journal: " << stream_.gcount()
+               << " bytes instead of " << bytes.size;
+    return false;
+  }
+  return true;
 }
 
 }  // namespace journal
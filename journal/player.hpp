@@ -1,11 +1,19 @@
 ﻿
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <experimental/filesystem>
 #include <fstream>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 
+#include "base/array.hpp"
+#include "base/macros.hpp"
+#include "journal/recorder.hpp"
 #include "serialization/journal.pb.h"
 
 namespace principia {
@@ -15,7 +23,13 @@ class Player final {
  public:
   using PointerMap = std::map<std::uint64_t, void*>;
 
-  explicit Player(std::experimental::filesystem::path const& path);
+  // The format of the journal at |path|, hexadecimal or binary, is detected
+  // from its first bytes.  If |decode_ahead| is true, the messages are read and
+  // decoded by a separate thread, concurrently with the replay.
+  explicit Player(std::experimental::filesystem::path const& path,
+                  bool decode_ahead = false);
+
+  ~Player();
 
   // Replays the next message in the journal.  Returns false at end of journal.
   bool Play();
@@ -24,19 +38,47 @@ class Player final {
   serialization::Method const& last_method_in() const;
   serialization::Method const& last_method_out_return() const;
 
+  // Returns the time spent executing the last replayed method, excluding the
+  // decoding of the messages.
+  std::chrono::nanoseconds last_method_duration() const;
+
  private:
-  // Reads one message from the stream.  Returns a |nullptr| at end of stream.
+  // Returns the next message, either from the stream or from |decoded_|.
+  // Returns a |nullptr| at end of stream.
   std::unique_ptr<serialization::Method> Read();
 
+  // Reads one message from the stream.  Returns a |nullptr| at end of stream.
+  std::unique_ptr<serialization::Method> ReadFromStream();
+
+  // Read the bytes of the next message from the stream in the given format.
+  // Return false at end of stream.
+  bool ReadHexadecimal(base::UniqueBytes& bytes);
+  bool ReadBinary(base::UniqueBytes& bytes);
+
   template<typename Profile>
   bool RunIfAppropriate(serialization::Method const& method_in,
                         serialization::Method const& method_out_return);
 
+  // The loop executed by |decoder_|.
+  void DecodeLoop();
+
   PointerMap pointer_map_;
   std::ifstream stream_;
+  Recorder::Format format_ = Recorder::Format::Hexadecimal;
+
+  // The messages decoded ahead of the replay.  A null message marks the end
+  // of the stream.  Only used if |decode_ahead| was true at construction.
+  std::mutex lock_;
+  std::condition_variable decoded_not_empty_;
+  std::condition_variable decoded_not_full_;
+  std::deque<std::unique_ptr<serialization::Method>> decoded_
+      GUARDED_BY(lock_);
+  bool shutdown_ GUARDED_BY(lock_) = false;
+  std::thread decoder_;
 
   std::unique_ptr<serialization::Method> last_method_in_;
   std::unique_ptr<serialization::Method> last_method_out_return_;
+  std::chrono::nanoseconds last_method_duration_;
 
   friend class PlayerTest;
   friend class RecorderTest;
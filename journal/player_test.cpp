@@ -1,6 +1,8 @@
 ﻿
 #include "journal/player.hpp"
 
+#include <chrono>
+#include <fstream>
 #include <list>
 #include <string>
 #include <thread>
@@ -12,6 +14,7 @@
 #include "journal/method.hpp"
 #include "journal/profiles.hpp"
 #include "journal/recorder.hpp"
+#include "journal/replay_statistics.hpp"
 #include "ksp_plugin/interface.hpp"
 #include "serialization/journal.pb.h"
 
@@ -84,6 +87,70 @@ TEST_F(PlayerTest, PlayTiny) {
   EXPECT_EQ(2, count);
 }
 
+TEST_F(PlayerTest, PlayTinyDecodingAhead) {
+  std::thread recorder([this]() {
+    Recorder* const r(new Recorder(test_name_ + ".journal",
+                                   Recorder::Format::Binary));
+    Recorder::Activate(r);
+
+    for (int i = 0; i < 10; ++i) {
+      {
+        Method<NewPlugin> m({"MJD1", "MJD2", 3});
+        m.Return(plugin_.get());
+      }
+      {
+        const ksp_plugin::Plugin* plugin = plugin_.get();
+        Method<DeletePlugin> m({&plugin}, {&plugin});
+        m.Return();
+      }
+    }
+    Recorder::Deactivate();
+  });
+  recorder.join();
+
+  Player player(test_name_ + ".journal", /*decode_ahead=*/true);
+  ReplayStatistics statistics;
+  int count = 0;
+  while (player.Play()) {
+    statistics.Add(player.last_method_in(), player.last_method_duration());
+    ++count;
+  }
+  EXPECT_EQ(20, count);
+  // Playing past the end of the journal is harmless.
+  EXPECT_FALSE(player.Play());
+  EXPECT_EQ(10, statistics.at("NewPlugin").count);
+  EXPECT_EQ(10, statistics.at("DeletePlugin").count);
+}
+
+// Replays a journal as fast as possible and writes a per-method profile of
+// the replay next to it, in a file with the extension ".csv".
+TEST_F(PlayerTest, DISABLED_Profile) {
+  std::experimental::filesystem::path const path =
+      R"(P:\Public Mockingbird\Principia\Journals\JOURNAL.20171112-193041)";
+  Player player(path, /*decode_ahead=*/true);
+  ReplayStatistics statistics;
+  int count = 0;
+  auto const start = std::chrono::steady_clock::now();
+  while (player.Play()) {
+    statistics.Add(player.last_method_in(), player.last_method_duration());
+    ++count;
+    LOG_IF(ERROR, (count % 100'000) == 0)
+        << count << " journal entries replayed";
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  LOG(ERROR) << count << " journal entries replayed in "
+             << std::chrono::duration<double>(elapsed).count()
+             << " s, of which "
+             << std::chrono::duration<double>(statistics.total()).count()
+             << " s in the interface";
+
+  std::experimental::filesystem::path csv_path = path;
+  csv_path += ".csv";
+  std::ofstream csv(csv_path);
+  CHECK(!csv.fail()) << csv_path;
+  statistics.WriteCsv(csv);
+}
+
 TEST_F(PlayerTest, DISABLED_Benchmarks) {
   benchmark::RunSpecifiedBenchmarks();
 }
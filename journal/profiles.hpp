@@ -20,10 +20,13 @@ using interface::BodyParameters;
 using interface::Burn;
 using interface::KeplerianElements;
 using interface::Iterator;
+using interface::LoadedPart;
 using interface::NavigationFrameParameters;
 using interface::NavigationManoeuvre;
 using interface::NavigationManoeuvreFrenetTrihedron;
 using interface::Origin;
+using interface::PartDegreesOfFreedom;
+using interface::PartIntrinsicForce;
 using interface::QP;
 using interface::WXYZ;
 using interface::XY;
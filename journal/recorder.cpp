@@ -1,38 +1,146 @@
 ﻿
 #include "journal/recorder.hpp"
 
+#include <ctime>
+#include <cstring>
+#include <set>
+#include <utility>
+
 #include "base/array.hpp"
 #include "base/hexadecimal.hpp"
+#include "base/macros.hpp"
 #include "glog/logging.h"
+#include "google/protobuf/io/coded_stream.h"
 
 namespace principia {
 
 using base::HexadecimalEncode;
 using base::UniqueBytes;
+using google::protobuf::io::CodedOutputStream;
 
 namespace journal {
 
-Recorder::Recorder(std::experimental::filesystem::path const& path)
-    : stream_(path, std::ios::out) {
+namespace {
+
+// How long |FlushOnCrash| waits for the writer of a recorder.  The writer may
+// never make progress, e.g., if it is the thread that crashed.
+constexpr std::chrono::seconds crash_flush_timeout(1);
+
+// The asynchronous recorders that must be flushed on crash.
+std::mutex crash_flushed_recorders_lock;
+std::set<Recorder*>* crash_flushed_recorders = new std::set<Recorder*>;
+std::once_flag add_flush_on_crash_sink;
+
+// The binary journals must not be subject to newline translation.
+std::ios::openmode OpenMode(Recorder::Format const format) {
+  switch (format) {
+    case Recorder::Format::Hexadecimal:
+      return std::ios::out;
+    case Recorder::Format::Binary:
+      return std::ios::out | std::ios::binary;
+  }
+  LOG(FATAL) << "Unexpected format " << static_cast<int>(format);
+  base::noreturn();
+}
+
+}  // namespace
+
+// glog sends the fatal messages to the sinks before calling its failure
+// function, so the pending messages are written and the stack trace is still
+// dumped as usual.
+class Recorder::FlushOnCrashSink : public google::LogSink {
+ public:
+  void send(google::LogSeverity severity,
+            char const* full_filename,
+            char const* base_filename,
+            int line,
+            struct ::tm const* tm_time,
+            char const* message,
+            std::size_t message_len) override;
+};
+
+void Recorder::FlushOnCrashSink::send(google::LogSeverity const severity,
+                                      char const* const full_filename,
+                                      char const* const base_filename,
+                                      int const line,
+                                      struct ::tm const* const tm_time,
+                                      char const* const message,
+                                      std::size_t const message_len) {
+  if (severity == google::FATAL) {
+    FlushOnCrash();
+  }
+}
+
+Recorder::Recorder(std::experimental::filesystem::path const& path,
+                   Format const format)
+    : stream_(path, OpenMode(format)),
+      format_(format),
+      asynchronous_(false) {
+  CHECK(!stream_.fail()) << path;
+  WriteHeader();
+}
+
+Recorder::Recorder(std::experimental::filesystem::path const& path,
+                   AsynchronousOptions const& options,
+                   Format const format)
+    : stream_(path, OpenMode(format)),
+      format_(format),
+      asynchronous_(true),
+      options_(options) {
   CHECK(!stream_.fail()) << path;
+  WriteHeader();
+  CHECK_LE(0, options_.flush_every_messages);
+  writer_ = std::thread(&Recorder::WriteLoop, this);
+  if (options_.flush_on_crash) {
+    std::call_once(add_flush_on_crash_sink, []() {
+      google::AddLogSink(new FlushOnCrashSink);
+    });
+    std::lock_guard<std::mutex> l(crash_flushed_recorders_lock);
+    crash_flushed_recorders->insert(this);
+  }
 }
 
 Recorder::~Recorder() {
+  if (asynchronous_) {
+    if (options_.flush_on_crash) {
+      std::lock_guard<std::mutex> l(crash_flushed_recorders_lock);
+      crash_flushed_recorders->erase(this);
+    }
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      shutdown_ = true;
+    }
+    has_work_.notify_all();
+    writer_.join();
+  }
   stream_.close();
 }
 
 void Recorder::Write(serialization::Method const& method) {
   CHECK_LT(0, method.ByteSize()) << method.DebugString();
-  UniqueBytes bytes(method.ByteSize());
-  method.SerializeToArray(bytes.data.get(), static_cast<int>(bytes.size));
-
-  std::int64_t const hexadecimal_size = (bytes.size << 1) + 2;
-  UniqueBytes hexadecimal(hexadecimal_size);
-  HexadecimalEncode({bytes.data.get(), bytes.size}, hexadecimal.get());
-  hexadecimal.data.get()[hexadecimal_size - 2] = '\n';
-  hexadecimal.data.get()[hexadecimal_size - 1] = '\0';
-  stream_ << hexadecimal.data.get();
-  stream_.flush();
+  if (!asynchronous_) {
+    std::vector<std::string> messages(1);
+    method.SerializeToString(&messages.front());
+    WriteBatch(messages);
+    return;
+  }
+
+  // Only the serialization happens on the calling thread, the writer thread
+  // is only woken up if a batch is complete.
+  std::string serialized;
+  method.SerializeToString(&serialized);
+  bool batch_complete;
+  {
+    std::lock_guard<std::mutex> l(lock_);
+    pending_.push_back(std::move(serialized));
+    batch_complete =
+        options_.flush_every_messages > 0 &&
+        pending_.size() == static_cast<std::size_t>(
+                               options_.flush_every_messages);
+  }
+  if (batch_complete) {
+    has_work_.notify_one();
+  }
 }
 
 void Recorder::Activate(base::not_null<Recorder*> const journal) {
@@ -50,6 +158,108 @@ bool Recorder::IsActivated() {
   return active_recorder_ != nullptr;
 }
 
+void Recorder::WriteHeader() {
+  if (format_ == Format::Binary) {
+    stream_.write(binary_journal_magic, sizeof(binary_journal_magic) - 1);
+    stream_.put(static_cast<char>(binary_journal_version));
+    stream_.flush();
+  }
+}
+
+void Recorder::WriteBatch(std::vector<std::string> const& messages) {
+  if (messages.empty()) {
+    return;
+  }
+  // The entire batch is encoded into a single buffer and written at once.
+  std::int64_t encoded_size = 0;
+  for (auto const& message : messages) {
+    switch (format_) {
+      case Format::Hexadecimal:
+        encoded_size += (message.size() << 1) + 1;
+        break;
+      case Format::Binary:
+        encoded_size += CodedOutputStream::VarintSize32(message.size()) +
+                        message.size();
+        break;
+    }
+  }
+  UniqueBytes encoded(encoded_size);
+  std::uint8_t* record = encoded.data.get();
+  for (auto const& message : messages) {
+    switch (format_) {
+      case Format::Hexadecimal: {
+        std::int64_t const line_size = message.size() << 1;
+        HexadecimalEncode(
+            {reinterpret_cast<std::uint8_t const*>(message.data()),
+             static_cast<std::int64_t>(message.size())},
+            {record, line_size});
+        record[line_size] = '\n';
+        record += line_size + 1;
+        break;
+      }
+      case Format::Binary:
+        record = CodedOutputStream::WriteVarint32ToArray(message.size(),
+                                                         record);
+        std::memcpy(record, message.data(), message.size());
+        record += message.size();
+        break;
+    }
+  }
+  CHECK_EQ(encoded.data.get() + encoded.size, record);
+  stream_.write(reinterpret_cast<char const*>(encoded.data.get()),
+                encoded.size);
+  stream_.flush();
+}
+
+void Recorder::WriteLoop() {
+  // The batches are swapped with |pending_| so that its capacity is reused.
+  std::vector<std::string> batch;
+  auto last_write = std::chrono::steady_clock::now();
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> l(lock_);
+      auto const batch_is_ready = [this]() {
+        return shutdown_ || flush_requested_ ||
+               (options_.flush_every_messages > 0 &&
+                pending_.size() >= static_cast<std::size_t>(
+                                       options_.flush_every_messages));
+      };
+      if (options_.flush_period > std::chrono::milliseconds::zero()) {
+        has_work_.wait_until(
+            l, last_write + options_.flush_period, batch_is_ready);
+      } else {
+        has_work_.wait(l, batch_is_ready);
+      }
+      if (shutdown_ && pending_.empty()) {
+        return;
+      }
+      batch.swap(pending_);
+      flush_requested_ = false;
+      writing_ = true;
+    }
+    WriteBatch(batch);
+    batch.clear();
+    last_write = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> l(lock_);
+      writing_ = false;
+    }
+    all_written_.notify_all();
+  }
+}
+
+void Recorder::FlushOnCrash() {
+  std::lock_guard<std::mutex> registry_lock(crash_flushed_recorders_lock);
+  for (Recorder* const recorder : *crash_flushed_recorders) {
+    std::unique_lock<std::mutex> l(recorder->lock_);
+    recorder->flush_requested_ = true;
+    recorder->has_work_.notify_one();
+    recorder->all_written_.wait_for(l, crash_flush_timeout, [recorder]() {
+      return recorder->pending_.empty() && !recorder->writing_;
+    });
+  }
+}
+
 thread_local Recorder* Recorder::active_recorder_ = nullptr;
 
 }  // namespace journal
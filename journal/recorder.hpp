@@ -1,9 +1,17 @@
 ﻿
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <experimental/filesystem>
 #include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "base/macros.hpp"
 #include "base/not_null.hpp"
 #include "serialization/journal.pb.h"
 
@@ -12,9 +20,55 @@ namespace journal {
 
 FORWARD_DECLARE_FROM(method, template<typename Profile> class, Method);
 
+// The first bytes of a journal in |Recorder::Format::Binary|, followed by a
+// byte giving the version of the format.  The first byte is not a hexadecimal
+// digit, so a binary journal cannot be mistaken for a hexadecimal one.
+constexpr char binary_journal_magic[] = "\x89PRINCIPIA JOURNAL\n";
+constexpr std::uint8_t binary_journal_version = 1;
+
 class Recorder final {
  public:
-  explicit Recorder(std::experimental::filesystem::path const& path);
+  // The encoding of the messages in the journal file.
+  enum class Format {
+    // Each message is hexadecimal-encoded on a line of its own.
+    Hexadecimal,
+    // A header made of |binary_journal_magic| and |binary_journal_version|,
+    // followed by the messages, each prefixed by its size as a varint.
+    Binary,
+  };
+
+  // The durability policy of an asynchronous recorder.  The messages are
+  // written and flushed to the file in batches; a batch is written as soon as
+  // one of the conditions below is met, and when the recorder is destroyed.
+  // Note that this is weaker than a synchronous recorder, which has written
+  // the in-message of a method to the file before the method executes: if the
+  // process dies other than by a failed CHECK or a fatal log, e.g., on an
+  // access violation, the pending messages are lost, including the in-message
+  // of the method that crashed.
+  struct AsynchronousOptions {
+    // If positive, a batch is written when that many messages are pending.
+    std::int64_t flush_every_messages = 0;
+    // If positive, a batch is written when that much time has elapsed since
+    // the last one.
+    std::chrono::milliseconds flush_period = std::chrono::seconds(1);
+    // If true, the pending messages are written when a CHECK fails or a fatal
+    // message is logged.
+    bool flush_on_crash = true;
+  };
+
+  // Constructs a synchronous recorder: each message is written and flushed to
+  // the file on the thread that calls |Write|.
+  explicit Recorder(std::experimental::filesystem::path const& path,
+                    Format format = Format::Hexadecimal);
+
+  // Constructs an asynchronous recorder: |Write| only serializes the message
+  // and queues it, and the messages are encoded and written to the file by a
+  // dedicated thread, according to |options|.
+  Recorder(std::experimental::filesystem::path const& path,
+           AsynchronousOptions const& options,
+           Format format = Format::Hexadecimal);
+
+  // Writes all the pending messages before returning.
   ~Recorder();
 
   void Write(serialization::Method const& method);
@@ -24,7 +78,38 @@ class Recorder final {
   static bool IsActivated();
 
  private:
+  // Writes the header of the file, if the format has one.
+  void WriteHeader();
+
+  // Encodes the serialized |messages| and writes them to |stream_|, followed
+  // by a flush.
+  void WriteBatch(std::vector<std::string> const& messages);
+
+  // The loop executed by |writer_|.
+  void WriteLoop();
+
+  // Writes the pending messages of all the asynchronous recorders that have
+  // |flush_on_crash|.
+  static void FlushOnCrash();
+
+  // A glog sink that calls |FlushOnCrash| when a fatal message is logged.
+  class FlushOnCrashSink;
+
   std::ofstream stream_;
+  Format const format_;
+  bool const asynchronous_;
+  AsynchronousOptions const options_;
+
+  std::mutex lock_;
+  std::condition_variable has_work_;
+  std::condition_variable all_written_;
+  // The serialized messages that have not been handed to |writer_| yet.
+  std::vector<std::string> pending_ GUARDED_BY(lock_);
+  // True while |writer_| is writing a batch that it has taken from |pending_|.
+  bool writing_ GUARDED_BY(lock_) = false;
+  bool flush_requested_ GUARDED_BY(lock_) = false;
+  bool shutdown_ GUARDED_BY(lock_) = false;
+  std::thread writer_;
 
   static thread_local Recorder* active_recorder_;
 
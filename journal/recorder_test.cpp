@@ -1,12 +1,15 @@
 ﻿
 #include "journal/recorder.hpp"
 
+#include <fstream>
 #include <list>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "base/array.hpp"
 #include "base/hexadecimal.hpp"
+#include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "journal/method.hpp"
 #include "journal/profiles.hpp"
@@ -125,5 +128,145 @@ TEST_F(RecorderTest, Recording) {
   }
 }
 
+// The parts are an in-out array: the part ids are given by the caller, and the
+// degrees of freedom are filled by the callee before the method returns.
+TEST_F(RecorderTest, InOutRepeatedField) {
+  interface::PartDegreesOfFreedom parts[] = {{17, {{0, 0, 0}, {0, 0, 0}}},
+                                             {42, {{0, 0, 0}, {0, 0, 0}}}};
+  interface::Origin const origin = {/*reference_part_is_at_origin=*/true,
+                                    /*reference_part_is_unmoving=*/false,
+                                    /*reference_part_id=*/17,
+                                    /*main_body_centre_in_world=*/{1, 2, 3}};
+  {
+    Method<GetPartsActualDegreesOfFreedom> m(
+        {plugin_.get(), parts, /*parts_size=*/2, origin},
+        {parts, /*parts_size=*/2});
+    parts[0].degrees_of_freedom = {{1, 2, 3}, {4, 5, 6}};
+    parts[1].degrees_of_freedom = {{7, 8, 9}, {10, 11, 12}};
+    m.Return();
+  }
+
+  std::vector<serialization::Method> const methods =
+      ReadAll(test_name_ + ".journal.hex");
+  ASSERT_EQ(2, methods.size());
+  {
+    auto const& extension = methods[0].GetExtension(
+        serialization::GetPartsActualDegreesOfFreedom::extension);
+    EXPECT_TRUE(extension.has_in());
+    EXPECT_FALSE(extension.has_out());
+    auto const& in = extension.in();
+    EXPECT_NE(0, in.plugin());
+    EXPECT_EQ(17, in.origin().reference_part_id());
+    ASSERT_EQ(2, in.parts_size());
+    EXPECT_EQ(17, in.parts(0).part_id());
+    EXPECT_EQ(0, in.parts(0).degrees_of_freedom().q().x());
+    EXPECT_EQ(42, in.parts(1).part_id());
+    EXPECT_EQ(0, in.parts(1).degrees_of_freedom().p().z());
+  }
+  {
+    auto const& extension = methods[1].GetExtension(
+        serialization::GetPartsActualDegreesOfFreedom::extension);
+    EXPECT_FALSE(extension.has_in());
+    EXPECT_TRUE(extension.has_out());
+    auto const& out = extension.out();
+    ASSERT_EQ(2, out.parts_size());
+    EXPECT_EQ(17, out.parts(0).part_id());
+    EXPECT_EQ(1, out.parts(0).degrees_of_freedom().q().x());
+    EXPECT_EQ(6, out.parts(0).degrees_of_freedom().p().z());
+    EXPECT_EQ(42, out.parts(1).part_id());
+    EXPECT_EQ(7, out.parts(1).degrees_of_freedom().q().x());
+    EXPECT_EQ(12, out.parts(1).degrees_of_freedom().p().z());
+  }
+}
+
+TEST_F(RecorderTest, AsynchronousRecording) {
+  // The fixture's recorder writes to |test_name_ + ".journal.hex"|.
+  std::string const path = test_name_ + ".asynchronous.journal.hex";
+  Recorder::AsynchronousOptions options;
+  options.flush_every_messages = 3;
+  options.flush_period = std::chrono::milliseconds::zero();
+  // The active recorder is thread-local, so the asynchronous recorder is
+  // activated on a separate thread.
+  std::thread recording([this, &options, &path]() {
+    Recorder::Activate(new Recorder(path, options));
+    {
+      const ksp_plugin::Plugin* plugin = plugin_.get();
+      Method<DeletePlugin> m({&plugin}, {&plugin});
+      m.Return();
+    }
+    {
+      Method<NewPlugin> m({"1 s", "2 s", 3});
+      m.Return(plugin_.get());
+    }
+    // Waits for the last message, which does not complete a batch.
+    Recorder::Deactivate();
+  });
+  recording.join();
+
+  std::vector<serialization::Method> const methods = ReadAll(path);
+  ASSERT_EQ(4, methods.size());
+  EXPECT_TRUE(methods[0].HasExtension(serialization::DeletePlugin::extension));
+  EXPECT_TRUE(methods[1].HasExtension(serialization::DeletePlugin::extension));
+  EXPECT_TRUE(methods[2].HasExtension(serialization::NewPlugin::extension));
+  EXPECT_TRUE(methods[3].HasExtension(serialization::NewPlugin::extension));
+  EXPECT_EQ("2 s",
+            methods[2].GetExtension(serialization::NewPlugin::extension)
+                .in().solar_system_epoch());
+}
+
+TEST_F(RecorderTest, BinaryRecording) {
+  std::string const path = test_name_ + ".journal";
+  std::thread recording([this, &path]() {
+    Recorder::Activate(new Recorder(path, Recorder::Format::Binary));
+    {
+      Method<NewPlugin> m({"1 s", "2 s", 3});
+      m.Return(plugin_.get());
+    }
+    Recorder::Deactivate();
+  });
+  recording.join();
+
+  std::ifstream stream(path, std::ios::in | std::ios::binary);
+  std::string magic(sizeof(binary_journal_magic) - 1, '\0');
+  stream.read(&magic[0], magic.size());
+  EXPECT_EQ(binary_journal_magic, magic);
+  EXPECT_EQ(binary_journal_version, stream.get());
+
+  std::vector<serialization::Method> const methods = ReadAll(path);
+  ASSERT_EQ(2, methods.size());
+  auto const& in = methods[0].GetExtension(serialization::NewPlugin::extension);
+  EXPECT_TRUE(in.has_in());
+  EXPECT_EQ("1 s", in.in().game_epoch());
+  auto const& return_ =
+      methods[1].GetExtension(serialization::NewPlugin::extension);
+  EXPECT_TRUE(return_.has_return_());
+  EXPECT_NE(0, return_.return_().result());
+}
+
+TEST_F(JournalDeathTest, FlushOnCrash) {
+  std::string const path = test_name_ + ".asynchronous.journal.hex";
+  EXPECT_DEATH({
+    Recorder::AsynchronousOptions options;
+    options.flush_period = std::chrono::hours(1);
+    Recorder recorder(path, options);
+    serialization::Method method;
+    auto* const in =
+        method.MutableExtension(serialization::NewPlugin::extension)
+            ->mutable_in();
+    in->set_game_epoch("1 s");
+    in->set_solar_system_epoch("2 s");
+    in->set_planetarium_rotation_in_degrees(3);
+    recorder.Write(method);
+    LOG(FATAL) << "Crash";
+  },
+  "Crash");
+
+  std::vector<serialization::Method> const methods = ReadAll(path);
+  ASSERT_EQ(1, methods.size());
+  EXPECT_EQ("1 s",
+            methods[0].GetExtension(serialization::NewPlugin::extension)
+                .in().game_epoch());
+}
+
 }  // namespace journal
 }  // namespace principia
@@ -0,0 +1,94 @@
+﻿
+#include "journal/replay_statistics.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace journal {
+
+namespace {
+
+int Bucket(std::chrono::nanoseconds const duration) {
+  std::int64_t const microseconds =
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+  int bucket = 0;
+  for (std::int64_t upper = 1;
+       upper <= microseconds && bucket < ReplayStatistics::buckets - 1;
+       upper <<= 1) {
+    ++bucket;
+  }
+  return bucket;
+}
+
+// The name of the method message that |method| extends, e.g., "AdvanceTime".
+std::string MethodName(serialization::Method const& method) {
+  std::vector<google::protobuf::FieldDescriptor const*> fields;
+  method.GetReflection()->ListFields(method, &fields);
+  CHECK_EQ(1, fields.size()) << method.DebugString();
+  return fields.front()->message_type()->name();
+}
+
+double Microseconds(std::chrono::nanoseconds const duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+void ReplayStatistics::Add(serialization::Method const& method_in,
+                           std::chrono::nanoseconds const duration) {
+  MethodStatistics& statistics = statistics_[MethodName(method_in)];
+  ++statistics.count;
+  statistics.total += duration;
+  statistics.max = std::max(statistics.max, duration);
+  ++statistics.histogram[Bucket(duration)];
+  total_ += duration;
+}
+
+ReplayStatistics::MethodStatistics const& ReplayStatistics::at(
+    std::string const& method_name) const {
+  auto const it = statistics_.find(method_name);
+  CHECK(it != statistics_.end()) << "No method " << method_name;
+  return it->second;
+}
+
+std::chrono::nanoseconds ReplayStatistics::total() const {
+  return total_;
+}
+
+void ReplayStatistics::WriteCsv(std::ostream& out) const {
+  using Entry = std::pair<std::string const, MethodStatistics>;
+  std::vector<Entry const*> entries;
+  for (auto const& entry : statistics_) {
+    entries.push_back(&entry);
+  }
+  std::sort(entries.begin(),
+            entries.end(),
+            [](Entry const* const left, Entry const* const right) {
+              return left->second.total > right->second.total;
+            });
+
+  out << "method,count,total_us,fraction,mean_us,max_us";
+  out << ",<1us";
+  for (int i = 1; i < buckets - 1; ++i) {
+    out << ",<" << (std::int64_t{1} << i) << "us";
+  }
+  out << ",>=" << (std::int64_t{1} << (buckets - 2)) << "us\n";
+  for (Entry const* const entry : entries) {
+    MethodStatistics const& statistics = entry->second;
+    out << entry->first << "," << statistics.count << ","
+        << Microseconds(statistics.total) << ","
+        << Microseconds(statistics.total) / Microseconds(total_) << ","
+        << Microseconds(statistics.total) / statistics.count << ","
+        << Microseconds(statistics.max);
+    for (std::int64_t const count : statistics.histogram) {
+      out << "," << count;
+    }
+    out << "\n";
+  }
+}
+
+}  // namespace journal
+}  // namespace principia
@@ -0,0 +1,52 @@
+﻿
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "serialization/journal.pb.h"
+
+namespace principia {
+namespace journal {
+
+// Accumulates the durations of the methods replayed by a |Player|, per method.
+class ReplayStatistics final {
+ public:
+  // The durations are binned in powers of 2: bucket i holds the durations in
+  // [2^(i-1) μs, 2^i μs[, bucket 0 the durations below 1 μs, and the last
+  // bucket all the durations above 2^(buckets - 2) μs.
+  static constexpr int buckets = 32;
+
+  struct MethodStatistics {
+    std::int64_t count = 0;
+    std::chrono::nanoseconds total{};
+    std::chrono::nanoseconds max{};
+    std::array<std::int64_t, buckets> histogram{};
+  };
+
+  // Records that the method whose input is |method_in| took |duration|.
+  void Add(serialization::Method const& method_in,
+           std::chrono::nanoseconds duration);
+
+  // The statistics for the method with the given name, e.g., "AdvanceTime".
+  // The method must have been added.
+  MethodStatistics const& at(std::string const& method_name) const;
+
+  // The total time spent in all the methods.
+  std::chrono::nanoseconds total() const;
+
+  // Writes a CSV with one line per method, by decreasing total time, giving
+  // the count, total, mean and maximum durations, and the histogram.
+  void WriteCsv(std::ostream& out) const;
+
+ private:
+  std::map<std::string, MethodStatistics> statistics_;
+  std::chrono::nanoseconds total_{};
+};
+
+}  // namespace journal
+}  // namespace principia
@@ -0,0 +1,71 @@
+﻿
+#include "journal/replay_statistics.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "serialization/journal.pb.h"
+
+namespace principia {
+namespace journal {
+
+using ::testing::StartsWith;
+
+class ReplayStatisticsTest : public ::testing::Test {
+ protected:
+  ReplayStatisticsTest() {
+    advance_time_.MutableExtension(serialization::AdvanceTime::extension)
+        ->mutable_in();
+    delete_plugin_.MutableExtension(serialization::DeletePlugin::extension)
+        ->mutable_in();
+  }
+
+  serialization::Method advance_time_;
+  serialization::Method delete_plugin_;
+  ReplayStatistics statistics_;
+};
+
+TEST_F(ReplayStatisticsTest, Histogram) {
+  statistics_.Add(advance_time_, std::chrono::nanoseconds(500));
+  statistics_.Add(advance_time_, std::chrono::microseconds(1));
+  statistics_.Add(advance_time_, std::chrono::microseconds(3));
+  statistics_.Add(advance_time_, std::chrono::microseconds(3));
+  statistics_.Add(delete_plugin_, std::chrono::hours(1));
+
+  auto const& advance_time = statistics_.at("AdvanceTime");
+  EXPECT_EQ(4, advance_time.count);
+  EXPECT_EQ(std::chrono::nanoseconds(7'500), advance_time.total);
+  EXPECT_EQ(std::chrono::microseconds(3), advance_time.max);
+  EXPECT_EQ(1, advance_time.histogram[0]);
+  EXPECT_EQ(1, advance_time.histogram[1]);
+  EXPECT_EQ(2, advance_time.histogram[2]);
+
+  auto const& delete_plugin = statistics_.at("DeletePlugin");
+  EXPECT_EQ(1, delete_plugin.count);
+  EXPECT_EQ(1, delete_plugin.histogram[ReplayStatistics::buckets - 1]);
+
+  EXPECT_EQ(std::chrono::hours(1) + std::chrono::nanoseconds(7'500),
+            statistics_.total());
+}
+
+TEST_F(ReplayStatisticsTest, Csv) {
+  statistics_.Add(advance_time_, std::chrono::microseconds(3));
+  statistics_.Add(delete_plugin_, std::chrono::microseconds(5));
+  std::stringstream csv;
+  statistics_.WriteCsv(csv);
+  std::string line;
+  std::getline(csv, line);
+  EXPECT_THAT(line, StartsWith("method,count,total_us,fraction,mean_us,max_us,"
+                               "<1us,<2us,<4us,<8us,"));
+  // The methods are sorted by decreasing total time.
+  std::getline(csv, line);
+  EXPECT_THAT(line, StartsWith("DeletePlugin,1,5,0.625,5,5,0,0,0,1,0,"));
+  std::getline(csv, line);
+  EXPECT_THAT(line, StartsWith("AdvanceTime,1,3,0.375,3,3,0,0,1,0,0,"));
+  EXPECT_FALSE(std::getline(csv, line));
+}
+
+}  // namespace journal
+}  // namespace principia
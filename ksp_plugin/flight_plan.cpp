@@ -1,9 +1,11 @@
 ﻿
 #include "ksp_plugin/flight_plan.hpp"
 
+#include <algorithm>
 #include <experimental/optional>
 #include <vector>
 
+#include "base/bundle.hpp"
 #include "integrators/embedded_explicit_runge_kutta_nyström_integrator.hpp"
 #include "testing_utilities/make_not_null.hpp"
 
@@ -11,6 +13,7 @@ namespace principia {
 namespace ksp_plugin {
 namespace internal_flight_plan {
 
+using base::AbortRequested;
 using base::make_not_null_unique;
 using geometry::Position;
 using geometry::Velocity;
@@ -43,6 +46,42 @@ FlightPlan::FlightPlan(
   CoastLastSegment(desired_final_time_);
 }
 
+FlightPlan::FlightPlan(FlightPlan const& other)
+    : initial_mass_(other.initial_mass_),
+      initial_time_(other.initial_time_),
+      initial_degrees_of_freedom_(other.initial_degrees_of_freedom_),
+      desired_final_time_(other.desired_final_time_),
+      root_(make_not_null_unique<DiscreteTrajectory<Barycentric>>()),
+      ephemeris_(other.ephemeris_),
+      adaptive_step_parameters_(other.adaptive_step_parameters_),
+      anomalous_segments_(other.anomalous_segments_) {
+  auto const root_last = other.root_->last();
+  root_->Append(root_last.time(), root_last.degrees_of_freedom());
+
+  // Each segment is forked at the last point of the previous one (or of the
+  // root), so we only need to copy the points after the forks.
+  DiscreteTrajectory<Barycentric>* parent = root_.get();
+  for (auto const other_segment : other.segments_) {
+    segments_.emplace_back(parent->NewForkAtLast());
+    auto it = other_segment->Fork();
+    for (++it; it != other_segment->End(); ++it) {
+      segments_.back()->Append(it.time(), it.degrees_of_freedom());
+    }
+    parent = segments_.back();
+  }
+
+  // The manœuvres own their frames, so they can only be copied through
+  // serialization.  The coasting trajectory of a manœuvre is the coast that
+  // precedes its burn.
+  for (int i = 0; i < other.manœuvres_.size(); ++i) {
+    serialization::Manoeuvre message;
+    other.manœuvres_[i].WriteToMessage(&message);
+    manœuvres_.push_back(
+        NavigationManœuvre::ReadFromMessage(message, ephemeris_));
+    manœuvres_.back().set_coasting_trajectory(segments_[2 * i]);
+  }
+}
+
 Instant FlightPlan::initial_time() const {
   return initial_time_;
 }
@@ -154,6 +193,90 @@ bool FlightPlan::ReplaceLast(Burn burn) {
   return false;
 }
 
+std::vector<std::experimental::optional<double>>
+FlightPlan::EvaluateCandidatesForLast(
+    std::vector<Burn> candidates,
+    Objective const& objective,
+    not_null<WorkStealingExecutor*> const executor) {
+  CHECK(!manœuvres_.empty());
+  std::vector<std::experimental::optional<double>> results(candidates.size());
+  if (candidates.empty()) {
+    return results;
+  }
+
+  Mass const initial_mass = manœuvres_.back().initial_mass();
+  std::vector<NavigationManœuvre> manœuvres;
+  for (auto& candidate : candidates) {
+    manœuvres.push_back(
+        MakeNavigationManœuvre(std::move(candidate), initial_mass));
+    CHECK_EQ(manœuvres.front().initial_time(),
+             manœuvres.back().initial_time());
+  }
+
+  std::vector<bool> feasible(manœuvres.size());
+  for (int i = 0; i < manœuvres.size(); ++i) {
+    auto const& manœuvre = manœuvres[i];
+    feasible[i] = manœuvre.FitsBetween(start_of_penultimate_coast(),
+                                       desired_final_time_) &&
+                  !manœuvre.IsSingular();
+  }
+  if (std::find(feasible.begin(), feasible.end(), true) == feasible.end()) {
+    return results;
+  }
+
+  // The coast leading to the candidates is shared by all of them.  It is a
+  // sibling of the penultimate coast, which is left untouched.
+  DiscreteTrajectory<Barycentric>* coast =
+      CoastIfReachesManœuvreInitialTime(penultimate_coast(),
+                                        manœuvres.front());
+  if (coast == nullptr) {
+    return results;
+  }
+
+  // The forks must be created on this thread, as they modify |coast|.
+  std::vector<DiscreteTrajectory<Barycentric>*> forks(manœuvres.size(),
+                                                      nullptr);
+  for (int i = 0; i < manœuvres.size(); ++i) {
+    if (feasible[i]) {
+      manœuvres[i].set_coasting_trajectory(coast);
+      forks[i] = coast->NewForkAtLast();
+    }
+  }
+
+  // The workers (and |objective|) evaluate the trajectories of the ephemeris
+  // without taking its lock, so they must never prolong it.  Prolong it here
+  // to cover all the candidates.
+  ephemeris_->Prolong(desired_final_time_);
+
+  // The integrations of the candidates are aborted if the caller's are.
+  std::function<bool()> const caller_abort_requested = AbortRequested;
+  executor->ParallelFor(
+      manœuvres.size(),
+      [this,
+       &caller_abort_requested,
+       &desired_final_time = desired_final_time_,
+       &forks,
+       &manœuvres,
+       &objective,
+       &results](std::int64_t const i) {
+        DiscreteTrajectory<Barycentric>* const fork = forks[i];
+        if (fork == nullptr) {
+          return;
+        }
+        std::function<bool()> const worker_abort_requested = AbortRequested;
+        AbortRequested = caller_abort_requested;
+        if (BurnSegment(manœuvres[i], *fork) &&
+            CoastSegment(desired_final_time, *fork)) {
+          results[i] = objective(fork->Fork(), fork->End());
+        }
+        AbortRequested = worker_abort_requested;
+      });
+
+  // This also deletes the forks.
+  coast->parent()->DeleteFork(coast);
+  return results;
+}
+
 bool FlightPlan::SetDesiredFinalTime(Instant const& desired_final_time) {
   if (start_of_last_coast() > desired_final_time) {
     return false;
@@ -238,23 +361,32 @@ std::unique_ptr<FlightPlan> FlightPlan::ReadFromMessage(
           DegreesOfFreedom<Barycentric>::ReadFromMessage(
               message.initial_degrees_of_freedom()));
 
-  auto flight_plan = std::make_unique<FlightPlan>(
-      Mass::ReadFromMessage(message.initial_mass()),
-      initial_time,
-      *initial_degrees_of_freedom,
-      Instant::ReadFromMessage(message.desired_final_time()),
-      ephemeris,
-      *adaptive_step_parameters);
-
+  Instant const desired_final_time =
+      Instant::ReadFromMessage(message.desired_final_time());
+  std::vector<NavigationManœuvre> manœuvres;
   for (int i = 0; i < message.manoeuvre_size(); ++i) {
     auto const& manoeuvre = message.manoeuvre(i);
-    flight_plan->manœuvres_.push_back(
+    manœuvres.push_back(
         NavigationManœuvre::ReadFromMessage(manoeuvre, ephemeris));
   }
+
   // We need to forcefully prolong, otherwise we might exceed the ephemeris
   // step limit while recomputing the segments and fail the check.
-  flight_plan->ephemeris_->Prolong(flight_plan->desired_final_time_);
-  CHECK(flight_plan->RecomputeSegments()) << message.DebugString();
+  ephemeris->Prolong(desired_final_time);
+
+  // The constructor integrates the first coast.  Make it end at the first
+  // manœuvre, like the coast built by |Append|, instead of integrating it until
+  // the desired final time.
+  auto flight_plan = std::make_unique<FlightPlan>(
+      Mass::ReadFromMessage(message.initial_mass()),
+      initial_time,
+      *initial_degrees_of_freedom,
+      manœuvres.empty() ? desired_final_time : manœuvres.front().initial_time(),
+      ephemeris,
+      *adaptive_step_parameters);
+  flight_plan->desired_final_time_ = desired_final_time;
+  flight_plan->manœuvres_ = std::move(manœuvres);
+  CHECK(flight_plan->ComputeMissingSegments()) << message.DebugString();
 
   return flight_plan;
 }
@@ -290,7 +422,13 @@ bool FlightPlan::RecomputeSegments() {
     PopLastSegment();
   }
   ResetLastSegment();
-  for (auto& manœuvre : manœuvres_) {
+  return ComputeMissingSegments();
+}
+
+bool FlightPlan::ComputeMissingSegments() {
+  CHECK_EQ(1, segments_.size() % 2);
+  for (int i = (segments_.size() - 1) / 2; i < manœuvres_.size(); ++i) {
+    auto& manœuvre = manœuvres_[i];
     CoastLastSegment(manœuvre.initial_time());
     manœuvre.set_coasting_trajectory(segments_.back());
     AddSegment();
@@ -301,21 +439,18 @@ bool FlightPlan::RecomputeSegments() {
   return anomalous_segments_ <= 2;
 }
 
-void FlightPlan::BurnLastSegment(NavigationManœuvre const& manœuvre) {
-  if (anomalous_segments_ > 0) {
-    return;
+bool FlightPlan::BurnSegment(NavigationManœuvre const& manœuvre,
+                             DiscreteTrajectory<Barycentric>& segment) const {
+  if (AbortRequested()) {
+    return false;
   } else if (manœuvre.initial_time() < manœuvre.final_time()) {
     if (manœuvre.is_inertially_fixed()) {
-      bool const reached_desired_final_time =
-          ephemeris_->FlowWithAdaptiveStep(segments_.back(),
-                                           manœuvre.IntrinsicAcceleration(),
-                                           manœuvre.final_time(),
-                                           adaptive_step_parameters_,
-                                           max_ephemeris_steps_per_frame,
-                                           /*last_point_only=*/false);
-      if (!reached_desired_final_time) {
-        anomalous_segments_ = 1;
-      }
+      return ephemeris_->FlowWithAdaptiveStep(&segment,
+                                              manœuvre.IntrinsicAcceleration(),
+                                              manœuvre.final_time(),
+                                              adaptive_step_parameters_,
+                                              max_ephemeris_steps_per_frame,
+                                              /*last_point_only=*/false);
     } else {
       // We decompose the manœuvre in smaller unguided manœuvres (movements),
       // which are unguided.
@@ -327,6 +462,9 @@ void FlightPlan::BurnLastSegment(NavigationManœuvre const& manœuvre) {
       serialization::DynamicFrame serialized_manœuvre_frame;
       manœuvre.frame()->WriteToMessage(&serialized_manœuvre_frame);
       for (int i = 0; i < movements; ++i) {
+        if (AbortRequested()) {
+          return false;
+        }
         NavigationManœuvre movement(manœuvre.thrust(),
                                     remaining_mass,
                                     manœuvre.specific_impulse(),
@@ -335,40 +473,49 @@ void FlightPlan::BurnLastSegment(NavigationManœuvre const& manœuvre) {
                                         serialized_manœuvre_frame, ephemeris_),
                                     /*is_inertially_fixed=*/true);
         movement.set_duration(manœuvre.duration() / movements);
-        movement.set_initial_time(segments_.back()->last().time());
-        movement.set_coasting_trajectory(segments_.back());
+        movement.set_initial_time(segment.last().time());
+        movement.set_coasting_trajectory(&segment);
         remaining_mass = movement.final_mass();
         bool const reached_desired_final_time =
-            ephemeris_->FlowWithAdaptiveStep(segments_.back(),
+            ephemeris_->FlowWithAdaptiveStep(&segment,
                                              movement.IntrinsicAcceleration(),
                                              movement.final_time(),
                                              adaptive_step_parameters_,
                                              max_ephemeris_steps_per_frame,
                                              /*last_point_only=*/false);
         if (!reached_desired_final_time) {
-          anomalous_segments_ = 1;
-          return;
+          return false;
         }
       }
     }
   }
+  return true;
+}
+
+bool FlightPlan::CoastSegment(Instant const& desired_final_time,
+                              DiscreteTrajectory<Barycentric>& segment) const {
+  if (AbortRequested()) {
+    return false;
+  }
+  return ephemeris_->FlowWithAdaptiveStep(
+                         &segment,
+                         Ephemeris<Barycentric>::NoIntrinsicAcceleration,
+                         desired_final_time,
+                         adaptive_step_parameters_,
+                         max_ephemeris_steps_per_frame,
+                         /*last_point_only=*/false);
+}
+
+void FlightPlan::BurnLastSegment(NavigationManœuvre const& manœuvre) {
+  if (anomalous_segments_ == 0 && !BurnSegment(manœuvre, *segments_.back())) {
+    anomalous_segments_ = 1;
+  }
 }
 
 void FlightPlan::CoastLastSegment(Instant const& desired_final_time) {
-  if (anomalous_segments_ > 0) {
-    return;
-  } else {
-    bool const reached_desired_final_time =
-        ephemeris_->FlowWithAdaptiveStep(
-                        segments_.back(),
-                        Ephemeris<Barycentric>::NoIntrinsicAcceleration,
-                        desired_final_time,
-                        adaptive_step_parameters_,
-                        max_ephemeris_steps_per_frame,
-                        /*last_point_only=*/false);
-    if (!reached_desired_final_time) {
-      anomalous_segments_ = 1;
-    }
+  if (anomalous_segments_ == 0 &&
+      !CoastSegment(desired_final_time, *segments_.back())) {
+    anomalous_segments_ = 1;
   }
 }
 
@@ -414,15 +561,7 @@ DiscreteTrajectory<Barycentric>* FlightPlan::CoastIfReachesManœuvreInitialTime(
     NavigationManœuvre const& manœuvre) {
   DiscreteTrajectory<Barycentric>* recomputed_coast =
       coast.parent()->NewForkWithoutCopy(coast.Fork().time());
-  bool const reached_manœuvre_initial_time =
-      ephemeris_->FlowWithAdaptiveStep(
-          recomputed_coast,
-          Ephemeris<Barycentric>::NoIntrinsicAcceleration,
-          manœuvre.initial_time(),
-          adaptive_step_parameters_,
-          max_ephemeris_steps_per_frame,
-          /*last_point_only=*/false);
-  if (!reached_manœuvre_initial_time) {
+  if (!CoastSegment(manœuvre.initial_time(), *recomputed_coast)) {
     recomputed_coast->parent()->DeleteFork(recomputed_coast);
   }
   return recomputed_coast;
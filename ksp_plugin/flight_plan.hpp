@@ -1,9 +1,12 @@
 ﻿
 #pragma once
 
+#include <experimental/optional>
+#include <functional>
 #include <vector>
 
 #include "base/not_null.hpp"
+#include "base/work_stealing_executor.hpp"
 #include "geometry/named_quantities.hpp"
 #include "integrators/ordinary_differential_equations.hpp"
 #include "ksp_plugin/burn.hpp"
@@ -21,6 +24,7 @@ namespace ksp_plugin {
 namespace internal_flight_plan {
 
 using base::not_null;
+using base::WorkStealingExecutor;
 using geometry::Instant;
 using integrators::AdaptiveStepSizeIntegrator;
 using physics::DegreesOfFreedom;
@@ -34,6 +38,13 @@ using quantities::Speed;
 // the corresponding |NavigationManœuvre|s.
 class FlightPlan {
  public:
+  // A function of the trajectory followed by the vessel from the beginning of a
+  // burn until the end of the flight plan.  It may be called concurrently for
+  // different trajectories.
+  using Objective = std::function<double(
+      DiscreteTrajectory<Barycentric>::Iterator const& begin,
+      DiscreteTrajectory<Barycentric>::Iterator const& end)>;
+
   // Creates a |FlightPlan| with no burns starting at |initial_time| with
   // |initial_degrees_of_freedom| and with the given |initial_mass|.  The
   // trajectories are computed using the given |integrator| in the given
@@ -45,6 +56,9 @@ class FlightPlan {
              not_null<Ephemeris<Barycentric>*> ephemeris,
              Ephemeris<Barycentric>::AdaptiveStepParameters const&
                  adaptive_step_parameters);
+  // Copies the manœuvres and trajectories of |other|, without integrating
+  // anything.
+  FlightPlan(FlightPlan const& other);
   virtual ~FlightPlan() = default;
 
   virtual Instant initial_time() const;
@@ -59,6 +73,9 @@ class FlightPlan {
   // |burn| would start before |initial_time_| or before the end of the previous
   // burn, or end after |desired_final_time_|, or if the integration of the
   // coasting phase times out or is singular before the burn.
+  // The integrations of a flight plan may be cooperatively aborted by
+  // |base::AbortRequested()|, in which case they behave as if they had timed
+  // out.
   virtual bool Append(Burn burn);
 
   // Forgets the flight plan at least before |time|.  The actual cutoff time
@@ -74,6 +91,23 @@ class FlightPlan {
   // |size()| must be greater than 0.
   virtual bool ReplaceLast(Burn burn);
 
+  // Evaluates |objective| for each of the |candidates| as a replacement for the
+  // last manœuvre.  All the |candidates| must start at the same time.  The
+  // coast until that time is integrated once, as a temporary fork of the
+  // trajectories of this object; the candidates are then integrated
+  // concurrently on |executor|, each on its own fork of that coast, until
+  // |desired_final_time()|.  The forks are deleted before returning, so the
+  // segments and the manœuvres are eventually unchanged, but the trajectories
+  // are modified in the meantime.  The result for a candidate is empty if
+  // |ReplaceLast| would fail for it or if its integration doesn't reach
+  // |desired_final_time()|.  The ephemeris is prolonged until
+  // |desired_final_time()| on the calling thread before the candidates are
+  // integrated.  |size()| must be greater than 0.
+  std::vector<std::experimental::optional<double>> EvaluateCandidatesForLast(
+      std::vector<Burn> candidates,
+      Objective const& objective,
+      not_null<WorkStealingExecutor*> executor);
+
   // Returns false and has no effect if |desired_final_time| is before the end
   // of the last manœuvre or before |initial_time_|.
   virtual bool SetDesiredFinalTime(Instant const& desired_final_time);
@@ -125,6 +159,25 @@ class FlightPlan {
   // recomputation resulted in more than 2 anomalous segments.
   bool RecomputeSegments();
 
+  // Computes the segments of the manœuvres that don't have any, i.e., of
+  // |manœuvres_[(segments_.size() - 1) / 2]| and those that follow it.  The
+  // existing segments are kept.  The last coast is flowed from its current end,
+  // so it must either have been reset or end at the initial time of the first
+  // of these manœuvres: a coast that was partially integrated to another time
+  // would not be the same as one integrated in one go.  Returns false if the
+  // computation resulted in more than 2 anomalous segments.
+  bool ComputeMissingSegments();
+
+  // Flows |segment| for the duration of |manœuvre| using its intrinsic
+  // acceleration.  Returns false if the integration doesn't reach the end of
+  // the manœuvre.
+  bool BurnSegment(NavigationManœuvre const& manœuvre,
+                   DiscreteTrajectory<Barycentric>& segment) const;
+  // Flows |segment| until |desired_final_time| with no intrinsic acceleration.
+  // Returns false if the integration doesn't reach |desired_final_time|.
+  bool CoastSegment(Instant const& desired_final_time,
+                    DiscreteTrajectory<Barycentric>& segment) const;
+
   // Flows the last segment for the duration of |manœuvre| using its intrinsic
   // acceleration.
   void BurnLastSegment(NavigationManœuvre const& manœuvre);
@@ -0,0 +1,140 @@
+﻿
+#include "ksp_plugin/flight_plan_optimizer.hpp"
+
+#include <algorithm>
+#include <experimental/optional>
+#include <vector>
+
+#include "physics/apsides.hpp"
+#include "physics/discrete_trajectory.hpp"
+#include "quantities/si.hpp"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_flight_plan_optimizer {
+
+using geometry::Instant;
+using geometry::Position;
+using physics::ComputeApsides;
+using physics::DiscreteTrajectory;
+using quantities::Abs;
+using quantities::si::Metre;
+
+FlightPlanOptimizer::FlightPlanOptimizer(
+    not_null<FlightPlan*> const flight_plan,
+    not_null<Ephemeris<Barycentric>*> const ephemeris,
+    not_null<WorkStealingExecutor*> const executor)
+    : flight_plan_(flight_plan),
+      ephemeris_(ephemeris),
+      executor_(executor) {}
+
+bool FlightPlanOptimizer::Optimize(FlightPlan::Objective const& objective,
+                                   Speed const& initial_step,
+                                   Speed const& Δv_tolerance,
+                                   int const max_iterations) {
+  CHECK_LT(0, flight_plan_->number_of_manœuvres());
+  auto const& last_manœuvre =
+      flight_plan_->GetManœuvre(flight_plan_->number_of_manœuvres() - 1);
+  Velocity<Frenet<Navigation>> const initial_Δv =
+      last_manœuvre.Δv() == Speed()
+          ? Velocity<Frenet<Navigation>>()
+          : last_manœuvre.Δv() * last_manœuvre.direction();
+
+  std::vector<Burn> initial_candidate;
+  initial_candidate.push_back(MakeLastBurn(initial_Δv));
+  std::experimental::optional<double> const initial_value =
+      flight_plan_->EvaluateCandidatesForLast(std::move(initial_candidate),
+                                              objective,
+                                              executor_).front();
+  if (!initial_value) {
+    return false;
+  }
+
+  Velocity<Frenet<Navigation>> best_Δv = initial_Δv;
+  double best_value = *initial_value;
+  Speed step = initial_step;
+  for (int iteration = 0;
+       iteration < max_iterations && step >= Δv_tolerance;
+       ++iteration) {
+    std::vector<Velocity<Frenet<Navigation>>> const Δvs = {
+        best_Δv + Velocity<Frenet<Navigation>>({step, Speed(), Speed()}),
+        best_Δv - Velocity<Frenet<Navigation>>({step, Speed(), Speed()}),
+        best_Δv + Velocity<Frenet<Navigation>>({Speed(), step, Speed()}),
+        best_Δv - Velocity<Frenet<Navigation>>({Speed(), step, Speed()}),
+        best_Δv + Velocity<Frenet<Navigation>>({Speed(), Speed(), step}),
+        best_Δv - Velocity<Frenet<Navigation>>({Speed(), Speed(), step})};
+    std::vector<Burn> candidates;
+    for (auto const& Δv : Δvs) {
+      candidates.push_back(MakeLastBurn(Δv));
+    }
+    std::vector<std::experimental::optional<double>> const values =
+        flight_plan_->EvaluateCandidatesForLast(std::move(candidates),
+                                                objective,
+                                                executor_);
+
+    bool improved = false;
+    for (int i = 0; i < values.size(); ++i) {
+      if (values[i] && *values[i] < best_value) {
+        best_Δv = Δvs[i];
+        best_value = *values[i];
+        improved = true;
+      }
+    }
+    if (!improved) {
+      step /= 2;
+    }
+  }
+
+  if (best_Δv == initial_Δv) {
+    return true;
+  }
+  return flight_plan_->ReplaceLast(MakeLastBurn(best_Δv));
+}
+
+FlightPlan::Objective FlightPlanOptimizer::PeriapsisDistanceError(
+    not_null<ContinuousTrajectory<Barycentric> const*> const centre,
+    Length const& periapsis_distance) {
+  return [centre, periapsis_distance](
+             DiscreteTrajectory<Barycentric>::Iterator const& begin,
+             DiscreteTrajectory<Barycentric>::Iterator const& end) {
+    auto const distance_at = [centre](Instant const& time,
+                                      Position<Barycentric> const& position) {
+      return (position - centre->EvaluatePosition(time)).Norm();
+    };
+
+    DiscreteTrajectory<Barycentric> apoapsides;
+    DiscreteTrajectory<Barycentric> periapsides;
+    ComputeApsides(*centre, begin, end, apoapsides, periapsides);
+    Length distance;
+    if (periapsides.Empty()) {
+      auto last = end;
+      --last;
+      distance = std::min(
+          distance_at(begin.time(), begin.degrees_of_freedom().position()),
+          distance_at(last.time(), last.degrees_of_freedom().position()));
+    } else {
+      auto const first_periapsis = periapsides.Begin();
+      distance = distance_at(first_periapsis.time(),
+                             first_periapsis.degrees_of_freedom().position());
+    }
+    return Abs(distance - periapsis_distance) / Metre;
+  };
+}
+
+Burn FlightPlanOptimizer::MakeLastBurn(
+    Velocity<Frenet<Navigation>> const& Δv) const {
+  auto const& last_manœuvre =
+      flight_plan_->GetManœuvre(flight_plan_->number_of_manœuvres() - 1);
+  serialization::DynamicFrame serialized_frame;
+  last_manœuvre.frame()->WriteToMessage(&serialized_frame);
+  return {last_manœuvre.thrust(),
+          last_manœuvre.specific_impulse(),
+          NavigationFrame::ReadFromMessage(serialized_frame, ephemeris_),
+          last_manœuvre.initial_time(),
+          Δv,
+          last_manœuvre.is_inertially_fixed()};
+}
+
+}  // namespace internal_flight_plan_optimizer
+}  // namespace ksp_plugin
+}  // namespace principia
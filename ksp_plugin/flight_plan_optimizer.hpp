@@ -0,0 +1,72 @@
+﻿
+#pragma once
+
+#include "base/not_null.hpp"
+#include "base/work_stealing_executor.hpp"
+#include "geometry/grassmann.hpp"
+#include "ksp_plugin/burn.hpp"
+#include "ksp_plugin/flight_plan.hpp"
+#include "ksp_plugin/frames.hpp"
+#include "physics/continuous_trajectory.hpp"
+#include "physics/ephemeris.hpp"
+#include "quantities/quantities.hpp"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_flight_plan_optimizer {
+
+using base::not_null;
+using base::WorkStealingExecutor;
+using geometry::Velocity;
+using physics::ContinuousTrajectory;
+using physics::Ephemeris;
+using physics::Frenet;
+using quantities::Length;
+using quantities::Speed;
+
+// Adjusts the Δv of the last manœuvre of a |FlightPlan| to minimize an
+// objective.  This is a pattern search on the components of Δv in the Frenet
+// frame of the manœuvre: at each iteration the six neighbours of the current
+// Δv are evaluated in a single batch, see
+// |FlightPlan::EvaluateCandidatesForLast|.
+class FlightPlanOptimizer {
+ public:
+  FlightPlanOptimizer(not_null<FlightPlan*> flight_plan,
+                      not_null<Ephemeris<Barycentric>*> ephemeris,
+                      not_null<WorkStealingExecutor*> executor);
+
+  // Minimizes |objective| starting from the current Δv of the last manœuvre of
+  // the flight plan, which must have at least one manœuvre.  The search starts
+  // with steps of |initial_step| and stops when the step falls below
+  // |Δv_tolerance| or after |max_iterations|.  The last manœuvre is replaced if
+  // a better one was found.  Returns false if the current last manœuvre could
+  // not be evaluated (e.g., because the flight plan is anomalous) or if it
+  // could not be replaced.
+  bool Optimize(FlightPlan::Objective const& objective,
+                Speed const& initial_step,
+                Speed const& Δv_tolerance,
+                int max_iterations);
+
+  // An objective that is the absolute difference, in metres, between
+  // |periapsis_distance| and the distance of the first periapsis with respect
+  // to |centre|.  If there is no periapsis, the distance of closest approach,
+  // which is at one end of the trajectory, is used instead.
+  static FlightPlan::Objective PeriapsisDistanceError(
+      not_null<ContinuousTrajectory<Barycentric> const*> centre,
+      Length const& periapsis_distance);
+
+ private:
+  // Returns a burn identical to the last manœuvre, except for its |Δv|.
+  Burn MakeLastBurn(Velocity<Frenet<Navigation>> const& Δv) const;
+
+  not_null<FlightPlan*> const flight_plan_;
+  not_null<Ephemeris<Barycentric>*> const ephemeris_;
+  not_null<WorkStealingExecutor*> const executor_;
+};
+
+}  // namespace internal_flight_plan_optimizer
+
+using internal_flight_plan_optimizer::FlightPlanOptimizer;
+
+}  // namespace ksp_plugin
+}  // namespace principia
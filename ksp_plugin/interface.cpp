@@ -42,6 +42,7 @@ using astronomy::J2000;
 using astronomy::ParseTT;
 using base::Bytes;
 using base::check_not_null;
+using base::Compressor;
 using base::HexadecimalDecode;
 using base::HexadecimalEncode;
 using base::make_not_null_unique;
@@ -144,9 +145,13 @@ serialization::GravityModel::Body MakeGravityModel(
 // If |activate| is true and there is no active journal, create one and
 // activate it.  If |activate| is false and there is an active journal,
 // deactivate it.  Does nothing if there is already a journal in the desired
-// state.  |verbose| causes methods to be output in the INFO log before being
-// executed.
-void principia__ActivateRecorder(bool const activate) {
+// state.  If |asynchronous| is true, the journal is written by a separate
+// thread, which is faster but loses the pending messages, including the
+// in-message of the method that crashed, if the process dies other than by a
+// failed CHECK.  By default each message is written before the method
+// executes.
+void principia__ActivateRecorder(bool const activate,
+                                 bool const asynchronous) {
   // NOTE: Do not journal!  You'd end up with half a message in the journal and
   // that would cause trouble.
   if (activate && !journal::Recorder::IsActivated()) {
@@ -156,9 +161,14 @@ void principia__ActivateRecorder(bool const activate) {
     std::tm* const localtime = std::localtime(&time);
     std::stringstream name;
     name << std::put_time(localtime, "JOURNAL.%Y%m%d-%H%M%S");
+    auto const path =
+        std::experimental::filesystem::path("glog") / "Principia" / name.str();
     journal::Recorder* const recorder =
-        new journal::Recorder(std::experimental::filesystem::path("glog") /
-                                  "Principia" / name.str());
+        asynchronous
+            ? new journal::Recorder(path,
+                                    journal::Recorder::AsynchronousOptions(),
+                                    journal::Recorder::Format::Binary)
+            : new journal::Recorder(path, journal::Recorder::Format::Binary);
     journal::Recorder::Activate(recorder);
   } else if (!activate && journal::Recorder::IsActivated()) {
     journal::Recorder::Deactivate();
@@ -305,12 +315,16 @@ void principia__DeserializePlugin(char const* const serialization,
   if (*deserializer == nullptr) {
     LOG(INFO) << "Begin plugin deserialization";
     *deserializer = new PushDeserializer(chunk_size, number_of_chunks);
-    auto message = make_not_null_unique<serialization::Plugin>();
+    // The plugin is reconstructed as the top-level fields are parsed, so that
+    // the entire message is not materialized.
+    auto const reader = std::make_shared<Plugin::Reader>();
     (*deserializer)->Start(
-        std::move(message),
-        [plugin](google::protobuf::Message const& message) {
-          *plugin = Plugin::ReadFromMessage(
-              static_cast<serialization::Plugin const&>(message)).release();
+        make_not_null_unique<serialization::Plugin>(),
+        [reader](google::protobuf::Message& part) {
+          reader->Add(static_cast<serialization::Plugin&>(part));
+        },
+        [plugin, reader]() {
+          *plugin = reader->Finish().release();
         });
   }
 
@@ -392,6 +406,32 @@ QP principia__GetPartActualDegreesOfFreedom(Plugin const* const plugin,
                             origin.main_body_centre_in_world))))));
 }
 
+// Fills the |degrees_of_freedom| of each of the |parts| with the actual degrees
+// of freedom of the part whose |part_id| is given.  The transformation to
+// |World| is only computed once for the entire batch.
+void principia__GetPartsActualDegreesOfFreedom(
+    Plugin const* const plugin,
+    PartDegreesOfFreedom* const parts,
+    int const parts_size,
+    Origin const origin) {
+  journal::Method<journal::GetPartsActualDegreesOfFreedom> m(
+      {plugin, parts, parts_size, origin},
+      {parts, parts_size});
+  CHECK_NOTNULL(plugin);
+  auto const barycentric_to_world = plugin->BarycentricToWorld(
+      origin.reference_part_is_unmoving,
+      origin.reference_part_id,
+      origin.reference_part_is_at_origin
+          ? std::experimental::nullopt
+          : std::experimental::make_optional(
+                FromXYZ<Position<World>>(origin.main_body_centre_in_world)));
+  for (int i = 0; i < parts_size; ++i) {
+    parts[i].degrees_of_freedom = ToQP(plugin->GetPartActualDegreesOfFreedom(
+        parts[i].part_id, barycentric_to_world));
+  }
+  return m.Return();
+}
+
 int principia__GetStderrLogging() {
   journal::Method<journal::GetStderrLogging> m;
   return m.Return(FLAGS_stderrthreshold);
@@ -451,6 +491,22 @@ void principia__IncrementPartIntrinsicForce(Plugin* const plugin,
   return m.Return();
 }
 
+void principia__IncrementPartIntrinsicForces(
+    Plugin* const plugin,
+    PartIntrinsicForce const* const forces,
+    int const forces_size) {
+  journal::Method<journal::IncrementPartIntrinsicForces> m(
+      {plugin, forces, forces_size});
+  CHECK_NOTNULL(plugin);
+  for (int i = 0; i < forces_size; ++i) {
+    plugin->IncrementPartIntrinsicForce(
+        forces[i].part_id,
+        Vector<Force, World>(FromXYZ(forces[i].force_in_kilonewtons) *
+                             Kilo(Newton)));
+  }
+  return m.Return();
+}
+
 // Sets stderr to log INFO, and redirects stderr, which Unity does not log, to
 // "<KSP directory>/stderr.log".  This provides an easily accessible file
 // containing a sufficiently verbose log of the latest session, instead of
@@ -635,6 +691,44 @@ void principia__InsertOrKeepLoadedPart(
   return m.Return();
 }
 
+// Same as |principia__InsertOrKeepLoadedPart| for all the loaded |parts| of the
+// vessel with GUID |vessel_guid|.
+void principia__InsertOrKeepLoadedParts(
+    Plugin* const plugin,
+    char const* const vessel_guid,
+    LoadedPart const* const parts,
+    int const parts_size,
+    int const main_body_index,
+    QP const main_body_world_degrees_of_freedom,
+    double const delta_t) {
+  journal::Method<journal::InsertOrKeepLoadedParts> m(
+      {plugin,
+       vessel_guid,
+       parts,
+       parts_size,
+       main_body_index,
+       main_body_world_degrees_of_freedom,
+       delta_t});
+  CHECK_NOTNULL(plugin);
+  std::vector<Plugin::LoadedPart> loaded_parts;
+  loaded_parts.reserve(parts_size);
+  for (int i = 0; i < parts_size; ++i) {
+    LoadedPart const& part = parts[i];
+    loaded_parts.push_back(
+        {part.part_id,
+         part.name,
+         part.mass_in_tonnes * Tonne,
+         FromQP<DegreesOfFreedom<World>>(part.world_degrees_of_freedom)});
+  }
+  plugin->InsertOrKeepLoadedParts(
+      vessel_guid,
+      main_body_index,
+      FromQP<DegreesOfFreedom<World>>(main_body_world_degrees_of_freedom),
+      loaded_parts,
+      delta_t * Second);
+  return m.Return();
+}
+
 // Calls |plugin->SetVesselStateOffset| with the arguments given.
 // |plugin| must not be null.  No transfer of ownership.
 void principia__InsertUnloadedPart(Plugin* const plugin,
@@ -752,7 +846,9 @@ char const* principia__SayHello() {
 // |plugin| must not be null.  The caller takes ownership of the result, except
 // when it is null (at the end of the stream).  No transfer of ownership of
 // |*plugin|.  |*serializer| must be null on the first call and must be passed
-// unchanged to the successive calls; its ownership is not transferred.
+// unchanged to the successive calls; its ownership is not transferred.  The
+// serialization is compressed; |principia__DeserializePlugin| accepts both
+// compressed and uncompressed serializations.
 char const* principia__SerializePlugin(Plugin const* const plugin,
                                        PullSerializer** const serializer) {
   journal::Method<journal::SerializePlugin> m({plugin, serializer},
@@ -763,10 +859,9 @@ char const* principia__SerializePlugin(Plugin const* const plugin,
   // Create and start a serializer if the caller didn't provide one.
   if (*serializer == nullptr) {
     LOG(INFO) << "Begin plugin serialization";
-    *serializer = new PullSerializer(chunk_size, number_of_chunks);
-    auto message = make_not_null_unique<serialization::Plugin>();
-    plugin->WriteToMessage(message.get());
-    (*serializer)->Start(std::move(message));
+    *serializer =
+        new PullSerializer(chunk_size, number_of_chunks, Compressor::LZ4);
+    plugin->WriteToSerializer(*serializer);
   }
 
   // Pull a chunk.
@@ -789,6 +884,64 @@ char const* principia__SerializePlugin(Plugin const* const plugin,
   return m.Return(reinterpret_cast<char const*>(hexadecimal.data.release()));
 }
 
+// Same as |principia__SerializePlugin|, but the serialization is handed over
+// without being encoded or copied: |*data| is set to a chunk of |*size| bytes
+// in the buffers of the serializer, or to null at the end of the
+// serialization.  The chunk is not owned by the caller and remains valid until
+// the next call, which acknowledges its consumption.  The serializer created
+// by the first call has |chunk_count| buffers of |chunk_bytes| bytes; these
+// parameters are ignored by the successive calls.  Like that of
+// |principia__SerializePlugin|, the serialization is compressed with LZ4.
+// This is not used by the adapter, which saves the plugin in the values of a
+// |ConfigNode| and therefore needs strings: encoding the chunks in C# would be
+// slower than |principia__SerializePlugin|.  Saving a game therefore still
+// encodes the serialization in hexadecimal and allocates a string for each
+// chunk.  This function is meant for clients that write the serialization to a
+// binary file.
+void principia__SerializePluginBinary(Plugin const* const plugin,
+                                      PullSerializer** const serializer,
+                                      int const chunk_bytes,
+                                      int const chunk_count,
+                                      std::uint8_t const** const data,
+                                      int* const size) {
+  journal::Method<journal::SerializePluginBinary> m(
+      {plugin, serializer, chunk_bytes, chunk_count},
+      {serializer, data, size});
+  CHECK_NOTNULL(plugin);
+  CHECK_NOTNULL(serializer);
+  CHECK_NOTNULL(data);
+  CHECK_NOTNULL(size);
+
+  // Create and start a serializer if the caller didn't provide one.
+  if (*serializer == nullptr) {
+    LOG(INFO) << "Begin binary plugin serialization";
+    CHECK_LT(0, chunk_bytes);
+    // The serializer needs at least one chunk being filled, one in the queue
+    // and one held by the caller.
+    CHECK_LE(3, chunk_count);
+    *serializer =
+        new PullSerializer(chunk_bytes, chunk_count, Compressor::LZ4);
+    plugin->WriteToSerializer(*serializer);
+  }
+
+  // Pull a chunk.  This releases the chunk returned by the previous call.
+  Bytes const bytes = (*serializer)->Pull();
+
+  // If this is the end of the serialization, delete the serializer and return a
+  // nullptr.
+  if (bytes.size == 0) {
+    LOG(INFO) << "End binary plugin serialization";
+    TakeOwnership(serializer);
+    *data = nullptr;
+    *size = 0;
+    return m.Return();
+  }
+
+  *data = bytes.data;
+  *size = static_cast<int>(bytes.size);
+  return m.Return();
+}
+
 // Sets the maximum number of seconds which logs may be buffered for.
 void principia__SetBufferDuration(int const seconds) {
   journal::Method<journal::SetBufferDuration> m({seconds});
@@ -826,6 +979,25 @@ void principia__SetPartApparentDegreesOfFreedom(
   return m.Return();
 }
 
+void principia__SetPartsApparentDegreesOfFreedom(
+    Plugin* const plugin,
+    PartDegreesOfFreedom const* const parts,
+    int const parts_size,
+    QP const main_body_degrees_of_freedom) {
+  journal::Method<journal::SetPartsApparentDegreesOfFreedom> m(
+      {plugin, parts, parts_size, main_body_degrees_of_freedom});
+  CHECK_NOTNULL(plugin);
+  auto const main_body =
+      FromQP<DegreesOfFreedom<World>>(main_body_degrees_of_freedom);
+  for (int i = 0; i < parts_size; ++i) {
+    plugin->SetPartApparentDegreesOfFreedom(
+        parts[i].part_id,
+        FromQP<DegreesOfFreedom<World>>(parts[i].degrees_of_freedom),
+        main_body);
+  }
+  return m.Return();
+}
+
 // Make it so that all log messages of at least |min_severity| are logged to
 // stderr (in addition to logging to the usual log file(s)).
 void principia__SetStderrLogging(int const min_severity) {
@@ -851,6 +1023,18 @@ void principia__SetVerboseLogging(int const level) {
   return m.Return();
 }
 
+// Sets the memory budget for the history of each vessel, in bytes.  The
+// oldest part of the histories is compressed as needed to fit in the budget.
+void principia__SetVesselHistoryMemoryBudget(
+    Plugin* const plugin,
+    std::int64_t const vessel_history_memory_budget) {
+  journal::Method<journal::SetVesselHistoryMemoryBudget> m(
+      {plugin, vessel_history_memory_budget});
+  CHECK_NOTNULL(plugin);
+  plugin->SetVesselHistoryMemoryBudget(vessel_history_memory_budget);
+  return m.Return();
+}
+
 void principia__SetWorldRotationalReferenceFrame(Plugin* const plugin,
                                                  int const index) {
   journal::Method<journal::SetWorldRotationalReferenceFrame> m({plugin, index});
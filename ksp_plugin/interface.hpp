@@ -65,7 +65,7 @@ std::unique_ptr<T[]> TakeOwnershipArray(T** pointer);
 #include "ksp_plugin/interface.generated.h"
 
 extern "C" PRINCIPIA_DLL
-void CDECL principia__ActivateRecorder(bool activate);
+void CDECL principia__ActivateRecorder(bool activate, bool asynchronous);
 
 extern "C" PRINCIPIA_DLL
 void CDECL principia__InitGoogleLogging();
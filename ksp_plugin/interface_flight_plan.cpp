@@ -74,6 +74,16 @@ FlightPlan& GetFlightPlan(Plugin const& plugin,
   return vessel.flight_plan();
 }
 
+// Same as above, but for synchronous edits: they must not be interleaved with
+// the asynchronous ones, so they first wait for the latter.
+FlightPlan& GetFlightPlanForEdit(Plugin const& plugin,
+                                 char const* const vessel_guid) {
+  Vessel& vessel = *plugin.GetVessel(vessel_guid);
+  vessel.WaitForFlightPlan();
+  CHECK(vessel.has_flight_plan()) << vessel_guid;
+  return vessel.flight_plan();
+}
+
 Burn GetBurn(Plugin const& plugin,
              NavigationManœuvre const& manœuvre) {
   Velocity<Frenet<NavigationFrame>> const Δv =
@@ -183,7 +193,7 @@ bool principia__FlightPlanAppend(Plugin const* const plugin,
                                  Burn const burn) {
   journal::Method<journal::FlightPlanAppend> m({plugin, vessel_guid, burn});
   CHECK_NOTNULL(plugin);
-  return m.Return(GetFlightPlan(*plugin, vessel_guid).
+  return m.Return(GetFlightPlanForEdit(*plugin, vessel_guid).
                       Append(FromInterfaceBurn(*plugin, burn)));
 }
 
@@ -314,6 +324,16 @@ principia__FlightPlanGetManoeuvreFrenetTrihedron(Plugin const* const plugin,
   return m.Return(result);
 }
 
+// Returns true if the asynchronous edits have not all been published by
+// |principia__FlightPlanPoll|, in which case the other functions operate on the
+// last published flight plan.  Has no side effects.
+bool principia__FlightPlanIsComputing(Plugin const* const plugin,
+                                      char const* const vessel_guid) {
+  journal::Method<journal::FlightPlanIsComputing> m({plugin, vessel_guid});
+  CHECK_NOTNULL(plugin);
+  return m.Return(plugin->GetVessel(vessel_guid)->flight_plan_is_computing());
+}
+
 int principia__FlightPlanNumberOfManoeuvres(Plugin const* const plugin,
                                             char const* const vessel_guid) {
   journal::Method<journal::FlightPlanNumberOfManoeuvres> m({plugin,
@@ -329,11 +349,21 @@ int principia__FlightPlanNumberOfSegments(Plugin const* const plugin,
   return m.Return(GetFlightPlan(*plugin, vessel_guid).number_of_segments());
 }
 
+// Publishes the flight plan recomputed after asynchronous edits, if the
+// recomputation is complete.
+void principia__FlightPlanPoll(Plugin const* const plugin,
+                               char const* const vessel_guid) {
+  journal::Method<journal::FlightPlanPoll> m({plugin, vessel_guid});
+  CHECK_NOTNULL(plugin);
+  plugin->GetVessel(vessel_guid)->RefreshFlightPlan();
+  return m.Return();
+}
+
 void principia__FlightPlanRemoveLast(Plugin const* const plugin,
                                      char const* const vessel_guid) {
   journal::Method<journal::FlightPlanRemoveLast> m({plugin, vessel_guid});
   CHECK_NOTNULL(plugin);
-  GetFlightPlan(*plugin, vessel_guid).RemoveLast();
+  GetFlightPlanForEdit(*plugin, vessel_guid).RemoveLast();
   return m.Return();
 }
 
@@ -457,10 +487,35 @@ bool principia__FlightPlanReplaceLast(Plugin const* const plugin,
                                                      vessel_guid,
                                                      burn});
   CHECK_NOTNULL(plugin);
-  return m.Return(GetFlightPlan(*plugin, vessel_guid).
+  return m.Return(GetFlightPlanForEdit(*plugin, vessel_guid).
                       ReplaceLast(FromInterfaceBurn(*plugin, burn)));
 }
 
+// Like |principia__FlightPlanReplaceLast|, but the flight plan is recomputed
+// asynchronously, superseding any pending replacement.  The outcome is known
+// once it has been published by |principia__FlightPlanPoll|, i.e., once
+// |principia__FlightPlanIsComputing| returns false.
+void principia__FlightPlanReplaceLastAsynchronously(
+    Plugin const* const plugin,
+    char const* const vessel_guid,
+    Burn const burn) {
+  journal::Method<journal::FlightPlanReplaceLastAsynchronously> m(
+      {plugin, vessel_guid, burn});
+  CHECK_NOTNULL(plugin);
+  CHECK(plugin->GetVessel(vessel_guid)->has_flight_plan()) << vessel_guid;
+  // The edit may be applied more than once if its recomputation is aborted,
+  // and |ksp_plugin::Burn| is not copyable, so the burn is converted by the
+  // edit.  This only reads the celestials and the game epoch, which don't
+  // change after initialization.
+  plugin->EditFlightPlanAsynchronously(
+      vessel_guid,
+      [plugin, burn](FlightPlan& flight_plan) {
+        return flight_plan.ReplaceLast(FromInterfaceBurn(*plugin, burn));
+      },
+      /*coalesce=*/true);
+  return m.Return();
+}
+
 bool principia__FlightPlanSetAdaptiveStepParameters(
     Plugin const* const plugin,
     char const* const vessel_guid,
@@ -469,7 +524,7 @@ bool principia__FlightPlanSetAdaptiveStepParameters(
       {plugin, vessel_guid, adaptive_step_parameters});
   CHECK_NOTNULL(plugin);
   return m.Return(
-      GetFlightPlan(*plugin, vessel_guid).
+      GetFlightPlanForEdit(*plugin, vessel_guid).
           SetAdaptiveStepParameters(
               FromAdaptiveStepParameters(adaptive_step_parameters)));
 }
@@ -481,7 +536,7 @@ bool principia__FlightPlanSetDesiredFinalTime(Plugin const* const plugin,
                                                              vessel_guid,
                                                              final_time});
   CHECK_NOTNULL(plugin);
-  return m.Return(GetFlightPlan(*plugin, vessel_guid).
+  return m.Return(GetFlightPlanForEdit(*plugin, vessel_guid).
                       SetDesiredFinalTime(FromGameTime(*plugin, final_time)));
 }
 
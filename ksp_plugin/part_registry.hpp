@@ -0,0 +1,109 @@
+﻿
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ksp_plugin/identification.hpp"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_part_registry {
+
+// The order in which the entries of a |PartRegistry| are iterated over.
+enum class PartOrder {
+  // An order that depends on the history of insertions and erasures.
+  // Insertion and erasure take constant time.
+  Unspecified,
+  // The increasing order of the keys, as for a |std::map|, which doesn't
+  // depend on the history of the registry.  Insertion and erasure take a time
+  // linear in the size of the registry, so entries should be inserted and
+  // extracted in bulk when there are many of them.
+  Increasing,
+};
+
+// An associative container keyed by |PartId|, used for the per-part lookups
+// that the adapter does every frame.  The entries are stored contiguously, in
+// the given |order|, and are found in constant time through a hash index.
+// |PartOrder::Increasing| is for the registries that are iterated over by
+// computations that must be reproducible across a reload, e.g., the parts of a
+// vessel; the others should use |PartOrder::Unspecified| and sort the entries
+// when needed.  Insertion and erasure invalidate the pointers and iterators
+// into the registry.
+template<typename Value, PartOrder order>
+class PartRegistry {
+  using Entries = std::vector<std::pair<PartId, Value>>;
+
+ public:
+  using value_type = typename Entries::value_type;
+  using iterator = typename Entries::iterator;
+  using const_iterator = typename Entries::const_iterator;
+
+  bool empty() const;
+  std::size_t size() const;
+
+  void reserve(std::size_t size);
+
+  bool Contains(PartId part_id) const;
+
+  // Returns the value associated with |part_id|, or null if there is none.
+  Value* Find(PartId part_id);
+  Value const* Find(PartId part_id) const;
+
+  // Returns the value associated with |part_id|, which must exist.
+  Value& at(PartId part_id);
+  Value const& at(PartId part_id) const;
+
+  // Associates |value| with |part_id| unless there is already a value for that
+  // key.  Returns a pointer to the value associated with |part_id| and whether
+  // the insertion took place.
+  std::pair<Value*, bool> Emplace(PartId part_id, Value value);
+
+  // Inserts the given |entries|, whose keys must be distinct and not already
+  // in this registry.  Contrary to repeated calls to |Emplace|, this takes a
+  // time linear in the size of the registry (plus the time to sort |entries|).
+  void EmplaceAll(std::vector<value_type> entries);
+
+  // Removes and returns the value associated with |part_id|, which must exist.
+  Value Extract(PartId part_id);
+
+  // Removes the value associated with |part_id|, if any.  Returns whether a
+  // value was removed.
+  bool Erase(PartId part_id);
+
+  // Removes and returns the entries for which |predicate(part_id, value)| is
+  // true.  The entries are visited, and returned, in the iteration order.
+  // Contrary to repeated calls to |Extract|, this takes a time linear in the
+  // size of the registry.
+  template<typename Predicate>
+  std::vector<value_type> ExtractIf(Predicate predicate);
+
+  // Same as |ExtractIf|, but the entries are destroyed.
+  template<typename Predicate>
+  void EraseIf(Predicate predicate);
+
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+
+ private:
+  // Sets the indices of the entries at or after |first| to their positions in
+  // |entries_|.
+  void Reindex(std::int32_t first);
+
+  Entries entries_;
+  std::unordered_map<PartId, std::int32_t> indices_;
+};
+
+}  // namespace internal_part_registry
+
+using internal_part_registry::PartOrder;
+using internal_part_registry::PartRegistry;
+
+}  // namespace ksp_plugin
+}  // namespace principia
+
+#include "ksp_plugin/part_registry_body.hpp"
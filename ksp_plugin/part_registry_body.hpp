@@ -0,0 +1,226 @@
+﻿
+#pragma once
+
+#include "ksp_plugin/part_registry.hpp"
+
+#include <algorithm>
+
+#include "glog/logging.h"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_part_registry {
+
+template<typename Value, PartOrder order>
+bool PartRegistry<Value, order>::empty() const {
+  return entries_.empty();
+}
+
+template<typename Value, PartOrder order>
+std::size_t PartRegistry<Value, order>::size() const {
+  return entries_.size();
+}
+
+template<typename Value, PartOrder order>
+void PartRegistry<Value, order>::reserve(std::size_t const size) {
+  entries_.reserve(size);
+  indices_.reserve(size);
+}
+
+template<typename Value, PartOrder order>
+bool PartRegistry<Value, order>::Contains(PartId const part_id) const {
+  return indices_.find(part_id) != indices_.end();
+}
+
+template<typename Value, PartOrder order>
+Value* PartRegistry<Value, order>::Find(PartId const part_id) {
+  auto const it = indices_.find(part_id);
+  if (it == indices_.end()) {
+    return nullptr;
+  }
+  return &entries_[it->second].second;
+}
+
+template<typename Value, PartOrder order>
+Value const* PartRegistry<Value, order>::Find(PartId const part_id) const {
+  auto const it = indices_.find(part_id);
+  if (it == indices_.end()) {
+    return nullptr;
+  }
+  return &entries_[it->second].second;
+}
+
+template<typename Value, PartOrder order>
+Value& PartRegistry<Value, order>::at(PartId const part_id) {
+  Value* const value = Find(part_id);
+  CHECK(value != nullptr) << "No part " << part_id;
+  return *value;
+}
+
+template<typename Value, PartOrder order>
+Value const& PartRegistry<Value, order>::at(PartId const part_id) const {
+  Value const* const value = Find(part_id);
+  CHECK(value != nullptr) << "No part " << part_id;
+  return *value;
+}
+
+template<typename Value, PartOrder order>
+std::pair<Value*, bool> PartRegistry<Value, order>::Emplace(
+    PartId const part_id,
+    Value value) {
+  auto const found = indices_.find(part_id);
+  if (found != indices_.end()) {
+    return {&entries_[found->second].second, false};
+  }
+  iterator it;
+  switch (order) {
+    case PartOrder::Unspecified:
+      entries_.emplace_back(part_id, std::move(value));
+      it = entries_.end() - 1;
+      break;
+    case PartOrder::Increasing:
+      it = entries_.emplace(
+          std::lower_bound(entries_.begin(),
+                           entries_.end(),
+                           part_id,
+                           [](value_type const& entry, PartId const part_id) {
+                             return entry.first < part_id;
+                           }),
+          part_id,
+          std::move(value));
+      Reindex(it - entries_.begin() + 1);
+      break;
+  }
+  indices_.emplace(part_id, it - entries_.begin());
+  return {&it->second, true};
+}
+
+template<typename Value, PartOrder order>
+void PartRegistry<Value, order>::EmplaceAll(std::vector<value_type> entries) {
+  if (entries.empty()) {
+    return;
+  }
+  std::int32_t const first_new = entries_.size();
+  reserve(entries_.size() + entries.size());
+  for (auto& entry : entries) {
+    CHECK(indices_.emplace(entry.first, entries_.size()).second)
+        << "Duplicate part " << entry.first;
+    entries_.push_back(std::move(entry));
+  }
+  switch (order) {
+    case PartOrder::Unspecified:
+      break;
+    case PartOrder::Increasing: {
+      auto const key_less = [](value_type const& left,
+                               value_type const& right) {
+        return left.first < right.first;
+      };
+      auto const middle = entries_.begin() + first_new;
+      std::sort(middle, entries_.end(), key_less);
+      // The entries that precede the smallest new key don't move.
+      std::int32_t const first_moved =
+          std::upper_bound(entries_.begin(), middle, *middle, key_less) -
+          entries_.begin();
+      std::inplace_merge(entries_.begin(), middle, entries_.end(), key_less);
+      Reindex(first_moved);
+      break;
+    }
+  }
+}
+
+template<typename Value, PartOrder order>
+Value PartRegistry<Value, order>::Extract(PartId const part_id) {
+  auto const it = indices_.find(part_id);
+  CHECK(it != indices_.end()) << "No part " << part_id;
+  std::int32_t const index = it->second;
+  indices_.erase(it);
+  Value result = std::move(entries_[index].second);
+  switch (order) {
+    case PartOrder::Unspecified:
+      // Move the last entry into the freed slot.
+      if (index != static_cast<std::int32_t>(entries_.size()) - 1) {
+        entries_[index] = std::move(entries_.back());
+        indices_[entries_[index].first] = index;
+      }
+      entries_.pop_back();
+      break;
+    case PartOrder::Increasing:
+      entries_.erase(entries_.begin() + index);
+      Reindex(index);
+      break;
+  }
+  return result;
+}
+
+template<typename Value, PartOrder order>
+bool PartRegistry<Value, order>::Erase(PartId const part_id) {
+  if (!Contains(part_id)) {
+    return false;
+  }
+  Extract(part_id);
+  return true;
+}
+
+template<typename Value, PartOrder order>
+template<typename Predicate>
+std::vector<typename PartRegistry<Value, order>::value_type>
+PartRegistry<Value, order>::ExtractIf(Predicate predicate) {
+  std::vector<value_type> extracted;
+  std::int32_t retained = 0;
+  for (std::int32_t i = 0; i < entries_.size(); ++i) {
+    auto& entry = entries_[i];
+    if (predicate(entry.first, entry.second)) {
+      indices_.erase(entry.first);
+      extracted.push_back(std::move(entry));
+    } else {
+      if (retained != i) {
+        entries_[retained] = std::move(entry);
+        indices_[entries_[retained].first] = retained;
+      }
+      ++retained;
+    }
+  }
+  entries_.erase(entries_.begin() + retained, entries_.end());
+  return extracted;
+}
+
+template<typename Value, PartOrder order>
+template<typename Predicate>
+void PartRegistry<Value, order>::EraseIf(Predicate predicate) {
+  ExtractIf(std::move(predicate));
+}
+
+template<typename Value, PartOrder order>
+void PartRegistry<Value, order>::Reindex(std::int32_t const first) {
+  for (std::int32_t i = first; i < entries_.size(); ++i) {
+    indices_[entries_[i].first] = i;
+  }
+}
+
+template<typename Value, PartOrder order>
+typename PartRegistry<Value, order>::iterator
+PartRegistry<Value, order>::begin() {
+  return entries_.begin();
+}
+
+template<typename Value, PartOrder order>
+typename PartRegistry<Value, order>::iterator
+PartRegistry<Value, order>::end() {
+  return entries_.end();
+}
+
+template<typename Value, PartOrder order>
+typename PartRegistry<Value, order>::const_iterator
+PartRegistry<Value, order>::begin() const {
+  return entries_.begin();
+}
+
+template<typename Value, PartOrder order>
+typename PartRegistry<Value, order>::const_iterator
+PartRegistry<Value, order>::end() const {
+  return entries_.end();
+}
+
+}  // namespace internal_part_registry
+}  // namespace ksp_plugin
+}  // namespace principia
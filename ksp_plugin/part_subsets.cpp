@@ -2,6 +2,7 @@
 #include "ksp_plugin/part_subsets.hpp"
 
 #include <list>
+#include <vector>
 
 #include "ksp_plugin/part.hpp"
 #include "ksp_plugin/pile_up.hpp"
@@ -18,31 +19,42 @@ using physics::Ephemeris;
 namespace base {
 
 Subset<Part>::Properties::Properties(not_null<ksp_plugin::Part*> const part)
-    : total_mass_(part->mass()),
+    : first_part_(part),
+      total_mass_(part->mass()),
       total_intrinsic_force_(part->intrinsic_force()) {
   if (part->is_piled_up()) {
     missing_ = part->containing_pile_up()->iterator()->parts().size() - 1;
   }
-  parts_.emplace_back(part);
 }
 
 void Subset<Part>::Properties::MergeWith(Properties& other) {
   if (SubsetsOfSamePileUp(*this, other)) {
     // The subsets |*this| and |other| are disjoint.
-    CHECK_EQ(missing_ - other.parts_.size(),
-             other.missing_ - parts_.size());
-    missing_ -= other.parts_.size();
+    CHECK_EQ(missing_ - other.number_of_parts_,
+             other.missing_ - number_of_parts_);
+    missing_ -= other.number_of_parts_;
     CHECK_GE(missing_, 0);
   } else {
-    parts_.front()->clear_pile_up();
-    other.parts_.front()->clear_pile_up();
+    first_part_->clear_pile_up();
+    other.first_part_->clear_pile_up();
   }
-  parts_.splice(parts_.end(), other.parts_);
+  number_of_parts_ += other.number_of_parts_;
   total_mass_ += other.total_mass_;
   total_intrinsic_force_ += other.total_intrinsic_force_;
   grounded_ |= other.grounded_;
 }
 
+void Subset<Part>::Properties::AddPart(not_null<Part*> const part) {
+  if (EqualsExistingPileUp()) {
+    return;
+  }
+  if (parts_.empty()) {
+    parts_.reserve(number_of_parts_);
+  }
+  parts_.push_back(part);
+  CHECK_LE(parts_.size(), number_of_parts_);
+}
+
 void Subset<Part>::Properties::Ground() {
   grounded_ = true;
 }
@@ -63,13 +75,14 @@ void Subset<Part>::Properties::Collect(
   }
   collected_ = true;
   if (EqualsExistingPileUp()) {
-    PileUp& pile_up = *parts_.front()->containing_pile_up()->iterator();
+    PileUp& pile_up = *first_part_->containing_pile_up()->iterator();
     pile_up.set_mass(total_mass_);
     pile_up.set_intrinsic_force(total_intrinsic_force_);
   } else {
     if (StrictSubsetOfExistingPileUp()) {
-      parts_.front()->clear_pile_up();
+      first_part_->clear_pile_up();
     }
+    CHECK_EQ(number_of_parts_, parts_.size());
     pile_ups->emplace_front(std::move(parts_),
                             t,
                             adaptive_step_parameters,
@@ -86,8 +99,8 @@ bool Subset<Part>::Properties::SubsetsOfSamePileUp(
     Properties const& left,
     Properties const& right) {
   return left.SubsetOfExistingPileUp() && right.SubsetOfExistingPileUp() &&
-         left.parts_.front()->containing_pile_up()->iterator() ==
-             right.parts_.front()->containing_pile_up()->iterator();
+         left.first_part_->containing_pile_up()->iterator() ==
+             right.first_part_->containing_pile_up()->iterator();
 }
 
 bool Subset<Part>::Properties::EqualsExistingPileUp() const {
@@ -95,7 +108,7 @@ bool Subset<Part>::Properties::EqualsExistingPileUp() const {
 }
 
 bool Subset<Part>::Properties::SubsetOfExistingPileUp() const {
-  return parts_.front()->is_piled_up();
+  return first_part_->is_piled_up();
 }
 
 bool Subset<Part>::Properties::StrictSubsetOfExistingPileUp()
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include "base/disjoint_sets.hpp"
 
@@ -23,9 +24,10 @@ FORWARD_DECLARE_FROM(part, class, Part);
 
 namespace base {
 
-// Within an union-find on |Part|s, we maintain lists of the elements in the
-// disjoint sets.  Moreover, we keep track of the inclusion relations of those
-// sets to the sets of |Part|s in existing |PileUp|s, destroying existing
+// Within an union-find on |Part|s, we maintain the number of elements in the
+// disjoint sets; the elements themselves are only listed once the sets are
+// final, by |AddPart|.  Moreover, we keep track of the inclusion relations of
+// those sets to the sets of |Part|s in existing |PileUp|s, destroying existing
 // |PileUp|s as we learn that they will not appear in the new arrangement.
 // The |Collect| operation finalizes this, destroying existing |PileUp| which
 // are strict supersets of the new sets, and creating the new |PileUp|s.
@@ -40,9 +42,14 @@ class Subset<ksp_plugin::Part>::Properties final {
   // subset and not the other, the relevant |PileUp|s are erased.
   // Otherwise, |this->subset_of_existing_pile_up_| keeps track of the number of
   // missing parts.
-  // Maintains |parts_| by joining the lists.
   void MergeWith(Properties& other);
 
+  // Adds |part|, which must be in this subset, to |parts_|.  Must be called for
+  // all the parts of the subset once the subsets are final, before |Collect|.
+  // Has no effect if |EqualsExistingPileUp()|, since the existing |PileUp| is
+  // kept.
+  void AddPart(not_null<ksp_plugin::Part*> part);
+
   // “What’s this thing suddenly coming towards me very fast? Very very fast.
   // So big and flat and round, it needs a big wide sounding name like … ow …
   // ound … round … ground! That’s it! That’s a good name – ground!  I wonder if
@@ -73,14 +80,14 @@ class Subset<ksp_plugin::Part>::Properties final {
   // |right.SubsetOfExistingPileUp()|.
   static bool SubsetsOfSamePileUp(Properties const& left,
                                   Properties const& right);
-  // Whether the set of |Part|s in |parts_| is equal to the set of |Part|s
+  // Whether the set of |Part|s in this subset is equal to the set of |Part|s
   // in an existing |PileUp|.  Implies |SubsetOfExistingPileUp()|.
   bool EqualsExistingPileUp() const;
-  // Whether the set of |Part|s in |parts_| is a subset of the set of
+  // Whether the set of |Part|s in this subset is a subset of the set of
   // |Part|s in an existing |PileUp|.  In that case
-  // |parts_.front()->containing_pile_up()| is that |PileUp|.
+  // |first_part_->containing_pile_up()| is that |PileUp|.
   bool SubsetOfExistingPileUp() const;
-  // Whether the set of |Part|s in |parts_| is a strict subset of the set of
+  // Whether the set of |Part|s in this subset is a strict subset of the set of
   // |Part|s in an existing |PileUp|.  Implies |SubsetOfExistingPileUp()|.
   bool StrictSubsetOfExistingPileUp() const;
 
@@ -89,8 +96,14 @@ class Subset<ksp_plugin::Part>::Properties final {
   // if |SubsetOfExistingPileUp()|, |missing_| is the number of parts in that
   // |PileUp| that are not in this subset.
   int missing_;
-  // The list of parts in this subset.
-  std::list<not_null<ksp_plugin::Part*>> parts_;
+  // The part from which this subset was made, or from which the subset with
+  // which it was merged was made.  Either all the parts in this subset are in
+  // the |PileUp| of |first_part_|, or none of them is piled up.
+  not_null<ksp_plugin::Part*> first_part_;
+  // The number of parts in this subset.
+  int number_of_parts_ = 1;
+  // The parts in this subset, once they have been added by |AddPart|.
+  std::vector<not_null<ksp_plugin::Part*>> parts_;
   // The sum of the masses of the |parts_|.
   quantities::Mass total_mass_;
   // The sum of the |intrinsic_force|s on the |parts_|.
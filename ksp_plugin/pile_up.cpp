@@ -1,9 +1,12 @@
 ﻿
 #include "ksp_plugin/pile_up.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
 #include <list>
 #include <map>
+#include <vector>
 
 #include "geometry/identity.hpp"
 #include "geometry/named_quantities.hpp"
@@ -15,7 +18,6 @@ namespace principia {
 namespace ksp_plugin {
 namespace internal_pile_up {
 
-using base::FindOrDie;
 using base::make_not_null_unique;
 using geometry::AngularVelocity;
 using geometry::BarycentreCalculator;
@@ -31,7 +33,7 @@ using ::std::placeholders::_2;
 using ::std::placeholders::_3;
 
 PileUp::PileUp(
-    std::list<not_null<Part*>>&& parts,
+    std::vector<not_null<Part*>>&& parts,
     Instant const& t,
     Ephemeris<Barycentric>::AdaptiveStepParameters const&
         adaptive_step_parameters,
@@ -62,9 +64,9 @@ PileUp::PileUp(
           Identity<Barycentric, RigidPileUp>().Forget()},
       AngularVelocity<Barycentric>{},
       barycentre.velocity()};
+  actual_part_degrees_of_freedom_.reserve(parts_.size());
   for (not_null<Part*> const part : parts_) {
-    actual_part_degrees_of_freedom_.emplace(
-        part,
+    actual_part_degrees_of_freedom_.push_back(
         barycentric_to_pile_up(part->degrees_of_freedom()));
   }
   psychohistory_ = history_->NewForkAtLast();
@@ -79,19 +81,18 @@ void PileUp::set_intrinsic_force(
   intrinsic_force_ = intrinsic_force;
 }
 
-std::list<not_null<Part*>> const& PileUp::parts() const {
+std::vector<not_null<Part*>> const& PileUp::parts() const {
   return parts_;
 }
 
 void PileUp::SetPartApparentDegreesOfFreedom(
     not_null<Part*> const part,
     DegreesOfFreedom<ApparentBubble> const& degrees_of_freedom) {
-  PartTo<DegreesOfFreedom<ApparentBubble>>::iterator it;
-  bool inserted;
-  std::tie(it, inserted) =
-      apparent_part_degrees_of_freedom_.emplace(part, degrees_of_freedom);
-  CHECK(inserted) << "Duplicate part " << part << " at "
-                  << degrees_of_freedom;
+  // Duplicates are detected by |DeformPileUpIfNeeded|.
+  if (apparent_part_degrees_of_freedom_.empty()) {
+    apparent_part_degrees_of_freedom_.reserve(parts_.size());
+  }
+  apparent_part_degrees_of_freedom_.emplace_back(part, degrees_of_freedom);
 }
 
 void PileUp::NudgeParts() const {
@@ -106,9 +107,9 @@ void PileUp::NudgeParts() const {
       AngularVelocity<Barycentric>(),
       actual_centre_of_mass.velocity()};
   auto const pile_up_to_barycentric = barycentric_to_pile_up.Inverse();
-  for (not_null<Part*> const part : parts_) {
-    part->set_degrees_of_freedom(pile_up_to_barycentric(
-        FindOrDie(actual_part_degrees_of_freedom_, part)));
+  for (std::size_t i = 0; i < parts_.size(); ++i) {
+    parts_[i]->set_degrees_of_freedom(
+        pile_up_to_barycentric(actual_part_degrees_of_freedom_[i]));
   }
 }
 
@@ -121,6 +122,26 @@ void PileUp::DeformAndAdvanceTime(Instant const& t) {
   }
 }
 
+std::int64_t PileUp::EstimatedStepsToAdvanceTime(Instant const& t) const {
+  if (psychohistory_->last().time() >= t) {
+    return 0;
+  }
+  double const steps =
+      (t - history_->last().time()) / fixed_step_parameters_.step();
+  return std::max<std::int64_t>(1, std::ceil(steps));
+}
+
+Instant PileUp::NextCatchUpTime(Instant const& t,
+                                std::int64_t const max_steps) const {
+  CHECK_LT(0, max_steps);
+  if (intrinsic_force_ != Vector<Force, Barycentric>{}) {
+    return t;
+  }
+  Instant const chunk_end =
+      history_->last().time() + max_steps * fixed_step_parameters_.step();
+  return std::min(chunk_end, t);
+}
+
 void PileUp::WriteToMessage(not_null<serialization::PileUp*> message) const {
   for (not_null<Part*> const part : parts_) {
     message->add_part_id(part->part_id());
@@ -129,11 +150,10 @@ void PileUp::WriteToMessage(not_null<serialization::PileUp*> message) const {
   intrinsic_force_.WriteToMessage(message->mutable_intrinsic_force());
   history_->WriteToMessage(message->mutable_history(),
                            /*forks=*/{psychohistory_});
-  for (auto const& pair : actual_part_degrees_of_freedom_) {
-    auto const part = pair.first;
-    auto const& degrees_of_freedom = pair.second;
-    degrees_of_freedom.WriteToMessage(&(
-        (*message->mutable_actual_part_degrees_of_freedom())[part->part_id()]));
+  for (std::size_t i = 0; i < parts_.size(); ++i) {
+    actual_part_degrees_of_freedom_[i].WriteToMessage(&(
+        (*message->mutable_actual_part_degrees_of_freedom())[
+            parts_[i]->part_id()]));
   }
   for (auto const& pair : apparent_part_degrees_of_freedom_) {
     auto const part = pair.first;
@@ -152,7 +172,8 @@ PileUp PileUp::ReadFromMessage(
     serialization::PileUp const& message,
     std::function<not_null<Part*>(PartId)> const& part_id_to_part,
     not_null<Ephemeris<Barycentric>*> const ephemeris) {
-  std::list<not_null<Part*>> parts;
+  std::vector<not_null<Part*>> parts;
+  parts.reserve(message.part_id_size());
   for (auto const part_id : message.part_id()) {
     parts.push_back(part_id_to_part(part_id));
   }
@@ -217,17 +238,19 @@ PileUp PileUp::ReadFromMessage(
   pile_up->mass_ = Mass::ReadFromMessage(message.mass());
   pile_up->intrinsic_force_ =
       Vector<Force, Barycentric>::ReadFromMessage(message.intrinsic_force());
-  for (auto const& pair : message.actual_part_degrees_of_freedom()) {
-    std::uint32_t const part_id = pair.first;
-    serialization::Pair const& degrees_of_freedom = pair.second;
-    pile_up->actual_part_degrees_of_freedom_.emplace(
-        part_id_to_part(part_id),
-        DegreesOfFreedom<RigidPileUp>::ReadFromMessage(degrees_of_freedom));
+  auto const& actual_part_degrees_of_freedom =
+      message.actual_part_degrees_of_freedom();
+  CHECK_EQ(pile_up->parts_.size(), actual_part_degrees_of_freedom.size());
+  pile_up->actual_part_degrees_of_freedom_.reserve(pile_up->parts_.size());
+  for (not_null<Part*> const part : pile_up->parts_) {
+    pile_up->actual_part_degrees_of_freedom_.push_back(
+        DegreesOfFreedom<RigidPileUp>::ReadFromMessage(
+            actual_part_degrees_of_freedom.at(part->part_id())));
   }
   for (auto const& pair : message.apparent_part_degrees_of_freedom()) {
     std::uint32_t const part_id = pair.first;
     serialization::Pair const& degrees_of_freedom = pair.second;
-    pile_up->apparent_part_degrees_of_freedom_.emplace(
+    pile_up->apparent_part_degrees_of_freedom_.emplace_back(
         part_id_to_part(part_id),
         DegreesOfFreedom<ApparentBubble>::ReadFromMessage(degrees_of_freedom));
   }
@@ -235,7 +258,7 @@ PileUp PileUp::ReadFromMessage(
 }
 
 PileUp::PileUp(
-    std::list<not_null<Part*>>&& parts,
+    std::vector<not_null<Part*>>&& parts,
     Ephemeris<Barycentric>::AdaptiveStepParameters const&
         adaptive_step_parameters,
     Ephemeris<Barycentric>::FixedStepParameters const& fixed_step_parameters,
@@ -264,9 +287,14 @@ void PileUp::DeformPileUpIfNeeded() {
   // need a clean way of getting the debug strings of all parts (rather than
   // giant self-evaluating lambdas).
   CHECK_EQ(parts_.size(), apparent_part_degrees_of_freedom_.size());
-  for (not_null<Part*> const part : parts_) {
-    CHECK(Contains(apparent_part_degrees_of_freedom_, part));
+  sorted_parts_ = parts_;
+  sorted_apparent_parts_.clear();
+  for (auto const& pair : apparent_part_degrees_of_freedom_) {
+    sorted_apparent_parts_.push_back(pair.first);
   }
+  std::sort(sorted_parts_.begin(), sorted_parts_.end());
+  std::sort(sorted_apparent_parts_.begin(), sorted_apparent_parts_.end());
+  CHECK(sorted_parts_ == sorted_apparent_parts_);
 
   // Compute the apparent centre of mass of the parts.
   BarycentreCalculator<DegreesOfFreedom<ApparentBubble>, Mass> calculator;
@@ -290,13 +318,16 @@ void PileUp::DeformPileUpIfNeeded() {
           AngularVelocity<ApparentBubble>(),
           apparent_centre_of_mass.velocity());
 
-  // Now update the positions of the parts in the pile-up frame.
+  // Now update the positions of the parts in the pile-up frame.  The parts are
+  // reordered to match the order in which their apparent degrees of freedom
+  // were reported, which avoids looking them up.
+  parts_.clear();
   actual_part_degrees_of_freedom_.clear();
   for (auto const& pair : apparent_part_degrees_of_freedom_) {
     auto const part = pair.first;
     auto const& apparent_part_degrees_of_freedom = pair.second;
-    actual_part_degrees_of_freedom_.emplace(
-        part,
+    parts_.push_back(part);
+    actual_part_degrees_of_freedom_.push_back(
         apparent_bubble_to_pile_up_motion(apparent_part_degrees_of_freedom));
   }
   apparent_part_degrees_of_freedom_.clear();
@@ -386,11 +417,10 @@ void PileUp::AppendToPart(DiscreteTrajectory<Barycentric>::Iterator it) const {
       AngularVelocity<Barycentric>{},
       pile_up_dof.velocity());
   auto const pile_up_to_barycentric = barycentric_to_pile_up.Inverse();
-  for (not_null<Part*> const part : parts_) {
-    (static_cast<Part*>(part)->*append_to_part_trajectory)(
+  for (std::size_t i = 0; i < parts_.size(); ++i) {
+    (static_cast<Part*>(parts_[i])->*append_to_part_trajectory)(
         it.time(),
-        pile_up_to_barycentric(
-            FindOrDie(actual_part_degrees_of_freedom_, part)));
+        pile_up_to_barycentric(actual_part_degrees_of_freedom_[i]));
   }
 }
 
@@ -5,6 +5,8 @@
 #include <list>
 #include <map>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 #include "base/not_null.hpp"
 #include "geometry/grassmann.hpp"
@@ -42,7 +44,7 @@ using quantities::Mass;
 class PileUp {
  public:
   PileUp(
-      std::list<not_null<Part*>>&& parts,
+      std::vector<not_null<Part*>>&& parts,
       Instant const& t,
       Ephemeris<Barycentric>::AdaptiveStepParameters const&
           adaptive_step_parameters,
@@ -58,7 +60,7 @@ class PileUp {
   void set_mass(Mass const& mass);
   void set_intrinsic_force(Vector<Force, Barycentric> const& intrinsic_force);
 
-  std::list<not_null<Part*>> const& parts() const;
+  std::vector<not_null<Part*>> const& parts() const;
 
   // Set the |degrees_of_freedom| for the given |part|.  These degrees of
   // freedom are *apparent* in the sense that they were reported by the game but
@@ -73,6 +75,20 @@ class PileUp {
   // not concurrently with any other method of this class.
   void DeformAndAdvanceTime(Instant const& t);
 
+  // Returns an estimate of the cost of |DeformAndAdvanceTime(t)|, as the number
+  // of steps of the fixed-step integrator between the end of the history and
+  // |t|.  Returns 0 if the psychohistory is already advanced beyond |t|.  Must
+  // not be called concurrently with |DeformAndAdvanceTime|.
+  std::int64_t EstimatedStepsToAdvanceTime(Instant const& t) const;
+
+  // Returns the time to pass to |DeformAndAdvanceTime| to catch up with |t| by
+  // chunks of at most |max_steps| fixed steps.  Returns |t| if the remaining
+  // integration is shorter than a chunk, or if the pile-up is subject to an
+  // intrinsic force, since the adaptive integration that is then used cannot be
+  // split without changing the history.  Must not be called concurrently with
+  // |DeformAndAdvanceTime|.
+  Instant NextCatchUpTime(Instant const& t, std::int64_t max_steps) const;
+
   void WriteToMessage(not_null<serialization::PileUp*> message) const;
   static PileUp ReadFromMessage(
       serialization::PileUp const& message,
@@ -87,7 +103,7 @@ class PileUp {
 
   // For deserialization.
   PileUp(
-      std::list<not_null<Part*>>&& parts,
+      std::vector<not_null<Part*>>&& parts,
       Ephemeris<Barycentric>::AdaptiveStepParameters const&
           adaptive_step_parameters,
       Ephemeris<Barycentric>::FixedStepParameters const& fixed_step_parameters,
@@ -115,7 +131,9 @@ class PileUp {
   // Adjusts the degrees of freedom of all parts in this pile up based on the
   // degrees of freedom of the pile-up computed by |AdvanceTime| and on the
   // |RigidPileUp| degrees of freedom of the parts, as set by
-  // |DeformPileUpIfNeeded|.
+  // |DeformPileUpIfNeeded|.  All the parts are nudged, even if the pile-up was
+  // not deformed, because their barycentric degrees of freedom follow the
+  // centre of mass, which moves at every call to |AdvanceTime|.
   void NudgeParts() const;
 
   template<AppendToPartTrajectory append_to_part_trajectory>
@@ -124,7 +142,7 @@ class PileUp {
   // Wrapped in a |unique_ptr| to be moveable.
   not_null<std::unique_ptr<std::mutex>> lock_;
 
-  std::list<not_null<Part*>> parts_;
+  std::vector<not_null<Part*>> parts_;
   not_null<Ephemeris<Barycentric>*> ephemeris_;
   Ephemeris<Barycentric>::AdaptiveStepParameters adaptive_step_parameters_;
   Ephemeris<Barycentric>::FixedStepParameters fixed_step_parameters_;
@@ -169,8 +187,22 @@ class PileUp {
                             serialization::Frame::RIGID_PILE_UP,
                             /*frame_is_inertial=*/false>;
 
-  PartTo<DegreesOfFreedom<RigidPileUp>> actual_part_degrees_of_freedom_;
-  PartTo<DegreesOfFreedom<ApparentBubble>> apparent_part_degrees_of_freedom_;
+  // The degrees of freedom of the parts in |RigidPileUp|, in the same order as
+  // |parts_|.  They only change when the pile-up is deformed, so a pile-up that
+  // is not in the bubble advances without touching them.
+  std::vector<DegreesOfFreedom<RigidPileUp>> actual_part_degrees_of_freedom_;
+
+  // The degrees of freedom reported by |SetPartApparentDegreesOfFreedom|, in
+  // the order in which they were reported.  This is nonempty if and only if
+  // the pile-up must be deformed by the next call to |DeformPileUpIfNeeded|.
+  std::vector<std::pair<not_null<Part*>, DegreesOfFreedom<ApparentBubble>>>
+      apparent_part_degrees_of_freedom_;
+
+  // Scratch buffers used by |DeformPileUpIfNeeded| to check that the apparent
+  // degrees of freedom were reported for all the parts.  They are kept here so
+  // that deforming the pile-up does not allocate once they have grown.
+  std::vector<not_null<Part*>> sorted_parts_;
+  std::vector<not_null<Part*>> sorted_apparent_parts_;
 
   friend class TestablePileUp;
 };
@@ -5,10 +5,14 @@
 #include <cmath>
 #include <experimental/filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <ios>
 #include <limits>
 #include <list>
 #include <map>
+#include <mutex>
+#include <queue>
 #include <string>
 #include <thread>
 #include <utility>
@@ -98,14 +102,44 @@ using quantities::si::Minute;
 using quantities::si::Radian;
 using ::operator<<;
 
+// The maximal number of fixed steps by which a pile-up is advanced before
+// giving other pile-ups a chance to be advanced when catching up.
+constexpr std::int64_t max_steps_per_catch_up_chunk = 1'000;
+// The number of threads computing predictions and recomputing flight plans in
+// the background.  Only the predictions of the active vessel and of the target
+// are normally requested, and there are enough threads that a flight plan
+// recomputation that is being aborted doesn't delay the one that supersedes it.
+constexpr std::int64_t background_threads = 4;
+
+namespace {
+
+// The number of threads that the hardware can run concurrently.
+// |std::thread::hardware_concurrency| returns 0 if it is not computable.
+std::int64_t HardwareConcurrency() {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Moves the elements of |from| to the end of |to|, preserving their order.
+template<typename Message>
+void MoveElements(google::protobuf::RepeatedPtrField<Message>& from,
+                  google::protobuf::RepeatedPtrField<Message>& to) {
+  std::vector<Message*> elements(from.size());
+  from.ExtractSubrange(0, from.size(), elements.data());
+  for (Message* const element : elements) {
+    to.AddAllocated(element);
+  }
+}
+
+}  // namespace
+
 Plugin::Plugin(std::string const& game_epoch,
                std::string const& solar_system_epoch,
                Angle const& planetarium_rotation)
     : history_parameters_(DefaultHistoryParameters()),
       prolongation_parameters_(DefaultProlongationParameters()),
       prediction_parameters_(DefaultPredictionParameters()),
-      vessel_thread_pool_(
-          /*pool_size=*/2 * std::thread::hardware_concurrency()),
+      vessel_executor_(/*pool_size=*/2 * HardwareConcurrency()),
+      background_executor_(/*pool_size=*/background_threads),
       planetarium_rotation_(planetarium_rotation),
       game_epoch_(ParseTT(game_epoch)),
       current_time_(ParseTT(solar_system_epoch)) {
@@ -357,6 +391,7 @@ void Plugin::InsertOrKeepVessel(GUID const& vessel_guid,
                                                       parent,
                                                       ephemeris_.get(),
                                                       prediction_parameters_));
+    it->second->set_history_memory_budget(vessel_history_memory_budget_);
   } else {
     inserted = false;
   }
@@ -406,38 +441,19 @@ void Plugin::InsertOrKeepLoadedPart(
   not_null<Vessel*> const vessel = FindOrDie(vessels_, vessel_guid).get();
   CHECK(is_loaded(vessel));
 
-  auto it = part_id_to_vessel_.find(part_id);
-  bool const part_found = it != part_id_to_vessel_.end();
+  not_null<Vessel*>* const associated_vessel =
+      part_id_to_vessel_.Find(part_id);
+  bool const part_found = associated_vessel != nullptr;
   if (part_found) {
-    not_null<Vessel*>& associated_vessel = it->second;
-    not_null<Vessel*> const current_vessel = associated_vessel;
+    not_null<Vessel*> const current_vessel = *associated_vessel;
     if (vessel == current_vessel) {
     } else {
-      associated_vessel = vessel;
+      *associated_vessel = vessel;
       vessel->AddPart(current_vessel->ExtractPart(part_id));
     }
   } else {
-    Instant const previous_time = current_time_ - Δt;
-    OrthogonalMap<Barycentric, Barycentric> const Δplanetarium_rotation =
-        Exp(Δt * angular_velocity_of_world_).Forget();
-    // TODO(egg): Can we use |BarycentricToWorld| here?
-    BodyCentredNonRotatingDynamicFrame<Barycentric, MainBodyCentred> const
-        main_body_frame{ephemeris_.get(),
-                        FindOrDie(celestials_, main_body_index)->body()};
-    RigidMotion<World, MainBodyCentred> const world_to_main_body_centred{
-        RigidTransformation<World, MainBodyCentred>{
-            main_body_degrees_of_freedom.position(),
-            MainBodyCentred::origin,
-            main_body_frame.ToThisFrameAtTime(previous_time).orthogonal_map() *
-                Δplanetarium_rotation.Inverse() *
-                renderer_->WorldToBarycentric(PlanetariumRotation())},
-            (renderer_->BarycentricToWorld(PlanetariumRotation()) *
-                 Δplanetarium_rotation)(-angular_velocity_of_world_),
-        main_body_degrees_of_freedom.velocity()};
-    auto const world_to_barycentric_motion =
-        main_body_frame.FromThisFrameAtTime(previous_time) *
-        world_to_main_body_centred;
-
+    auto const world_to_barycentric_motion = WorldToBarycentricMotion(
+        main_body_index, main_body_degrees_of_freedom, Δt);
     AddPart(vessel,
             part_id,
             name,
@@ -449,10 +465,59 @@ void Plugin::InsertOrKeepLoadedPart(
   part->set_mass(mass);
 }
 
+void Plugin::InsertOrKeepLoadedParts(
+    GUID const& vessel_guid,
+    Index const main_body_index,
+    DegreesOfFreedom<World> const& main_body_degrees_of_freedom,
+    std::vector<LoadedPart> const& parts,
+    Time const& Δt) {
+  not_null<Vessel*> const vessel = FindOrDie(vessels_, vessel_guid).get();
+  CHECK(is_loaded(vessel));
+
+  // The parts that move to |vessel| are extracted from each of their current
+  // vessels at once, and added to |vessel| together with the new parts.
+  std::map<not_null<Vessel*>, std::set<PartId>> moved_part_ids;
+  std::vector<not_null<std::unique_ptr<Part>>> added_parts;
+  std::experimental::optional<RigidMotion<World, Barycentric>>
+      world_to_barycentric_motion;
+  for (auto const& part : parts) {
+    not_null<Vessel*>* const associated_vessel =
+        part_id_to_vessel_.Find(part.part_id);
+    if (associated_vessel == nullptr) {
+      if (!world_to_barycentric_motion) {
+        world_to_barycentric_motion.emplace(WorldToBarycentricMotion(
+            main_body_index, main_body_degrees_of_freedom, Δt));
+      }
+      added_parts.push_back(
+          NewPart(vessel,
+                  part.part_id,
+                  part.name,
+                  part.mass,
+                  (*world_to_barycentric_motion)(part.degrees_of_freedom)));
+    } else if (*associated_vessel != vessel) {
+      moved_part_ids[*associated_vessel].insert(part.part_id);
+      *associated_vessel = vessel;
+    }
+  }
+  for (auto const& pair : moved_part_ids) {
+    not_null<Vessel*> const current_vessel = pair.first;
+    std::set<PartId> const& part_ids = pair.second;
+    for (auto& part : current_vessel->ExtractParts(part_ids)) {
+      added_parts.push_back(std::move(part));
+    }
+  }
+  vessel->AddParts(std::move(added_parts));
+
+  for (auto const& part : parts) {
+    vessel->KeepPart(part.part_id);
+    vessel->part(part.part_id)->set_mass(part.mass);
+  }
+}
+
 void Plugin::IncrementPartIntrinsicForce(PartId const part_id,
                                          Vector<Force, World> const& force) {
   CHECK(!initializing_);
-  not_null<Vessel*> const vessel = FindOrDie(part_id_to_vessel_, part_id);
+  not_null<Vessel*> const vessel = part_id_to_vessel_.at(part_id);
   CHECK(is_loaded(vessel));
   vessel->part(part_id)->increment_intrinsic_force(
       renderer_->WorldToBarycentric(PlanetariumRotation())(force));
@@ -470,7 +535,7 @@ void Plugin::PrepareToReportCollisions() {
 }
 
 void Plugin::ReportGroundCollision(PartId const part) const {
-  Vessel const& v = *FindOrDie(part_id_to_vessel_, part);
+  Vessel const& v = *part_id_to_vessel_.at(part);
   Part& p = *v.part(part);
   LOG(INFO) << "Collision between " << p.ShortDebugString()
             << " and the ground.";
@@ -478,8 +543,8 @@ void Plugin::ReportGroundCollision(PartId const part) const {
 }
 
 void Plugin::ReportPartCollision(PartId const part1, PartId const part2) const {
-  Vessel const& v1 = *FindOrDie(part_id_to_vessel_, part1);
-  Vessel const& v2 = *FindOrDie(part_id_to_vessel_, part2);
+  Vessel const& v1 = *part_id_to_vessel_.at(part1);
+  Vessel const& v2 = *part_id_to_vessel_.at(part2);
   Part& p1 = *v1.part(part1);
   Part& p2 = *v2.part(part2);
   LOG(INFO) << "Collision between " << p1.ShortDebugString() << " and "
@@ -558,6 +623,14 @@ void Plugin::FreeVesselsAndPartsAndCollectPileUps(Time const& Δt) {
     }
   }
 
+  // Now that the subsets are final, give them their parts.  This is cheaper
+  // than maintaining the parts of the subsets as they are united.
+  for (auto const& pair : vessels_) {
+    pair.second->ForAllParts([](Part& part) {
+      Subset<Part>::Find(part).mutable_properties().AddPart(&part);
+    });
+  }
+
   // We only need to collect one part per vessel, since the other parts are in
   // the same subset.
   for (auto const& pair : vessels_) {
@@ -591,7 +664,7 @@ void Plugin::SetPartApparentDegreesOfFreedom(
           -angular_velocity_of_world_),
       main_body_degrees_of_freedom.velocity()};
 
-  not_null<Vessel*> vessel = FindOrDie(part_id_to_vessel_, part_id);
+  not_null<Vessel*> vessel = part_id_to_vessel_.at(part_id);
   CHECK(is_loaded(vessel));
   not_null<Part*> const part = vessel->part(part_id);
   CHECK(part->is_piled_up());
@@ -603,8 +676,8 @@ DegreesOfFreedom<World> Plugin::GetPartActualDegreesOfFreedom(
     PartId const part_id,
     RigidMotion<Barycentric, World> const& barycentric_to_world) const {
   return barycentric_to_world(
-             FindOrDie(part_id_to_vessel_,
-                       part_id)->part(part_id)->degrees_of_freedom());
+             part_id_to_vessel_.at(part_id)->part(part_id)->
+                 degrees_of_freedom());
 }
 
 DegreesOfFreedom<World> Plugin::CelestialWorldDegreesOfFreedom(
@@ -631,7 +704,7 @@ RigidMotion<Barycentric, World> Plugin::BarycentricToWorld(
       barycentric_to_main_body_motion.rigid_transformation().linear_map();
   auto const reference_part_degrees_of_freedom =
       barycentric_to_main_body_motion(
-          FindOrDie(part_id_to_vessel_, reference_part_id)->
+          part_id_to_vessel_.at(reference_part_id)->
               part(reference_part_id)->degrees_of_freedom());
 
   RigidTransformation<MainBodyCentred, World> const
@@ -688,7 +761,7 @@ not_null<std::unique_ptr<std::future<void>>> Plugin::CatchUpVessel(
   CHECK(!initializing_);
 
   return make_not_null_unique<std::future<void>>(
-      vessel_thread_pool_.Add([this, vessel_guid]() {
+      vessel_executor_.Add([this, vessel_guid]() {
         Vessel& vessel = *FindOrDie(vessels_, vessel_guid);
         vessel.ForSomePart([this](Part& part) {
           auto const pile_up = part.containing_pile_up()->iterator();
@@ -704,37 +777,85 @@ not_null<std::unique_ptr<std::future<void>>> Plugin::CatchUpVessel(
 void Plugin::CatchUpLaggingVessels() {
   CHECK(!initializing_);
 
-  // Start all the integrations in parallel.
-  std::vector<std::future<void>> futures;
+  // The pile-ups that lag behind, keyed by the estimated cost of catching up.
+  // The most expensive one is always advanced first, which keeps the critical
+  // path close to the total work divided by the number of threads.  Long
+  // catch-ups are split in chunks, and a pile-up goes back in the queue after
+  // each chunk, so that the chunks of different pile-ups are interleaved.
+  std::mutex lock;
+  std::priority_queue<std::pair<std::int64_t, PileUp*>> lagging_pile_ups;
   for (PileUp& pile_up : pile_ups_) {
-    futures.emplace_back(
-        vessel_thread_pool_.Add([this, &pile_up]() {
-          // Note that there cannot be contention in the following method as
-          // no two pile-ups are advanced at the same time.
-          pile_up.DeformAndAdvanceTime(current_time_);
-        }));
+    std::int64_t const cost =
+        pile_up.EstimatedStepsToAdvanceTime(current_time_);
+    if (cost > 0) {
+      lagging_pile_ups.emplace(cost, &pile_up);
+    }
   }
 
-  // Wait for the integrations to finish before updating the vessels.
-  for (auto const& future : futures) {
-    future.wait();
+  auto const advance_lagging_pile_ups = [this, &lock, &lagging_pile_ups]() {
+    for (;;) {
+      PileUp* pile_up;
+      {
+        std::lock_guard<std::mutex> l(lock);
+        if (lagging_pile_ups.empty()) {
+          return;
+        }
+        pile_up = lagging_pile_ups.top().second;
+        lagging_pile_ups.pop();
+      }
+      // Note that there cannot be contention in the following method as a
+      // pile-up is not in the queue while it is being advanced.
+      pile_up->DeformAndAdvanceTime(
+          pile_up->NextCatchUpTime(current_time_,
+                                   max_steps_per_catch_up_chunk));
+      std::int64_t const remaining_cost =
+          pile_up->EstimatedStepsToAdvanceTime(current_time_);
+      if (remaining_cost > 0) {
+        std::lock_guard<std::mutex> l(lock);
+        lagging_pile_ups.emplace(remaining_cost, pile_up);
+      }
+    }
+  };
+
+  // Start all the integrations in parallel.
+  std::int64_t const number_of_workers = std::min<std::int64_t>(
+      lagging_pile_ups.size(), vessel_executor_.pool_size());
+  WorkStealingExecutor::TaskGroup integrations(
+      check_not_null(&vessel_executor_));
+  for (std::int64_t i = 0; i < number_of_workers; ++i) {
+    integrations.Add(advance_lagging_pile_ups);
   }
+
+  // Wait for the integrations to finish before updating the vessels.
+  integrations.Wait();
   for (auto const& pair : vessels_) {
     Vessel& vessel = *pair.second;
-    if (vessel.psychohistory().last().time() < current_time_) {
+    if (vessel.psychohistory_last().time() < current_time_) {
       vessel.AdvanceTime();
     }
   }
 }
 
-void Plugin::ForgetAllHistoriesBefore(Instant const& t) const {
+void Plugin::ForgetAllHistoriesBefore(Instant const& t) {
   CHECK(!initializing_);
   CHECK_LT(t, current_time_);
+  // Forgetting is not thread-safe with respect to the integrations of the
+  // predictions and flight plans.
+  for (auto const& pair : vessels_) {
+    pair.second->WaitForPrediction();
+    pair.second->WaitForFlightPlan();
+  }
   ephemeris_->ForgetBefore(t);
+
+  // The histories and flight plans of distinct vessels are disjoint, so they
+  // may be trimmed concurrently.
+  WorkStealingExecutor::TaskGroup forgetting(
+      check_not_null(&vessel_executor_));
   for (auto const& pair : vessels_) {
-    not_null<std::unique_ptr<Vessel>> const& vessel = pair.second;
-    vessel->ForgetBefore(t);
+    Vessel* const vessel = pair.second.get();
+    forgetting.Add([vessel, t]() { vessel->ForgetBefore(t); });
   }
+  forgetting.Wait();
 }
 
 RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParent(
@@ -749,7 +870,7 @@ RelativeDegreesOfFreedom<AliceSun> Plugin::VesselFromParent(
     vessel->set_parent(parent);
   }
   RelativeDegreesOfFreedom<Barycentric> const barycentric_result =
-      vessel->psychohistory().last().degrees_of_freedom() -
+      vessel->psychohistory_last().degrees_of_freedom() -
       vessel->parent()->current_degrees_of_freedom(current_time_);
   RelativeDegreesOfFreedom<AliceSun> const result =
       PlanetariumRotation()(barycentric_result);
@@ -789,7 +910,24 @@ void Plugin::SetPredictionAdaptiveStepParameters(
 
 void Plugin::UpdatePrediction(GUID const& vessel_guid) const {
   CHECK(!initializing_);
-  FindOrDie(vessels_, vessel_guid)->FlowPrediction(InfiniteFuture);
+  FindOrDie(vessels_, vessel_guid)->RefreshPrediction(
+      check_not_null(&background_executor_));
+}
+
+void Plugin::WaitForPrediction(GUID const& vessel_guid) const {
+  CHECK(!initializing_);
+  FindOrDie(vessels_, vessel_guid)->WaitForPrediction();
+}
+
+void Plugin::EditFlightPlanAsynchronously(
+    GUID const& vessel_guid,
+    Vessel::FlightPlanEdit const& edit,
+    bool const coalesce) const {
+  CHECK(!initializing_);
+  FindOrDie(vessels_, vessel_guid)->EditFlightPlanAsynchronously(
+      edit,
+      coalesce,
+      check_not_null(&background_executor_));
 }
 
 void Plugin::CreateFlightPlan(GUID const& vessel_guid,
@@ -893,6 +1031,15 @@ void Plugin::SetPredictionAdaptiveStepParameters(
   }
 }
 
+void Plugin::SetVesselHistoryMemoryBudget(
+    std::int64_t const vessel_history_memory_budget) {
+  vessel_history_memory_budget_ = vessel_history_memory_budget;
+  for (auto const& pair : vessels_) {
+    not_null<std::unique_ptr<Vessel>> const& vessel = pair.second;
+    vessel->set_history_memory_budget(vessel_history_memory_budget_);
+  }
+}
+
 bool Plugin::HasVessel(GUID const& vessel_guid) const {
   return Contains(vessels_, vessel_guid);
 }
@@ -1102,7 +1249,7 @@ Velocity<World> Plugin::UnmanageableVesselVelocity(
 
 Velocity<World> Plugin::VesselVelocity(GUID const& vessel_guid) const {
   Vessel const& vessel = *FindOrDie(vessels_, vessel_guid);
-  auto const& last = vessel.psychohistory().last();
+  auto const& last = vessel.psychohistory_last();
   return VesselVelocity(last.time(), last.degrees_of_freedom());
 }
 
@@ -1129,69 +1276,37 @@ Renderer const& Plugin::renderer() const {
 void Plugin::WriteToMessage(
     not_null<serialization::Plugin*> const message) const {
   LOG(INFO) << __FUNCTION__;
-  CHECK(!initializing_);
-  ephemeris_->Prolong(current_time_);
-  std::map<not_null<Celestial const*>, Index const> celestial_to_index;
-  for (auto const& pair : celestials_) {
-    Index const index = pair.first;
-    auto const& owned_celestial = pair.second;
-    celestial_to_index.emplace(owned_celestial.get(), index);
-  }
-  for (auto const& pair : celestials_) {
-    Index const index = pair.first;
-    auto const& owned_celestial = pair.second.get();
-    auto* const celestial_message = message->add_celestial();
-    celestial_message->set_index(index);
-    if (owned_celestial->has_parent()) {
-      Index const parent_index =
-          FindOrDie(celestial_to_index, owned_celestial->parent());
-      celestial_message->set_parent_index(parent_index);
-    }
-    celestial_message->set_ephemeris_index(
-        ephemeris_->serialization_index_for_body(owned_celestial->body()));
-  }
-  std::map<not_null<Vessel const*>, GUID const> vessel_to_guid;
-  for (auto const& pair : vessels_) {
-    std::string const& guid = pair.first;
-    not_null<Vessel*> const vessel = pair.second.get();
-    vessel_to_guid.emplace(vessel, guid);
-    auto* const vessel_message = message->add_vessel();
-    vessel_message->set_guid(guid);
-    vessel->WriteToMessage(vessel_message->mutable_vessel());
-    Index const parent_index = FindOrDie(celestial_to_index, vessel->parent());
-    vessel_message->set_parent_index(parent_index);
-    vessel_message->set_loaded(Contains(loaded_vessels_, vessel));
-    vessel_message->set_kept(Contains(kept_vessels_, vessel));
-  }
-  for (auto const& pair : part_id_to_vessel_) {
-    PartId const part_id = pair.first;
-    not_null<Vessel*> const vessel = pair.second;
-    (*message->mutable_part_id_to_vessel())[part_id] = vessel_to_guid[vessel];
-  }
-
-  ephemeris_->WriteToMessage(message->mutable_ephemeris());
-
-  history_parameters_.WriteToMessage(message->mutable_history_parameters());
-  prolongation_parameters_.WriteToMessage(
-      message->mutable_prolongation_parameters());
-  prediction_parameters_.WriteToMessage(
-      message->mutable_prediction_parameters());
-
-  planetarium_rotation_.WriteToMessage(message->mutable_planetarium_rotation());
-  game_epoch_.WriteToMessage(message->mutable_game_epoch());
-  current_time_.WriteToMessage(message->mutable_current_time());
-  Index const sun_index = FindOrDie(celestial_to_index, sun_);
-  message->set_sun_index(sun_index);
-  renderer_->WriteToMessage(message->mutable_renderer());
-
-  for (auto const& pile_up : pile_ups_) {
-    pile_up.WriteToMessage(message->add_pile_up());
-  }
-
+  WriteParts([message](PartWriter const& write_part) {
+    write_part(message);
+  });
   LOG(INFO) << NAMED(message->SpaceUsed());
   LOG(INFO) << NAMED(message->ByteSize());
 }
 
+void Plugin::WriteToSerializer(
+    not_null<PullSerializer*> const serializer) const {
+  LOG(INFO) << __FUNCTION__;
+  std::vector<PullSerializer::Part> parts;
+  WriteParts([this, &parts](PartWriter const& write_part) {
+    parts.push_back([this, write_part]() {
+      auto const promise = std::make_shared<
+          std::promise<std::unique_ptr<google::protobuf::Message const>>>();
+      // The task fulfils |promise|, so it doesn't need a future of its own.
+      vessel_executor_.Execute([promise, write_part]() {
+        auto message = std::make_unique<serialization::Plugin>();
+        write_part(message.get());
+        promise->set_value(std::move(message));
+      });
+      return promise->get_future();
+    });
+  });
+  // Only start as many parts as the executor can build concurrently, so that
+  // the parts are not built much faster than they are serialized.
+  serializer->Start(
+      std::move(parts),
+      /*max_pending_parts=*/static_cast<int>(vessel_executor_.pool_size()));
+}
+
 not_null<std::unique_ptr<Plugin>> Plugin::ReadFromMessage(
     serialization::Plugin const& message) {
   LOG(INFO) << __FUNCTION__;
@@ -1218,33 +1333,15 @@ not_null<std::unique_ptr<Plugin>> Plugin::ReadFromMessage(
                              plugin->name_to_index_);
 
   for (auto const& vessel_message : message.vessel()) {
-    not_null<Celestial const*> const parent =
-        FindOrDie(plugin->celestials_, vessel_message.parent_index()).get();
-    not_null<std::unique_ptr<Vessel>> vessel = Vessel::ReadFromMessage(
-        vessel_message.vessel(),
-        parent,
-        plugin->ephemeris_.get(),
-        [&part_id_to_vessel = plugin->part_id_to_vessel_](
-            PartId const part_id) {
-          CHECK_NE(part_id_to_vessel.erase(part_id), 0) << part_id;
-        });
-
-    if (vessel_message.loaded()) {
-      plugin->loaded_vessels_.insert(vessel.get());
-    }
-    if (vessel_message.kept()) {
-      plugin->kept_vessels_.insert(vessel.get());
-    }
-    auto const inserted =
-        plugin->vessels_.emplace(vessel_message.guid(), std::move(vessel));
-    CHECK(inserted.second);
+    plugin->ReadVesselFromMessage(vessel_message);
   }
 
   for (auto const& pair : message.part_id_to_vessel()) {
     PartId const part_id = pair.first;
     GUID const guid = pair.second;
     auto const& vessel = FindOrDie(plugin->vessels_, guid);
-    plugin->part_id_to_vessel_.emplace(part_id, vessel.get());
+    CHECK(plugin->part_id_to_vessel_.Emplace(part_id, vessel.get()).second)
+        << part_id;
   }
 
   plugin->game_epoch_ = Instant::ReadFromMessage(message.game_epoch());
@@ -1256,32 +1353,12 @@ not_null<std::unique_ptr<Plugin>> Plugin::ReadFromMessage(
   plugin->main_body_ = plugin->sun_->body();
   plugin->UpdatePlanetariumRotation();
 
-  bool const is_pre_cauchy = message.has_pre_cauchy_plotting_frame();
-  if (is_pre_cauchy) {
-    plugin->renderer_ =
-        std::make_unique<Renderer>(
-            plugin->sun_,
-            NavigationFrame::ReadFromMessage(
-                message.pre_cauchy_plotting_frame(),
-                plugin->ephemeris_.get()));
-  } else {
-    plugin->renderer_ = Renderer::ReadFromMessage(message.renderer(),
-                                                  plugin->sun_,
-                                                  plugin->ephemeris_.get());
-  }
+  plugin->ReadRendererFromMessage(message);
 
   // Note that for proper deserialization of parts this list must be
   // reconstructed in its original order.
   for (auto const& pile_up_message : message.pile_up()) {
-    plugin->pile_ups_.push_back(PileUp::ReadFromMessage(
-        pile_up_message,
-        [&part_id_to_vessel = plugin->part_id_to_vessel_](
-            PartId const part_id) {
-          not_null<Vessel*> const vessel = part_id_to_vessel.at(part_id);
-          not_null<Part*> const part = vessel->part(part_id);
-          return part;
-        },
-        plugin->ephemeris_.get()));
+    plugin->ReadPileUpFromMessage(pile_up_message);
   }
 
   // Now fill the containing pile-up of all the parts.
@@ -1296,6 +1373,151 @@ not_null<std::unique_ptr<Plugin>> Plugin::ReadFromMessage(
   return plugin;
 }
 
+void Plugin::Reader::Add(serialization::Plugin& part) {
+  // The large submessages are moved rather than copied.
+  if (part.has_ephemeris()) {
+    CHECK(!pending_.has_ephemeris() && ephemeris_ == nullptr &&
+          plugin_ == nullptr) << "Duplicate ephemeris";
+    pending_.set_allocated_ephemeris(part.release_ephemeris());
+  }
+  MoveElements(*part.mutable_vessel(), *pending_.mutable_vessel());
+  MoveElements(*part.mutable_pile_up(), *pending_.mutable_pile_up());
+  pending_.MergeFrom(part);
+  ReadPending();
+}
+
+not_null<std::unique_ptr<Plugin>> Plugin::Reader::Finish() {
+  ReadPending();
+  CHECK(plugin_ != nullptr) << "Missing ephemeris or parameters";
+  CHECK_EQ(0, pending_.vessel_size());
+  CHECK(pending_.part_id_to_vessel().empty())
+      << "Parts of unknown vessels: " << pending_.part_id_to_vessel_size();
+  CHECK_EQ(0, pending_.pile_up_size());
+  CHECK(plugin_->sun_ != nullptr) << "Missing sun index";
+  if (plugin_->renderer_ == nullptr) {
+    plugin_->ReadRendererFromMessage(pending_);
+  }
+  plugin_->UpdatePlanetariumRotation();
+
+  // Now fill the containing pile-up of all the parts.
+  for (auto const& pair : vessel_parts_) {
+    GUID const& guid = pair.first;
+    auto const& vessel = FindOrDie(plugin_->vessels_, guid);
+    vessel->FillContainingPileUpsFromMessage(pair.second,
+                                             &plugin_->pile_ups_);
+  }
+
+  plugin_->initializing_.Flop();
+  return std::move(plugin_);
+}
+
+void Plugin::Reader::ReadPending() {
+  if (plugin_ == nullptr) {
+    // The ephemeris is the largest part that doesn't depend on anything, so it
+    // is read as soon as it is available.
+    if (ephemeris_ == nullptr && pending_.has_ephemeris()) {
+      ephemeris_ =
+          Ephemeris<Barycentric>::ReadFromMessage(pending_.ephemeris());
+      delete pending_.release_ephemeris();
+    }
+    if (ephemeris_ == nullptr ||
+        !pending_.has_history_parameters() ||
+        !pending_.has_prolongation_parameters() ||
+        !pending_.has_prediction_parameters()) {
+      return;
+    }
+    auto const history_parameters =
+        Ephemeris<Barycentric>::FixedStepParameters::ReadFromMessage(
+            pending_.history_parameters());
+    auto const prolongation_parameters =
+        Ephemeris<Barycentric>::AdaptiveStepParameters::ReadFromMessage(
+            pending_.prolongation_parameters());
+    auto const prediction_parameters =
+        Ephemeris<Barycentric>::AdaptiveStepParameters::ReadFromMessage(
+            pending_.prediction_parameters());
+    plugin_.reset(new Plugin(history_parameters,
+                             prolongation_parameters,
+                             prediction_parameters));
+    plugin_->ephemeris_ = std::move(ephemeris_);
+    pending_.clear_history_parameters();
+    pending_.clear_prolongation_parameters();
+    pending_.clear_prediction_parameters();
+  }
+
+  if (!celestials_read_) {
+    ReadCelestialsFromMessages(*plugin_->ephemeris_,
+                               pending_.celestial(),
+                               plugin_->celestials_,
+                               plugin_->name_to_index_);
+    pending_.clear_celestial();
+    celestials_read_ = true;
+  }
+  CHECK_EQ(0, pending_.celestial_size())
+      << "Celestial added after the ephemeris and the parameters";
+
+  if (pending_.has_game_epoch()) {
+    plugin_->game_epoch_ = Instant::ReadFromMessage(pending_.game_epoch());
+    pending_.clear_game_epoch();
+  }
+  if (pending_.has_current_time()) {
+    plugin_->current_time_ = Instant::ReadFromMessage(pending_.current_time());
+    pending_.clear_current_time();
+  }
+  if (pending_.has_planetarium_rotation()) {
+    plugin_->planetarium_rotation_ =
+        Angle::ReadFromMessage(pending_.planetarium_rotation());
+    pending_.clear_planetarium_rotation();
+  }
+  if (pending_.has_sun_index()) {
+    plugin_->sun_ = FindOrDie(plugin_->celestials_, pending_.sun_index()).get();
+    plugin_->main_body_ = plugin_->sun_->body();
+    pending_.clear_sun_index();
+  }
+  if (plugin_->sun_ != nullptr &&
+      (pending_.has_renderer() || pending_.has_pre_cauchy_plotting_frame())) {
+    plugin_->ReadRendererFromMessage(pending_);
+    pending_.clear_renderer();
+    pending_.clear_pre_cauchy_plotting_frame();
+  }
+
+  for (auto const& vessel_message : pending_.vessel()) {
+    plugin_->ReadVesselFromMessage(vessel_message);
+    // Only retain what is needed to fill the containing pile-ups.
+    serialization::Vessel& parts = vessel_parts_[vessel_message.guid()];
+    for (auto const& part_message : vessel_message.vessel().parts()) {
+      auto* const part = parts.add_parts();
+      part->set_part_id(part_message.part_id());
+      if (part_message.has_containing_pile_up()) {
+        part->set_containing_pile_up(part_message.containing_pile_up());
+      }
+    }
+  }
+  pending_.mutable_vessel()->DeleteSubrange(0, pending_.vessel_size());
+
+  auto& part_id_to_vessel = *pending_.mutable_part_id_to_vessel();
+  for (auto it = part_id_to_vessel.begin(); it != part_id_to_vessel.end();) {
+    PartId const part_id = it->first;
+    auto const vessel = plugin_->vessels_.find(it->second);
+    if (vessel == plugin_->vessels_.end()) {
+      ++it;
+      continue;
+    }
+    CHECK(plugin_->part_id_to_vessel_.Emplace(part_id,
+                                              vessel->second.get()).second)
+        << part_id;
+    it = part_id_to_vessel.erase(it);
+  }
+
+  // The pile-ups refer to the parts through |part_id_to_vessel_|, and must be
+  // read in their original order.
+  if (part_id_to_vessel.empty()) {
+    for (auto const& pile_up_message : pending_.pile_up()) {
+      plugin_->ReadPileUpFromMessage(pile_up_message);
+    }
+    pending_.mutable_pile_up()->DeleteSubrange(0, pending_.pile_up_size());
+  }
+}
+
 Plugin::Plugin(
     Ephemeris<Barycentric>::FixedStepParameters const& history_parameters,
     Ephemeris<Barycentric>::AdaptiveStepParameters const&
@@ -1304,8 +1526,110 @@ Plugin::Plugin(
     : history_parameters_(history_parameters),
       prolongation_parameters_(prolongation_parameters),
       prediction_parameters_(prediction_parameters),
-      vessel_thread_pool_(
-          /*pool_size=*/2 * std::thread::hardware_concurrency()) {}
+      vessel_executor_(/*pool_size=*/2 * HardwareConcurrency()),
+      background_executor_(/*pool_size=*/background_threads) {}
+
+void Plugin::WriteParts(
+    std::function<void(PartWriter)> const& add_part) const {
+  CHECK(!initializing_);
+  for (auto const& pair : vessels_) {
+    pair.second->WaitForPrediction();
+    pair.second->WaitForFlightPlan();
+  }
+  ephemeris_->Prolong(current_time_);
+  std::map<not_null<Celestial const*>, Index const> celestial_to_index;
+  for (auto const& pair : celestials_) {
+    Index const index = pair.first;
+    auto const& owned_celestial = pair.second;
+    celestial_to_index.emplace(owned_celestial.get(), index);
+  }
+
+  add_part([this, celestial_to_index](
+               not_null<serialization::Plugin*> const message) {
+    for (auto const& pair : celestials_) {
+      Index const index = pair.first;
+      auto const& owned_celestial = pair.second.get();
+      auto* const celestial_message = message->add_celestial();
+      celestial_message->set_index(index);
+      if (owned_celestial->has_parent()) {
+        Index const parent_index =
+            FindOrDie(celestial_to_index, owned_celestial->parent());
+        celestial_message->set_parent_index(parent_index);
+      }
+      celestial_message->set_ephemeris_index(
+          ephemeris_->serialization_index_for_body(owned_celestial->body()));
+    }
+
+    history_parameters_.WriteToMessage(message->mutable_history_parameters());
+    prolongation_parameters_.WriteToMessage(
+        message->mutable_prolongation_parameters());
+    prediction_parameters_.WriteToMessage(
+        message->mutable_prediction_parameters());
+
+    planetarium_rotation_.WriteToMessage(
+        message->mutable_planetarium_rotation());
+    game_epoch_.WriteToMessage(message->mutable_game_epoch());
+    current_time_.WriteToMessage(message->mutable_current_time());
+    Index const sun_index = FindOrDie(celestial_to_index, sun_);
+    message->set_sun_index(sun_index);
+    renderer_->WriteToMessage(message->mutable_renderer());
+  });
+
+  // The ephemeris and the vessels are the bulk of the serialization, so they
+  // each get a part of their own.
+  add_part([this](not_null<serialization::Plugin*> const message) {
+    ephemeris_->WriteToMessage(message->mutable_ephemeris());
+  });
+
+  std::map<not_null<Vessel const*>, GUID const> vessel_to_guid;
+  std::int64_t history_bytes = 0;
+  std::int64_t serialized_history_bytes = 0;
+  for (auto const& pair : vessels_) {
+    std::string const& guid = pair.first;
+    not_null<Vessel*> const vessel = pair.second.get();
+    vessel_to_guid.emplace(vessel, guid);
+    Vessel::HistoryMemoryUsage const usage = vessel->history_memory_usage();
+    history_bytes += usage.bytes;
+    serialized_history_bytes += usage.serialized_bytes;
+    Index const parent_index = FindOrDie(celestial_to_index, vessel->parent());
+    bool const loaded = Contains(loaded_vessels_, vessel);
+    bool const kept = Contains(kept_vessels_, vessel);
+    add_part([guid, vessel, parent_index, loaded, kept](
+                 not_null<serialization::Plugin*> const message) {
+      auto* const vessel_message = message->add_vessel();
+      vessel_message->set_guid(guid);
+      vessel->WriteToMessage(vessel_message->mutable_vessel());
+      vessel_message->set_parent_index(parent_index);
+      vessel_message->set_loaded(loaded);
+      vessel_message->set_kept(kept);
+    });
+  }
+
+  add_part([this, vessel_to_guid](
+               not_null<serialization::Plugin*> const message) {
+    // The parts are sorted so that the serialization doesn't depend on the
+    // history of |part_id_to_vessel_|.
+    std::vector<std::pair<PartId, not_null<Vessel*>>> sorted_part_id_to_vessel(
+        part_id_to_vessel_.begin(), part_id_to_vessel_.end());
+    std::sort(sorted_part_id_to_vessel.begin(),
+              sorted_part_id_to_vessel.end(),
+              [](auto const& left, auto const& right) {
+                return left.first < right.first;
+              });
+    for (auto const& pair : sorted_part_id_to_vessel) {
+      PartId const part_id = pair.first;
+      not_null<Vessel*> const vessel = pair.second;
+      (*message->mutable_part_id_to_vessel())[part_id] =
+          FindOrDie(vessel_to_guid, vessel);
+    }
+    for (auto const& pile_up : pile_ups_) {
+      pile_up.WriteToMessage(message->add_pile_up());
+    }
+  });
+
+  LOG(INFO) << NAMED(history_bytes);
+  LOG(INFO) << NAMED(serialized_history_bytes);
+}
 
 void Plugin::InitializeIndices(
     std::string const& name,
@@ -1394,24 +1718,104 @@ void Plugin::ReadCelestialsFromMessages(
   }
 }
 
+void Plugin::ReadVesselFromMessage(
+    serialization::Plugin::VesselAndProperties const& message) {
+  not_null<Celestial const*> const parent =
+      FindOrDie(celestials_, message.parent_index()).get();
+  not_null<std::unique_ptr<Vessel>> vessel = Vessel::ReadFromMessage(
+      message.vessel(),
+      parent,
+      ephemeris_.get(),
+      [&part_id_to_vessel = part_id_to_vessel_](PartId const part_id) {
+        CHECK(part_id_to_vessel.Erase(part_id)) << part_id;
+      });
+
+  if (message.loaded()) {
+    loaded_vessels_.insert(vessel.get());
+  }
+  if (message.kept()) {
+    kept_vessels_.insert(vessel.get());
+  }
+  auto const inserted = vessels_.emplace(message.guid(), std::move(vessel));
+  CHECK(inserted.second);
+}
+
+void Plugin::ReadPileUpFromMessage(serialization::PileUp const& message) {
+  pile_ups_.push_back(PileUp::ReadFromMessage(
+      message,
+      [&part_id_to_vessel = part_id_to_vessel_](PartId const part_id) {
+        not_null<Vessel*> const vessel = part_id_to_vessel.at(part_id);
+        not_null<Part*> const part = vessel->part(part_id);
+        return part;
+      },
+      ephemeris_.get()));
+}
+
+void Plugin::ReadRendererFromMessage(serialization::Plugin const& message) {
+  bool const is_pre_cauchy = message.has_pre_cauchy_plotting_frame();
+  if (is_pre_cauchy) {
+    renderer_ =
+        std::make_unique<Renderer>(
+            sun_,
+            NavigationFrame::ReadFromMessage(
+                message.pre_cauchy_plotting_frame(),
+                ephemeris_.get()));
+  } else {
+    renderer_ = Renderer::ReadFromMessage(message.renderer(),
+                                          sun_,
+                                          ephemeris_.get());
+  }
+}
+
+RigidMotion<World, Barycentric> Plugin::WorldToBarycentricMotion(
+    Index const main_body_index,
+    DegreesOfFreedom<World> const& main_body_degrees_of_freedom,
+    Time const& Δt) const {
+  Instant const previous_time = current_time_ - Δt;
+  OrthogonalMap<Barycentric, Barycentric> const Δplanetarium_rotation =
+      Exp(Δt * angular_velocity_of_world_).Forget();
+  // TODO(egg): Can we use |BarycentricToWorld| here?
+  BodyCentredNonRotatingDynamicFrame<Barycentric, MainBodyCentred> const
+      main_body_frame{ephemeris_.get(),
+                      FindOrDie(celestials_, main_body_index)->body()};
+  RigidMotion<World, MainBodyCentred> const world_to_main_body_centred{
+      RigidTransformation<World, MainBodyCentred>{
+          main_body_degrees_of_freedom.position(),
+          MainBodyCentred::origin,
+          main_body_frame.ToThisFrameAtTime(previous_time).orthogonal_map() *
+              Δplanetarium_rotation.Inverse() *
+              renderer_->WorldToBarycentric(PlanetariumRotation())},
+          (renderer_->BarycentricToWorld(PlanetariumRotation()) *
+               Δplanetarium_rotation)(-angular_velocity_of_world_),
+      main_body_degrees_of_freedom.velocity()};
+  return main_body_frame.FromThisFrameAtTime(previous_time) *
+         world_to_main_body_centred;
+}
+
+not_null<std::unique_ptr<Part>> Plugin::NewPart(
+    not_null<Vessel*> const vessel,
+    PartId const part_id,
+    std::string const& name,
+    Mass const mass,
+    DegreesOfFreedom<Barycentric> const& degrees_of_freedom) {
+  bool const emplaced = part_id_to_vessel_.Emplace(part_id, vessel).second;
+  CHECK(emplaced) << NAMED(part_id);
+  auto deletion_callback = [part_id, &registry = part_id_to_vessel_] {
+    CHECK(registry.Erase(part_id)) << part_id;
+  };
+  return make_not_null_unique<Part>(part_id,
+                                    name,
+                                    mass,
+                                    degrees_of_freedom,
+                                    std::move(deletion_callback));
+}
+
 void Plugin::AddPart(not_null<Vessel*> const vessel,
                      PartId const part_id,
                      std::string const& name,
                      Mass const mass,
                      DegreesOfFreedom<Barycentric> const& degrees_of_freedom) {
-  std::map<PartId, not_null<Vessel*>>::iterator it;
-  bool emplaced;
-  std::tie(it, emplaced) = part_id_to_vessel_.emplace(part_id, vessel);
-  CHECK(emplaced) << NAMED(part_id);
-  auto deletion_callback = [it, &map = part_id_to_vessel_] {
-    map.erase(it);
-  };
-  auto part = make_not_null_unique<Part>(part_id,
-                                         name,
-                                         mass,
-                                         degrees_of_freedom,
-                                         std::move(deletion_callback));
-  vessel->AddPart(std::move(part));
+  vessel->AddPart(NewPart(vessel, part_id, name, mass, degrees_of_freedom));
 }
 
 bool Plugin::is_loaded(not_null<Vessel*> vessel) const {
@@ -1,6 +1,7 @@
 ﻿
 #pragma once
 
+#include <functional>
 #include <future>
 #include <limits>
 #include <list>
@@ -12,7 +13,8 @@
 #include <vector>
 
 #include "base/monostable.hpp"
-#include "base/thread_pool.hpp"
+#include "base/pull_serializer.hpp"
+#include "base/work_stealing_executor.hpp"
 #include "geometry/affine_map.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/perspective.hpp"
@@ -20,6 +22,7 @@
 #include "ksp_plugin/celestial.hpp"
 #include "ksp_plugin/frames.hpp"
 #include "ksp_plugin/manœuvre.hpp"
+#include "ksp_plugin/part_registry.hpp"
 #include "ksp_plugin/planetarium.hpp"
 #include "ksp_plugin/renderer.hpp"
 #include "ksp_plugin/vessel.hpp"
@@ -45,8 +48,9 @@ namespace ksp_plugin {
 namespace internal_plugin {
 
 using base::not_null;
+using base::PullSerializer;
 using base::Subset;
-using base::ThreadPool;
+using base::WorkStealingExecutor;
 using geometry::AffineMap;
 using geometry::AngularVelocity;
 using geometry::Displacement;
@@ -195,6 +199,24 @@ class Plugin {
       DegreesOfFreedom<World> const& part_degrees_of_freedom,
       Time const& Δt);
 
+  // The arguments of |InsertOrKeepLoadedPart| that are specific to a part.
+  struct LoadedPart {
+    PartId part_id;
+    std::string name;
+    Mass mass;
+    DegreesOfFreedom<World> degrees_of_freedom;
+  };
+
+  // Same as |InsertOrKeepLoadedPart| for all the given |parts|.  The parts that
+  // are created or that move from other vessels, e.g., when docking, are added
+  // to the vessel all at once, in a time linear in the number of its parts.
+  virtual void InsertOrKeepLoadedParts(
+      GUID const& vessel_guid,
+      Index main_body_index,
+      DegreesOfFreedom<World> const& main_body_degrees_of_freedom,
+      std::vector<LoadedPart> const& parts,
+      Time const& Δt);
+
   // Calls |increment_intrinsic_force| on the relevant part, which must be in a
   // loaded vessel.
   virtual void IncrementPartIntrinsicForce(PartId part_id,
@@ -274,7 +296,8 @@ class Plugin {
   virtual void CatchUpLaggingVessels();
 
   // Forgets the histories of the |celestials_| and of the vessels before |t|.
-  virtual void ForgetAllHistoriesBefore(Instant const& t) const;
+  // The vessels are processed in parallel.
+  virtual void ForgetAllHistoriesBefore(Instant const& t);
 
   // Returns the displacement and velocity of the vessel with GUID |vessel_guid|
   // relative to its parent at current time. For a KSP |Vessel| |v|, the
@@ -300,13 +323,26 @@ class Plugin {
       Ephemeris<Barycentric>::AdaptiveStepParameters const&
           prediction_adaptive_step_parameters) const;
 
-  // Updates the prediction for the vessel with guid |vessel_guid|.
+  // Updates the prediction for the vessel with guid |vessel_guid|.  The
+  // prediction is computed asynchronously: this publishes the last prediction
+  // that was completed, if any, and starts computing a new one.
   void UpdatePrediction(GUID const& vessel_guid) const;
 
+  // Waits for the prediction of the vessel with guid |vessel_guid| that is
+  // being computed, if any, and publishes it.
+  void WaitForPrediction(GUID const& vessel_guid) const;
+
   virtual void CreateFlightPlan(GUID const& vessel_guid,
                                 Instant const& final_time,
                                 Mass const& initial_mass) const;
 
+  // Applies |edit| asynchronously to the flight plan of the vessel with guid
+  // |vessel_guid|, see |Vessel::EditFlightPlanAsynchronously|.
+  virtual void EditFlightPlanAsynchronously(
+      GUID const& vessel_guid,
+      Vessel::FlightPlanEdit const& edit,
+      bool coalesce) const;
+
   // Computes the apsides of the trajectory defined by |begin| and |end| with
   // respect to the celestial with index |celestial_index|.
   virtual void ComputeAndRenderApsides(
@@ -338,6 +374,11 @@ class Plugin {
       Ephemeris<Barycentric>::AdaptiveStepParameters const&
           prediction_adaptive_step_parameters);
 
+  // Sets the memory budget for the history of each vessel, in bytes, for the
+  // existing vessels and for those that will be inserted later.
+  virtual void SetVesselHistoryMemoryBudget(
+      std::int64_t vessel_history_memory_budget);
+
   virtual bool HasVessel(GUID const& vessel_guid) const;
   virtual not_null<Vessel*> GetVessel(GUID const& vessel_guid) const;
 
@@ -400,10 +441,22 @@ class Plugin {
 
   // Must be called after initialization.
   virtual void WriteToMessage(not_null<serialization::Plugin*> message) const;
+  // Starts |serializer| on the serialization of this object, which is
+  // equivalent to that of |WriteToMessage|.  The messages for the vessels and
+  // for the ephemeris are built concurrently and serialized as soon as they
+  // are complete, so bytes may be pulled from |serializer| before the entire
+  // message has been built.  This object must not be modified or destroyed
+  // until the serialization has completed.  Must be called after
+  // initialization.
+  virtual void WriteToSerializer(not_null<PullSerializer*> serializer) const;
   static not_null<std::unique_ptr<Plugin>> ReadFromMessage(
       serialization::Plugin const& message);
 
+  class Reader;
+
  private:
+  // A function that writes a part of the serialization of this object.
+  using PartWriter = std::function<void(not_null<serialization::Plugin*>)>;
   using GUIDToOwnedVessel = std::map<GUID, not_null<std::unique_ptr<Vessel>>>;
   using IndexToOwnedCelestial =
       std::map<Index, not_null<std::unique_ptr<Celestial>>>;
@@ -430,6 +483,12 @@ class Plugin {
       Instant const& time,
       DegreesOfFreedom<Barycentric> const& degrees_of_freedom) const;
 
+  // Waits for the computations in progress and calls |add_part| with
+  // functions that write the parts of the serialization of this object.  The
+  // functions may be called concurrently, and the merge in order of the
+  // messages that they write is the serialization of this object.
+  void WriteParts(std::function<void(PartWriter)> const& add_part) const;
+
   // Fill |celestials| using the |index| and |parent_index| fields found in
   // |celestial_messages|.
   template<typename T>
@@ -439,6 +498,37 @@ class Plugin {
       IndexToOwnedCelestial& celestials,
       std::map<std::string, Index>& name_to_index);
 
+  // Reads a vessel, records it in |vessels_| and in the sets of loaded and kept
+  // vessels.  The celestials and the ephemeris must have been read.
+  void ReadVesselFromMessage(
+      serialization::Plugin::VesselAndProperties const& message);
+
+  // Reads a pile-up and appends it to |pile_ups_|.  The parts of the pile-up
+  // must be in |part_id_to_vessel_|.
+  void ReadPileUpFromMessage(serialization::PileUp const& message);
+
+  // Reads |renderer_| from the |renderer| field of |message|, or from its
+  // pre-Cauchy plotting frame.  |sun_| must have been read.
+  void ReadRendererFromMessage(serialization::Plugin const& message);
+
+  // Returns the motion that maps the degrees of freedom in |World| at the
+  // beginning of the last frame, of duration |Δt|, to |Barycentric|.  |World|
+  // is centred on the body with the given |main_body_index|, whose degrees of
+  // freedom in |World| are given.
+  RigidMotion<World, Barycentric> WorldToBarycentricMotion(
+      Index main_body_index,
+      DegreesOfFreedom<World> const& main_body_degrees_of_freedom,
+      Time const& Δt) const;
+
+  // Creates a part for a vessel, recording it in the appropriate map and
+  // setting up a deletion callback.  The caller must add the part to |vessel|.
+  not_null<std::unique_ptr<Part>> NewPart(
+      not_null<Vessel*> vessel,
+      PartId part_id,
+      std::string const& name,
+      Mass mass,
+      DegreesOfFreedom<Barycentric> const& degrees_of_freedom);
+
   // Adds a part to a vessel, recording it in the appropriate map and setting up
   // a deletion callback.
   void AddPart(not_null<Vessel*> vessel,
@@ -460,8 +550,9 @@ class Plugin {
 
   GUIDToOwnedVessel vessels_;
   // For each part, the vessel that this part belongs to. The part is guaranteed
-  // to be in the parts() map of the vessel, and owned by it.
-  std::map<PartId, not_null<Vessel*>> part_id_to_vessel_;
+  // to be in the parts() map of the vessel, and owned by it.  This index is
+  // only iterated over for serialization, which sorts the parts.
+  PartRegistry<not_null<Vessel*>, PartOrder::Unspecified> part_id_to_vessel_;
   IndexToOwnedCelestial celestials_;
 
   // Not null after initialization.
@@ -472,8 +563,20 @@ class Plugin {
   Ephemeris<Barycentric>::AdaptiveStepParameters prolongation_parameters_;
   Ephemeris<Barycentric>::AdaptiveStepParameters prediction_parameters_;
 
-  // The thread pool for advancing vessels.
-  ThreadPool<void> vessel_thread_pool_;
+  std::int64_t vessel_history_memory_budget_ =
+      Vessel::default_history_memory_budget;
+
+  // The executor for advancing vessels and forgetting their histories, and for
+  // building the parts of the serialization of this object.  The vessels are
+  // not advanced while saving, so the threads don't need to be distinct.
+  // Mutable because it is thread-safe and the serialization is built by const
+  // methods.
+  mutable WorkStealingExecutor vessel_executor_;
+  // The executor for computing the predictions and for recomputing the flight
+  // plans after asynchronous edits.  Distinct from the above so that advancing
+  // the vessels is never delayed by these long-running tasks.  Mutable because
+  // it is thread-safe and the predictions are updated by const methods.
+  mutable WorkStealingExecutor background_executor_;
 
   Angle planetarium_rotation_;
   std::experimental::optional<Rotation<Barycentric, AliceSun>>
@@ -503,6 +606,43 @@ class Plugin {
   friend class TestablePlugin;
 };
 
+// Reconstructs a plugin from the successive parts of its serialization, e.g.,
+// as produced by a |PushDeserializer| that parses the top-level fields one at a
+// time.  Each part is read, and its memory released, as soon as the parts that
+// it depends upon have been read.  The large parts (the ephemeris, the vessels
+// and the pile-ups) are therefore not retained if they come after their
+// dependencies, as they do in the serialization produced by
+// |WriteToSerializer|.  All the celestials must have been added by the time the
+// ephemeris and the parameters have been added.
+class Plugin::Reader final {
+ public:
+  Reader() = default;
+
+  // Reads or retains the contents of |part|, which may be moved out of it.
+  void Add(serialization::Plugin& part);
+
+  // Returns the plugin once all the parts have been added.
+  not_null<std::unique_ptr<Plugin>> Finish();
+
+ private:
+  // Reads the parts of |pending_| whose dependencies have been read, and
+  // removes them from |pending_|.
+  void ReadPending();
+
+  // The parts that could not be read yet.
+  serialization::Plugin pending_;
+
+  // The ephemeris, if it was read before |plugin_| could be constructed.
+  std::unique_ptr<Ephemeris<Barycentric>> ephemeris_;
+  std::unique_ptr<Plugin> plugin_;
+  bool celestials_read_ = false;
+
+  // For each vessel, the identifiers of its parts and the indices of their
+  // containing pile-ups, which can only be filled once all the pile-ups have
+  // been read.
+  std::map<GUID, serialization::Vessel> vessel_parts_;
+};
+
 }  // namespace internal_plugin
 
 using internal_plugin::Index;
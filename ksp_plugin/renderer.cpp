@@ -208,7 +208,7 @@ OrthogonalMap<Frenet<Navigation>, World> Renderer::FrenetToWorld(
 OrthogonalMap<Frenet<Navigation>, World> Renderer::FrenetToWorld(
     Vessel const& vessel,
     Rotation<Barycentric, AliceSun> const& planetarium_rotation) const {
-  auto const last = vessel.psychohistory().last();
+  auto const last = vessel.psychohistory_last();
   Instant const& time = last.time();
   DegreesOfFreedom<Barycentric> const& barycentric_degrees_of_freedom =
       last.degrees_of_freedom();
@@ -228,7 +228,7 @@ OrthogonalMap<Frenet<Navigation>, World> Renderer::FrenetToWorld(
     Vessel const& vessel,
     NavigationFrame const& navigation_frame,
     Rotation<Barycentric, AliceSun> const& planetarium_rotation) const {
-  auto const vessel_psychohistory_last = vessel.psychohistory().last();
+  auto const vessel_psychohistory_last = vessel.psychohistory_last();
   auto const to_navigation =
       navigation_frame.ToThisFrameAtTime(vessel_psychohistory_last.time());
   auto const from_navigation = to_navigation.orthogonal_map().Inverse();
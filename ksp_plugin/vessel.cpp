@@ -2,12 +2,17 @@
 #include "ksp_plugin/vessel.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <limits>
 #include <list>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "astronomy/epoch.hpp"
+#include "base/bundle.hpp"
+#include "base/map_util.hpp"
 #include "ksp_plugin/integrators.hpp"
 #include "ksp_plugin/pile_up.hpp"
 #include "quantities/si.hpp"
@@ -18,18 +23,51 @@ namespace ksp_plugin {
 namespace internal_vessel {
 
 using astronomy::InfiniteFuture;
+using astronomy::InfinitePast;
+using base::AbortRequested;
 using base::Contains;
-using base::FindOrDie;
 using base::make_not_null_unique;
 using geometry::BarycentreCalculator;
 using geometry::Position;
 using quantities::IsFinite;
 using quantities::Length;
 using quantities::Time;
+using quantities::si::Kilo;
 using quantities::si::Metre;
 
 constexpr std::int64_t max_dense_intervals = 10'000;
 constexpr Length downsampling_tolerance = 10 * Metre;
+// The tolerances used to compress the oldest part of the history.  The
+// tolerance starts at the smallest value and is doubled when the history
+// doesn't fit in the memory budget, but never exceeds the largest value.
+constexpr Length min_history_compression_tolerance = 100 * Metre;
+constexpr Length max_history_compression_tolerance = 1 * Kilo(Metre);
+// An estimate of the memory used by a point of a trajectory, including the
+// nodes of the map.
+constexpr std::int64_t bytes_per_history_point =
+    sizeof(std::pair<Instant const, DegreesOfFreedom<Barycentric>>) +
+    4 * sizeof(void*);
+
+std::int64_t const Vessel::default_history_memory_budget = 16 << 20;
+
+namespace {
+
+// Returns true if all the forks of |history| are at its last point.
+bool ForksAtLastPoint(serialization::DiscreteTrajectory const& history) {
+  if (history.timeline().empty()) {
+    return false;
+  }
+  Instant const last_time = Instant::ReadFromMessage(
+      history.timeline(history.timeline_size() - 1).instant());
+  for (auto const& litter : history.children()) {
+    if (Instant::ReadFromMessage(litter.fork_time()) != last_time) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
 
 Vessel::Vessel(GUID const& guid,
                std::string const& name,
@@ -43,17 +81,31 @@ Vessel::Vessel(GUID const& guid,
       prediction_adaptive_step_parameters_(prediction_adaptive_step_parameters),
       parent_(parent),
       ephemeris_(ephemeris),
-      history_(make_not_null_unique<DiscreteTrajectory<Barycentric>>()) {
+      history_(make_not_null_unique<DiscreteTrajectory<Barycentric>>()),
+      history_memory_budget_(default_history_memory_budget),
+      compressed_history_end_(InfinitePast),
+      history_compression_tolerance_(min_history_compression_tolerance),
+      history_compression_threshold_(history_memory_budget_ /
+                                     bytes_per_history_point) {
   // Can't create the |psychohistory_| and |prediction_| here because |history_|
   // is empty;
 }
 
 Vessel::~Vessel() {
   LOG(INFO) << "Destroying vessel " << ShortDebugString();
+  // The |prognosticator_| writes to this object.
+  if (prognosticator_.valid()) {
+    prognosticator_.wait();
+  }
+  // So do the |flight_planners_|, including those that are aborted.
+  CancelFlightPlanEdits();
+  for (auto const& flight_planner : flight_planners_) {
+    flight_planner.wait();
+  }
   // The parts must remove themselves from their pile-ups *before* any of them
   // starts to destroy, otherwise |clear_pile_up| might access destroyed parts.
   for (auto const& pair : parts_) {
-    auto const& part = pair.second;
+    auto const& part = pair.second.part;
     part->clear_pile_up();
   }
 }
@@ -86,52 +138,93 @@ void Vessel::set_parent(not_null<Celestial const*> const parent) {
   parent_ = parent;
 }
 
+Vessel::OwnedPart::OwnedPart(not_null<std::unique_ptr<Part>> part)
+    : part(std::move(part)) {}
+
 void Vessel::AddPart(not_null<std::unique_ptr<Part>> part) {
   LOG(INFO) << "Adding part " << part->ShortDebugString() << " to vessel "
             << ShortDebugString();
-  parts_.emplace(part->part_id(), std::move(part));
+  PartId const id = part->part_id();
+  CHECK(parts_.Emplace(id, OwnedPart(std::move(part))).second) << id;
 }
 
 not_null<std::unique_ptr<Part>> Vessel::ExtractPart(PartId const id) {
-  CHECK_LE(kept_parts_.size(), parts_.size());
-  auto const it = parts_.find(id);
-  CHECK(it != parts_.end()) << id;
-  auto result = std::move(it->second);
-  LOG(INFO) << "Extracting part " << result->ShortDebugString()
+  CHECK_LE(number_of_kept_parts_, parts_.size());
+  OwnedPart owned_part = parts_.Extract(id);
+  LOG(INFO) << "Extracting part " << owned_part.part->ShortDebugString()
             << " from vessel " << ShortDebugString();
-  parts_.erase(it);
-  kept_parts_.erase(id);
-  return result;
+  if (owned_part.kept) {
+    --number_of_kept_parts_;
+  }
+  return std::move(owned_part.part);
+}
+
+void Vessel::AddParts(std::vector<not_null<std::unique_ptr<Part>>> parts) {
+  std::vector<std::pair<PartId, OwnedPart>> owned_parts;
+  owned_parts.reserve(parts.size());
+  for (auto& part : parts) {
+    LOG(INFO) << "Adding part " << part->ShortDebugString() << " to vessel "
+              << ShortDebugString();
+    PartId const id = part->part_id();
+    owned_parts.emplace_back(id, OwnedPart(std::move(part)));
+  }
+  parts_.EmplaceAll(std::move(owned_parts));
+}
+
+std::vector<not_null<std::unique_ptr<Part>>> Vessel::ExtractParts(
+    std::set<PartId> const& ids) {
+  CHECK_LE(number_of_kept_parts_, parts_.size());
+  auto owned_parts = parts_.ExtractIf(
+      [&ids](PartId const id, OwnedPart const&) {
+        return Contains(ids, id);
+      });
+  CHECK_EQ(ids.size(), owned_parts.size()) << "Missing parts";
+  std::vector<not_null<std::unique_ptr<Part>>> parts;
+  parts.reserve(owned_parts.size());
+  for (auto& pair : owned_parts) {
+    OwnedPart& owned_part = pair.second;
+    LOG(INFO) << "Extracting part " << owned_part.part->ShortDebugString()
+              << " from vessel " << ShortDebugString();
+    if (owned_part.kept) {
+      --number_of_kept_parts_;
+    }
+    parts.push_back(std::move(owned_part.part));
+  }
+  return parts;
 }
 
 void Vessel::KeepPart(PartId const id) {
-  CHECK_LE(kept_parts_.size(), parts_.size());
-  CHECK(Contains(parts_, id)) << id;
-  kept_parts_.insert(id);
+  CHECK_LE(number_of_kept_parts_, parts_.size());
+  OwnedPart& owned_part = parts_.at(id);
+  if (!owned_part.kept) {
+    owned_part.kept = true;
+    ++number_of_kept_parts_;
+  }
 }
 
 bool Vessel::WillKeepPart(PartId const id) const {
-  return Contains(kept_parts_, id);
+  OwnedPart const* const owned_part = parts_.Find(id);
+  return owned_part != nullptr && owned_part->kept;
 }
 
 void Vessel::FreeParts() {
-  CHECK_LE(kept_parts_.size(), parts_.size());
-  for (auto it = parts_.begin(); it != parts_.end();) {
-    not_null<Part*> const part = it->second.get();
-    if (Contains(kept_parts_, part->part_id())) {
-      ++it;
+  CHECK_LE(number_of_kept_parts_, parts_.size());
+  parts_.EraseIf([](PartId const id, OwnedPart& owned_part) {
+    if (owned_part.kept) {
+      owned_part.kept = false;
+      return false;
     } else {
-      part->clear_pile_up();
-      it = parts_.erase(it);
+      owned_part.part->clear_pile_up();
+      return true;
     }
-  }
+  });
   CHECK(!parts_.empty());
-  kept_parts_.clear();
+  number_of_kept_parts_ = 0;
 }
 
 void Vessel::ClearAllIntrinsicForces() {
   for (auto const& pair : parts_) {
-    auto const& part = pair.second;
+    auto const& part = pair.second.part;
     part->clear_intrinsic_force();
   }
 }
@@ -154,21 +247,22 @@ void Vessel::PrepareHistory(Instant const& t) {
 }
 
 not_null<Part*> Vessel::part(PartId const id) const {
-  return FindOrDie(parts_, id).get();
+  return parts_.at(id).part.get();
 }
 
 void Vessel::ForSomePart(std::function<void(Part&)> action) const {
   CHECK(!parts_.empty());
-  action(*parts_.begin()->second);
+  action(*parts_.begin()->second.part);
 }
 
 void Vessel::ForAllParts(std::function<void(Part&)> action) const {
   for (auto const& pair : parts_) {
-    action(*pair.second);
+    action(*pair.second.part);
   }
 }
 
-DiscreteTrajectory<Barycentric> const& Vessel::prediction() const {
+DiscreteTrajectory<Barycentric> const& Vessel::prediction() {
+  DeserializeHistoryIfNeeded();
   return *prediction_;
 }
 
@@ -202,28 +296,65 @@ void Vessel::AdvanceTime() {
                            &Part::psychohistory_end,
                            *psychohistory_);
   prediction_ = psychohistory_->NewForkAtLast();
+  if (prognostication_ != nullptr) {
+    // Keep showing the last published prognostication until a new one
+    // replaces it.
+    AttachPrediction(*prognostication_);
+  }
 
   for (auto const& pair : parts_) {
-    Part& part = *pair.second;
+    Part& part = *pair.second.part;
     part.ClearHistory();
   }
+
+  CompressHistoryIfNeeded();
 }
 
 void Vessel::ForgetBefore(Instant const& time) {
+  if (!serialized_history_.empty()) {
+    if (time >= history_->Begin().time()) {
+      // All the points that have not been deserialized are forgotten.
+      serialized_history_.clear();
+      serialized_history_.shrink_to_fit();
+    } else if (time > serialized_history_begin_time_) {
+      DeserializeHistoryIfNeeded();
+    }
+  }
   // Make sure that the history keeps at least one (authoritative) point and
   // don't change the psychohistory or prediction.  We cannot use the parts
   // because they may have been moved to the future already.
   history_->ForgetBefore(std::min(time, history_->last().time()));
   if (flight_plan_ != nullptr) {
-    flight_plan_->ForgetBefore(time, [this]() { flight_plan_.reset(); });
+    flight_plan_->ForgetBefore(time, [this]() { DeleteFlightPlan(); });
   }
 }
 
+void Vessel::set_history_memory_budget(
+    std::int64_t const history_memory_budget) {
+  history_memory_budget_ = history_memory_budget;
+  history_compression_threshold_ =
+      history_memory_budget_ / bytes_per_history_point;
+}
+
+std::int64_t Vessel::history_memory_budget() const {
+  return history_memory_budget_;
+}
+
+Vessel::HistoryMemoryUsage Vessel::history_memory_usage() const {
+  std::int64_t const points = history_->Size();
+  return {points,
+          points * bytes_per_history_point,
+          static_cast<std::int64_t>(serialized_history_.size()),
+          compressed_history_end_,
+          history_compression_tolerance_};
+}
+
 void Vessel::CreateFlightPlan(
     Instant const& final_time,
     Mass const& initial_mass,
     Ephemeris<Barycentric>::AdaptiveStepParameters const&
         flight_plan_adaptive_step_parameters) {
+  CancelFlightPlanEdits();
   auto const history_last = history_->last();
   flight_plan_ = std::make_unique<FlightPlan>(
       initial_mass,
@@ -235,39 +366,231 @@ void Vessel::CreateFlightPlan(
 }
 
 void Vessel::DeleteFlightPlan() {
+  CancelFlightPlanEdits();
   flight_plan_.reset();
 }
 
+void Vessel::EditFlightPlanAsynchronously(
+    FlightPlanEdit const& edit,
+    bool const coalesce,
+    not_null<WorkStealingExecutor*> const executor) {
+  CHECK(has_flight_plan());
+  if (coalesce &&
+      !pending_flight_plan_edits_.empty() &&
+      pending_flight_plan_edits_.back().second) {
+    pending_flight_plan_edits_.back().first = edit;
+  } else {
+    pending_flight_plan_edits_.emplace_back(edit, coalesce);
+  }
+
+  // Abort the current recomputation, if any, and forget the ones that have
+  // terminated.
+  std::int64_t generation;
+  {
+    std::lock_guard<std::mutex> l(edited_flight_plan_lock_);
+    generation = ++flight_plan_generation_;
+    edited_flight_plan_.reset();
+  }
+  flight_planners_.erase(
+      std::remove_if(flight_planners_.begin(),
+                     flight_planners_.end(),
+                     [](std::future<void> const& flight_planner) {
+                       return flight_planner.wait_for(
+                                  std::chrono::seconds(0)) ==
+                              std::future_status::ready;
+                     }),
+      flight_planners_.end());
+
+  // Prolonging the ephemeris is not thread-safe with respect to the evaluation
+  // of the trajectories of the celestials on this thread, so it is done here
+  // rather than by the integrations of the edits.
+  ephemeris_->Prolong(flight_plan_->desired_final_time());
+
+  // The copy is made here because the |flight_plan_| may change (e.g., be
+  // truncated by |ForgetBefore|) during the recomputation.  It doesn't
+  // integrate anything.  It is wrapped in a |shared_ptr| because tasks must be
+  // copyable.
+  auto const flight_plan = std::make_shared<std::unique_ptr<FlightPlan>>(
+      std::make_unique<FlightPlan>(*flight_plan_));
+  flight_planners_.push_back(executor->Add(
+      [this, edits = pending_flight_plan_edits_, flight_plan, generation]() {
+        auto const abort_requested = AbortRequested;
+        AbortRequested = [this, generation]() {
+          return flight_plan_generation_ != generation;
+        };
+        bool succeeded = true;
+        for (auto const& edit : edits) {
+          succeeded &= edit.first(**flight_plan);
+        }
+        AbortRequested = abort_requested;
+
+        std::lock_guard<std::mutex> l(edited_flight_plan_lock_);
+        if (flight_plan_generation_ == generation) {
+          edited_flight_plan_ = std::move(*flight_plan);
+          edited_flight_plan_succeeded_ = succeeded;
+        }
+      }));
+}
+
+void Vessel::RefreshFlightPlan() {
+  if (!pending_flight_plan_edits_.empty() &&
+      flight_planners_.back().wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    PublishEditedFlightPlan();
+  }
+}
+
+bool Vessel::flight_plan_is_computing() const {
+  return !pending_flight_plan_edits_.empty();
+}
+
+void Vessel::WaitForFlightPlan() {
+  // The aborted recomputations use the ephemeris too, so we must wait for all
+  // of them.
+  for (auto const& flight_planner : flight_planners_) {
+    flight_planner.wait();
+  }
+  if (!pending_flight_plan_edits_.empty()) {
+    PublishEditedFlightPlan();
+  }
+  flight_planners_.clear();
+}
+
+bool Vessel::last_flight_plan_edit_succeeded() const {
+  return last_flight_plan_edit_succeeded_;
+}
+
 void Vessel::FlowPrediction(Instant const& time) {
-  if (time > prediction_->last().time()) {
-    bool const finite_time = IsFinite(time - prediction_->last().time());
+  FlowPrognostication(time, prediction_adaptive_step_parameters_, *prediction_);
+}
+
+void Vessel::RefreshPrediction(
+    not_null<WorkStealingExecutor*> const executor) {
+  if (prognosticator_.valid()) {
+    if (prognosticator_.wait_for(std::chrono::seconds(0)) !=
+            std::future_status::ready) {
+      return;
+    }
+    PublishPrognostication();
+  }
+
+  // Prolonging the ephemeris is not thread-safe with respect to the evaluation
+  // of the trajectories of the celestials on this thread, so the task only
+  // flows up to the current |t_max()|.  Unless the last prognostication stopped
+  // before the end of the ephemeris (because of its step limit or of a
+  // singularity), the ephemeris is prolonged here, by as much as a flow to the
+  // infinite future would.
+  bool const prolong =
+      prognostication_ == nullptr ||
+      prognostication_->last().time() == prognostication_t_max_;
+  prognostication_t_max_ = ephemeris_->t_max();
+  if (prolong) {
+    prognostication_t_max_ += FlightPlan::max_ephemeris_steps_per_frame *
+                              ephemeris_->planetary_integrator_step();
+    ephemeris_->Prolong(prognostication_t_max_);
+  }
+
+  // The task only uses copies of the state of this vessel, so that the latter
+  // may change while the prediction is being computed.
+  auto const last = psychohistory_->last();
+  prognosticator_ = executor->Add(
+      [this,
+       time = last.time(),
+       degrees_of_freedom = last.degrees_of_freedom(),
+       t_max = prognostication_t_max_,
+       parameters = prediction_adaptive_step_parameters_]() {
+        auto prognostication =
+            std::make_unique<DiscreteTrajectory<Barycentric>>();
+        prognostication->Append(time, degrees_of_freedom);
+        FlowPrognostication(t_max, parameters, *prognostication);
+        next_prognostication_ = std::move(prognostication);
+      });
+}
+
+void Vessel::WaitForPrediction() {
+  if (prognosticator_.valid()) {
+    prognosticator_.wait();
+    PublishPrognostication();
+  }
+}
+
+void Vessel::FlowPrognostication(
+    Instant const& time,
+    Ephemeris<Barycentric>::AdaptiveStepParameters const&
+        adaptive_step_parameters,
+    DiscreteTrajectory<Barycentric>& prognostication) const {
+  if (time > prognostication.last().time()) {
+    bool const finite_time = IsFinite(time - prognostication.last().time());
     Instant const t = finite_time ? time : ephemeris_->t_max();
     // This will not prolong the ephemeris if |time| is infinite (but it may do
     // so if it is finite).
     bool const reached_t = ephemeris_->FlowWithAdaptiveStep(
-        prediction_,
+        &prognostication,
         Ephemeris<Barycentric>::NoIntrinsicAcceleration,
         t,
-        prediction_adaptive_step_parameters_,
+        adaptive_step_parameters,
         FlightPlan::max_ephemeris_steps_per_frame,
         /*last_point_only=*/false);
     if (!finite_time && reached_t) {
       // This will prolong the ephemeris by |max_ephemeris_steps_per_frame|.
       ephemeris_->FlowWithAdaptiveStep(
-        prediction_,
+        &prognostication,
         Ephemeris<Barycentric>::NoIntrinsicAcceleration,
         time,
-        prediction_adaptive_step_parameters_,
+        adaptive_step_parameters,
         FlightPlan::max_ephemeris_steps_per_frame,
         /*last_point_only=*/false);
     }
   }
 }
 
-DiscreteTrajectory<Barycentric> const& Vessel::psychohistory() const {
+void Vessel::AttachPrediction(
+    DiscreteTrajectory<Barycentric> const& prognostication) {
+  psychohistory_->DeleteFork(prediction_);
+  prediction_ = psychohistory_->NewForkAtLast();
+  Instant const& fork_time = prediction_->Fork().time();
+  for (auto it = prognostication.Begin(); it != prognostication.End(); ++it) {
+    if (it.time() > fork_time) {
+      prediction_->Append(it.time(), it.degrees_of_freedom());
+    }
+  }
+}
+
+void Vessel::PublishPrognostication() {
+  prognosticator_.get();
+  CHECK(next_prognostication_ != nullptr);
+  prognostication_ = std::move(next_prognostication_);
+  AttachPrediction(*prognostication_);
+}
+
+void Vessel::CancelFlightPlanEdits() {
+  {
+    std::lock_guard<std::mutex> l(edited_flight_plan_lock_);
+    ++flight_plan_generation_;
+    edited_flight_plan_.reset();
+  }
+  pending_flight_plan_edits_.clear();
+}
+
+void Vessel::PublishEditedFlightPlan() {
+  flight_planners_.back().get();
+  flight_planners_.pop_back();
+  std::lock_guard<std::mutex> l(edited_flight_plan_lock_);
+  CHECK(edited_flight_plan_ != nullptr);
+  flight_plan_ = std::move(edited_flight_plan_);
+  last_flight_plan_edit_succeeded_ = edited_flight_plan_succeeded_;
+  pending_flight_plan_edits_.clear();
+}
+
+DiscreteTrajectory<Barycentric> const& Vessel::psychohistory() {
+  DeserializeHistoryIfNeeded();
   return *psychohistory_;
 }
 
+DiscreteTrajectory<Barycentric>::Iterator Vessel::psychohistory_last() const {
+  return psychohistory_->last();
+}
+
 void Vessel::WriteToMessage(
     not_null<serialization::Vessel*> const message) const {
   message->set_guid(guid_);
@@ -276,18 +599,53 @@ void Vessel::WriteToMessage(
   prediction_adaptive_step_parameters_.WriteToMessage(
       message->mutable_prediction_adaptive_step_parameters());
   for (auto const& pair : parts_) {
-    auto const& part = pair.second;
-    part->WriteToMessage(message->add_parts());
+    pair.second.part->WriteToMessage(message->add_parts());
   }
-  for (auto const& part_id : kept_parts_) {
-    CHECK(Contains(parts_, part_id));
-    message->add_kept_parts(part_id);
+  for (auto const& pair : parts_) {
+    if (pair.second.kept) {
+      message->add_kept_parts(pair.first);
+    }
+  }
+  if (serialized_history_.empty()) {
+    history_->WriteToMessage(message->mutable_history(),
+                             /*forks=*/{psychohistory_, prediction_});
+  } else {
+    // Don't deserialize the history just to serialize it again, splice the
+    // serialized points with those of |history_| instead.  The first point of
+    // |history_| is the last serialized point.
+    serialization::DiscreteTrajectory tail;
+    history_->WriteToMessage(&tail, /*forks=*/{psychohistory_, prediction_});
+    auto const history = message->mutable_history();
+    CHECK(history->ParseFromString(serialized_history_));
+    history->clear_children();
+    history->clear_fork_position();
+    history->mutable_timeline()->RemoveLast();
+    history->mutable_timeline()->MergeFrom(tail.timeline());
+    *history->mutable_children() = tail.children();
+    *history->mutable_fork_position() = tail.fork_position();
+    // The downsampling state that was read by |ReadFromMessage| is only
+    // current if |history_| has not been downsampled since, i.e., if the dense
+    // timeline of |history_| still starts at its first point.  Otherwise that
+    // of |history_| is current.
+    CHECK(tail.has_downsampling());
+    auto const& tail_downsampling = tail.downsampling();
+    if (!tail_downsampling.has_start_of_dense_timeline() ||
+        Instant::ReadFromMessage(
+            tail_downsampling.start_of_dense_timeline()) !=
+            history_->Begin().time()) {
+      *history->mutable_downsampling() = tail_downsampling;
+    }
   }
-  history_->WriteToMessage(message->mutable_history(),
-                           /*forks=*/{psychohistory_, prediction_});
   if (flight_plan_ != nullptr) {
     flight_plan_->WriteToMessage(message->mutable_flight_plan());
   }
+  if (compressed_history_end_ != InfinitePast) {
+    auto const history_compression = message->mutable_history_compression();
+    compressed_history_end_.WriteToMessage(
+        history_compression->mutable_compressed_history_end());
+    history_compression_tolerance_.WriteToMessage(
+        history_compression->mutable_tolerance());
+  }
 }
 
 not_null<std::unique_ptr<Vessel>> Vessel::ReadFromMessage(
@@ -308,6 +666,10 @@ not_null<std::unique_ptr<Vessel>> Vessel::ReadFromMessage(
       ephemeris,
       Ephemeris<Barycentric>::AdaptiveStepParameters::ReadFromMessage(
           message.prediction_adaptive_step_parameters()));
+  // The parts are inserted all at once, so that the time taken doesn't depend
+  // on the order in which they were serialized.
+  std::vector<std::pair<PartId, OwnedPart>> owned_parts;
+  owned_parts.reserve(message.parts_size());
   for (auto const& serialized_part : message.parts()) {
     PartId const part_id = serialized_part.part_id();
     auto part =
@@ -316,11 +678,11 @@ not_null<std::unique_ptr<Vessel>> Vessel::ReadFromMessage(
             deletion_callback(part_id);
           }
         });
-    vessel->parts_.emplace(part_id, std::move(part));
+    owned_parts.emplace_back(part_id, OwnedPart(std::move(part)));
   }
+  vessel->parts_.EmplaceAll(std::move(owned_parts));
   for (PartId const part_id : message.kept_parts()) {
-    CHECK(Contains(vessel->parts_, part_id));
-    vessel->kept_parts_.insert(part_id);
+    vessel->KeepPart(part_id);
   }
 
   if (is_pre_cesàro) {
@@ -349,10 +711,28 @@ not_null<std::unique_ptr<Vessel>> Vessel::ReadFromMessage(
         /*forks=*/{&vessel->psychohistory_});
     vessel->prediction_ = vessel->psychohistory_->NewForkAtLast();
     vessel->FlowPrediction(InfiniteFuture);
-  } else {
+  } else if (is_pre_陈景润 || !ForksAtLastPoint(message.history())) {
     vessel->history_ = DiscreteTrajectory<Barycentric>::ReadFromMessage(
         message.history(),
         /*forks=*/{&vessel->psychohistory_, &vessel->prediction_});
+  } else {
+    // Only deserialize the last point of the history and its forks.  The rest
+    // of the history is kept in serialized form until it is needed.
+    auto const& history = message.history();
+    serialization::DiscreteTrajectory tail;
+    *tail.add_timeline() = history.timeline(history.timeline_size() - 1);
+    *tail.mutable_children() = history.children();
+    *tail.mutable_fork_position() = history.fork_position();
+    vessel->history_ = DiscreteTrajectory<Barycentric>::ReadFromMessage(
+        tail,
+        /*forks=*/{&vessel->psychohistory_, &vessel->prediction_});
+    vessel->history_->SetDownsampling(max_dense_intervals,
+                                      downsampling_tolerance);
+    if (history.timeline_size() > 1) {
+      CHECK(history.SerializeToString(&vessel->serialized_history_));
+      vessel->serialized_history_begin_time_ =
+          Instant::ReadFromMessage(history.timeline(0).instant());
+    }
   }
 
   if (is_pre_陈景润) {
@@ -364,6 +744,13 @@ not_null<std::unique_ptr<Vessel>> Vessel::ReadFromMessage(
     vessel->flight_plan_ = FlightPlan::ReadFromMessage(message.flight_plan(),
                                                        ephemeris);
   }
+  if (message.has_history_compression()) {
+    auto const& history_compression = message.history_compression();
+    vessel->compressed_history_end_ = Instant::ReadFromMessage(
+        history_compression.compressed_history_end());
+    vessel->history_compression_tolerance_ =
+        Length::ReadFromMessage(history_compression.tolerance());
+  }
   return vessel;
 }
 
@@ -371,7 +758,7 @@ void Vessel::FillContainingPileUpsFromMessage(
     serialization::Vessel const& message,
     not_null<std::list<PileUp>*> const pile_ups) {
   for (auto const& part_message : message.parts()) {
-    auto const& part = FindOrDie(parts_, part_message.part_id());
+    auto const& part = parts_.at(part_message.part_id()).part;
     part->FillContainingPileUpFromMessage(part_message, pile_ups);
   }
 }
@@ -385,7 +772,109 @@ Vessel::Vessel()
       prediction_adaptive_step_parameters_(DefaultPredictionParameters()),
       parent_(testing_utilities::make_not_null<Celestial const*>()),
       ephemeris_(testing_utilities::make_not_null<Ephemeris<Barycentric>*>()),
-      history_(make_not_null_unique<DiscreteTrajectory<Barycentric>>()) {}
+      history_(make_not_null_unique<DiscreteTrajectory<Barycentric>>()),
+      history_memory_budget_(default_history_memory_budget),
+      compressed_history_end_(InfinitePast),
+      history_compression_tolerance_(min_history_compression_tolerance),
+      history_compression_threshold_(history_memory_budget_ /
+                                     bytes_per_history_point) {}
+
+void Vessel::CompressHistoryIfNeeded() {
+  std::int64_t const size = history_->Size();
+  if (size <= history_compression_threshold_) {
+    return;
+  }
+  std::int64_t const max_points =
+      history_memory_budget_ / bytes_per_history_point;
+  // Compress below the budget, so that we don't have to compress again after a
+  // few more calls to |AdvanceTime|.
+  std::int64_t const target_points = 3 * max_points / 4;
+
+  // Only the points after |compressed_history_end_| are compressed.  They have
+  // never been compressed, so each point is compressed at most once, and the
+  // error of the compressed tier with respect to the original history is
+  // bounded by the tolerance instead of compounding.  Compress the older half
+  // of these points, then the older half of the remaining ones, and so on until
+  // the history fits.  The points that have not been downsampled yet cannot be
+  // compressed, so we stop at the first of them: the points after it will be
+  // compressed by a later call, once they have been downsampled.
+  Instant const first_dense_time = history_->first_dense_time();
+  auto begin = history_->LowerBound(compressed_history_end_);
+  std::int64_t uncompressed = 0;
+  for (auto it = begin;
+       it != history_->End() && it.time() <= first_dense_time;
+       ++it) {
+    ++uncompressed;
+  }
+  std::int64_t removed = 0;
+  while (uncompressed > 2 && history_->Size() > target_points) {
+    auto end = begin;
+    for (std::int64_t i = 0; i < uncompressed / 2; ++i) {
+      ++end;
+    }
+    removed += history_->DownsampleBetween(begin.time(),
+                                           end.time(),
+                                           history_compression_tolerance_);
+    compressed_history_end_ = end.time();
+    uncompressed -= uncompressed / 2;
+    begin = end;
+  }
+  Length const tolerance = history_compression_tolerance_;
+  if (history_->Size() > target_points) {
+    // The next points will be compressed more coarsely.
+    history_compression_tolerance_ =
+        std::min(2 * history_compression_tolerance_,
+                 max_history_compression_tolerance);
+  }
+
+  // If the budget could not be met, wait until the history has grown
+  // significantly before trying again.
+  history_compression_threshold_ =
+      std::max(max_points, history_->Size() + history_->Size() / 4);
+  LOG(INFO) << "Compressed the history of " << ShortDebugString()
+            << " before " << compressed_history_end_ << " with a tolerance of "
+            << tolerance << ": " << removed
+            << " points removed, " << history_->Size() << " points left";
+}
+
+void Vessel::DeserializeHistoryIfNeeded() {
+  if (serialized_history_.empty()) {
+    return;
+  }
+  LOG(INFO) << "Deserializing the history of vessel " << ShortDebugString();
+  serialization::DiscreteTrajectory message;
+  CHECK(message.ParseFromString(serialized_history_));
+  serialized_history_.clear();
+  serialized_history_.shrink_to_fit();
+
+  // The forks and the last point of the serialized history are already in
+  // |history_|.
+  message.clear_children();
+  message.clear_fork_position();
+  message.mutable_timeline()->RemoveLast();
+  Instant const history_begin_time = history_->Begin().time();
+  auto const& new_last_instant =
+      message.timeline(message.timeline_size() - 1).instant();
+  if (message.downsampling().has_start_of_dense_timeline() &&
+      Instant::ReadFromMessage(
+          message.downsampling().start_of_dense_timeline()) ==
+          history_begin_time) {
+    // The dense timeline may not start at the point that we just removed.
+    *message.mutable_downsampling()->mutable_start_of_dense_timeline() =
+        new_last_instant;
+  }
+  not_null<std::unique_ptr<DiscreteTrajectory<Barycentric>>> history =
+      DiscreteTrajectory<Barycentric>::ReadFromMessage(message, /*forks=*/{});
+
+  // Append the points of |history_| except the last one, and then move the
+  // |psychohistory_| (and therefore the |prediction_|) which is forked at that
+  // last point.
+  for (auto it = history_->Begin(); it != history_->last(); ++it) {
+    history->Append(it.time(), it.degrees_of_freedom());
+  }
+  history->AttachFork(psychohistory_->DetachFork());
+  history_ = std::move(history);
+}
 
 void Vessel::AppendToVesselTrajectory(
     TrajectoryIterator const part_trajectory_begin,
@@ -397,7 +886,7 @@ void Vessel::AppendToVesselTrajectory(
   its.reserve(parts_.size());
   ends.reserve(parts_.size());
   for (auto const& pair : parts_) {
-    Part& part = *pair.second;
+    Part& part = *pair.second.part;
     its.push_back((part.*part_trajectory_begin)());
     ends.push_back((part.*part_trajectory_end)());
   }
@@ -413,7 +902,7 @@ void Vessel::AppendToVesselTrajectory(
     BarycentreCalculator<DegreesOfFreedom<Barycentric>, Mass> calculator;
     int i = 0;
     for (auto const& pair : parts_) {
-      Part& part = *pair.second;
+      Part& part = *pair.second.part;
       auto& it = its[i];
       CHECK_EQ(at_end_of_part_trajectory, it == ends[i]);
       if (!at_end_of_part_trajectory) {
@@ -1,16 +1,23 @@
 ﻿
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "base/macros.hpp"
+#include "base/work_stealing_executor.hpp"
 #include "ksp_plugin/celestial.hpp"
 #include "ksp_plugin/flight_plan.hpp"
 #include "ksp_plugin/part.hpp"
+#include "ksp_plugin/part_registry.hpp"
 #include "ksp_plugin/pile_up.hpp"
 #include "physics/discrete_trajectory.hpp"
 #include "physics/ephemeris.hpp"
@@ -24,6 +31,7 @@ namespace internal_vessel {
 
 using base::IteratorOn;
 using base::not_null;
+using base::WorkStealingExecutor;
 using geometry::Instant;
 using geometry::Vector;
 using physics::DegreesOfFreedom;
@@ -32,6 +40,7 @@ using physics::Ephemeris;
 using physics::MasslessBody;
 using quantities::Force;
 using quantities::GravitationalParameter;
+using quantities::Length;
 using quantities::Mass;
 
 // Represents a KSP |Vessel|.
@@ -40,6 +49,28 @@ class Vessel {
   using Manœuvres = std::vector<
       not_null<std::unique_ptr<Manœuvre<Barycentric, Navigation> const>>>;
 
+  // An edit of a flight plan, e.g., |FlightPlan::ReplaceLast|.  Returns false
+  // if the edit failed.
+  using FlightPlanEdit = std::function<bool(FlightPlan& flight_plan)>;
+
+  // Telemetry about the memory used by the history.
+  struct HistoryMemoryUsage {
+    // The number of points of the history that are held in memory, and an
+    // estimate of the number of bytes that they use.
+    std::int64_t points;
+    std::int64_t bytes;
+    // The number of bytes used by the part of the history whose
+    // deserialization was deferred.
+    std::int64_t serialized_bytes;
+    // The points before |compressed_history_end| have been compressed, each of
+    // them once, with a tolerance no larger than |compression_tolerance|.
+    Instant compressed_history_end;
+    Length compression_tolerance;
+  };
+
+  // The default value for |history_memory_budget|.
+  static std::int64_t const default_history_memory_budget;
+
   // Constructs a vessel whose parent is initially |*parent|.  No transfer of
   // ownership.
   Vessel(GUID const& guid,
@@ -78,6 +109,14 @@ class Vessel {
   // as happens when a vessel ceases to exist while loaded.  Note that in that
   // case |FreeParts| must not be called.
   virtual not_null<std::unique_ptr<Part>> ExtractPart(PartId id);
+  // Same as |AddPart| and |ExtractPart| for several parts, e.g., when vessels
+  // dock.  These functions take a time linear in the number of parts of this
+  // vessel, instead of a time proportional to it for each part.  The parts
+  // with the given |ids| must exist; they are returned in increasing order of
+  // their IDs.
+  virtual void AddParts(std::vector<not_null<std::unique_ptr<Part>>> parts);
+  virtual std::vector<not_null<std::unique_ptr<Part>>> ExtractParts(
+      std::set<PartId> const& ids);
   // Prevents the part with the given ID from being removed in the next call to
   // |FreeParts|.
   virtual void KeepPart(PartId id);
@@ -107,7 +146,9 @@ class Vessel {
   // Calls |action| on all parts.
   virtual void ForAllParts(std::function<void(Part&)> action) const;
 
-  virtual DiscreteTrajectory<Barycentric> const& prediction() const;
+  // Not const because it may deserialize the history, see
+  // |DeserializeHistoryIfNeeded|.
+  virtual DiscreteTrajectory<Barycentric> const& prediction();
 
   virtual void set_prediction_adaptive_step_parameters(
       Ephemeris<Barycentric>::AdaptiveStepParameters const&
@@ -120,13 +161,25 @@ class Vessel {
   virtual bool has_flight_plan() const;
 
   // Extends the psychohistory of this vessel by computing the centre of mass of
-  // its parts at every point in their tail.  Clears the tails.
+  // its parts at every point in their tail.  Clears the tails.  The prediction
+  // is restarted from the new end of the psychohistory, so it is empty until it
+  // is flowed or published again.
   virtual void AdvanceTime();
 
   // Forgets the trajectories and flight plan before |time|.  This may delete
   // the flight plan.
   virtual void ForgetBefore(Instant const& time);
 
+  // The history is stored in three tiers: the most recent points are dense,
+  // the older ones are downsampled, and the oldest ones are compressed by
+  // |AdvanceTime| as needed to keep the memory used by the history within the
+  // given budget, in bytes.  The points are compressed with a coarser (but
+  // bounded) tolerance, which is increased for the points compressed later if
+  // the budget is not met.  A point is never compressed twice.
+  virtual void set_history_memory_budget(std::int64_t history_memory_budget);
+  virtual std::int64_t history_memory_budget() const;
+  virtual HistoryMemoryUsage history_memory_usage() const;
+
   // Creates a |flight_plan_| at the end of history using the given parameters.
   // Deletes any pre-existing predictions.
   virtual void CreateFlightPlan(
@@ -138,11 +191,76 @@ class Vessel {
   // Deletes the |flight_plan_|.  Performs no action unless |has_flight_plan()|.
   virtual void DeleteFlightPlan();
 
+  // Requests that |edit| be applied to the flight plan asynchronously.  The
+  // pending edits are applied in order, on |executor|, to a copy of the last
+  // completed flight plan; a recomputation which is in progress is
+  // cooperatively aborted, since it is superseded by the new one.  If
+  // |coalesce| is true and the last pending edit was also requested with
+  // |coalesce|, |edit| replaces it; this is appropriate for repeated
+  // replacements of the last manœuvre.  Until the recomputation is published
+  // by |RefreshFlightPlan|, |flight_plan()| is the last published flight plan.
+  // The ephemeris is prolonged on the calling thread up to the desired final
+  // time of |flight_plan()|; the edits must not set a later desired final time,
+  // as they would then prolong the ephemeris on a worker thread, which is not
+  // thread-safe with respect to the evaluation of the trajectories of the
+  // celestials.  Requires |has_flight_plan()|.
+  virtual void EditFlightPlanAsynchronously(
+      FlightPlanEdit const& edit,
+      bool coalesce,
+      not_null<WorkStealingExecutor*> executor);
+
+  // If the asynchronous recomputation of the flight plan has completed,
+  // publishes it, i.e., makes it the |flight_plan()|.
+  virtual void RefreshFlightPlan();
+
+  // Returns true if some asynchronous edits have not yet been published by
+  // |RefreshFlightPlan| or |WaitForFlightPlan|, whether or not their
+  // recomputation has completed.
+  virtual bool flight_plan_is_computing() const;
+
+  // Waits for the asynchronous recomputation of the flight plan, if any, and
+  // publishes it.  Must be called before any operation that is not thread-safe
+  // with respect to the integrations of the ephemeris.
+  virtual void WaitForFlightPlan();
+
+  // Whether all the asynchronous edits published by the last call to
+  // |RefreshFlightPlan| or |WaitForFlightPlan| succeeded; true if no edits were
+  // ever published.
+  virtual bool last_flight_plan_edit_succeeded() const;
+
   // Tries to extend the prediction up to and including |last_time|.  May not be
   // able to do it next to a singularity.
   virtual void FlowPrediction(Instant const& last_time);
 
-  virtual DiscreteTrajectory<Barycentric> const& psychohistory() const;
+  // If the prediction computed asynchronously by a previous call has
+  // completed, publishes it, i.e., makes it the |prediction()|.  Then, unless a
+  // computation is still in flight, starts computing on |executor| a new
+  // prediction from the last point of the psychohistory.  Never waits for an
+  // integration.  The published prediction is kept until a new one is
+  // published: |AdvanceTime| attaches it again to the new end of the
+  // psychohistory, only dropping the points that are not after that end, so
+  // that |prediction()| doesn't become empty while a computation is in flight.
+  // Note that the published prediction was computed from the end of the
+  // psychohistory at the time it was started, so it lags by the duration of
+  // one computation.
+  // The computation doesn't prolong the ephemeris: this function does it
+  // before starting the computation, unless the last one stopped before the
+  // end of the ephemeris.
+  virtual void RefreshPrediction(not_null<WorkStealingExecutor*> executor);
+
+  // Waits for the prediction being computed asynchronously, if any, and
+  // publishes it.  Must be called before any operation that is not thread-safe
+  // with respect to the integrations of the ephemeris.
+  virtual void WaitForPrediction();
+
+  // Not const because it may deserialize the history, see
+  // |DeserializeHistoryIfNeeded|.
+  virtual DiscreteTrajectory<Barycentric> const& psychohistory();
+
+  // Returns the last point of the psychohistory.  Contrary to |psychohistory()|
+  // and |prediction()|, this does not require the deserialization of the
+  // history, so it is const.
+  virtual DiscreteTrajectory<Barycentric>::Iterator psychohistory_last() const;
 
   // The vessel must satisfy |is_initialized()|.
   virtual void WriteToMessage(not_null<serialization::Vessel*> message) const;
@@ -170,6 +288,46 @@ class Vessel {
                                 TrajectoryIterator part_trajectory_end,
                                 DiscreteTrajectory<Barycentric>& trajectory);
 
+  // Compresses the oldest points of |history_| if it exceeds the memory
+  // budget.
+  void CompressHistoryIfNeeded();
+
+  // Extends |trajectory| up to and including |last_time| using the given
+  // parameters.  Only uses the |ephemeris_|, so it may be called on a worker
+  // thread, provided that |last_time| is not after the |t_max()| of the
+  // ephemeris: prolonging the ephemeris is not thread-safe with respect to the
+  // evaluation of the trajectories of the celestials.
+  void FlowPrognostication(
+      Instant const& last_time,
+      Ephemeris<Barycentric>::AdaptiveStepParameters const&
+          adaptive_step_parameters,
+      DiscreteTrajectory<Barycentric>& prognostication) const;
+
+  // Replaces the |prediction_| with a fork at the end of the |psychohistory_|
+  // containing the points of |prognostication| that are after that fork.
+  void AttachPrediction(
+      DiscreteTrajectory<Barycentric> const& prognostication);
+
+  // Once the |prognosticator_| has completed, makes the |next_prognostication_|
+  // the |prognostication_| and publishes it.
+  void PublishPrognostication();
+
+  // Aborts the asynchronous recomputation of the flight plan, if any, and
+  // forgets the pending edits.
+  void CancelFlightPlanEdits();
+
+  // Publishes the |edited_flight_plan_| once the last of the
+  // |flight_planners_| has completed.
+  void PublishEditedFlightPlan();
+
+  // If the deserialization of the history was deferred by |ReadFromMessage|,
+  // deserializes the points of |serialized_history_| and prepends them to
+  // |history_|.  The |psychohistory_| and the |prediction_| are not changed.
+  // This modifies |history_|, so it is only called by non-const member
+  // functions, which, like the other non-const member functions, must not be
+  // called concurrently with any other member function.
+  void DeserializeHistoryIfNeeded();
+
   GUID const guid_;
   std::string name_;
 
@@ -180,17 +338,82 @@ class Vessel {
   not_null<Celestial const*> parent_;
   not_null<Ephemeris<Barycentric>*> const ephemeris_;
 
-  std::map<PartId, not_null<std::unique_ptr<Part>>> parts_;
-  std::set<PartId> kept_parts_;
+  // A part owned by this vessel, and whether |KeepPart| was called for it since
+  // the last call to |FreeParts|.
+  struct OwnedPart {
+    explicit OwnedPart(not_null<std::unique_ptr<Part>> part);
+
+    not_null<std::unique_ptr<Part>> part;
+    bool kept = false;
+  };
+
+  // The parts are visited in increasing order of their IDs, so that the
+  // computations over them are reproducible across a reload.
+  PartRegistry<OwnedPart, PartOrder::Increasing> parts_;
+  int number_of_kept_parts_ = 0;
 
   // See the comments in pile_up.hpp for an explanation of the terminology.
   not_null<std::unique_ptr<DiscreteTrajectory<Barycentric>>> history_;
+
+  // Most vessels are never looked at by the user, so |ReadFromMessage| only
+  // deserializes the last point of the history (and the forks), which is all
+  // that is needed to integrate the vessel.  If this string is not empty, it
+  // contains the entire serialized history as read by |ReadFromMessage|, and
+  // its last point is the first point of |history_|.
+  std::string serialized_history_;
+  // The time of the first point of |serialized_history_|.  Only meaningful if
+  // |serialized_history_| is not empty.
+  Instant serialized_history_begin_time_;
+
   DiscreteTrajectory<Barycentric>* psychohistory_ = nullptr;
 
   // The |prediction_| is forked off the end of the |psychohistory_|.
   DiscreteTrajectory<Barycentric>* prediction_ = nullptr;
 
+  // The asynchronous computation of the prediction started by
+  // |RefreshPrediction|, if any.  It writes its result to the
+  // |next_prognostication_|, a root trajectory starting at the point of the
+  // psychohistory from which it was computed, which must only be accessed once
+  // the |prognosticator_| is ready.
+  std::future<void> prognosticator_;
+  std::unique_ptr<DiscreteTrajectory<Barycentric>> next_prognostication_;
+  // The last published prognostication, if any.  The |prediction_| contains its
+  // points that are after the end of the |psychohistory_|.
+  std::unique_ptr<DiscreteTrajectory<Barycentric>> prognostication_;
+  // The |t_max()| of the ephemeris when the last computation was started, i.e.,
+  // the time up to which it flows.
+  Instant prognostication_t_max_;
+
+  std::int64_t history_memory_budget_;
+  // The points of |history_| before |compressed_history_end_| have been
+  // compressed, and are never compressed again.  The points after it will be
+  // compressed with |history_compression_tolerance_|.  Not after the first
+  // point of |history_| that has not been downsampled yet.
+  Instant compressed_history_end_;
+  Length history_compression_tolerance_;
+  // The size of |history_| above which |CompressHistoryIfNeeded| does
+  // something.
+  std::int64_t history_compression_threshold_;
+
   std::unique_ptr<FlightPlan> flight_plan_;
+
+  // The edits requested by |EditFlightPlanAsynchronously| that are not yet
+  // reflected in |flight_plan_|, and whether they may be coalesced.
+  std::vector<std::pair<FlightPlanEdit, bool>> pending_flight_plan_edits_;
+  // The asynchronous recomputations of the flight plan.  Only the last one may
+  // be current, the others have been aborted but may still be running.
+  std::vector<std::future<void>> flight_planners_;
+  // Incremented each time a recomputation is started; a recomputation aborts
+  // when it notices that it is no longer current.
+  std::atomic<std::int64_t> flight_plan_generation_{0};
+  std::mutex edited_flight_plan_lock_;
+  // The result of the current recomputation, and whether all its edits
+  // succeeded.
+  std::unique_ptr<FlightPlan> edited_flight_plan_
+      GUARDED_BY(edited_flight_plan_lock_);
+  bool edited_flight_plan_succeeded_ GUARDED_BY(edited_flight_plan_lock_) =
+      false;
+  bool last_flight_plan_edit_succeeded_ = true;
 };
 
 }  // namespace internal_vessel
@@ -205,10 +205,22 @@ class FlightPlanner : WindowRenderer {
               UnityEngine.GUILayout.TextArea("Editing manœuvre #" +
                                              (burn_editors_.Count) + ":");
               if (last_burn.Render(enabled : true)) {
-                plugin_.FlightPlanReplaceLast(vessel_guid, last_burn.Burn());
-                last_burn.Reset(
-                    plugin_.FlightPlanGetManoeuvre(vessel_guid,
-                                                   burn_editors_.Count - 1));
+                // Dragging a slider edits the burn many times per second, so
+                // the flight plan is recomputed asynchronously.  The editor is
+                // only reset to the actual manœuvre once the recomputation is
+                // complete, otherwise it would revert the user's input.
+                plugin_.FlightPlanReplaceLastAsynchronously(vessel_guid,
+                                                            last_burn.Burn());
+                last_burn_pending_ = true;
+              }
+              if (last_burn_pending_) {
+                plugin_.FlightPlanPoll(vessel_guid);
+                if (!plugin_.FlightPlanIsComputing(vessel_guid)) {
+                  last_burn_pending_ = false;
+                  last_burn.Reset(
+                      plugin_.FlightPlanGetManoeuvre(vessel_guid,
+                                                     burn_editors_.Count - 1));
+                }
               }
               if (UnityEngine.GUILayout.Button(
                       "Delete last manœuvre",
@@ -349,6 +361,7 @@ class FlightPlanner : WindowRenderer {
       Shrink();
     }
     burn_editors_ = null;
+    last_burn_pending_ = false;
     vessel_ = FlightGlobals.ActiveVessel;
   }
 
@@ -377,6 +390,9 @@ class FlightPlanner : WindowRenderer {
   private readonly PrincipiaPluginAdapter adapter_;
   private Vessel vessel_;
   private List<BurnEditor> burn_editors_;
+  // Whether the last burn was edited asynchronously and the corresponding
+  // editor has not been reset since.
+  private bool last_burn_pending_ = false;
 
   private DifferentialSlider final_time_;
 
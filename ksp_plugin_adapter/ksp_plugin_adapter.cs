@@ -105,6 +105,9 @@ private enum UnityLayers {
        1 << 26, 1 << 27, 1 << 28, 1 << 29, double.PositiveInfinity};
   [KSPField(isPersistant = true)]
   private int history_length_index_ = 10;
+  // The memory budget for the history of each vessel, in mebibytes.
+  [KSPField(isPersistant = true)]
+  private int vessel_history_memory_budget_in_mib_ = 16;
 
   [KSPField(isPersistant = true)]
   private bool show_prediction_settings_ = true;
@@ -127,6 +130,10 @@ private enum UnityLayers {
   // Whether a journal will be recorded when the plugin is next constructed.
   [KSPField(isPersistant = true)]
   private bool must_record_journal_ = false;
+  // Whether that journal will be written by a separate thread.  This is faster
+  // but the last calls may be lost if the game crashes.
+  [KSPField(isPersistant = true)]
+  private bool must_record_journal_asynchronously_ = false;
 
   // Whether the plotting frame must be set to something convenient at the next
   // opportunity.
@@ -604,7 +611,8 @@ private enum UnityLayers {
     base.OnLoad(node);
     if (must_record_journal_) {
       journaling_ = true;
-      Log.ActivateRecorder(true);
+      Log.ActivateRecorder(activate     : true,
+                           asynchronous : must_record_journal_asynchronously_);
     }
     if (node.HasValue(principia_key_)) {
       Cleanup();
@@ -624,6 +632,7 @@ private enum UnityLayers {
                                     ref plugin_);
       }
       Interface.DeserializePlugin("", 0, ref deserializer, ref plugin_);
+      SetVesselHistoryMemoryBudget();
 
       plotting_frame_selector_.reset(
           new ReferenceFrameSelector(this, 
@@ -1092,6 +1101,8 @@ private System.Collections.IEnumerator
                                  !vessel.packed,
                                  out inserted);
       if (!vessel.packed) {
+        var loaded_parts = new List<LoadedPart>();
+        var intrinsic_forces = new List<PartIntrinsicForce>();
         foreach (Part part in vessel.parts.Where((part) => part.rb != null)) {
           QP degrees_of_freedom;
           if (part_id_to_degrees_of_freedom_.ContainsKey(part.flightID)) {
@@ -1114,15 +1125,12 @@ private System.Collections.IEnumerator
           // NOTE(egg): the physics engine does not move the celestials, so it
           // is fine to use |main_body_degrees_of_freedom| here rather than to
           // store it during |FixedUpdate| or one of its timings.
-          plugin_.InsertOrKeepLoadedPart(
-              part.flightID,
-              part.name,
-              part.physicsMass == 0 ? part.rb.mass : part.physicsMass,
-              vessel.id.ToString(),
-              vessel.mainBody.flightGlobalsIndex,
-              main_body_degrees_of_freedom,
-              degrees_of_freedom,
-              Δt);
+          loaded_parts.Add(new LoadedPart{
+              part_id = part.flightID,
+              name = part.name,
+              mass_in_tonnes =
+                  part.physicsMass == 0 ? part.rb.mass : part.physicsMass,
+              world_degrees_of_freedom = degrees_of_freedom});
           if (part_id_to_intrinsic_force_.ContainsKey(part.flightID)) {
             // When a Kerbal is doing an EVA and holding on to a ladder, the
             // ladder imbues them with their weight at the location of the
@@ -1130,19 +1138,31 @@ private System.Collections.IEnumerator
             // effects where doing an EVA accelerates the vessel, see #1415.
             // Just say no to stupidity.
             if (!(vessel.isEVA && vessel.evaController.OnALadder)) {
-              plugin_.IncrementPartIntrinsicForce(
-                  part.flightID,
-                  (XYZ)part_id_to_intrinsic_force_[part.flightID]);
+              intrinsic_forces.Add(new PartIntrinsicForce{
+                  part_id = part.flightID,
+                  force_in_kilonewtons =
+                      (XYZ)part_id_to_intrinsic_force_[part.flightID]});
             }
           }
           if (part_id_to_intrinsic_forces_.ContainsKey(part.flightID)) {
             foreach (
                 var force in part_id_to_intrinsic_forces_[part.flightID]) {
-              plugin_.IncrementPartIntrinsicForce(part.flightID,
-                                                  (XYZ)force.force);
+              intrinsic_forces.Add(new PartIntrinsicForce{
+                  part_id = part.flightID,
+                  force_in_kilonewtons = (XYZ)force.force});
             }
           }
         }
+        // The parts of a vessel are sent in a single call, and so are their
+        // intrinsic forces, which are only valid once the parts are inserted.
+        plugin_.InsertOrKeepLoadedParts(vessel.id.ToString(),
+                                        loaded_parts.ToArray(),
+                                        loaded_parts.Count,
+                                        vessel.mainBody.flightGlobalsIndex,
+                                        main_body_degrees_of_freedom,
+                                        Δt);
+        plugin_.IncrementPartIntrinsicForces(intrinsic_forces.ToArray(),
+                                             intrinsic_forces.Count);
       } else if (inserted) {
         var parts = vessel.protoVessel.protoPartSnapshots;
         // For reasons that are unclear, the asteroid spawning code sometimes
@@ -1245,6 +1265,7 @@ private System.Collections.IEnumerator
 
     plugin_.FreeVesselsAndPartsAndCollectPileUps(Δt);
 
+    var apparent_parts = new List<PartDegreesOfFreedom>();
     foreach (Vessel vessel in FlightGlobals.Vessels.Where(v => !v.packed)) {
       if (!plugin_.HasVessel(vessel.id.ToString())) {
         continue;
@@ -1253,14 +1274,17 @@ private System.Collections.IEnumerator
         if (part.rb == null) {
           continue;
         }
-        plugin_.SetPartApparentDegreesOfFreedom(
-            part.flightID,
+        apparent_parts.Add(new PartDegreesOfFreedom{
+            part_id = part.flightID,
             // TODO(egg): use the centre of mass.
-            new QP{q = (XYZ)(Vector3d)part.rb.position,
-                   p = (XYZ)(Vector3d)part.rb.velocity},
-            main_body_degrees_of_freedom);
+            degrees_of_freedom =
+                new QP{q = (XYZ)(Vector3d)part.rb.position,
+                       p = (XYZ)(Vector3d)part.rb.velocity}});
       }
     }
+    plugin_.SetPartsApparentDegreesOfFreedom(apparent_parts.ToArray(),
+                                             apparent_parts.Count,
+                                             main_body_degrees_of_freedom);
 
     plugin_.CatchUpLaggingVessels();
 
@@ -1273,6 +1297,7 @@ private System.Collections.IEnumerator
         plugin_.HasVessel(FlightGlobals.ActiveVessel.id.ToString())) {
       Vector3d q_correction_at_root_part = Vector3d.zero;
       Vector3d v_correction_at_root_part = Vector3d.zero;
+      var actual_parts = new List<Part>();
       foreach (Vessel vessel in FlightGlobals.Vessels.Where(v => !v.packed)) {
         // TODO(egg): if I understand anything, there should probably be a
         // special treatment for loaded packed vessels.  I don't understand
@@ -1280,13 +1305,16 @@ private System.Collections.IEnumerator
         if (!plugin_.HasVessel(vessel.id.ToString())) {
           continue;
         }
-        foreach (Part part in vessel.parts) {
-          if (part.rb == null) {
-            continue;
-          }
-          QP part_actual_degrees_of_freedom =
-              plugin_.GetPartActualDegreesOfFreedom(
-                  part.flightID,
+        actual_parts.AddRange(vessel.parts.Where(part => part.rb != null));
+      }
+      var actual_degrees_of_freedom =
+          new PartDegreesOfFreedom[actual_parts.Count];
+      for (int i = 0; i < actual_parts.Count; ++i) {
+        actual_degrees_of_freedom[i].part_id = actual_parts[i].flightID;
+      }
+      plugin_.GetPartsActualDegreesOfFreedom(
+          actual_degrees_of_freedom,
+          actual_degrees_of_freedom.Length,
           new Origin{reference_part_is_at_origin  =
                          FloatingOrigin.fetch.continuous,
                      reference_part_is_unmoving =
@@ -1295,20 +1323,23 @@ private System.Collections.IEnumerator
                          (XYZ)FlightGlobals.ActiveVessel.mainBody.position,
                      reference_part_id =
                          FlightGlobals.ActiveVessel.rootPart.flightID});
-          if (part == FlightGlobals.ActiveVessel.rootPart) {
-            q_correction_at_root_part =
-                (Vector3d)part_actual_degrees_of_freedom.q - part.rb.position;
-            v_correction_at_root_part =
-                (Vector3d)part_actual_degrees_of_freedom.p - part.rb.velocity;
-          }
-
-          // TODO(egg): use the centre of mass.  Here it's a bit tedious, some
-          // transform nonsense must probably be done.
-          part.rb.position = (Vector3d)part_actual_degrees_of_freedom.q;
-          part.rb.transform.position =
-              (Vector3d)part_actual_degrees_of_freedom.q;
-          part.rb.velocity = (Vector3d)part_actual_degrees_of_freedom.p;
+      for (int i = 0; i < actual_parts.Count; ++i) {
+        Part part = actual_parts[i];
+        QP part_actual_degrees_of_freedom =
+            actual_degrees_of_freedom[i].degrees_of_freedom;
+        if (part == FlightGlobals.ActiveVessel.rootPart) {
+          q_correction_at_root_part =
+              (Vector3d)part_actual_degrees_of_freedom.q - part.rb.position;
+          v_correction_at_root_part =
+              (Vector3d)part_actual_degrees_of_freedom.p - part.rb.velocity;
         }
+
+        // TODO(egg): use the centre of mass.  Here it's a bit tedious, some
+        // transform nonsense must probably be done.
+        part.rb.position = (Vector3d)part_actual_degrees_of_freedom.q;
+        part.rb.transform.position =
+            (Vector3d)part_actual_degrees_of_freedom.q;
+        part.rb.velocity = (Vector3d)part_actual_degrees_of_freedom.p;
       }
       foreach (
           physicalObject physical_object in FlightGlobals.physicalObjects.Where(
@@ -2333,11 +2364,16 @@ private System.Collections.IEnumerator
     must_record_journal_ = UnityEngine.GUILayout.Toggle(
         value   : must_record_journal_,
         text    : "Record journal (starts on load)");
+    must_record_journal_asynchronously_ = UnityEngine.GUILayout.Toggle(
+        value   : must_record_journal_asynchronously_,
+        text    : "Record journal asynchronously (faster, may lose the last " +
+                  "calls on a crash)");
     if (journaling_ && !must_record_journal_) {
       // We can deactivate a recorder at any time, but in order for replaying to
       // work, we should only activate one before creating a plugin.
       journaling_ = false;
-      Interface.ActivateRecorder(false);
+      Interface.ActivateRecorder(activate     : false,
+                                 asynchronous : false);
     }
   }
 
@@ -2509,6 +2545,7 @@ private System.Collections.IEnumerator
       plugin_.AdvanceTime(Planetarium.GetUniversalTime(),
                           Planetarium.InverseRotAngle);
     }
+    SetVesselHistoryMemoryBudget();
     plotting_frame_selector_.reset(
         new ReferenceFrameSelector(this,
                                    plugin_,
@@ -2518,6 +2555,11 @@ private System.Collections.IEnumerator
     flight_planner_.reset(new FlightPlanner(this, plugin_));
   }
 
+  private void SetVesselHistoryMemoryBudget() {
+    plugin_.SetVesselHistoryMemoryBudget(
+        (Int64)vessel_history_memory_budget_in_mib_ << 20);
+  }
+
   private void RemoveBuggyTidalLocking() {
     ApplyToBodyTree(body => body.tidallyLocked = false);
   }
@@ -1,26 +1,50 @@
 
 #include "ksp_plugin/plugin.hpp"
 
+#include <cmath>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "astronomy/epoch.hpp"
+#include "base/not_null.hpp"
 #include "benchmark/benchmark.h"
 #include "geometry/named_quantities.hpp"
 #include "gtest/gtest.h"
+#include "ksp_plugin/celestial.hpp"
+#include "ksp_plugin/integrators.hpp"
 #include "ksp_plugin/interface.hpp"
+#include "ksp_plugin/part.hpp"
+#include "ksp_plugin/vessel.hpp"
+#include "physics/massive_body.hpp"
+#include "physics/mock_ephemeris.hpp"
+#include "physics/rotating_body.hpp"
 #include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
 #include "serialization/ksp_plugin.pb.h"
 #include "testing_utilities/serialization.hpp"
 
 namespace principia {
 
+using base::make_not_null_unique;
+using base::not_null;
+using geometry::Displacement;
 using geometry::Instant;
+using geometry::Velocity;
 using interface::principia__AdvanceTime;
 using interface::principia__FutureCatchUpVessel;
 using interface::principia__FutureWait;
+using physics::DegreesOfFreedom;
+using physics::MassiveBody;
+using physics::MockEphemeris;
+using physics::RotatingBody;
 using quantities::Frequency;
 using quantities::Time;
+using quantities::si::Degree;
 using quantities::si::Hertz;
+using quantities::si::Kilogram;
+using quantities::si::Metre;
+using quantities::si::Radian;
 using quantities::si::Second;
 using testing_utilities::ReadFromBinaryFile;
 
@@ -66,5 +90,97 @@ TEST(PluginBenchmark, DISABLED_3Vessels) {
   benchmark::RunSpecifiedBenchmarks();
 }
 
+class VesselDeserializationBenchmark {
+ public:
+  // Constructs the serialized form of a vessel whose history has
+  // |history_points| points, one per second, on a circle so that downsampling
+  // doesn't eliminate them all.
+  explicit VesselDeserializationBenchmark(int const history_points)
+      : body_(MassiveBody::Parameters(1 * Kilogram),
+              RotatingBody<Barycentric>::Parameters(
+                  /*mean_radius=*/1 * Metre,
+                  /*reference_angle=*/0 * Degree,
+                  /*reference_instant=*/astronomy::J2000,
+                  /*angular_frequency=*/1 * Radian / Second,
+                  /*right_ascension_of_pole=*/0 * Degree,
+                  /*declination_of_pole=*/90 * Degree)),
+        celestial_(&body_) {
+    Vessel vessel("123",
+                  "vessel",
+                  &celestial_,
+                  &ephemeris_,
+                  DefaultPredictionParameters());
+    auto const degrees_of_freedom = [](Instant const& t) {
+      double const θ = (t - astronomy::J2000) / (1000 * Second);
+      return DegreesOfFreedom<Barycentric>(
+          Barycentric::origin +
+              Displacement<Barycentric>({std::cos(θ) * 1e6 * Metre,
+                                         std::sin(θ) * 1e6 * Metre,
+                                         0 * Metre}),
+          Velocity<Barycentric>({-std::sin(θ) * 1e3 * Metre / Second,
+                                 std::cos(θ) * 1e3 * Metre / Second,
+                                 0 * Metre / Second}));
+    };
+    vessel.AddPart(make_not_null_unique<Part>(
+        /*part_id=*/1,
+        "part",
+        1 * Kilogram,
+        degrees_of_freedom(astronomy::J2000),
+        /*deletion_callback=*/nullptr));
+    vessel.PrepareHistory(astronomy::J2000);
+    for (int i = 1; i < history_points; ++i) {
+      Instant const t = astronomy::J2000 + i * Second;
+      vessel.part(1)->AppendToHistory(t, degrees_of_freedom(t));
+      vessel.AdvanceTime();
+    }
+    vessel.WriteToMessage(&message_);
+  }
+
+  not_null<std::unique_ptr<Vessel>> ReadFromMessage() {
+    return Vessel::ReadFromMessage(message_,
+                                   &celestial_,
+                                   &ephemeris_,
+                                   /*deletion_callback=*/nullptr);
+  }
+
+ private:
+  MockEphemeris<Barycentric> ephemeris_;
+  RotatingBody<Barycentric> const body_;
+  Celestial const celestial_;
+  serialization::Vessel message_;
+};
+
+// Measures the time to read a save with 100 vessels having long histories.
+void BM_VesselDeserialization(benchmark::State& state) {
+  constexpr int vessels = 100;
+  VesselDeserializationBenchmark deserialization(
+      /*history_points=*/state.range_x());
+  while (state.KeepRunning()) {
+    for (int i = 0; i < vessels; ++i) {
+      benchmark::DoNotOptimize(deserialization.ReadFromMessage());
+    }
+  }
+}
+
+// Same as above, but the histories are then accessed, e.g., for plotting.
+void BM_VesselDeserializationAndPsychohistory(benchmark::State& state) {
+  constexpr int vessels = 100;
+  VesselDeserializationBenchmark deserialization(
+      /*history_points=*/state.range_x());
+  while (state.KeepRunning()) {
+    for (int i = 0; i < vessels; ++i) {
+      auto const vessel = deserialization.ReadFromMessage();
+      benchmark::DoNotOptimize(vessel->psychohistory().Size());
+    }
+  }
+}
+
+BENCHMARK(BM_VesselDeserialization)->Arg(1'000)->Arg(10'000);
+BENCHMARK(BM_VesselDeserializationAndPsychohistory)->Arg(1'000)->Arg(10'000);
+
+TEST(PluginBenchmark, DISABLED_VesselDeserialization) {
+  benchmark::RunSpecifiedBenchmarks();
+}
+
 }  // namespace ksp_plugin
 }  // namespace principia
@@ -0,0 +1,185 @@
+﻿
+#include "ksp_plugin/flight_plan_optimizer.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "base/work_stealing_executor.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "integrators/embedded_explicit_runge_kutta_nyström_integrator.hpp"
+#include "integrators/symmetric_linear_multistep_integrator.hpp"
+#include "ksp_plugin/flight_plan.hpp"
+#include "physics/apsides.hpp"
+#include "physics/discrete_trajectory.hpp"
+#include "physics/massive_body.hpp"
+#include "testing_utilities/numerics.hpp"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_flight_plan_optimizer {
+
+using base::make_not_null_unique;
+using geometry::Displacement;
+using geometry::Instant;
+using geometry::Position;
+using integrators::DormandElMikkawyPrince1986RKN434FM;
+using integrators::QuinlanTremaine1990Order12;
+using physics::BodyCentredNonRotatingDynamicFrame;
+using physics::ComputeApsides;
+using physics::DegreesOfFreedom;
+using physics::DiscreteTrajectory;
+using physics::MassiveBody;
+using quantities::Pow;
+using quantities::si::Kilogram;
+using quantities::si::Metre;
+using quantities::si::Milli;
+using quantities::si::Minute;
+using quantities::si::Newton;
+using quantities::si::Second;
+using quantities::Sqrt;
+using quantities::Time;
+using testing_utilities::AbsoluteError;
+using ::testing::Ge;
+using ::testing::Gt;
+using ::testing::Lt;
+
+class FlightPlanOptimizerTest : public testing::Test {
+ protected:
+  using TestNavigationFrame =
+      BodyCentredNonRotatingDynamicFrame<Barycentric, Navigation>;
+
+  FlightPlanOptimizerTest() : executor_(/*pool_size=*/2) {
+    MakeFlightPlan(/*ephemeris_step=*/10 * Minute,
+                   /*final_time=*/t0_ + 10 * Second);
+  }
+
+  // Replaces the ephemeris and the flight plan.  The flight plan starts on a
+  // circular orbit with a radius of 1 m and a period of 2π s.
+  void MakeFlightPlan(Time const& ephemeris_step, Instant const& final_time) {
+    flight_plan_.reset();
+    navigation_frame_.reset();
+    std::vector<not_null<std::unique_ptr<MassiveBody const>>> bodies;
+    bodies.emplace_back(
+        make_not_null_unique<MassiveBody>(1 * Pow<3>(Metre) / Pow<2>(Second)));
+    std::vector<DegreesOfFreedom<Barycentric>> initial_state{
+        {Barycentric::origin, Velocity<Barycentric>()}};
+    ephemeris_ = std::make_unique<Ephemeris<Barycentric>>(
+        std::move(bodies),
+        initial_state,
+        /*initial_time=*/t0_ - 2 * π * Second,
+        /*fitting_tolerance=*/1 * Milli(Metre),
+        Ephemeris<Barycentric>::FixedStepParameters(
+            QuinlanTremaine1990Order12<Position<Barycentric>>(),
+            ephemeris_step));
+    navigation_frame_ = std::make_unique<TestNavigationFrame>(
+        ephemeris_.get(),
+        ephemeris_->bodies().back());
+    flight_plan_ = std::make_unique<FlightPlan>(
+        /*initial_mass=*/1 * Kilogram,
+        /*initial_time=*/t0_,
+        DegreesOfFreedom<Barycentric>(
+            Barycentric::origin + Displacement<Barycentric>(
+                                      {1 * Metre, 0 * Metre, 0 * Metre}),
+            Velocity<Barycentric>({0 * Metre / Second,
+                                   1 * Metre / Second,
+                                   0 * Metre / Second})),
+        final_time,
+        ephemeris_.get(),
+        Ephemeris<Barycentric>::AdaptiveStepParameters(
+            DormandElMikkawyPrince1986RKN434FM<Position<Barycentric>>(),
+            /*max_steps=*/1000,
+            /*length_integration_tolerance=*/1 * Milli(Metre),
+            /*speed_integration_tolerance=*/1 * Milli(Metre) / Second));
+  }
+
+  Burn MakeRetrogradeBurn(Speed const& Δv) {
+    return {/*thrust=*/10 * Newton,
+            /*specific_impulse=*/100 * Newton * Second / Kilogram,
+            make_not_null_unique<TestNavigationFrame>(*navigation_frame_),
+            /*initial_time=*/t0_ + 1 * Second,
+            Velocity<Frenet<Navigation>>(
+                {-Δv, 0 * Metre / Second, 0 * Metre / Second}),
+            /*is_inertially_fixed=*/true};
+  }
+
+  Length FirstPeriapsisDistance() {
+    DiscreteTrajectory<Barycentric>::Iterator begin;
+    DiscreteTrajectory<Barycentric>::Iterator end;
+    flight_plan_->GetSegment(flight_plan_->number_of_segments() - 1,
+                             begin,
+                             end);
+    auto const& centre =
+        *ephemeris_->trajectory(ephemeris_->bodies().back());
+    DiscreteTrajectory<Barycentric> apoapsides;
+    DiscreteTrajectory<Barycentric> periapsides;
+    ComputeApsides(centre, begin, end, apoapsides, periapsides);
+    CHECK(!periapsides.Empty());
+    auto const periapsis = periapsides.Begin();
+    return (periapsis.degrees_of_freedom().position() -
+            centre.EvaluatePosition(periapsis.time())).Norm();
+  }
+
+  Instant const t0_;
+  WorkStealingExecutor executor_;
+  std::unique_ptr<TestNavigationFrame> navigation_frame_;
+  std::unique_ptr<Ephemeris<Barycentric>> ephemeris_;
+  std::unique_ptr<FlightPlan> flight_plan_;
+};
+
+TEST_F(FlightPlanOptimizerTest, PeriapsisTargeting) {
+  EXPECT_TRUE(flight_plan_->Append(MakeRetrogradeBurn(0.01 * Metre / Second)));
+  FlightPlanOptimizer optimizer(flight_plan_.get(),
+                                ephemeris_.get(),
+                                &executor_);
+  EXPECT_TRUE(optimizer.Optimize(
+      FlightPlanOptimizer::PeriapsisDistanceError(
+          ephemeris_->trajectory(ephemeris_->bodies().back()),
+          /*periapsis_distance=*/0.8 * Metre),
+      /*initial_step=*/0.02 * Metre / Second,
+      /*Δv_tolerance=*/1e-4 * Metre / Second,
+      /*max_iterations=*/100));
+
+  // For an apoapsis at 1 m and a periapsis at 0.8 m, the vis-viva equation
+  // gives a speed at apoapsis of √(8/9) m/s, so a purely retrograde burn would
+  // have a Δv of about 57 mm/s.  The search may also use the other components
+  // of Δv, but it cannot do with less.
+  EXPECT_EQ(1, flight_plan_->number_of_manœuvres());
+  EXPECT_THAT(flight_plan_->GetManœuvre(0).Δv(),
+              Gt((1 - Sqrt(8.0 / 9.0)) * Metre / Second -
+                 1 * Milli(Metre) / Second));
+  EXPECT_THAT(AbsoluteError(0.8 * Metre, FirstPeriapsisDistance()),
+              Lt(1e-3 * Metre));
+}
+
+// With a short ephemeris step, each coast only prolongs the ephemeris by
+// |FlightPlan::max_ephemeris_steps_per_frame| steps, so the candidates must
+// coast past |t_max()|.  The ephemeris must be prolonged before they are
+// evaluated, not by the workers.
+TEST_F(FlightPlanOptimizerTest, CoastPastEphemerisEnd) {
+  MakeFlightPlan(/*ephemeris_step=*/10 * Milli(Second),
+                 /*final_time=*/t0_ + 30 * Second);
+  EXPECT_TRUE(flight_plan_->Append(MakeRetrogradeBurn(0.01 * Metre / Second)));
+  EXPECT_THAT(ephemeris_->t_max(), Lt(flight_plan_->desired_final_time()));
+  FlightPlanOptimizer optimizer(flight_plan_.get(),
+                                ephemeris_.get(),
+                                &executor_);
+  EXPECT_TRUE(optimizer.Optimize(
+      FlightPlanOptimizer::PeriapsisDistanceError(
+          ephemeris_->trajectory(ephemeris_->bodies().back()),
+          /*periapsis_distance=*/0.8 * Metre),
+      /*initial_step=*/0.02 * Metre / Second,
+      /*Δv_tolerance=*/1e-4 * Metre / Second,
+      /*max_iterations=*/100));
+
+  EXPECT_THAT(ephemeris_->t_max(), Ge(flight_plan_->desired_final_time()));
+  EXPECT_EQ(flight_plan_->desired_final_time(),
+            flight_plan_->actual_final_time());
+  EXPECT_EQ(1, flight_plan_->number_of_manœuvres());
+  EXPECT_THAT(AbsoluteError(0.8 * Metre, FirstPeriapsisDistance()),
+              Lt(1e-3 * Metre));
+}
+
+}  // namespace internal_flight_plan_optimizer
+}  // namespace ksp_plugin
+}  // namespace principia
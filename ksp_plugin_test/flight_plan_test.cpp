@@ -4,6 +4,7 @@
 #include <limits>
 #include <vector>
 
+#include "base/bundle.hpp"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "integrators/embedded_explicit_runge_kutta_nyström_integrator.hpp"
@@ -19,7 +20,9 @@ namespace principia {
 namespace ksp_plugin {
 namespace internal_flight_plan {
 
+using base::AbortRequested;
 using base::make_not_null_unique;
+using base::WorkStealingExecutor;
 using geometry::Barycentre;
 using geometry::Displacement;
 using geometry::Position;
@@ -376,6 +379,165 @@ TEST_F(FlightPlanTest, Segments) {
   }
 }
 
+TEST_F(FlightPlanTest, EditOrder) {
+  auto const expect_same_segments = [](FlightPlan const& expected,
+                                       FlightPlan const& actual) {
+    ASSERT_EQ(expected.number_of_segments(), actual.number_of_segments());
+    for (int i = 0; i < expected.number_of_segments(); ++i) {
+      DiscreteTrajectory<Barycentric>::Iterator expected_begin;
+      DiscreteTrajectory<Barycentric>::Iterator expected_end;
+      DiscreteTrajectory<Barycentric>::Iterator actual_begin;
+      DiscreteTrajectory<Barycentric>::Iterator actual_end;
+      expected.GetSegment(i, expected_begin, expected_end);
+      actual.GetSegment(i, actual_begin, actual_end);
+      auto expected_it = expected_begin;
+      auto actual_it = actual_begin;
+      for (;
+           expected_it != expected_end && actual_it != actual_end;
+           ++expected_it, ++actual_it) {
+        EXPECT_EQ(expected_it.time(), actual_it.time()) << i;
+        EXPECT_EQ(expected_it.degrees_of_freedom(),
+                  actual_it.degrees_of_freedom()) << i;
+      }
+      EXPECT_TRUE(expected_it == expected_end) << i;
+      EXPECT_TRUE(actual_it == actual_end) << i;
+    }
+  };
+
+  flight_plan_->SetDesiredFinalTime(t0_ + 42 * Second);
+  EXPECT_TRUE(flight_plan_->Append(MakeFirstBurn()));
+  EXPECT_TRUE(flight_plan_->Append(MakeSecondBurn()));
+
+  // The same flight plan, obtained by a different sequence of edits.
+  FlightPlan edited_flight_plan(
+      /*initial_mass=*/1 * Kilogram,
+      /*initial_time=*/root_.Begin().time(),
+      /*initial_degrees_of_freedom=*/root_.Begin().degrees_of_freedom(),
+      /*final_time=*/t0_ + 1.5 * Second,
+      ephemeris_.get(),
+      flight_plan_->adaptive_step_parameters());
+  EXPECT_TRUE(edited_flight_plan.SetDesiredFinalTime(t0_ + 84 * Second));
+  EXPECT_TRUE(edited_flight_plan.Append(MakeSecondBurn()));
+  edited_flight_plan.RemoveLast();
+  EXPECT_TRUE(edited_flight_plan.Append(MakeThirdBurn()));
+  EXPECT_TRUE(edited_flight_plan.SetDesiredFinalTime(t0_ + 21 * Second));
+  EXPECT_TRUE(edited_flight_plan.ReplaceLast(MakeFirstBurn()));
+  EXPECT_TRUE(edited_flight_plan.Append(MakeSecondBurn()));
+  EXPECT_TRUE(edited_flight_plan.SetDesiredFinalTime(t0_ + 42 * Second));
+  expect_same_segments(*flight_plan_, edited_flight_plan);
+
+  // The deserialized flight plan is also the same.
+  serialization::FlightPlan message;
+  flight_plan_->WriteToMessage(&message);
+  std::unique_ptr<FlightPlan> const flight_plan_read =
+      FlightPlan::ReadFromMessage(message, ephemeris_.get());
+  expect_same_segments(*flight_plan_, *flight_plan_read);
+}
+
+TEST_F(FlightPlanTest, Copy) {
+  flight_plan_->SetDesiredFinalTime(t0_ + 42 * Second);
+  EXPECT_TRUE(flight_plan_->Append(MakeFirstBurn()));
+  EXPECT_TRUE(flight_plan_->Append(MakeSecondBurn()));
+
+  FlightPlan copy(*flight_plan_);
+  EXPECT_EQ(2, copy.number_of_manœuvres());
+  EXPECT_EQ(flight_plan_->GetManœuvre(1).final_mass(),
+            copy.GetManœuvre(1).final_mass());
+  ASSERT_EQ(5, copy.number_of_segments());
+  for (int i = 0; i < copy.number_of_segments(); ++i) {
+    DiscreteTrajectory<Barycentric>::Iterator begin;
+    DiscreteTrajectory<Barycentric>::Iterator end;
+    DiscreteTrajectory<Barycentric>::Iterator copy_begin;
+    DiscreteTrajectory<Barycentric>::Iterator copy_end;
+    flight_plan_->GetSegment(i, begin, end);
+    copy.GetSegment(i, copy_begin, copy_end);
+    for (; begin != end; ++begin, ++copy_begin) {
+      ASSERT_TRUE(copy_begin != copy_end);
+      EXPECT_EQ(begin.time(), copy_begin.time());
+      EXPECT_EQ(begin.degrees_of_freedom(), copy_begin.degrees_of_freedom());
+    }
+    EXPECT_TRUE(copy_begin == copy_end);
+  }
+
+  // The copy is independent from the original.
+  copy.RemoveLast();
+  EXPECT_EQ(1, copy.number_of_manœuvres());
+  EXPECT_EQ(2, flight_plan_->number_of_manœuvres());
+  EXPECT_EQ(5, flight_plan_->number_of_segments());
+}
+
+TEST_F(FlightPlanTest, Abort) {
+  flight_plan_->SetDesiredFinalTime(t0_ + 42 * Second);
+  EXPECT_TRUE(flight_plan_->Append(MakeFirstBurn()));
+  Instant const actual_final_time = flight_plan_->actual_final_time();
+
+  // An aborted edit fails and has no effect.
+  AbortRequested = []() { return true; };
+  EXPECT_FALSE(flight_plan_->ReplaceLast(MakeThirdBurn()));
+  EXPECT_FALSE(flight_plan_->Append(MakeSecondBurn()));
+  AbortRequested = []() { return false; };
+  EXPECT_EQ(1, flight_plan_->number_of_manœuvres());
+  EXPECT_EQ(actual_final_time, flight_plan_->actual_final_time());
+
+  // Once the abort is no longer requested, the flight plan may be edited.
+  EXPECT_TRUE(flight_plan_->Append(MakeSecondBurn()));
+  EXPECT_EQ(2, flight_plan_->number_of_manœuvres());
+}
+
+TEST_F(FlightPlanTest, EvaluateCandidatesForLast) {
+  WorkStealingExecutor executor(/*pool_size=*/2);
+  FlightPlan::Objective const final_distance =
+      [](DiscreteTrajectory<Barycentric>::Iterator const& begin,
+         DiscreteTrajectory<Barycentric>::Iterator const& end) {
+        auto last = end;
+        --last;
+        return (last.degrees_of_freedom().position() - Barycentric::origin)
+                   .Norm() / Metre;
+      };
+
+  flight_plan_->SetDesiredFinalTime(t0_ + 42 * Second);
+  EXPECT_TRUE(flight_plan_->Append(MakeFirstBurn()));
+  Instant const actual_final_time = flight_plan_->actual_final_time();
+
+  auto too_long_burn = MakeFirstBurn();
+  too_long_burn.Δv *= 1000;
+  std::vector<Burn> candidates;
+  candidates.push_back(MakeFirstBurn());
+  candidates.push_back(MakeThirdBurn());
+  candidates.push_back(std::move(too_long_burn));
+  auto const values = flight_plan_->EvaluateCandidatesForLast(
+      std::move(candidates), final_distance, &executor);
+  ASSERT_EQ(3, values.size());
+  ASSERT_TRUE(values[0]);
+  ASSERT_TRUE(values[1]);
+  EXPECT_FALSE(values[2]);
+
+  // The flight plan is unchanged.
+  EXPECT_EQ(1, flight_plan_->number_of_manœuvres());
+  EXPECT_EQ(3, flight_plan_->number_of_segments());
+  EXPECT_EQ(actual_final_time, flight_plan_->actual_final_time());
+
+  // The values are those obtained by replacing the last manœuvre.
+  DiscreteTrajectory<Barycentric>::Iterator begin;
+  DiscreteTrajectory<Barycentric>::Iterator end;
+  flight_plan_->GetAllSegments(begin, end);
+  EXPECT_EQ(final_distance(begin, end), *values[0]);
+  EXPECT_TRUE(flight_plan_->ReplaceLast(MakeThirdBurn()));
+  flight_plan_->GetAllSegments(begin, end);
+  EXPECT_EQ(final_distance(begin, end), *values[1]);
+  EXPECT_NE(*values[0], *values[1]);
+
+  // An aborted evaluation has no results.
+  std::vector<Burn> aborted_candidates;
+  aborted_candidates.push_back(MakeFirstBurn());
+  AbortRequested = []() { return true; };
+  auto const aborted_values = flight_plan_->EvaluateCandidatesForLast(
+      std::move(aborted_candidates), final_distance, &executor);
+  AbortRequested = []() { return false; };
+  ASSERT_EQ(1, aborted_values.size());
+  EXPECT_FALSE(aborted_values[0]);
+}
+
 TEST_F(FlightPlanTest, SetAdaptiveStepParameter) {
   DiscreteTrajectory<Barycentric>::Iterator begin;
   DiscreteTrajectory<Barycentric>::Iterator end;
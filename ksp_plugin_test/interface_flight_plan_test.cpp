@@ -119,6 +119,7 @@ TEST_F(InterfaceFlightPlanTest, FlightPlan) {
       .WillRepeatedly(Return(true));
   EXPECT_CALL(vessel, flight_plan())
       .WillRepeatedly(ReturnRef(flight_plan));
+  EXPECT_CALL(vessel, WaitForFlightPlan()).WillRepeatedly(Return());
 
   EXPECT_TRUE(principia__FlightPlanExists(plugin_.get(), vessel_guid));
 
@@ -348,6 +349,21 @@ TEST_F(InterfaceFlightPlanTest, FlightPlan) {
                                                vessel_guid,
                                                burn));
 
+  EXPECT_CALL(*plugin_,
+              EditFlightPlanAsynchronously(vessel_guid, _, /*coalesce=*/true));
+  principia__FlightPlanReplaceLastAsynchronously(plugin_.get(),
+                                                 vessel_guid,
+                                                 burn);
+
+  EXPECT_CALL(vessel, flight_plan_is_computing()).WillOnce(Return(true));
+  EXPECT_TRUE(principia__FlightPlanIsComputing(plugin_.get(), vessel_guid));
+
+  EXPECT_CALL(vessel, RefreshFlightPlan());
+  principia__FlightPlanPoll(plugin_.get(), vessel_guid);
+
+  EXPECT_CALL(vessel, flight_plan_is_computing()).WillOnce(Return(false));
+  EXPECT_FALSE(principia__FlightPlanIsComputing(plugin_.get(), vessel_guid));
+
   EXPECT_CALL(flight_plan, RemoveLast());
   principia__FlightPlanRemoveLast(plugin_.get(), vessel_guid);
 
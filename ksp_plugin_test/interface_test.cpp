@@ -5,6 +5,7 @@
 #include <string>
 
 #include "astronomy/epoch.hpp"
+#include "base/hexadecimal.hpp"
 #include "base/not_null.hpp"
 #include "base/pull_serializer.hpp"
 #include "base/push_deserializer.hpp"
@@ -32,7 +33,12 @@ namespace principia {
 namespace interface {
 
 using astronomy::ModifiedJulianDate;
+using base::Bytes;
 using base::check_not_null;
+using base::compressed_serialization_magic;
+using base::Compressor;
+using base::HexadecimalDecode;
+using base::HexadecimalEncode;
 using base::make_not_null_unique;
 using base::PullSerializer;
 using base::PushDeserializer;
@@ -70,6 +76,7 @@ using physics::MockDynamicFrame;
 using physics::RelativeDegreesOfFreedom;
 using physics::RigidMotion;
 using quantities::GravitationalParameter;
+using quantities::Force;
 using quantities::Length;
 using quantities::Pow;
 using quantities::SIUnit;
@@ -95,6 +102,7 @@ using ::testing::DoAll;
 using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::ExitedWithCode;
+using ::testing::Field;
 using ::testing::Invoke;
 using ::testing::IsNull;
 using ::testing::NotNull;
@@ -219,7 +227,7 @@ TEST_F(InterfaceDeathTest, ActivateRecorder) {
   EXPECT_DEATH({
     journal::Recorder::Deactivate();
     // Fails because the glog directory doesn't exist.
-    principia__ActivateRecorder(true);
+    principia__ActivateRecorder(/*activate=*/true, /*asynchronous=*/false);
   }, "glog.Principia.JOURNAL");
 }
 
@@ -405,6 +413,105 @@ TEST_F(InterfaceTest, InsertUnloadedPart) {
                                 parent_relative_degrees_of_freedom);
 }
 
+TEST_F(InterfaceTest, InsertOrKeepLoadedParts) {
+  QP const main_body_degrees_of_freedom = {{1, 2, 3}, {4, 5, 6}};
+  LoadedPart const parts[] = {
+      {part_id, part_name, 3, {{7, 8, 9}, {10, 11, 12}}},
+      {part_id + 1, "Riker's chair", 5, {{13, 14, 15}, {16, 17, 18}}}};
+  DegreesOfFreedom<World> const main_body(
+      World::origin + Displacement<World>({1 * Metre, 2 * Metre, 3 * Metre}),
+      Velocity<World>({4 * (Metre / Second),
+                       5 * (Metre / Second),
+                       6 * (Metre / Second)}));
+  EXPECT_CALL(
+      *plugin_,
+      InsertOrKeepLoadedParts(
+          vessel_guid,
+          parent_index,
+          main_body,
+          ElementsAre(
+              AllOf(Field(&Plugin::LoadedPart::part_id, part_id),
+                    Field(&Plugin::LoadedPart::name, part_name),
+                    Field(&Plugin::LoadedPart::mass, 3 * Tonne),
+                    Field(&Plugin::LoadedPart::degrees_of_freedom,
+                          DegreesOfFreedom<World>(
+                              World::origin +
+                                  Displacement<World>({7 * Metre,
+                                                       8 * Metre,
+                                                       9 * Metre}),
+                              Velocity<World>({10 * (Metre / Second),
+                                               11 * (Metre / Second),
+                                               12 * (Metre / Second)})))),
+              AllOf(Field(&Plugin::LoadedPart::part_id, part_id + 1),
+                    Field(&Plugin::LoadedPart::name, "Riker's chair"),
+                    Field(&Plugin::LoadedPart::mass, 5 * Tonne))),
+          time * Second));
+  principia__InsertOrKeepLoadedParts(plugin_.get(),
+                                     vessel_guid,
+                                     parts,
+                                     /*parts_size=*/2,
+                                     parent_index,
+                                     main_body_degrees_of_freedom,
+                                     time);
+}
+
+TEST_F(InterfaceTest, IncrementPartIntrinsicForces) {
+  PartIntrinsicForce const forces[] = {{part_id, {1, 2, 3}},
+                                       {part_id + 1, {4, 5, 6}}};
+  {
+    ::testing::InSequence s;
+    EXPECT_CALL(*plugin_,
+                IncrementPartIntrinsicForce(
+                    part_id,
+                    Vector<Force, World>({1 * Kilo(Newton),
+                                          2 * Kilo(Newton),
+                                          3 * Kilo(Newton)})));
+    EXPECT_CALL(*plugin_,
+                IncrementPartIntrinsicForce(
+                    part_id + 1,
+                    Vector<Force, World>({4 * Kilo(Newton),
+                                          5 * Kilo(Newton),
+                                          6 * Kilo(Newton)})));
+  }
+  principia__IncrementPartIntrinsicForces(plugin_.get(),
+                                          forces,
+                                          /*forces_size=*/2);
+}
+
+TEST_F(InterfaceTest, SetPartsApparentDegreesOfFreedom) {
+  QP const main_body_degrees_of_freedom = {{1, 2, 3}, {4, 5, 6}};
+  PartDegreesOfFreedom const parts[] = {{part_id, {{7, 8, 9}, {10, 11, 12}}},
+                                        {part_id + 1, {{0, 0, 0}, {0, 0, 0}}}};
+  DegreesOfFreedom<World> const main_body(
+      World::origin + Displacement<World>({1 * Metre, 2 * Metre, 3 * Metre}),
+      Velocity<World>({4 * (Metre / Second),
+                       5 * (Metre / Second),
+                       6 * (Metre / Second)}));
+  {
+    ::testing::InSequence s;
+    EXPECT_CALL(*plugin_,
+                SetPartApparentDegreesOfFreedom(
+                    part_id,
+                    DegreesOfFreedom<World>(
+                        World::origin + Displacement<World>({7 * Metre,
+                                                             8 * Metre,
+                                                             9 * Metre}),
+                        Velocity<World>({10 * (Metre / Second),
+                                         11 * (Metre / Second),
+                                         12 * (Metre / Second)})),
+                    main_body));
+    EXPECT_CALL(*plugin_,
+                SetPartApparentDegreesOfFreedom(
+                    part_id + 1,
+                    DegreesOfFreedom<World>(World::origin, Velocity<World>()),
+                    main_body));
+  }
+  principia__SetPartsApparentDegreesOfFreedom(plugin_.get(),
+                                              parts,
+                                              /*parts_size=*/2,
+                                              main_body_degrees_of_freedom);
+}
+
 TEST_F(InterfaceTest, AdvanceTime) {
   EXPECT_CALL(*plugin_,
               AdvanceTime(t0_ + time * SIUnit<Time>(),
@@ -418,6 +525,11 @@ TEST_F(InterfaceTest, ForgetAllHistoriesBefore) {
   principia__ForgetAllHistoriesBefore(plugin_.get(), time);
 }
 
+TEST_F(InterfaceTest, SetVesselHistoryMemoryBudget) {
+  EXPECT_CALL(*plugin_, SetVesselHistoryMemoryBudget(32 << 20));
+  principia__SetVesselHistoryMemoryBudget(plugin_.get(), 32 << 20);
+}
+
 TEST_F(InterfaceTest, VesselFromParent) {
   EXPECT_CALL(*plugin_,
               VesselFromParent(celestial_index, vessel_guid))
@@ -552,13 +664,100 @@ TEST_F(InterfaceTest, SerializePlugin) {
   principia::serialization::Plugin message;
   message.ParseFromString(serialized_simple_plugin_);
 
-  EXPECT_CALL(*plugin_, WriteToMessage(_)).WillOnce(SetArgPointee<0>(message));
-  char const* serialization =
-      principia__SerializePlugin(plugin_.get(), &serializer);
-  EXPECT_STREQ(hexadecimal_simple_plugin_.c_str(), serialization);
-  EXPECT_EQ(nullptr, principia__SerializePlugin(plugin_.get(), &serializer));
-  principia__DeleteString(&serialization);
-  EXPECT_THAT(serialization, IsNull());
+  EXPECT_CALL(*plugin_, WriteToSerializer(_))
+      .WillOnce(Invoke([&message](not_null<PullSerializer*> const serializer) {
+        serializer->Start(
+            make_not_null_unique<principia::serialization::Plugin>(message));
+      }));
+  std::string hexadecimal;
+  for (;;) {
+    char const* serialization =
+        principia__SerializePlugin(plugin_.get(), &serializer);
+    if (serialization == nullptr) {
+      break;
+    }
+    hexadecimal += serialization;
+    principia__DeleteString(&serialization);
+    EXPECT_THAT(serialization, IsNull());
+  }
+  EXPECT_THAT(serializer, IsNull());
+
+  // The serialization is compressed.
+  std::string bytes(hexadecimal.size() / 2, '\0');
+  HexadecimalDecode(
+      {reinterpret_cast<std::uint8_t const*>(hexadecimal.data()),
+       hexadecimal.size()},
+      {reinterpret_cast<std::uint8_t*>(&bytes[0]), bytes.size()});
+  EXPECT_EQ(compressed_serialization_magic,
+            bytes.substr(0, sizeof(compressed_serialization_magic) - 1));
+  EXPECT_GT(serialized_simple_plugin_.size(), bytes.size());
+
+  principia::serialization::Plugin read_message;
+  auto deserializer = std::make_unique<PushDeserializer>(
+      /*chunk_size=*/100, /*number_of_chunks=*/3);
+  deserializer->Start(make_not_null_unique<principia::serialization::Plugin>(),
+                      [&read_message](google::protobuf::Message const& m) {
+                        read_message.CopyFrom(m);
+                      });
+  deserializer->Push(Bytes(reinterpret_cast<std::uint8_t*>(&bytes[0]),
+                           bytes.size()),
+                     nullptr);
+  deserializer->Push(Bytes(), nullptr);
+  // Destroying the deserializer waits until deserialization is done.
+  deserializer.reset();
+  EXPECT_THAT(read_message, EqualsProto(message));
+}
+
+TEST_F(InterfaceTest, SerializePluginBinary) {
+  PullSerializer* serializer = nullptr;
+  principia::serialization::Plugin message;
+  message.ParseFromString(serialized_simple_plugin_);
+
+  EXPECT_CALL(*plugin_, WriteToSerializer(_))
+      .WillOnce(Invoke([&message](not_null<PullSerializer*> const serializer) {
+        serializer->Start(
+            make_not_null_unique<principia::serialization::Plugin>(message));
+      }));
+  // Use chunks small enough that the serialization spans several of them.
+  int const chunk_bytes = 100;
+  std::string serialization;
+  for (;;) {
+    std::uint8_t const* data;
+    int size;
+    principia__SerializePluginBinary(plugin_.get(),
+                                     &serializer,
+                                     chunk_bytes,
+                                     /*chunk_count=*/3,
+                                     &data,
+                                     &size);
+    if (data == nullptr) {
+      EXPECT_EQ(0, size);
+      break;
+    }
+    EXPECT_LT(0, size);
+    EXPECT_GE(chunk_bytes, size);
+    serialization.append(reinterpret_cast<char const*>(data), size);
+  }
+  EXPECT_THAT(serializer, IsNull());
+  EXPECT_EQ(
+      compressed_serialization_magic,
+      serialization.substr(0, sizeof(compressed_serialization_magic) - 1));
+  EXPECT_GT(serialized_simple_plugin_.size(), serialization.size());
+
+  principia::serialization::Plugin read_message;
+  auto deserializer = std::make_unique<PushDeserializer>(
+      /*chunk_size=*/100, /*number_of_chunks=*/3);
+  deserializer->Start(make_not_null_unique<principia::serialization::Plugin>(),
+                      [&read_message](google::protobuf::Message const& m) {
+                        read_message.CopyFrom(m);
+                      });
+  deserializer->Push(Bytes(reinterpret_cast<std::uint8_t*>(&serialization[0]),
+                           serialization.size()),
+                     nullptr);
+  deserializer->Push(Bytes(), nullptr);
+  // Destroying the deserializer waits until deserialization is done.
+  deserializer.reset();
+  EXPECT_THAT(read_message, EqualsProto(message));
 }
 
 TEST_F(InterfaceTest, DeserializePlugin) {
@@ -577,6 +776,40 @@ TEST_F(InterfaceTest, DeserializePlugin) {
   principia__DeletePlugin(&plugin);
 }
 
+TEST_F(InterfaceTest, DeserializeCompressedPlugin) {
+  principia::serialization::Plugin message;
+  message.ParseFromString(serialized_simple_plugin_);
+  PullSerializer serializer(/*chunk_size=*/100,
+                            /*number_of_chunks=*/3,
+                            Compressor::LZ4);
+  serializer.Start(
+      make_not_null_unique<principia::serialization::Plugin>(message));
+  std::string hexadecimal;
+  for (;;) {
+    Bytes const bytes = serializer.Pull();
+    if (bytes.size == 0) {
+      break;
+    }
+    std::string chunk(bytes.size << 1, '\0');
+    HexadecimalEncode(
+        bytes, {reinterpret_cast<std::uint8_t*>(&chunk[0]), chunk.size()});
+    hexadecimal += chunk;
+  }
+
+  PushDeserializer* deserializer = nullptr;
+  Plugin const* plugin = nullptr;
+  principia__DeserializePlugin(hexadecimal.c_str(),
+                               hexadecimal.size(),
+                               &deserializer,
+                               &plugin);
+  principia__DeserializePlugin(hexadecimal.c_str(),
+                               0,
+                               &deserializer,
+                               &plugin);
+  EXPECT_THAT(plugin, NotNull());
+  principia__DeletePlugin(&plugin);
+}
+
 // Use for debugging saves given by users.
 TEST_F(InterfaceTest, DISABLED_DeserializePluginDebug) {
   PushDeserializer* deserializer = nullptr;
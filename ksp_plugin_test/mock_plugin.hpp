@@ -50,10 +50,40 @@ class MockPlugin : public Plugin {
                     GUID const& vessel_guid,
                     RelativeDegreesOfFreedom<AliceSun> const& from_parent));
 
+  MOCK_METHOD8(InsertOrKeepLoadedPart,
+               void(PartId part_id,
+                    std::string const& name,
+                    Mass const& mass,
+                    GUID const& vessel_guid,
+                    Index main_body_index,
+                    DegreesOfFreedom<World> const&
+                        main_body_degrees_of_freedom,
+                    DegreesOfFreedom<World> const& part_degrees_of_freedom,
+                    Time const& Δt));
+  MOCK_METHOD5(InsertOrKeepLoadedParts,
+               void(GUID const& vessel_guid,
+                    Index main_body_index,
+                    DegreesOfFreedom<World> const&
+                        main_body_degrees_of_freedom,
+                    std::vector<LoadedPart> const& parts,
+                    Time const& Δt));
+
+  MOCK_METHOD2(IncrementPartIntrinsicForce,
+               void(PartId part_id, Vector<Force, World> const& force));
+
+  MOCK_METHOD3(SetPartApparentDegreesOfFreedom,
+               void(PartId part_id,
+                    DegreesOfFreedom<World> const& degrees_of_freedom,
+                    DegreesOfFreedom<World> const&
+                        main_body_degrees_of_freedom));
+
   MOCK_METHOD2(AdvanceTime,
                void(Instant const& t, Angle const& planetarium_rotation));
 
-  MOCK_CONST_METHOD1(ForgetAllHistoriesBefore, void(Instant const& t));
+  MOCK_METHOD1(ForgetAllHistoriesBefore, void(Instant const& t));
+
+  MOCK_METHOD1(SetVesselHistoryMemoryBudget,
+               void(std::int64_t vessel_history_memory_budget));
 
   MOCK_CONST_METHOD2(VesselFromParent,
                      RelativeDegreesOfFreedom<AliceSun>(
@@ -67,6 +97,10 @@ class MockPlugin : public Plugin {
                      void(GUID const& vessel_guid,
                           Instant const& final_time,
                           Mass const& initial_mass));
+  MOCK_CONST_METHOD3(EditFlightPlanAsynchronously,
+                     void(GUID const& vessel_guid,
+                          Vessel::FlightPlanEdit const& edit,
+                          bool coalesce));
 
   MOCK_METHOD1(SetPredictionAdaptiveStepParameters,
                void(Ephemeris<Barycentric>::AdaptiveStepParameters const&
@@ -126,6 +160,8 @@ class MockPlugin : public Plugin {
 
   MOCK_CONST_METHOD1(WriteToMessage,
                      void(not_null<serialization::Plugin*> message));
+  MOCK_CONST_METHOD1(WriteToSerializer,
+                     void(not_null<PullSerializer*> serializer));
 };
 
 }  // namespace internal_plugin
@@ -19,7 +19,7 @@ class MockVessel : public Vessel {
   MOCK_CONST_METHOD0(parent, not_null<Celestial const*>());
   MOCK_METHOD1(set_parent, void(not_null<Celestial const*> parent));
 
-  MOCK_CONST_METHOD0(prediction, DiscreteTrajectory<Barycentric> const&());
+  MOCK_METHOD0(prediction, DiscreteTrajectory<Barycentric> const&());
 
   MOCK_CONST_METHOD0(flight_plan, FlightPlan&());
   MOCK_CONST_METHOD0(has_flight_plan, bool());
@@ -33,10 +33,23 @@ class MockVessel : public Vessel {
                         adaptive_parameters));
 
   MOCK_METHOD0(DeleteFlightPlan, void());
+  MOCK_METHOD3(EditFlightPlanAsynchronously,
+               void(FlightPlanEdit const& edit,
+                    bool coalesce,
+                    not_null<WorkStealingExecutor*> executor));
+  MOCK_METHOD0(RefreshFlightPlan, void());
+  MOCK_CONST_METHOD0(flight_plan_is_computing, bool());
+  MOCK_METHOD0(WaitForFlightPlan, void());
+  MOCK_CONST_METHOD0(last_flight_plan_edit_succeeded, bool());
 
   MOCK_METHOD1(FlowPrediction, void(Instant const& last_time));
+  MOCK_METHOD1(RefreshPrediction,
+               void(not_null<WorkStealingExecutor*> executor));
+  MOCK_METHOD0(WaitForPrediction, void());
 
-  MOCK_CONST_METHOD0(psychohistory, DiscreteTrajectory<Barycentric> const&());
+  MOCK_METHOD0(psychohistory, DiscreteTrajectory<Barycentric> const&());
+  MOCK_CONST_METHOD0(psychohistory_last,
+                     DiscreteTrajectory<Barycentric>::Iterator());
   MOCK_CONST_METHOD0(psychohistory_is_authoritative, bool());
 
   MOCK_CONST_METHOD1(WriteToMessage,
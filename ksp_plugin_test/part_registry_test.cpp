@@ -0,0 +1,219 @@
+﻿
+#include "ksp_plugin/part_registry.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace principia {
+namespace ksp_plugin {
+namespace internal_part_registry {
+
+using ::testing::ElementsAre;
+using ::testing::ElementsAreArray;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+using ::testing::Pointee;
+
+class PartRegistryTest : public testing::Test {
+ protected:
+  PartRegistryTest() {
+    registry_.Emplace(3, "three");
+    registry_.Emplace(1, "one");
+    registry_.Emplace(4, "four");
+    registry_.Emplace(5, "five");
+  }
+
+  PartRegistry<std::string, PartOrder::Increasing> registry_;
+};
+
+TEST_F(PartRegistryTest, Lookup) {
+  EXPECT_EQ(4, registry_.size());
+  EXPECT_TRUE(registry_.Contains(1));
+  EXPECT_FALSE(registry_.Contains(2));
+  EXPECT_EQ("four", registry_.at(4));
+  EXPECT_THAT(registry_.Find(5), Pointee(std::string("five")));
+  EXPECT_EQ(nullptr, registry_.Find(9));
+
+  // Entries are iterated in the order of their keys.
+  EXPECT_THAT(registry_,
+              ElementsAre(Pair(1, "one"),
+                          Pair(3, "three"),
+                          Pair(4, "four"),
+                          Pair(5, "five")));
+}
+
+TEST_F(PartRegistryTest, Emplace) {
+  auto const not_inserted = registry_.Emplace(1, "uno");
+  EXPECT_FALSE(not_inserted.second);
+  EXPECT_EQ("one", *not_inserted.first);
+
+  auto const inserted = registry_.Emplace(9, "nine");
+  EXPECT_TRUE(inserted.second);
+  EXPECT_EQ("nine", *inserted.first);
+  *inserted.first = "neun";
+  EXPECT_EQ("neun", registry_.at(9));
+}
+
+TEST_F(PartRegistryTest, EmplaceAll) {
+  registry_.EmplaceAll({{9, "nine"}, {2, "two"}, {0, "zero"}, {6, "six"}});
+  EXPECT_THAT(registry_,
+              ElementsAre(Pair(0, "zero"),
+                          Pair(1, "one"),
+                          Pair(2, "two"),
+                          Pair(3, "three"),
+                          Pair(4, "four"),
+                          Pair(5, "five"),
+                          Pair(6, "six"),
+                          Pair(9, "nine")));
+  for (auto const& pair : registry_) {
+    EXPECT_EQ(&pair.second, registry_.Find(pair.first));
+  }
+
+  registry_.EmplaceAll({});
+  EXPECT_EQ(8, registry_.size());
+
+  PartRegistry<std::string, PartOrder::Unspecified> registry;
+  registry.Emplace(3, "three");
+  registry.EmplaceAll({{2, "two"}, {1, "one"}});
+  EXPECT_THAT(registry,
+              ElementsAre(Pair(3, "three"), Pair(2, "two"), Pair(1, "one")));
+  EXPECT_EQ("one", registry.at(1));
+}
+
+TEST_F(PartRegistryTest, Erase) {
+  EXPECT_EQ("three", registry_.Extract(3));
+  EXPECT_FALSE(registry_.Erase(3));
+  EXPECT_TRUE(registry_.Erase(5));
+  EXPECT_THAT(registry_, ElementsAre(Pair(1, "one"), Pair(4, "four")));
+  EXPECT_EQ("one", registry_.at(1));
+  EXPECT_EQ("four", registry_.at(4));
+
+  registry_.Emplace(3, "trois");
+  EXPECT_EQ("trois", registry_.at(3));
+  EXPECT_THAT(registry_,
+              ElementsAre(Pair(1, "one"), Pair(3, "trois"), Pair(4, "four")));
+  EXPECT_TRUE(registry_.Erase(1));
+  EXPECT_TRUE(registry_.Erase(4));
+  EXPECT_TRUE(registry_.Erase(3));
+  EXPECT_TRUE(registry_.empty());
+  EXPECT_THAT(registry_, IsEmpty());
+}
+
+TEST_F(PartRegistryTest, EraseIf) {
+  std::vector<PartId> visited;
+  registry_.EraseIf([&visited](PartId const part_id, std::string& value) {
+    visited.push_back(part_id);
+    value += "!";
+    return part_id % 2 == 1;
+  });
+  EXPECT_THAT(visited, ElementsAre(1, 3, 4, 5));
+  EXPECT_THAT(registry_, ElementsAre(Pair(4, "four!")));
+  EXPECT_FALSE(registry_.Contains(3));
+  EXPECT_EQ("four!", registry_.at(4));
+}
+
+TEST_F(PartRegistryTest, ExtractIf) {
+  auto const extracted = registry_.ExtractIf(
+      [](PartId const part_id, std::string const&) {
+        return part_id != 4;
+      });
+  EXPECT_THAT(extracted,
+              ElementsAre(Pair(1, "one"), Pair(3, "three"), Pair(5, "five")));
+  EXPECT_THAT(registry_, ElementsAre(Pair(4, "four")));
+  EXPECT_FALSE(registry_.Contains(1));
+  EXPECT_EQ("four", registry_.at(4));
+
+  registry_.EmplaceAll(extracted);
+  EXPECT_THAT(registry_,
+              ElementsAre(Pair(1, "one"),
+                          Pair(3, "three"),
+                          Pair(4, "four"),
+                          Pair(5, "five")));
+}
+
+// The iteration order doesn't depend on the history of the registry, so that
+// the parts of a vessel are visited in the same order after a reload.
+TEST_F(PartRegistryTest, HistoryIndependence) {
+  PartRegistry<std::string, PartOrder::Increasing> registry;
+  registry.Emplace(5, "five");
+  registry.Emplace(2, "two");
+  registry.Emplace(4, "four");
+  registry.Emplace(1, "one");
+  registry.Emplace(3, "three");
+  EXPECT_TRUE(registry.Erase(2));
+  EXPECT_THAT(registry,
+              ElementsAre(Pair(1, "one"),
+                          Pair(3, "three"),
+                          Pair(4, "four"),
+                          Pair(5, "five")));
+  EXPECT_THAT(registry, ElementsAreArray(registry_));
+  for (auto const& pair : registry) {
+    EXPECT_EQ(&pair.second, registry.Find(pair.first));
+  }
+}
+
+// An unordered registry removes entries by moving the last one into the freed
+// slot.
+TEST_F(PartRegistryTest, Unordered) {
+  PartRegistry<std::string, PartOrder::Unspecified> registry;
+  registry.Emplace(3, "three");
+  registry.Emplace(1, "one");
+  registry.Emplace(4, "four");
+  registry.Emplace(5, "five");
+  EXPECT_THAT(registry,
+              ElementsAre(Pair(3, "three"),
+                          Pair(1, "one"),
+                          Pair(4, "four"),
+                          Pair(5, "five")));
+  EXPECT_EQ("three", registry.Extract(3));
+  EXPECT_TRUE(registry.Erase(5));
+  EXPECT_FALSE(registry.Erase(5));
+  registry.Emplace(2, "two");
+  EXPECT_THAT(registry,
+              ElementsAre(Pair(4, "four"), Pair(1, "one"), Pair(2, "two")));
+  for (auto const& pair : registry) {
+    EXPECT_EQ(&pair.second, registry.Find(pair.first));
+  }
+}
+
+TEST_F(PartRegistryTest, MoveOnly) {
+  PartRegistry<std::unique_ptr<int>, PartOrder::Unspecified> registry;
+  for (int i = 0; i < 10; ++i) {
+    registry.Emplace(i, std::make_unique<int>(i * i));
+  }
+  EXPECT_EQ(49, *registry.Extract(7));
+  registry.EraseIf([](PartId const part_id, std::unique_ptr<int> const&) {
+    return part_id < 3;
+  });
+  EXPECT_EQ(6, registry.size());
+  for (auto const& pair : registry) {
+    EXPECT_EQ(pair.first * pair.first, *pair.second);
+    EXPECT_EQ(pair.second.get(), registry.at(pair.first).get());
+  }
+}
+
+using PartRegistryDeathTest = PartRegistryTest;
+
+TEST_F(PartRegistryDeathTest, Missing) {
+  EXPECT_DEATH({
+    registry_.at(2);
+  }, "No part 2");
+  EXPECT_DEATH({
+    registry_.Extract(2);
+  }, "No part 2");
+}
+
+TEST_F(PartRegistryDeathTest, Duplicate) {
+  EXPECT_DEATH({
+    registry_.EmplaceAll({{2, "two"}, {4, "vier"}});
+  }, "Duplicate part 4");
+}
+
+}  // namespace internal_part_registry
+}  // namespace ksp_plugin
+}  // namespace principia
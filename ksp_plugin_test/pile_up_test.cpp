@@ -77,14 +77,20 @@ class TestablePileUp : public PileUp {
     return psychohistory_;
   }
 
-  PartTo<DegreesOfFreedom<RigidPileUp>> const&
+  PartTo<DegreesOfFreedom<RigidPileUp>>
   actual_part_degrees_of_freedom() const {
-    return actual_part_degrees_of_freedom_;
+    PartTo<DegreesOfFreedom<RigidPileUp>> result;
+    for (int i = 0; i < parts_.size(); ++i) {
+      result.emplace(parts_[i], actual_part_degrees_of_freedom_[i]);
+    }
+    return result;
   }
 
-  PartTo<DegreesOfFreedom<ApparentBubble>> const&
+  PartTo<DegreesOfFreedom<ApparentBubble>>
   apparent_part_degrees_of_freedom() const {
-    return apparent_part_degrees_of_freedom_;
+    return PartTo<DegreesOfFreedom<ApparentBubble>>(
+        apparent_part_degrees_of_freedom_.begin(),
+        apparent_part_degrees_of_freedom_.end());
   }
 };
 
@@ -562,6 +568,115 @@ TEST_F(PileUpTest, MidStepIntrinsicForce) {
               AlmostEquals(old_velocity + 0.5 * fixed_step * a, 1));
 }
 
+// Checks that the apparent degrees of freedom may be reported in any order,
+// and that a pile-up that is not deformed keeps the degrees of freedom of its
+// parts.
+TEST_F(PileUpTest, DeformInAnyOrder) {
+  MockEphemeris<Barycentric> ephemeris;
+  TestablePileUp pile_up({&p1_, &p2_},
+                         astronomy::J2000,
+                         DefaultProlongationParameters(),
+                         DefaultHistoryParameters(),
+                         &ephemeris);
+  auto const undeformed = pile_up.actual_part_degrees_of_freedom();
+  pile_up.DeformPileUpIfNeeded();
+  EXPECT_EQ(undeformed, pile_up.actual_part_degrees_of_freedom());
+
+  pile_up.SetPartApparentDegreesOfFreedom(
+      &p2_,
+      DegreesOfFreedom<ApparentBubble>(
+          ApparentBubble::origin +
+              Displacement<ApparentBubble>({2.0 * Metre,
+                                            0.0 * Metre,
+                                            -2.0 / 3.0 * Metre}),
+          Velocity<ApparentBubble>({20.0 * Metre / Second,
+                                    0.0 * Metre / Second,
+                                    -20.0 / 3.0 * Metre / Second})));
+  pile_up.SetPartApparentDegreesOfFreedom(
+      &p1_,
+      DegreesOfFreedom<ApparentBubble>(
+          ApparentBubble::origin +
+              Displacement<ApparentBubble>({-11.0 / 3.0 * Metre,
+                                            -1.0 * Metre,
+                                            2.0 / 3.0 * Metre}),
+          Velocity<ApparentBubble>({-110.0 / 3.0 * Metre / Second,
+                                    -10.0 * Metre / Second,
+                                    20.0 / 3.0 * Metre / Second})));
+  pile_up.DeformPileUpIfNeeded();
+  CheckPreAdvanceTimeInvariants(pile_up);
+  EXPECT_THAT(pile_up.parts(), ElementsAre(&p2_, &p1_));
+
+  auto const deformed = pile_up.actual_part_degrees_of_freedom();
+  pile_up.DeformPileUpIfNeeded();
+  EXPECT_EQ(deformed, pile_up.actual_part_degrees_of_freedom());
+}
+
+// Check that catching up by chunks yields the same histories as catching up in
+// one go.
+TEST_F(PileUpTest, ChunkedCatchUp) {
+  std::vector<not_null<std::unique_ptr<MassiveBody const>>> bodies;
+  bodies.emplace_back(make_not_null_unique<MassiveBody>(1 * Kilogram));
+  std::vector<DegreesOfFreedom<Barycentric>> initial_state{
+      DegreesOfFreedom<Barycentric>{
+          Barycentric::origin +
+              Displacement<Barycentric>(
+                  {std::pow(2, 100) * Metre, 0 * Metre, 0 * Metre}),
+          Velocity<Barycentric>{}}};
+  Ephemeris<Barycentric> ephemeris{
+      std::move(bodies),
+      initial_state,
+      /*initial_time=*/astronomy::J2000,
+      /*fitting_tolerance=*/1 * Metre,
+      Ephemeris<Barycentric>::FixedStepParameters{
+          integrators::BlanesMoan2002SRKN6B<Position<Barycentric>>(),
+          1 * Second}};
+
+  Time const fixed_step = 10 * Second;
+  Ephemeris<Barycentric>::FixedStepParameters fixed_parameters{
+      integrators::BlanesMoan2002SRKN6B<Position<Barycentric>>(), fixed_step};
+
+  Part p3(part_id2_ + 1, "p3", mass1_, p1_dof_, /*deletion_callback=*/nullptr);
+  TestablePileUp chunked_pile_up({&p1_},
+                                 astronomy::J2000,
+                                 DefaultProlongationParameters(),
+                                 fixed_parameters,
+                                 &ephemeris);
+  TestablePileUp pile_up({&p3},
+                         astronomy::J2000,
+                         DefaultProlongationParameters(),
+                         fixed_parameters,
+                         &ephemeris);
+
+  Instant const t = astronomy::J2000 + 1000.5 * fixed_step;
+  EXPECT_EQ(0, chunked_pile_up.EstimatedStepsToAdvanceTime(astronomy::J2000));
+  EXPECT_EQ(1001, chunked_pile_up.EstimatedStepsToAdvanceTime(t));
+  EXPECT_EQ(astronomy::J2000 + 100 * fixed_step,
+            chunked_pile_up.NextCatchUpTime(t, /*max_steps=*/100));
+
+  int chunks = 0;
+  while (chunked_pile_up.EstimatedStepsToAdvanceTime(t) > 0) {
+    chunked_pile_up.DeformAndAdvanceTime(
+        chunked_pile_up.NextCatchUpTime(t, /*max_steps=*/100));
+    ++chunks;
+  }
+  EXPECT_EQ(11, chunks);
+  pile_up.DeformAndAdvanceTime(t);
+
+  auto it1 = p1_.history_begin();
+  auto it3 = p3.history_begin();
+  for (; it1 != p1_.history_end() && it3 != p3.history_end(); ++it1, ++it3) {
+    EXPECT_EQ(it3.time(), it1.time());
+    EXPECT_EQ(it3.degrees_of_freedom(), it1.degrees_of_freedom());
+  }
+  EXPECT_EQ(p1_.history_end(), it1);
+  EXPECT_EQ(p3.history_end(), it3);
+  EXPECT_EQ(++p1_.psychohistory_begin(), p1_.psychohistory_end());
+  EXPECT_EQ(++p3.psychohistory_begin(), p3.psychohistory_end());
+  EXPECT_EQ(t, p1_.psychohistory_begin().time());
+  EXPECT_EQ(p3.psychohistory_begin().degrees_of_freedom(),
+            p1_.psychohistory_begin().degrees_of_freedom());
+}
+
 TEST_F(PileUpTest, Serialization) {
   MockEphemeris<Barycentric> ephemeris;
   p1_.increment_intrinsic_force(
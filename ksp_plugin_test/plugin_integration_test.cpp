@@ -712,6 +712,7 @@ TEST_F(PluginIntegrationTest, Prediction) {
   plugin.SetPredictionAdaptiveStepParameters(adaptive_step_parameters);
   plugin.AdvanceTime(Instant() + 1e-10 * Second, 0 * Radian);
   plugin.UpdatePrediction(vessel_guid);
+  plugin.WaitForPrediction(vessel_guid);
   auto const& prediction =
       plugin.GetVessel(vessel_guid)->prediction();
   auto const rendered_prediction =
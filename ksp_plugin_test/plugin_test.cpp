@@ -14,6 +14,8 @@
 #include "astronomy/time_scales.hpp"
 #include "base/macros.hpp"
 #include "base/not_null.hpp"
+#include "base/pull_serializer.hpp"
+#include "base/push_deserializer.hpp"
 #include "geometry/identity.hpp"
 #include "geometry/named_quantities.hpp"
 #include "geometry/permutation.hpp"
@@ -45,9 +47,12 @@ namespace internal_plugin {
 
 using astronomy::ICRFJ2000Equator;
 using astronomy::ParseTT;
+using base::Bytes;
 using base::FindOrDie;
 using base::make_not_null_unique;
 using base::not_null;
+using base::PullSerializer;
+using base::PushDeserializer;
 using geometry::AngularVelocity;
 using geometry::Bivector;
 using geometry::Identity;
@@ -103,6 +108,7 @@ using ::testing::AnyNumber;
 using ::testing::ByMove;
 using ::testing::Contains;
 using ::testing::DoAll;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::Ge;
 using ::testing::Gt;
@@ -416,6 +422,40 @@ TEST_F(PluginTest, Serialization) {
   serialization::Plugin second_message;
   plugin->WriteToMessage(&second_message);
   EXPECT_THAT(message, EqualsProto(second_message));
+
+  // Round-trip through the streaming serializer and deserializer, which read
+  // and write the plugin in parts.
+  std::unique_ptr<Plugin> streamed_plugin;
+  {
+    PullSerializer serializer(/*chunk_size=*/1 << 10, /*number_of_chunks=*/4);
+    // The reader is used by the thread of the deserializer, so it must outlive
+    // the deserializer, whose destructor waits for that thread.
+    Plugin::Reader reader;
+    PushDeserializer deserializer(/*chunk_size=*/1 << 10,
+                                  /*number_of_chunks=*/4);
+    plugin->WriteToSerializer(&serializer);
+    deserializer.Start(
+        make_not_null_unique<serialization::Plugin>(),
+        [&reader](google::protobuf::Message& part) {
+          reader.Add(static_cast<serialization::Plugin&>(part));
+        },
+        [&reader, &streamed_plugin]() {
+          streamed_plugin.reset(reader.Finish().release());
+        });
+    for (;;) {
+      Bytes const bytes = serializer.Pull();
+      // The chunk returned by |Pull| is only valid until the next call.
+      std::uint8_t* const copy = new std::uint8_t[bytes.size];
+      std::copy(bytes.data, bytes.data + bytes.size, copy);
+      deserializer.Push(Bytes(copy, bytes.size), [copy]() { delete[] copy; });
+      if (bytes.size == 0) {
+        break;
+      }
+    }
+  }
+  serialization::Plugin third_message;
+  streamed_plugin->WriteToMessage(&third_message);
+  EXPECT_THAT(message, EqualsProto(third_message));
   EXPECT_EQ(SolarSystemFactory::LastMajorBody - SolarSystemFactory::Sun + 1,
             message.celestial_size());
 
@@ -726,6 +766,69 @@ TEST_F(PluginDeathTest, InsertUnloadedPartError) {
   }, "emplaced");
 }
 
+// When vessels dock, the parts of one vessel are moved to the other one.
+TEST_F(PluginTest, InsertOrKeepLoadedPartsMovesParts) {
+  GUID const station = "Station";
+  GUID const ship = "Ship";
+  InsertAllSolarSystemBodies();
+  plugin_->EndInitialization();
+  EXPECT_CALL(plugin_->mock_ephemeris(), Prolong(_)).Times(AnyNumber());
+
+  bool inserted;
+  for (GUID const& guid : {station, ship}) {
+    plugin_->InsertOrKeepVessel(guid,
+                                "v" + guid,
+                                SolarSystemFactory::Earth,
+                                /*loaded=*/false,
+                                inserted);
+  }
+  for (PartId const part_id : {3, 1}) {
+    plugin_->InsertUnloadedPart(
+        part_id,
+        "station part",
+        station,
+        RelativeDegreesOfFreedom<AliceSun>(satellite_initial_displacement_,
+                                           satellite_initial_velocity_));
+  }
+  for (PartId const part_id : {4, 2}) {
+    plugin_->InsertUnloadedPart(
+        part_id,
+        "ship part",
+        ship,
+        RelativeDegreesOfFreedom<AliceSun>(satellite_initial_displacement_,
+                                           satellite_initial_velocity_));
+  }
+
+  plugin_->InsertOrKeepVessel(station,
+                              "v" + station,
+                              SolarSystemFactory::Earth,
+                              /*loaded=*/true,
+                              inserted);
+  DegreesOfFreedom<World> const degrees_of_freedom(World::origin,
+                                                   Velocity<World>());
+  std::vector<Plugin::LoadedPart> parts;
+  for (PartId const part_id : {4, 3, 2, 1}) {
+    parts.push_back(
+        {part_id, "part", part_id * Kilogram, degrees_of_freedom});
+  }
+  plugin_->InsertOrKeepLoadedParts(station,
+                                   SolarSystemFactory::Earth,
+                                   degrees_of_freedom,
+                                   parts,
+                                   20 * Milli(Second));
+
+  not_null<Vessel*> const vessel = plugin_->GetVessel(station);
+  std::vector<PartId> part_ids;
+  vessel->ForAllParts([&part_ids](Part const& part) {
+    part_ids.push_back(part.part_id());
+  });
+  EXPECT_THAT(part_ids, ElementsAre(1, 2, 3, 4));
+  for (PartId const part_id : part_ids) {
+    EXPECT_TRUE(vessel->WillKeepPart(part_id));
+    EXPECT_EQ(part_id * Kilogram, vessel->part(part_id)->mass());
+  }
+}
+
 TEST_F(PluginDeathTest, AdvanceTimeError) {
   EXPECT_DEATH({
     InsertAllSolarSystemBodies();
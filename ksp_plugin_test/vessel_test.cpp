@@ -1,11 +1,15 @@
 ﻿
 #include "ksp_plugin/vessel.hpp"
 
+#include <cmath>
+#include <future>
 #include <limits>
 #include <set>
+#include <thread>
 
 #include "astronomy/epoch.hpp"
 #include "base/not_null.hpp"
+#include "base/work_stealing_executor.hpp"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "ksp_plugin/celestial.hpp"
@@ -23,6 +27,7 @@ namespace ksp_plugin {
 namespace internal_vessel {
 
 using base::make_not_null_unique;
+using base::WorkStealingExecutor;
 using geometry::Displacement;
 using geometry::Position;
 using geometry::Velocity;
@@ -30,8 +35,10 @@ using physics::MassiveBody;
 using physics::MockEphemeris;
 using physics::RotatingBody;
 using quantities::si::Degree;
+using quantities::si::Kilo;
 using quantities::si::Kilogram;
 using quantities::si::Metre;
+using quantities::si::Milli;
 using quantities::si::Radian;
 using quantities::si::Second;
 using testing_utilities::AlmostEquals;
@@ -39,6 +46,7 @@ using testing_utilities::Componentwise;
 using testing_utilities::EqualsProto;
 using ::testing::DoAll;
 using ::testing::ElementsAre;
+using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::_;
 
@@ -127,6 +135,41 @@ TEST_F(VesselTest, KeepAndFreeParts) {
   EXPECT_EQ(part_id2_, vessel_.part(part_id2_)->part_id());
 }
 
+TEST_F(VesselTest, AddAndExtractParts) {
+  vessel_.KeepPart(part_id1_);
+  std::vector<not_null<std::unique_ptr<Part>>> parts;
+  parts.push_back(make_not_null_unique<Part>(333,
+                                             "p3",
+                                             mass1_,
+                                             p1_dof_,
+                                             /*deletion_callback=*/nullptr));
+  parts.push_back(make_not_null_unique<Part>(100,
+                                             "p0",
+                                             mass2_,
+                                             p2_dof_,
+                                             /*deletion_callback=*/nullptr));
+  vessel_.AddParts(std::move(parts));
+  std::vector<PartId> part_ids;
+  vessel_.ForAllParts([&part_ids](Part const& part) {
+    part_ids.push_back(part.part_id());
+  });
+  EXPECT_THAT(part_ids, ElementsAre(100, part_id1_, part_id2_, 333));
+
+  auto const extracted = vessel_.ExtractParts({333, part_id1_});
+  ASSERT_EQ(2, extracted.size());
+  EXPECT_EQ(p1_, extracted[0].get());
+  EXPECT_EQ(333, extracted[1]->part_id());
+  EXPECT_FALSE(vessel_.WillKeepPart(part_id1_));
+
+  vessel_.KeepPart(100);
+  vessel_.FreeParts();
+  part_ids.clear();
+  vessel_.ForAllParts([&part_ids](Part const& part) {
+    part_ids.push_back(part.part_id());
+  });
+  EXPECT_THAT(part_ids, ElementsAre(100));
+}
+
 TEST_F(VesselTest, PrepareHistory) {
   vessel_.PrepareHistory(astronomy::J2000 + 1 * Second);
   EXPECT_EQ(1, vessel_.psychohistory().Size());
@@ -314,6 +357,142 @@ TEST_F(VesselTest, PredictBeyondTheInfinite) {
                                        50.0 * Metre / Second}), 0)));
 }
 
+TEST_F(VesselTest, AsynchronousPrediction) {
+  WorkStealingExecutor executor(/*pool_size=*/1);
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  DegreesOfFreedom<Barycentric> const dof(
+      Barycentric::origin +
+          Displacement<Barycentric>(
+              {14.0 / 3.0 * Metre, 5.0 * Metre, 4.0 * Metre}),
+      Velocity<Barycentric>({140.0 / 3.0 * Metre / Second,
+                             50.0 * Metre / Second,
+                             40.0 * Metre / Second}));
+  EXPECT_CALL(ephemeris_, t_max())
+      .WillOnce(Return(astronomy::J2000 + 2.0 * Second));
+  EXPECT_CALL(
+      ephemeris_,
+      FlowWithAdaptiveStep(_, _, astronomy::J2000 + 2.0 * Second, _, _, _))
+      .WillOnce(DoAll(
+          AppendToDiscreteTrajectory(astronomy::J2000 + 0.5 * Second, dof),
+          AppendToDiscreteTrajectory(astronomy::J2000 + 1.5 * Second, dof),
+          Return(false)));
+
+  // The prediction is only published once it has been computed.
+  vessel_.RefreshPrediction(&executor);
+  EXPECT_EQ(1, vessel_.prediction().Size());
+  vessel_.WaitForPrediction();
+  EXPECT_EQ(3, vessel_.prediction().Size());
+  EXPECT_EQ(astronomy::J2000 + 1.5 * Second,
+            vessel_.prediction().last().time());
+  EXPECT_EQ(dof, vessel_.prediction().last().degrees_of_freedom());
+}
+
+// Check that the ephemeris is only prolonged on the thread that refreshes the
+// prediction.
+TEST_F(VesselTest, AsynchronousPredictionProlongsEphemeris) {
+  WorkStealingExecutor executor(/*pool_size=*/1);
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  DegreesOfFreedom<Barycentric> const dof(
+      Barycentric::origin +
+          Displacement<Barycentric>(
+              {14.0 / 3.0 * Metre, 5.0 * Metre, 4.0 * Metre}),
+      Velocity<Barycentric>({140.0 / 3.0 * Metre / Second,
+                             50.0 * Metre / Second,
+                             40.0 * Metre / Second}));
+  std::thread::id const this_thread = std::this_thread::get_id();
+  auto const on_this_thread = [this_thread](Instant const&) {
+    EXPECT_EQ(this_thread, std::this_thread::get_id());
+  };
+  EXPECT_CALL(ephemeris_, t_max())
+      .WillOnce(Return(astronomy::J2000 + 2.0 * Second))
+      .WillOnce(Return(astronomy::J2000 + 12.0 * Second));
+  EXPECT_CALL(ephemeris_, planetary_integrator_step())
+      .WillRepeatedly(Return(10 * Milli(Second)));
+
+  // The first refresh prolongs the ephemeris, and the prediction flows until
+  // its end.
+  EXPECT_CALL(ephemeris_, Prolong(astronomy::J2000 + 12.0 * Second))
+      .WillOnce(Invoke(on_this_thread));
+  EXPECT_CALL(
+      ephemeris_,
+      FlowWithAdaptiveStep(_, _, astronomy::J2000 + 12.0 * Second, _, _, _))
+      .WillOnce(DoAll(
+          AppendToDiscreteTrajectory(astronomy::J2000 + 12.0 * Second, dof),
+          Return(true)));
+  vessel_.RefreshPrediction(&executor);
+  vessel_.WaitForPrediction();
+  EXPECT_EQ(astronomy::J2000 + 12.0 * Second,
+            vessel_.prediction().last().time());
+
+  // The last prediction reached the end of the ephemeris, so the next refresh
+  // prolongs it again.
+  EXPECT_CALL(ephemeris_, Prolong(astronomy::J2000 + 22.0 * Second))
+      .WillOnce(Invoke(on_this_thread));
+  EXPECT_CALL(
+      ephemeris_,
+      FlowWithAdaptiveStep(_, _, astronomy::J2000 + 22.0 * Second, _, _, _))
+      .WillOnce(DoAll(
+          AppendToDiscreteTrajectory(astronomy::J2000 + 17.0 * Second, dof),
+          Return(false)));
+  vessel_.RefreshPrediction(&executor);
+  vessel_.WaitForPrediction();
+  EXPECT_EQ(astronomy::J2000 + 17.0 * Second,
+            vessel_.prediction().last().time());
+}
+
+TEST_F(VesselTest, AdvanceTimeKeepsPrediction) {
+  WorkStealingExecutor executor(/*pool_size=*/1);
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  DegreesOfFreedom<Barycentric> const dof(
+      Barycentric::origin +
+          Displacement<Barycentric>(
+              {14.0 / 3.0 * Metre, 5.0 * Metre, 4.0 * Metre}),
+      Velocity<Barycentric>({140.0 / 3.0 * Metre / Second,
+                             50.0 * Metre / Second,
+                             40.0 * Metre / Second}));
+  EXPECT_CALL(ephemeris_, t_max())
+      .WillRepeatedly(Return(astronomy::J2000 + 2.0 * Second));
+  EXPECT_CALL(
+      ephemeris_,
+      FlowWithAdaptiveStep(_, _, astronomy::J2000 + 2.0 * Second, _, _, _))
+      .WillRepeatedly(DoAll(
+          AppendToDiscreteTrajectory(astronomy::J2000 + 1.5 * Second, dof),
+          Return(false)));
+  vessel_.RefreshPrediction(&executor);
+  vessel_.WaitForPrediction();
+  EXPECT_EQ(2, vessel_.prediction().Size());
+
+  // Keep the executor busy so that the next prediction is still being computed
+  // when the psychohistory moves.
+  std::promise<void> unblock;
+  std::shared_future<void> const blocked = unblock.get_future().share();
+  executor.Add([blocked]() { blocked.wait(); });
+  vessel_.RefreshPrediction(&executor);
+
+  // The published prediction is attached to the new end of the psychohistory.
+  p1_->AppendToHistory(astronomy::J2000 + 1.0 * Second, p1_dof_);
+  p2_->AppendToHistory(astronomy::J2000 + 1.0 * Second, p2_dof_);
+  vessel_.AdvanceTime();
+  vessel_.RefreshPrediction(&executor);
+  auto const psychohistory_last = vessel_.psychohistory().last();
+  auto const fork = vessel_.prediction().Fork();
+  EXPECT_EQ(psychohistory_last.time(), fork.time());
+  EXPECT_EQ(psychohistory_last.degrees_of_freedom(),
+            fork.degrees_of_freedom());
+  EXPECT_EQ(astronomy::J2000 + 1.0 * Second, fork.time());
+  // The points at 0 s and 1 s are those of the psychohistory.
+  EXPECT_EQ(3, vessel_.prediction().Size());
+  EXPECT_EQ(astronomy::J2000 + 1.5 * Second,
+            vessel_.prediction().last().time());
+  EXPECT_EQ(dof, vessel_.prediction().last().degrees_of_freedom());
+
+  unblock.set_value();
+  vessel_.WaitForPrediction();
+}
+
 TEST_F(VesselTest, FlightPlan) {
   vessel_.PrepareHistory(astronomy::J2000);
 
@@ -330,6 +509,76 @@ TEST_F(VesselTest, FlightPlan) {
   EXPECT_FALSE(vessel_.has_flight_plan());
 }
 
+TEST_F(VesselTest, AsynchronousFlightPlanEdits) {
+  WorkStealingExecutor executor(/*pool_size=*/1);
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  EXPECT_CALL(ephemeris_, FlowWithAdaptiveStep(_, _, _, _, _, _))
+      .WillRepeatedly(Return(true));
+  vessel_.CreateFlightPlan(astronomy::J2000 + 6.0 * Second,
+                           10 * Kilogram,
+                           DefaultPredictionParameters());
+  auto const set_desired_final_time = [](Instant const& desired_final_time) {
+    return [desired_final_time](FlightPlan& flight_plan) {
+      return flight_plan.SetDesiredFinalTime(desired_final_time);
+    };
+  };
+
+  // The ephemeris is prolonged to the desired final time of the last published
+  // flight plan on this thread, not by the edits.
+  EXPECT_CALL(ephemeris_, Prolong(astronomy::J2000 + 6.0 * Second)).Times(2);
+  EXPECT_CALL(ephemeris_, Prolong(astronomy::J2000 + 5.0 * Second)).Times(2);
+  EXPECT_CALL(ephemeris_, Prolong(astronomy::J2000 + 4.0 * Second)).Times(1);
+
+  // Keep the executor busy so that the edits are pending.
+  std::promise<void> unblock;
+  std::shared_future<void> const blocked = unblock.get_future().share();
+  executor.Add([blocked]() { blocked.wait(); });
+
+  // The failed edit is replaced by the one that follows it.
+  vessel_.EditFlightPlanAsynchronously(
+      set_desired_final_time(astronomy::J2000 - 1.0 * Second),
+      /*coalesce=*/true,
+      &executor);
+  vessel_.EditFlightPlanAsynchronously(
+      set_desired_final_time(astronomy::J2000 + 5.0 * Second),
+      /*coalesce=*/true,
+      &executor);
+  vessel_.RefreshFlightPlan();
+  EXPECT_TRUE(vessel_.flight_plan_is_computing());
+  EXPECT_EQ(astronomy::J2000 + 6.0 * Second,
+            vessel_.flight_plan().desired_final_time());
+  unblock.set_value();
+  vessel_.WaitForFlightPlan();
+  EXPECT_FALSE(vessel_.flight_plan_is_computing());
+  EXPECT_TRUE(vessel_.last_flight_plan_edit_succeeded());
+  EXPECT_EQ(astronomy::J2000 + 5.0 * Second,
+            vessel_.flight_plan().desired_final_time());
+
+  // A failed edit that is not coalesced is reported.
+  vessel_.EditFlightPlanAsynchronously(
+      set_desired_final_time(astronomy::J2000 - 1.0 * Second),
+      /*coalesce=*/false,
+      &executor);
+  vessel_.EditFlightPlanAsynchronously(
+      set_desired_final_time(astronomy::J2000 + 4.0 * Second),
+      /*coalesce=*/true,
+      &executor);
+  vessel_.WaitForFlightPlan();
+  EXPECT_FALSE(vessel_.last_flight_plan_edit_succeeded());
+  EXPECT_EQ(astronomy::J2000 + 4.0 * Second,
+            vessel_.flight_plan().desired_final_time());
+
+  // Deleting the flight plan cancels the pending edits.
+  vessel_.EditFlightPlanAsynchronously(
+      set_desired_final_time(astronomy::J2000 + 3.0 * Second),
+      /*coalesce=*/false,
+      &executor);
+  vessel_.DeleteFlightPlan();
+  vessel_.WaitForFlightPlan();
+  EXPECT_FALSE(vessel_.has_flight_plan());
+}
+
 TEST_F(VesselTest, SerializationSuccess) {
   vessel_.PrepareHistory(astronomy::J2000);
 
@@ -353,6 +602,208 @@ TEST_F(VesselTest, SerializationSuccess) {
   EXPECT_THAT(message, EqualsProto(second_message));
 }
 
+TEST_F(VesselTest, DeferredHistoryDeserialization) {
+  auto const advance_time = [this](Vessel& vessel, Instant const& t) {
+    for (PartId const part_id : {part_id1_, part_id2_}) {
+      not_null<Part*> const part = vessel.part(part_id);
+      part->AppendToHistory(
+          t,
+          DegreesOfFreedom<Barycentric>(
+              Barycentric::origin +
+                  Displacement<Barycentric>(
+                      {part_id * Metre, (t - astronomy::J2000) * Metre / Second,
+                       3 * Metre}),
+              Velocity<Barycentric>({part_id * Metre / Second,
+                                     1 * Metre / Second,
+                                     0 * Metre / Second})));
+    }
+    vessel.AdvanceTime();
+  };
+  auto const expect_same_trajectories =
+      [](DiscreteTrajectory<Barycentric> const& expected,
+         DiscreteTrajectory<Barycentric> const& actual) {
+        EXPECT_EQ(expected.Size(), actual.Size());
+        for (auto it1 = expected.Begin(), it2 = actual.Begin();
+             it1 != expected.End() && it2 != actual.End();
+             ++it1, ++it2) {
+          EXPECT_EQ(it1.time(), it2.time());
+          EXPECT_EQ(it1.degrees_of_freedom(), it2.degrees_of_freedom());
+        }
+      };
+
+  vessel_.PrepareHistory(astronomy::J2000);
+  for (int i = 1; i <= 10; ++i) {
+    advance_time(vessel_, astronomy::J2000 + i * Second);
+  }
+  serialization::Vessel message;
+  vessel_.WriteToMessage(&message);
+  EXPECT_EQ(11, message.history().timeline_size());
+
+  auto const v = Vessel::ReadFromMessage(
+      message, &celestial_, &ephemeris_, /*deletion_callback=*/nullptr);
+  EXPECT_EQ(astronomy::J2000 + 10 * Second, v->psychohistory_last().time());
+
+  // Serialization doesn't need the history to be deserialized.
+  serialization::Vessel second_message;
+  v->WriteToMessage(&second_message);
+  EXPECT_THAT(second_message, EqualsProto(message));
+
+  // Neither does advancing time or forgetting points that were deserialized.
+  for (int i = 11; i <= 15; ++i) {
+    advance_time(vessel_, astronomy::J2000 + i * Second);
+    advance_time(*v, astronomy::J2000 + i * Second);
+  }
+  EXPECT_EQ(astronomy::J2000 + 15 * Second, v->psychohistory_last().time());
+  vessel_.ForgetBefore(astronomy::J2000);
+  v->ForgetBefore(astronomy::J2000);
+
+  serialization::Vessel third_message;
+  serialization::Vessel fourth_message;
+  vessel_.WriteToMessage(&third_message);
+  v->WriteToMessage(&fourth_message);
+  EXPECT_THAT(fourth_message, EqualsProto(third_message));
+
+  // Forgetting points that were not deserialized, either all of them or only
+  // some of them.
+  auto const u = Vessel::ReadFromMessage(
+      fourth_message, &celestial_, &ephemeris_, /*deletion_callback=*/nullptr);
+  auto const w = Vessel::ReadFromMessage(
+      fourth_message, &celestial_, &ephemeris_, /*deletion_callback=*/nullptr);
+  u->ForgetBefore(astronomy::J2000 + 15 * Second);
+  w->ForgetBefore(astronomy::J2000 + 12 * Second);
+
+  expect_same_trajectories(vessel_.psychohistory(), v->psychohistory());
+  expect_same_trajectories(vessel_.prediction(), v->prediction());
+  vessel_.ForgetBefore(astronomy::J2000 + 12 * Second);
+  expect_same_trajectories(vessel_.psychohistory(), w->psychohistory());
+  vessel_.ForgetBefore(astronomy::J2000 + 15 * Second);
+  expect_same_trajectories(vessel_.psychohistory(), u->psychohistory());
+}
+
+TEST_F(VesselTest, HistoryMemoryBudget) {
+  // A trajectory with wiggles which are too large to be downsampled much, but
+  // small enough to be compressed.
+  auto const degrees_of_freedom = [](Instant const& t) {
+    double const θ = (t - astronomy::J2000) / Second;
+    return DegreesOfFreedom<Barycentric>(
+        Barycentric::origin +
+            Displacement<Barycentric>({θ * Kilo(Metre),
+                                       20 * std::sin(2 * θ) * Metre,
+                                       0 * Metre}),
+        Velocity<Barycentric>({1 * Kilo(Metre) / Second,
+                               40 * std::cos(2 * θ) * Metre / Second,
+                               0 * Metre / Second}));
+  };
+  std::int64_t const budget = 1'000'000;
+  vessel_.set_history_memory_budget(budget);
+  EXPECT_EQ(budget, vessel_.history_memory_budget());
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  DiscreteTrajectory<Barycentric> expected_history;
+  expected_history.Append(astronomy::J2000,
+                          vessel_.psychohistory().Begin().degrees_of_freedom());
+  for (int i = 1; i <= 20'000; ++i) {
+    Instant const t = astronomy::J2000 + i * Second;
+    for (PartId const part_id : {part_id1_, part_id2_}) {
+      vessel_.part(part_id)->AppendToHistory(t, degrees_of_freedom(t));
+    }
+    expected_history.Append(t, degrees_of_freedom(t));
+    vessel_.AdvanceTime();
+  }
+
+  Vessel::HistoryMemoryUsage const usage = vessel_.history_memory_usage();
+  EXPECT_LT(usage.bytes, budget);
+  EXPECT_EQ(0, usage.serialized_bytes);
+  EXPECT_LT(astronomy::J2000, usage.compressed_history_end);
+  EXPECT_LE(100 * Metre, usage.compression_tolerance);
+  EXPECT_GE(1 * Kilo(Metre), usage.compression_tolerance);
+  EXPECT_EQ(usage.points, vessel_.psychohistory().Size());
+  EXPECT_EQ(astronomy::J2000 + 20'000 * Second,
+            vessel_.psychohistory().last().time());
+
+  // The points which are not compressed are within the downsampling tolerance.
+  // The others were compressed only once, so they are within the compression
+  // tolerance of the points that were left by the downsampling.
+  for (auto it = expected_history.Begin(); it != expected_history.End();
+       ++it) {
+    Length const error = (vessel_.psychohistory().EvaluatePosition(it.time()) -
+                          it.degrees_of_freedom().position()).Norm();
+    if (it.time() <= usage.compressed_history_end) {
+      EXPECT_LT(error, usage.compression_tolerance + 10 * Metre) << it.time();
+    } else {
+      EXPECT_LT(error, 10 * Metre) << it.time();
+    }
+  }
+
+  // The state of the compression is serialized.
+  serialization::Vessel message;
+  vessel_.WriteToMessage(&message);
+  EXPECT_TRUE(message.has_history_compression());
+  auto const v = Vessel::ReadFromMessage(
+      message, &celestial_, &ephemeris_, /*deletion_callback=*/nullptr);
+  Vessel::HistoryMemoryUsage const read_usage = v->history_memory_usage();
+  EXPECT_EQ(usage.compressed_history_end, read_usage.compressed_history_end);
+  EXPECT_EQ(usage.compression_tolerance, read_usage.compression_tolerance);
+}
+
+TEST_F(VesselTest, HistoryCompressionAfterAppending) {
+  auto const degrees_of_freedom = [](Instant const& t) {
+    double const θ = (t - astronomy::J2000) / Second;
+    return DegreesOfFreedom<Barycentric>(
+        Barycentric::origin +
+            Displacement<Barycentric>({θ * Kilo(Metre),
+                                       20 * std::sin(2 * θ) * Metre,
+                                       0 * Metre}),
+        Velocity<Barycentric>({1 * Kilo(Metre) / Second,
+                               40 * std::cos(2 * θ) * Metre / Second,
+                               0 * Metre / Second}));
+  };
+  auto const append = [this, &degrees_of_freedom](int const first,
+                                                  int const last) {
+    for (int i = first; i <= last; ++i) {
+      Instant const t = astronomy::J2000 + i * Second;
+      for (PartId const part_id : {part_id1_, part_id2_}) {
+        vessel_.part(part_id)->AppendToHistory(t, degrees_of_freedom(t));
+      }
+      vessel_.AdvanceTime();
+    }
+  };
+  std::int64_t const budget = 1'000'000;
+  vessel_.set_history_memory_budget(budget);
+  vessel_.PrepareHistory(astronomy::J2000);
+
+  // The history is compressed while the points after the first 10'000 seconds
+  // have not been downsampled yet.  They are not compressed.
+  append(1, 20'000);
+  Vessel::HistoryMemoryUsage const first_usage = vessel_.history_memory_usage();
+  EXPECT_LT(astronomy::J2000, first_usage.compressed_history_end);
+  EXPECT_GE(astronomy::J2000 + 10'000 * Second,
+            first_usage.compressed_history_end);
+
+  // Once they have been downsampled, these points are compressed by the next
+  // compressions.
+  append(20'001, 40'000);
+  Vessel::HistoryMemoryUsage const second_usage =
+      vessel_.history_memory_usage();
+  EXPECT_LT(second_usage.bytes, budget);
+  EXPECT_LT(astronomy::J2000 + 20'000 * Second,
+            second_usage.compressed_history_end);
+  std::int64_t points_compressed_later = 0;
+  for (auto it = vessel_.psychohistory().LowerBound(
+           first_usage.compressed_history_end);
+       it.time() <= second_usage.compressed_history_end;
+       ++it) {
+    ++points_compressed_later;
+  }
+  EXPECT_LT(points_compressed_later, 1'000);
+  for (int i = 1; i <= 40'000; ++i) {
+    Instant const t = astronomy::J2000 + i * Second;
+    Length const error = (vessel_.psychohistory().EvaluatePosition(t) -
+                          degrees_of_freedom(t).position()).Norm();
+    EXPECT_LT(error, second_usage.compression_tolerance + 10 * Metre) << t;
+  }
+}
+
 }  // namespace internal_vessel
 }  // namespace ksp_plugin
 }  // namespace principia
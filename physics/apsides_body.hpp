@@ -37,6 +37,10 @@ void ComputeApsides(Trajectory<Frame> const& reference,
   std::experimental::optional<Variation<Square<Length>>>
       previous_squared_distance_derivative;
 
+  // The apsides are found in increasing time order, so the trajectory is
+  // evaluated incrementally.
+  typename DiscreteTrajectory<Frame>::Evaluator evaluator(begin.trajectory());
+
   Instant const t_min = reference.t_min();
   Instant const t_max = reference.t_max();
   for (auto it = begin; it != end; ++it) {
@@ -104,7 +108,7 @@ void ComputeApsides(Trajectory<Frame> const& reference,
       // 3rd-degree polynomial would yield |squared_distance_approximation|, so
       // we shouldn't be far from the truth.
       DegreesOfFreedom<Frame> const apsis_degrees_of_freedom =
-          begin.trajectory()->EvaluateDegreesOfFreedom(apsis_time);
+          evaluator.EvaluateDegreesOfFreedom(apsis_time);
       if (Sign(squared_distance_derivative).Negative()) {
         apoapsides.Append(apsis_time, apsis_degrees_of_freedom);
       } else {
@@ -129,6 +133,8 @@ void ComputeNodes(typename DiscreteTrajectory<Frame>::Iterator begin,
   std::experimental::optional<Length> previous_z;
   std::experimental::optional<Speed> previous_z_speed;
 
+  typename DiscreteTrajectory<Frame>::Evaluator evaluator(begin.trajectory());
+
   for (auto it = begin; it != end; ++it) {
     Instant const time = it.time();
     DegreesOfFreedom<Frame> const& degrees_of_freedom = it.degrees_of_freedom();
@@ -166,7 +172,7 @@ void ComputeNodes(typename DiscreteTrajectory<Frame>::Iterator begin,
       }
 
       DegreesOfFreedom<Frame> const node_degrees_of_freedom =
-          begin.trajectory()->EvaluateDegreesOfFreedom(node_time);
+          evaluator.EvaluateDegreesOfFreedom(node_time);
       if (Sign(InnerProduct(north, Vector<double, Frame>({0, 0, 1}))) ==
           Sign(z_speed)) {
         // |north| is up and we are going up, or |north| is down and we are
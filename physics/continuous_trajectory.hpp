@@ -1,6 +1,7 @@
 ﻿
 #pragma once
 
+#include <deque>
 #include <experimental/optional>
 #include <vector>
 #include <utility>
@@ -150,7 +151,7 @@ class ContinuousTrajectory : public Trajectory<Frame> {
   // Returns an iterator to the series applicable for the given |time|, or
   // |begin()| if |time| is before the first series or |end()| if |time| is
   // after the last series.  Time complexity is O(N Log N).
-  typename std::vector<ЧебышёвSeries<Displacement<Frame>>>::const_iterator
+  typename std::deque<ЧебышёвSeries<Displacement<Frame>>>::const_iterator
   FindSeriesForInstant(Instant const& time) const;
 
   // Construction parameters;
@@ -168,7 +169,9 @@ class ContinuousTrajectory : public Trajectory<Frame> {
   int degree_age_;
 
   // The series are in increasing time order.  Their intervals are consecutive.
-  std::vector<ЧебышёвSeries<Displacement<Frame>>> series_;
+  // A deque is used so that |ForgetBefore| only releases the series that it
+  // removes instead of moving all the remaining ones.
+  std::deque<ЧебышёвSeries<Displacement<Frame>>> series_;
 
   // The time at which this trajectory starts.  Set for a nonempty trajectory.
   // |*first_time_ >= series_.front().t_min()|
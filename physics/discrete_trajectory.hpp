@@ -1,6 +1,7 @@
 ﻿
 #pragma once
 
+#include <experimental/optional>
 #include <functional>
 #include <list>
 #include <map>
@@ -139,6 +140,24 @@ class DiscreteTrajectory : public Forkable<DiscreteTrajectory<Frame>,
   // number of points that can be added before removal is considered.
   void SetDownsampling(std::int64_t max_dense_intervals, Length tolerance);
 
+  // This trajectory must be a root, and must not have forks at times (strictly)
+  // less than |t2|.  Removes intermediate points with times in [t1, t2],
+  // ensuring that |EvaluatePosition| returns a result within |tolerance| of the
+  // removed points.  The first point at or after |t1| and the last point at or
+  // before |t2| are kept, so the trajectory is unchanged outside of [t1, t2].
+  // If this trajectory is downsampling, the points that have not been
+  // downsampled yet are not changed.  Returns the number of points that were
+  // removed.  Invalidates the iterators to the removed points.
+  std::int64_t DownsampleBetween(Instant const& t1,
+                                 Instant const& t2,
+                                 Length tolerance);
+
+  // If this trajectory is downsampling and nonempty, returns the time of the
+  // first point that has not been downsampled yet.  |DownsampleBetween| doesn't
+  // remove that point nor the points after it.  Otherwise, returns
+  // |InfiniteFuture|.
+  Instant first_dense_time() const;
+
   // Implementation of the interface |Trajectory|.
 
   // The bounds are the times of |Begin()| and |last()| if this trajectory is
@@ -153,6 +172,47 @@ class DiscreteTrajectory : public Forkable<DiscreteTrajectory<Frame>,
 
   // End of the implementation of the interface.
 
+  // An object that evaluates a trajectory at a sequence of times.  It caches
+  // the interval and the Hermite interpolation used for the last evaluation
+  // and moves incrementally to the neighbouring intervals, so that evaluating
+  // at times that are close to each other (e.g., when sweeping a range of times
+  // monotonically, in either direction) doesn't require a binary search and
+  // the construction of an interpolation for each call.  The results are
+  // identical to those of the |Evaluate...| functions of the trajectory.  The
+  // trajectory must not be changed while an |Evaluator| is in use.
+  class Evaluator final {
+   public:
+    explicit Evaluator(not_null<DiscreteTrajectory const*> trajectory);
+
+    // |time| must be in [t_min(), t_max()] for the trajectory.
+    Position<Frame> EvaluatePosition(Instant const& time);
+    Velocity<Frame> EvaluateVelocity(Instant const& time);
+    DegreesOfFreedom<Frame> EvaluateDegreesOfFreedom(Instant const& time);
+
+   private:
+    // The number of neighbouring intervals that are examined before falling
+    // back to a binary search.
+    static constexpr int max_linear_search_steps_ = 8;
+
+    // Returns true if |time| is in the interval [lower_, upper_] used by
+    // |GetInterpolation|.
+    bool IntervalContains(Instant const& time) const;
+
+    // Ensures that |interpolation_| is the interpolation that
+    // |GetInterpolation| would return for |time|.
+    void UpdateInterpolation(Instant const& time);
+
+    not_null<DiscreteTrajectory const*> const trajectory_;
+    Iterator const begin_;
+    // The bounds of the current interval; |lower_ == upper_| if the current
+    // interval is reduced to |t_min()|.  Only meaningful if |interpolation_|
+    // has a value.
+    Iterator lower_;
+    Iterator upper_;
+    std::experimental::optional<Hermite3<Instant, Position<Frame>>>
+        interpolation_;
+  };
+
   // This trajectory must be a root.  Only the given |forks| are serialized.
   // They must be descended from this trajectory.  The pointers in |forks| may
   // be null at entry.
@@ -259,6 +259,74 @@ void DiscreteTrajectory<Frame>::SetDownsampling(
       max_dense_intervals, tolerance, timeline_.begin(), timeline_);
 }
 
+template<typename Frame>
+std::int64_t DiscreteTrajectory<Frame>::DownsampleBetween(
+    Instant const& t1,
+    Instant const& t2,
+    Length const tolerance) {
+  CHECK(this->is_root());
+  this->CheckNoForksBefore(t2);
+
+  // Find the first point and the last point that must be kept, i.e., the first
+  // point at or after |t1| and the last point at or before |t2|, but not after
+  // the start of the dense timeline.
+  TimelineConstIterator const first_in_timeline = timeline_.lower_bound(t1);
+  TimelineConstIterator last_in_timeline = timeline_.upper_bound(t2);
+  if (last_in_timeline == timeline_.cbegin()) {
+    return 0;
+  }
+  --last_in_timeline;
+  if (downsampling_.has_value() &&
+      downsampling_->start_of_dense_timeline() != timeline_.end() &&
+      downsampling_->first_dense_time() < last_in_timeline->first) {
+    last_in_timeline = downsampling_->start_of_dense_timeline();
+  }
+  if (first_in_timeline == timeline_.cend() ||
+      first_in_timeline->first >= last_in_timeline->first) {
+    return 0;
+  }
+
+  std::vector<TimelineConstIterator> iterators;
+  for (TimelineConstIterator it = first_in_timeline;; ++it) {
+    iterators.push_back(it);
+    if (it == last_in_timeline) {
+      break;
+    }
+  }
+  if (iterators.size() < 3) {
+    return 0;
+  }
+
+  // The spline returned by |FitHermiteSpline| doesn't include the last point,
+  // but it guarantees that the interpolation from its last right endpoint to
+  // the last point fits within |tolerance|.
+  auto const right_endpoints = FitHermiteSpline<Instant, Position<Frame>>(
+      iterators,
+      [](auto&& it) -> auto&& { return it->first; },
+      [](auto&& it) -> auto&& { return it->second.position(); },
+      [](auto&& it) -> auto&& { return it->second.velocity(); },
+      tolerance);
+  std::int64_t const size_before = timeline_.size();
+  TimelineConstIterator left = first_in_timeline;
+  for (auto const& it_in_iterators : right_endpoints) {
+    TimelineConstIterator const right = *it_in_iterators;
+    timeline_.erase(++left, right);
+    left = right;
+  }
+  timeline_.erase(++left, last_in_timeline);
+  return size_before - timeline_.size();
+}
+
+template<typename Frame>
+Instant DiscreteTrajectory<Frame>::first_dense_time() const {
+  if (downsampling_.has_value() &&
+      downsampling_->start_of_dense_timeline() != timeline_.end()) {
+    return downsampling_->first_dense_time();
+  } else {
+    return InfiniteFuture;
+  }
+}
+
 template<typename Frame>
 Instant DiscreteTrajectory<Frame>::t_min() const {
   return this->Empty() ? InfiniteFuture : this->Begin().time();
@@ -288,6 +356,87 @@ DegreesOfFreedom<Frame> DiscreteTrajectory<Frame>::EvaluateDegreesOfFreedom(
   return {interpolation.Evaluate(time), interpolation.EvaluateDerivative(time)};
 }
 
+template<typename Frame>
+DiscreteTrajectory<Frame>::Evaluator::Evaluator(
+    not_null<DiscreteTrajectory const*> const trajectory)
+    : trajectory_(trajectory),
+      begin_(trajectory->Begin()) {}
+
+template<typename Frame>
+Position<Frame> DiscreteTrajectory<Frame>::Evaluator::EvaluatePosition(
+    Instant const& time) {
+  UpdateInterpolation(time);
+  return interpolation_->Evaluate(time);
+}
+
+template<typename Frame>
+Velocity<Frame> DiscreteTrajectory<Frame>::Evaluator::EvaluateVelocity(
+    Instant const& time) {
+  UpdateInterpolation(time);
+  return interpolation_->EvaluateDerivative(time);
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame>
+DiscreteTrajectory<Frame>::Evaluator::EvaluateDegreesOfFreedom(
+    Instant const& time) {
+  UpdateInterpolation(time);
+  return {interpolation_->Evaluate(time),
+          interpolation_->EvaluateDerivative(time)};
+}
+
+template<typename Frame>
+bool DiscreteTrajectory<Frame>::Evaluator::IntervalContains(
+    Instant const& time) const {
+  if (lower_ == upper_) {
+    return time == upper_.time();
+  } else {
+    return lower_.time() < time && time <= upper_.time();
+  }
+}
+
+template<typename Frame>
+void DiscreteTrajectory<Frame>::Evaluator::UpdateInterpolation(
+    Instant const& time) {
+  CHECK_LE(trajectory_->t_min(), time);
+  CHECK_GE(trajectory_->t_max(), time);
+  bool found = false;
+  if (interpolation_.has_value()) {
+    if (IntervalContains(time)) {
+      return;
+    }
+    // Try the neighbouring intervals, this is the common case when the times
+    // are monotonic.  Note that |upper_| never reaches |End()| because |time|
+    // is at most |t_max()|.
+    for (int i = 0; i < max_linear_search_steps_ && !found; ++i) {
+      if (upper_.time() < time) {
+        if (lower_ != upper_) {
+          ++lower_;
+        }
+        ++upper_;
+      } else if (lower_ == begin_) {
+        // Here |time| is |t_min()|.
+        upper_ = lower_;
+      } else {
+        --lower_;
+        --upper_;
+      }
+      found = IntervalContains(time);
+    }
+  }
+  if (!found) {
+    // Same as |GetInterpolation|.
+    upper_ = trajectory_->LowerBound(time);
+    lower_ = upper_ == begin_ ? upper_ : --Iterator{upper_};
+  }
+  interpolation_.emplace(
+      std::make_pair(lower_.time(), upper_.time()),
+      std::make_pair(lower_.degrees_of_freedom().position(),
+                     upper_.degrees_of_freedom().position()),
+      std::make_pair(lower_.degrees_of_freedom().velocity(),
+                     upper_.degrees_of_freedom().velocity()));
+}
+
 template<typename Frame>
 void DiscreteTrajectory<Frame>::WriteToMessage(
     not_null<serialization::DiscreteTrajectory*> const message,
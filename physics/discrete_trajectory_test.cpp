@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 
+#include "astronomy/epoch.hpp"
 #include "geometry/frame.hpp"
 #include "geometry/grassmann.hpp"
 #include "geometry/named_quantities.hpp"
@@ -24,6 +25,7 @@ namespace principia {
 namespace physics {
 namespace internal_discrete_trajectory {
 
+using astronomy::InfiniteFuture;
 using geometry::Displacement;
 using geometry::Frame;
 using geometry::Instant;
@@ -60,6 +62,7 @@ using ::testing::Le;
 using ::testing::Lt;
 using ::testing::Pair;
 using ::testing::Ref;
+using ::testing::SizeIs;
 
 class DiscreteTrajectoryTest : public testing::Test {
  protected:
@@ -869,6 +872,72 @@ TEST_F(DiscreteTrajectoryTest, QuadrilateralCircle) {
   EXPECT_THAT(max_v_error, AllOf(Ge(0.011), Le(0.013)));
 }
 
+TEST_F(DiscreteTrajectoryTest, Evaluator) {
+  DiscreteTrajectory<World> circle;
+  AngularFrequency const ω = 3 * Radian / Second;
+  Length const r = 2 * Metre;
+  Speed const v = ω * r / Radian;
+  Time const period = 2 * π * Radian / ω;
+  for (Time t; t <= period; t += period / 16) {
+    circle.Append(
+        t0_ + t,
+        {World::origin + Displacement<World>{{r * Cos(ω * t),
+                                              r * Sin(ω * t),
+                                              0 * Metre}},
+         Velocity<World>{{-v * Sin(ω * t),
+                          v * Cos(ω * t),
+                          0 * Metre / Second}}});
+  }
+  auto const clamp = [&circle](Instant const& t) {
+    return std::min(std::max(t, circle.t_min()), circle.t_max());
+  };
+  std::vector<Instant> times;
+  // Forward, including both ends and the points of the trajectory.
+  for (int i = 0; i <= 64; ++i) {
+    times.push_back(clamp(t0_ + i * period / 64));
+  }
+  times.push_back(circle.t_max());
+  // Backward.
+  for (int i = 48; i >= 0; --i) {
+    times.push_back(clamp(t0_ + i * period / 48));
+  }
+  times.push_back(circle.t_min());
+  // Jumps that require a binary search.
+  times.push_back(clamp(t0_ + 0.9 * period));
+  times.push_back(clamp(t0_ + 0.1 * period));
+  times.push_back(circle.t_min());
+  times.push_back(clamp(t0_ + 0.7 * period));
+
+  DiscreteTrajectory<World>::Evaluator evaluator(&circle);
+  for (Instant const& t : times) {
+    EXPECT_THAT(evaluator.EvaluatePosition(t),
+                Eq(circle.EvaluatePosition(t))) << t;
+    EXPECT_THAT(evaluator.EvaluateVelocity(t),
+                Eq(circle.EvaluateVelocity(t))) << t;
+    EXPECT_THAT(evaluator.EvaluateDegreesOfFreedom(t),
+                Eq(circle.EvaluateDegreesOfFreedom(t))) << t;
+  }
+}
+
+TEST_F(DiscreteTrajectoryTest, EvaluatorFork) {
+  massive_trajectory_->Append(t1_, d1_);
+  massive_trajectory_->Append(t2_, d2_);
+  not_null<DiscreteTrajectory<World>*> const fork =
+      massive_trajectory_->NewForkWithCopy(t2_);
+  fork->Append(t3_, d3_);
+  fork->Append(t4_, d4_);
+
+  DiscreteTrajectory<World>::Evaluator evaluator(fork);
+  for (Instant t = t4_; t >= t1_; t -= 1 * Second) {
+    EXPECT_THAT(evaluator.EvaluateDegreesOfFreedom(t),
+                Eq(fork->EvaluateDegreesOfFreedom(t))) << t;
+  }
+  for (Instant t = t1_; t <= t4_; t += 3 * Second) {
+    EXPECT_THAT(evaluator.EvaluateDegreesOfFreedom(t),
+                Eq(fork->EvaluateDegreesOfFreedom(t))) << t;
+  }
+}
+
 TEST_F(DiscreteTrajectoryTest, Downsampling) {
   DiscreteTrajectory<World> circle;
   DiscreteTrajectory<World> downsampled_circle;
@@ -994,6 +1063,92 @@ TEST_F(DiscreteTrajectoryTest, DownsamplingForgetAfter) {
   EXPECT_THAT(errors, Each(Eq(0 * Metre)));
 }
 
+TEST_F(DiscreteTrajectoryTest, DownsampleBetween) {
+  DiscreteTrajectory<World> circle;
+  DiscreteTrajectory<World> downsampled_circle;
+  downsampled_circle.SetDownsampling(/*max_dense_intervals=*/50,
+                                     /*tolerance=*/1 * Milli(Metre));
+  AngularFrequency const ω = 3 * Radian / Second;
+  Length const r = 2 * Metre;
+  Speed const v = ω * r / Radian;
+  for (auto t = DoublePrecision<Instant>(t0_);
+       t.value <= t0_ + 10 * Second;
+       t.Increment(10 * Milli(Second))) {
+    DegreesOfFreedom<World> const dof =
+        {World::origin + Displacement<World>{{r * Cos(ω * (t.value - t0_)),
+                                              r * Sin(ω * (t.value - t0_)),
+                                              0 * Metre}},
+         Velocity<World>{{-v * Sin(ω * (t.value - t0_)),
+                          v * Cos(ω * (t.value - t0_)),
+                          0 * Metre / Second}}};
+    circle.Append(t.value, dof);
+    downsampled_circle.Append(t.value, dof);
+  }
+  EXPECT_THAT(downsampled_circle.Size(), Eq(77));
+
+  Instant const t_max = downsampled_circle.last().time();
+  std::vector<Instant> dense_times;
+  for (auto it = downsampled_circle.LowerBound(t_max - 500 * Milli(Second));
+       it != downsampled_circle.End();
+       ++it) {
+    dense_times.push_back(it.time());
+  }
+  EXPECT_THAT(dense_times, SizeIs(Gt(10)));
+  EXPECT_THAT(downsampled_circle.DownsampleBetween(t0_,
+                                                   t0_ + 5 * Second,
+                                                   /*tolerance=*/1 * Metre),
+              Eq(18));
+  EXPECT_THAT(downsampled_circle.Size(), Eq(59));
+  EXPECT_EQ(t0_, downsampled_circle.Begin().time());
+  for (Instant const& t : dense_times) {
+    EXPECT_NE(downsampled_circle.End(), downsampled_circle.Find(t));
+  }
+
+  std::vector<Length> errors;
+  for (auto it = circle.Begin(); it != circle.End(); ++it) {
+    errors.push_back((downsampled_circle.EvaluatePosition(it.time()) -
+                      it.degrees_of_freedom().position()).Norm());
+  }
+  EXPECT_THAT(errors, Each(Lt(1 * Metre)));
+
+  // The points that have not been downsampled yet are never removed.
+  EXPECT_THAT(downsampled_circle.DownsampleBetween(t0_,
+                                                   t_max,
+                                                   /*tolerance=*/1 * Metre),
+              Eq(18));
+  EXPECT_THAT(downsampled_circle.Size(), Eq(41));
+  for (Instant const& t : dense_times) {
+    EXPECT_NE(downsampled_circle.End(), downsampled_circle.Find(t));
+  }
+  EXPECT_LE(downsampled_circle.first_dense_time(), dense_times.front());
+  EXPECT_THAT(downsampled_circle.DownsampleBetween(
+                  downsampled_circle.first_dense_time(),
+                  t_max,
+                  /*tolerance=*/1 * Metre),
+              Eq(0));
+  EXPECT_EQ(InfiniteFuture, circle.first_dense_time());
+
+  // The points outside of the interval are not changed.
+  std::vector<Instant> times_before;
+  for (auto it = circle.Begin(); it != circle.End(); ++it) {
+    if (it.time() <= t0_ + 5 * Second) {
+      times_before.push_back(it.time());
+    }
+  }
+  EXPECT_THAT(circle.DownsampleBetween(t0_ + 5 * Second,
+                                       t_max,
+                                       /*tolerance=*/1 * Metre),
+              Gt(0));
+  std::vector<Instant> times_after;
+  for (auto it = circle.Begin(); it != circle.End(); ++it) {
+    if (it.time() <= t0_ + 5 * Second) {
+      times_after.push_back(it.time());
+    }
+  }
+  EXPECT_EQ(times_before, times_after);
+  EXPECT_EQ(t_max, circle.last().time());
+}
+
 }  // namespace internal_discrete_trajectory
 }  // namespace physics
 }  // namespace principia
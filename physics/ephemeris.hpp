@@ -150,6 +150,8 @@ class Ephemeris {
 
   virtual FixedStepSizeIntegrator<NewtonianMotionEquation> const&
   planetary_integrator() const;
+  // The step used by the |planetary_integrator()|.
+  virtual Time planetary_integrator_step() const;
 
   virtual Status last_severe_integration_status() const;
 
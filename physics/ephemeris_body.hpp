@@ -320,6 +320,11 @@ Ephemeris<Frame>::planetary_integrator() const {
   return *parameters_.integrator_;
 }
 
+template<typename Frame>
+Time Ephemeris<Frame>::planetary_integrator_step() const {
+  return parameters_.step_;
+}
+
 template<typename Frame>
 Status Ephemeris<Frame>::last_severe_integration_status() const {
   return last_severe_integration_status_;
@@ -37,6 +37,7 @@ class MockEphemeris : public Ephemeris<Frame> {
   MOCK_CONST_METHOD0_T(
       planetary_integrator,
       FixedStepSizeIntegrator<NewtonianMotionEquation> const&());
+  MOCK_CONST_METHOD0_T(planetary_integrator_step, Time());
 
   MOCK_METHOD1_T(ForgetBefore, void(Instant const& t));
   MOCK_METHOD1_T(Prolong, void(Instant const& t));
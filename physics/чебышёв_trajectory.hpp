@@ -0,0 +1,92 @@
+﻿
+#pragma once
+
+#include <experimental/optional>
+#include <vector>
+
+#include "geometry/named_quantities.hpp"
+#include "numerics/чебышёв_series.hpp"
+#include "physics/degrees_of_freedom.hpp"
+#include "physics/discrete_trajectory.hpp"
+#include "physics/trajectory.hpp"
+#include "quantities/quantities.hpp"
+
+// Spelling: Чебышёв ЧЕБЫШЁВ чебышёв
+namespace principia {
+namespace physics {
+namespace internal_чебышёв_trajectory {
+
+using geometry::Displacement;
+using geometry::Instant;
+using geometry::Position;
+using geometry::Velocity;
+using numerics::ЧебышёвSeries;
+using quantities::Length;
+
+// A trajectory made of Чебышёв series on consecutive intervals, obtained by
+// computing Newhall approximations of a |DiscreteTrajectory|.  For smooth
+// motion, e.g., a long coast, the series span many points of the discrete
+// trajectory, so this is much more compact and faster to evaluate.  The
+// intervals are chosen adaptively, so manœuvres are supported but result in
+// shorter intervals.
+template<typename Frame>
+class ЧебышёвTrajectory : public Trajectory<Frame> {
+ public:
+  // Approximates |trajectory| on [t_min, t_max], which must be within
+  // [trajectory.t_min(), trajectory.t_max()].  The positions of the points of
+  // |trajectory| in that interval are within |tolerance| of the
+  // approximation.
+  ЧебышёвTrajectory(DiscreteTrajectory<Frame> const& trajectory,
+                    Instant const& t_min,
+                    Instant const& t_max,
+                    Length const& tolerance);
+
+  ЧебышёвTrajectory(ЧебышёвTrajectory const&) = delete;
+  ЧебышёвTrajectory(ЧебышёвTrajectory&&) = delete;
+  ЧебышёвTrajectory& operator=(ЧебышёвTrajectory const&) = delete;
+  ЧебышёвTrajectory& operator=(ЧебышёвTrajectory&&) = delete;
+
+  // The number of series and their average degree.  Only useful for
+  // benchmarking or analyzing performance.  Do not use in real code.
+  std::int64_t number_of_series() const;
+  double average_degree() const;
+
+  // Implementation of the interface |Trajectory|.
+
+  Instant t_min() const override;
+  Instant t_max() const override;
+
+  Position<Frame> EvaluatePosition(Instant const& time) const override;
+  Velocity<Frame> EvaluateVelocity(Instant const& time) const override;
+  DegreesOfFreedom<Frame> EvaluateDegreesOfFreedom(
+      Instant const& time) const override;
+
+  // End of the implementation of the interface.
+
+ private:
+  // Returns a series that approximates |trajectory| on [lower, upper] within
+  // |tolerance|, or nullopt if no series of an acceptable degree does.
+  static std::experimental::optional<ЧебышёвSeries<Displacement<Frame>>>
+  FitSeries(
+      DiscreteTrajectory<Frame> const& trajectory,
+      typename DiscreteTrajectory<Frame>::Evaluator& evaluator,
+      Instant const& lower,
+      Instant const& upper,
+      Length const& tolerance);
+
+  // Returns an iterator to the series applicable for the given |time|.
+  typename std::vector<ЧебышёвSeries<Displacement<Frame>>>::const_iterator
+  FindSeriesForInstant(Instant const& time) const;
+
+  // The series are in increasing time order.  Their intervals are consecutive.
+  std::vector<ЧебышёвSeries<Displacement<Frame>>> series_;
+};
+
+}  // namespace internal_чебышёв_trajectory
+
+using internal_чебышёв_trajectory::ЧебышёвTrajectory;
+
+}  // namespace physics
+}  // namespace principia
+
+#include "physics/чебышёв_trajectory_body.hpp"
@@ -0,0 +1,195 @@
+﻿
+#pragma once
+
+#include "physics/чебышёв_trajectory.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "glog/logging.h"
+#include "quantities/si.hpp"
+
+namespace principia {
+namespace physics {
+namespace internal_чебышёв_trajectory {
+
+using quantities::Time;
+using quantities::si::Metre;
+
+int const max_degree = 17;
+int const min_degree = 3;
+
+// Only supports 8 divisions for now.
+int const divisions = 8;
+
+template<typename Frame>
+ЧебышёвTrajectory<Frame>::ЧебышёвTrajectory(
+    DiscreteTrajectory<Frame> const& trajectory,
+    Instant const& t_min,
+    Instant const& t_max,
+    Length const& tolerance) {
+  CHECK_LT(0 * Metre, tolerance);
+  CHECK_LE(trajectory.t_min(), t_min);
+  CHECK_LT(t_min, t_max);
+  CHECK_GE(trajectory.t_max(), t_max);
+
+  // Start with intervals spanning about as many points of |trajectory| as there
+  // are divisions.
+  std::int64_t points = 0;
+  for (auto it = trajectory.LowerBound(t_min);
+       it != trajectory.End() && it.time() <= t_max;
+       ++it) {
+    ++points;
+  }
+  Time span = (t_max - t_min) * divisions / std::max<std::int64_t>(points, 1);
+
+  typename DiscreteTrajectory<Frame>::Evaluator evaluator(&trajectory);
+  Instant lower = t_min;
+  while (lower < t_max) {
+    Instant const upper = t_max - lower <= span ? t_max : lower + span;
+    auto series = FitSeries(trajectory, evaluator, lower, upper, tolerance);
+    if (series) {
+      series_.push_back(std::move(*series));
+      // Try a longer interval next time, in case the motion became smoother.
+      span = 2 * (upper - lower);
+      lower = upper;
+    } else {
+      // No series fits, try a shorter interval.  This terminates because, on an
+      // interval between consecutive points of |trajectory|, the trajectory is
+      // a cubic, which is fitted exactly.
+      span = 0.5 * (upper - lower);
+    }
+  }
+}
+
+template<typename Frame>
+std::int64_t ЧебышёвTrajectory<Frame>::number_of_series() const {
+  return series_.size();
+}
+
+template<typename Frame>
+double ЧебышёвTrajectory<Frame>::average_degree() const {
+  double total = 0;
+  for (auto const& series : series_) {
+    total += series.degree();
+  }
+  return total / series_.size();
+}
+
+template<typename Frame>
+Instant ЧебышёвTrajectory<Frame>::t_min() const {
+  return series_.front().t_min();
+}
+
+template<typename Frame>
+Instant ЧебышёвTrajectory<Frame>::t_max() const {
+  return series_.back().t_max();
+}
+
+template<typename Frame>
+Position<Frame> ЧебышёвTrajectory<Frame>::EvaluatePosition(
+    Instant const& time) const {
+  return FindSeriesForInstant(time)->Evaluate(time) + Frame::origin;
+}
+
+template<typename Frame>
+Velocity<Frame> ЧебышёвTrajectory<Frame>::EvaluateVelocity(
+    Instant const& time) const {
+  return FindSeriesForInstant(time)->EvaluateDerivative(time);
+}
+
+template<typename Frame>
+DegreesOfFreedom<Frame> ЧебышёвTrajectory<Frame>::EvaluateDegreesOfFreedom(
+    Instant const& time) const {
+  auto const it = FindSeriesForInstant(time);
+  return DegreesOfFreedom<Frame>(it->Evaluate(time) + Frame::origin,
+                                 it->EvaluateDerivative(time));
+}
+
+template<typename Frame>
+std::experimental::optional<ЧебышёвSeries<Displacement<Frame>>>
+ЧебышёвTrajectory<Frame>::FitSeries(
+    DiscreteTrajectory<Frame> const& trajectory,
+    typename DiscreteTrajectory<Frame>::Evaluator& evaluator,
+    Instant const& lower,
+    Instant const& upper,
+    Length const& tolerance) {
+  // These vectors are thread-local to avoid deallocation/reallocation each
+  // time we go through this code path.
+  thread_local std::vector<Displacement<Frame>> q(divisions + 1);
+  thread_local std::vector<Velocity<Frame>> v(divisions + 1);
+  q.clear();
+  v.clear();
+  Time const step = (upper - lower) / divisions;
+  for (int i = 0; i <= divisions; ++i) {
+    Instant const t = i == divisions ? upper : lower + i * step;
+    DegreesOfFreedom<Frame> const degrees_of_freedom =
+        evaluator.EvaluateDegreesOfFreedom(t);
+    q.push_back(degrees_of_freedom.position() - Frame::origin);
+    v.push_back(degrees_of_freedom.velocity());
+  }
+
+  // If there are no points of |trajectory| strictly inside the interval, the
+  // trajectory is a cubic there, so the series of lowest degree is exact.
+  auto begin = trajectory.LowerBound(lower);
+  if (begin != trajectory.End() && begin.time() == lower) {
+    ++begin;
+  }
+  auto const end = trajectory.LowerBound(upper);
+  if (begin == end) {
+    return ЧебышёвSeries<Displacement<Frame>>::NewhallApproximation(
+        min_degree, q, v, lower, upper);
+  }
+
+  // Increase the degree until the error estimate is below |tolerance| and the
+  // series actually fits the points of |trajectory|.  Stop when the error
+  // estimate stops decreasing, which indicates numerical instabilities.
+  Length previous_error_estimate;
+  for (int degree = min_degree; degree <= max_degree; ++degree) {
+    auto series = ЧебышёвSeries<Displacement<Frame>>::NewhallApproximation(
+        degree, q, v, lower, upper);
+    Length const error_estimate = series.last_coefficient().Norm();
+    if (degree > min_degree && error_estimate >= previous_error_estimate) {
+      break;
+    }
+    previous_error_estimate = error_estimate;
+    if (error_estimate > tolerance) {
+      continue;
+    }
+    bool fits = true;
+    for (auto it = begin; it != end; ++it) {
+      if ((series.Evaluate(it.time()) -
+           (it.degrees_of_freedom().position() - Frame::origin)).Norm() >
+          tolerance) {
+        fits = false;
+        break;
+      }
+    }
+    if (fits) {
+      return std::move(series);
+    }
+  }
+  return std::experimental::nullopt;
+}
+
+template<typename Frame>
+typename std::vector<ЧебышёвSeries<Displacement<Frame>>>::const_iterator
+ЧебышёвTrajectory<Frame>::FindSeriesForInstant(Instant const& time) const {
+  CHECK_LE(t_min(), time);
+  CHECK_GE(t_max(), time);
+  // Need to use |lower_bound|, not |upper_bound|, because it allows
+  // heterogeneous arguments.  This returns the first series |s| such that
+  // |time <= s.t_max()|.
+  auto const it = std::lower_bound(
+                      series_.begin(), series_.end(), time,
+                      [](ЧебышёвSeries<Displacement<Frame>> const& left,
+                         Instant const& right) {
+                        return left.t_max() < right;
+                      });
+  CHECK(it != series_.end());
+  return it;
+}
+
+}  // namespace internal_чебышёв_trajectory
+}  // namespace physics
+}  // namespace principia
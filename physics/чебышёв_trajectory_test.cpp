@@ -0,0 +1,148 @@
+﻿
+#include "physics/чебышёв_trajectory.hpp"
+
+#include <vector>
+
+#include "astronomy/epoch.hpp"
+#include "geometry/frame.hpp"
+#include "geometry/named_quantities.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "physics/discrete_trajectory.hpp"
+#include "quantities/elementary_functions.hpp"
+#include "quantities/named_quantities.hpp"
+#include "quantities/quantities.hpp"
+#include "quantities/si.hpp"
+#include "serialization/geometry.pb.h"
+
+namespace principia {
+namespace physics {
+namespace internal_чебышёв_trajectory {
+
+using geometry::Frame;
+using quantities::Acceleration;
+using quantities::AngularFrequency;
+using quantities::Cos;
+using quantities::Sin;
+using quantities::Speed;
+using quantities::Time;
+using quantities::si::Kilo;
+using quantities::si::Metre;
+using quantities::si::Radian;
+using quantities::si::Second;
+using ::testing::AllOf;
+using ::testing::Each;
+using ::testing::Gt;
+using ::testing::Lt;
+
+class ЧебышёвTrajectoryTest : public testing::Test {
+ protected:
+  using World = Frame<serialization::Frame::TestTag,
+                      serialization::Frame::TEST1, true>;
+
+  // A circular orbit with a period of about 5800 s.
+  DegreesOfFreedom<World> Circle(Instant const& t) const {
+    return {World::origin + Displacement<World>({r_ * Cos(ω_ * (t - t0_)),
+                                                 r_ * Sin(ω_ * (t - t0_)),
+                                                 0 * Metre}),
+            Velocity<World>({-v_ * Sin(ω_ * (t - t0_)),
+                             v_ * Cos(ω_ * (t - t0_)),
+                             0 * Metre / Second})};
+  }
+
+  // Returns the errors on the positions of the points of |trajectory| in
+  // [t_min, t_max].
+  std::vector<Length> Errors(DiscreteTrajectory<World> const& trajectory,
+                             ЧебышёвTrajectory<World> const& approximation,
+                             Instant const& t_min,
+                             Instant const& t_max) const {
+    std::vector<Length> errors;
+    for (auto it = trajectory.LowerBound(t_min);
+         it != trajectory.End() && it.time() <= t_max;
+         ++it) {
+      errors.push_back((approximation.EvaluatePosition(it.time()) -
+                        it.degrees_of_freedom().position()).Norm());
+    }
+    return errors;
+  }
+
+  Instant const t0_ = astronomy::J2000;
+  Length const r_ = 7000 * Kilo(Metre);
+  AngularFrequency const ω_ = 1.08e-3 * Radian / Second;
+  Speed const v_ = ω_ * r_ / Radian;
+};
+
+TEST_F(ЧебышёвTrajectoryTest, Coast) {
+  DiscreteTrajectory<World> trajectory;
+  for (Instant t = t0_; t <= t0_ + 20'000 * Second; t += 10 * Second) {
+    trajectory.Append(t, Circle(t));
+  }
+  EXPECT_EQ(2001, trajectory.Size());
+
+  ЧебышёвTrajectory<World> const approximation(trajectory,
+                                               trajectory.t_min(),
+                                               trajectory.t_max(),
+                                               /*tolerance=*/1 * Metre);
+  EXPECT_EQ(trajectory.t_min(), approximation.t_min());
+  EXPECT_EQ(trajectory.t_max(), approximation.t_max());
+  // About 100 times more compact than the points.
+  EXPECT_EQ(9, approximation.number_of_series());
+  EXPECT_THAT(approximation.average_degree(), AllOf(Gt(8), Lt(9)));
+  EXPECT_THAT(Errors(trajectory,
+                     approximation,
+                     trajectory.t_min(),
+                     trajectory.t_max()),
+              Each(Lt(1 * Metre)));
+
+  // The velocities are also close to those of the trajectory.
+  for (auto it = trajectory.Begin(); it != trajectory.End(); ++it) {
+    EXPECT_LT((approximation.EvaluateVelocity(it.time()) -
+               it.degrees_of_freedom().velocity()).Norm(),
+              1e-2 * Metre / Second);
+  }
+}
+
+TEST_F(ЧебышёвTrajectoryTest, Manœuvre) {
+  // A burn with a constant acceleration along the y axis from 1000 s to
+  // 1060 s, followed by a coast.
+  Instant const burn_start = t0_ + 1000 * Second;
+  Instant const burn_end = t0_ + 1060 * Second;
+  Acceleration const a = 10 * Metre / Second / Second;
+  auto const degrees_of_freedom = [this, a, burn_start, burn_end](
+                                      Instant const& t) {
+    DegreesOfFreedom<World> const circle = Circle(t);
+    Time const Δt_burn = std::min(std::max(t, burn_start), burn_end) -
+                         burn_start;
+    Time const Δt_coast = std::max(t, burn_end) - burn_end;
+    Displacement<World> const Δq(
+        {0 * Metre,
+         0.5 * a * Δt_burn * Δt_burn + a * Δt_burn * Δt_coast,
+         0 * Metre});
+    Velocity<World> const Δv({0 * Metre / Second,
+                              a * Δt_burn,
+                              0 * Metre / Second});
+    return DegreesOfFreedom<World>(circle.position() + Δq,
+                                   circle.velocity() + Δv);
+  };
+  DiscreteTrajectory<World> trajectory;
+  for (Instant t = t0_; t <= t0_ + 5000 * Second; t += 5 * Second) {
+    trajectory.Append(t, degrees_of_freedom(t));
+  }
+
+  // Only approximate part of the trajectory.
+  Instant const t_min = t0_ + 502 * Second;
+  Instant const t_max = t0_ + 4498 * Second;
+  ЧебышёвTrajectory<World> const approximation(trajectory,
+                                               t_min,
+                                               t_max,
+                                               /*tolerance=*/10 * Metre);
+  EXPECT_EQ(t_min, approximation.t_min());
+  EXPECT_EQ(t_max, approximation.t_max());
+  EXPECT_EQ(15, approximation.number_of_series());
+  EXPECT_THAT(Errors(trajectory, approximation, t_min, t_max),
+              Each(Lt(10 * Metre)));
+}
+
+}  // namespace internal_чебышёв_trajectory
+}  // namespace physics
+}  // namespace principia
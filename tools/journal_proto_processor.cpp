@@ -190,11 +190,18 @@ void JournalProtoProcessor::ProcessRepeatedMessageField(
   size_member_name_[descriptor] =
       options.GetExtension(journal::serialization::size);
   field_cs_type_[descriptor] = message_type_name + "[]";
-  field_cxx_type_[descriptor] = message_type_name + " const*";
+  if (Contains(in_out_, descriptor)) {
+    // An in-out array is passed as a pointer to its first element, and its
+    // elements are updated in place by the callee.
+    field_cs_marshal_[descriptor] = "In, Out";
+    field_cxx_type_[descriptor] = message_type_name + "*";
+  } else {
+    field_cxx_type_[descriptor] = message_type_name + " const*";
+  }
 
   field_cxx_arguments_fn_[descriptor] =
       [](std::string const& identifier) -> std::vector<std::string> {
-        return {"&" + identifier + "[0]", identifier + ".size()"};
+        return {identifier + ".data()", identifier + ".size()"};
       };
   field_cxx_assignment_fn_[descriptor] =
       [this, descriptor, message_type_name](
@@ -8,6 +8,7 @@
 #include "quantities/parser.hpp"
 #include "tools/generate_configuration.hpp"
 #include "tools/generate_profiles.hpp"
+#include "tools/profile_save.hpp"
 
 int main(int argc, char const* argv[]) {
   google::InitGoogleLogging(argv[0]);
@@ -42,9 +43,18 @@ int main(int argc, char const* argv[]) {
     }
     principia::tools::GenerateProfiles();
     return 0;
+  } else if (command == "profile_save") {
+    if (argc != 3) {
+      // tools.exe profile_save persistent.sfs > profile.csv
+      std::cerr << "Usage: " << argv[0] << " " << argv[1] << " "
+                << "save_path\n";
+      return 5;
+    }
+    principia::tools::ProfileSave(argv[2], std::cout);
+    return 0;
   } else {
     std::cerr << "Usage: " << argv[0]
-              << " generate_configuration|generate_profiles\n";
+              << " generate_configuration|generate_profiles|profile_save\n";
     return 4;
   }
 }
@@ -0,0 +1,337 @@
+﻿
+#include "tools/profile_save.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/array.hpp"
+#include "base/hexadecimal.hpp"
+#include "base/not_null.hpp"
+#include "base/push_deserializer.hpp"
+#include "glog/logging.h"
+#include "google/protobuf/descriptor.h"
+#include "google/protobuf/message.h"
+#include "serialization/ksp_plugin.pb.h"
+
+namespace principia {
+
+using base::Bytes;
+using base::HexadecimalDecode;
+using base::make_not_null_unique;
+using base::PushDeserializer;
+
+namespace tools {
+namespace internal_profile_save {
+
+namespace {
+
+// The key of the serialization of the plugin in a KSP save, see
+// ksp_plugin_adapter.cs.
+constexpr char serialized_plugin_key[] = "serialized_plugin";
+
+// The parse times are the minimum over that many parses.
+constexpr int parse_repetitions = 3;
+
+constexpr int chunk_size = 64 << 10;
+constexpr int number_of_chunks = 8;
+
+struct Measurement {
+  std::int64_t count = 0;
+  // The size of the uncompressed serialization.
+  std::int64_t bytes = 0;
+  // The size of the serialization as stored in the file, possibly compressed.
+  // Only known for the entire save, 0 otherwise.
+  std::int64_t stored_bytes = 0;
+  std::chrono::nanoseconds parse_time{};
+
+  Measurement& operator+=(Measurement const& right) {
+    count += right.count;
+    bytes += right.bytes;
+    stored_bytes += right.stored_bytes;
+    parse_time += right.parse_time;
+    return *this;
+  }
+};
+
+// The profile of the structures of a plugin, in the order in which they are
+// reported.
+using Profile = std::vector<std::pair<std::string, Measurement>>;
+
+// Returns the serialization of the plugin contained in the file at |path|,
+// possibly compressed.
+std::string ReadSerialization(std::experimental::filesystem::path const& path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  CHECK(file.good()) << path;
+  std::string const extension = path.extension().string();
+  if (extension == ".bin") {
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  }
+
+  // Collect the hexadecimal digits, either from the entire file or only from
+  // the values of |serialized_plugin_key| in a KSP save.
+  std::string hexadecimal;
+  for (std::string line; std::getline(file, line);) {
+    if (extension == ".sfs") {
+      auto const key = line.find(serialized_plugin_key);
+      auto const equal = line.find('=');
+      if (key == std::string::npos || equal == std::string::npos ||
+          equal < key) {
+        continue;
+      }
+      line.erase(0, equal + 1);
+    }
+    std::copy_if(line.begin(),
+                 line.end(),
+                 std::back_inserter(hexadecimal),
+                 [](char const c) {
+                   return std::isxdigit(static_cast<unsigned char>(c));
+                 });
+  }
+  CHECK(!hexadecimal.empty()) << "No serialization in " << path;
+  std::string bytes(hexadecimal.size() >> 1, '\0');
+  HexadecimalDecode(
+      {reinterpret_cast<std::uint8_t const*>(hexadecimal.data()),
+       hexadecimal.size()},
+      {reinterpret_cast<std::uint8_t*>(&bytes[0]), bytes.size()});
+  return bytes;
+}
+
+// Returns the size of |message| and the time it takes to parse it.
+Measurement Measure(google::protobuf::Message const& message) {
+  std::string const serialized = message.SerializeAsString();
+  std::unique_ptr<google::protobuf::Message> const parsed(message.New());
+  auto parse_time = std::chrono::nanoseconds::max();
+  for (int i = 0; i < parse_repetitions; ++i) {
+    parsed->Clear();
+    auto const start = std::chrono::steady_clock::now();
+    CHECK(parsed->ParseFromString(serialized));
+    parse_time = std::min(parse_time,
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start));
+  }
+  return {/*count=*/1,
+          static_cast<std::int64_t>(serialized.size()),
+          /*stored_bytes=*/0,
+          parse_time};
+}
+
+// Adds to |profile| the top-level fields of |message|, prefixed with |prefix|.
+void AddFields(std::string const& prefix,
+               google::protobuf::Message const& message,
+               Profile& profile) {
+  auto const* const reflection = message.GetReflection();
+  std::vector<google::protobuf::FieldDescriptor const*> fields;
+  reflection->ListFields(message, &fields);
+  for (auto const* const field : fields) {
+    if (field->cpp_type() !=
+            google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+      continue;
+    }
+    Measurement measurement;
+    if (field->is_repeated()) {
+      for (int i = 0; i < reflection->FieldSize(message, field); ++i) {
+        measurement +=
+            Measure(reflection->GetRepeatedMessage(message, field, i));
+      }
+    } else {
+      measurement = Measure(reflection->GetMessage(message, field));
+    }
+    profile.emplace_back(prefix + field->name(), measurement);
+  }
+}
+
+// Adds to |types| the number and sizes of all the messages in the tree rooted
+// at |message|, by type.  The sizes of the submessages must have been cached
+// by a call to |ByteSizeLong|.
+void AddTypes(google::protobuf::Message const& message,
+              std::int64_t const bytes,
+              std::map<std::string, Measurement>& types) {
+  Measurement& measurement = types[message.GetDescriptor()->full_name()];
+  ++measurement.count;
+  measurement.bytes += bytes;
+  auto const* const reflection = message.GetReflection();
+  std::vector<google::protobuf::FieldDescriptor const*> fields;
+  reflection->ListFields(message, &fields);
+  for (auto const* const field : fields) {
+    if (field->cpp_type() !=
+            google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+      continue;
+    }
+    // The sizes of the entries of maps are not cached.
+    auto const size = [field](google::protobuf::Message const& submessage) {
+      return field->is_map()
+                 ? static_cast<std::int64_t>(submessage.ByteSizeLong())
+                 : submessage.GetCachedSize();
+    };
+    if (field->is_repeated()) {
+      for (int i = 0; i < reflection->FieldSize(message, field); ++i) {
+        auto const& submessage =
+            reflection->GetRepeatedMessage(message, field, i);
+        AddTypes(submessage, size(submessage), types);
+      }
+    } else {
+      auto const& submessage = reflection->GetMessage(message, field);
+      AddTypes(submessage, size(submessage), types);
+    }
+  }
+}
+
+void AddVessel(serialization::Plugin::VesselAndProperties const& message,
+               Profile& profile) {
+  serialization::Vessel const& vessel = message.vessel();
+  std::string const prefix =
+      "vessel " + vessel.name() + " (" + message.guid() + ").";
+  profile.emplace_back(prefix + "history", Measure(vessel.history()));
+  if (vessel.has_prediction()) {
+    profile.emplace_back(prefix + "prediction", Measure(vessel.prediction()));
+  }
+  if (vessel.has_flight_plan()) {
+    profile.emplace_back(prefix + "flight_plan",
+                         Measure(vessel.flight_plan()));
+  }
+  Measurement parts;
+  Measurement prehistories;
+  for (auto const& part : vessel.parts()) {
+    parts += Measure(part);
+    prehistories += Measure(part.prehistory());
+  }
+  profile.emplace_back(prefix + "parts", parts);
+  profile.emplace_back(prefix + "parts.prehistory", prehistories);
+  profile.emplace_back(prefix + "total", Measure(vessel));
+}
+
+void AddCelestial(serialization::MassiveBody const& body,
+                  serialization::ContinuousTrajectory const& trajectory,
+                  Profile& profile) {
+  std::string const prefix = "celestial " + body.name() + ".";
+  Measurement series;
+  for (auto const& s : trajectory.series()) {
+    series += Measure(s);
+  }
+  profile.emplace_back(prefix + "trajectory", Measure(trajectory));
+  profile.emplace_back(prefix + "trajectory.series", series);
+}
+
+// Writes a line of the CSV.  The fraction is that of the uncompressed
+// |total_bytes|.  The stored size is left empty if it is not known, and the
+// parse time is left empty if |has_parse_time| is false.
+void WriteLine(std::string const& structure,
+               Measurement const& measurement,
+               bool const has_parse_time,
+               std::int64_t const total_bytes,
+               std::ostream& out) {
+  // The structure names may contain commas, e.g., in vessel names.
+  std::string quoted = structure;
+  std::replace(quoted.begin(), quoted.end(), '"', '\'');
+  out << '"' << quoted << "\"," << measurement.count << ","
+      << measurement.bytes << ","
+      << static_cast<double>(measurement.bytes) / total_bytes << ",";
+  if (measurement.stored_bytes > 0) {
+    out << measurement.stored_bytes;
+  }
+  out << ",";
+  if (has_parse_time) {
+    out << std::chrono::duration<double, std::micro>(measurement.parse_time)
+               .count();
+  }
+  out << "\n";
+}
+
+}  // namespace
+
+void ProfileSave(std::experimental::filesystem::path const& path,
+                 std::ostream& out) {
+  std::string serialization = ReadSerialization(path);
+
+  // Deserialize the plugin as the game does, thereby decompressing it if
+  // needed.
+  serialization::Plugin plugin;
+  auto const start = std::chrono::steady_clock::now();
+  {
+    PushDeserializer deserializer(chunk_size, number_of_chunks);
+    deserializer.Start(make_not_null_unique<serialization::Plugin>(),
+                       [&plugin](google::protobuf::Message const& message) {
+                         plugin.CopyFrom(message);
+                       });
+    deserializer.Push(Bytes(reinterpret_cast<std::uint8_t*>(&serialization[0]),
+                            serialization.size()),
+                      nullptr);
+    deserializer.Push(Bytes(), nullptr);
+  }
+  auto const deserialization_time =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start);
+
+  Profile profile;
+  Measurement const total = Measure(plugin);
+  // The save is reported with its uncompressed size, like all the other
+  // structures, and with the size that it occupies in the file.
+  profile.emplace_back("save",
+                       Measurement{/*count=*/1,
+                                   total.bytes,
+                                   static_cast<std::int64_t>(
+                                       serialization.size()),
+                                   deserialization_time});
+  profile.emplace_back("plugin", total);
+  AddFields("plugin.", plugin, profile);
+  AddFields("ephemeris.", plugin.ephemeris(), profile);
+  for (int i = 0;
+       i < plugin.ephemeris().body_size() &&
+       i < plugin.ephemeris().trajectory_size();
+       ++i) {
+    AddCelestial(plugin.ephemeris().body(i),
+                 plugin.ephemeris().trajectory(i),
+                 profile);
+  }
+  for (auto const& vessel : plugin.vessel()) {
+    AddVessel(vessel, profile);
+  }
+  for (int i = 0; i < plugin.pile_up_size(); ++i) {
+    profile.emplace_back("pile_up " + std::to_string(i) + ".history",
+                         Measure(plugin.pile_up(i).history()));
+  }
+
+  // The types are sorted by decreasing size.  The size of a type includes
+  // that of its submessages, so the sizes of the types overlap.  The types are
+  // not timed, as most of their messages are too small to be timed
+  // individually.
+  std::map<std::string, Measurement> types;
+  AddTypes(plugin, plugin.ByteSizeLong(), types);
+  std::vector<std::pair<std::string, Measurement>> sorted_types(types.begin(),
+                                                                types.end());
+  std::stable_sort(sorted_types.begin(),
+                   sorted_types.end(),
+                   [](auto const& left, auto const& right) {
+                     return left.second.bytes > right.second.bytes;
+                   });
+
+  out << "structure,count,bytes,fraction,stored_bytes,parse_us\n";
+  for (auto const& entry : profile) {
+    WriteLine(entry.first,
+              entry.second,
+              /*has_parse_time=*/true,
+              total.bytes,
+              out);
+  }
+  for (auto const& entry : sorted_types) {
+    WriteLine("type " + entry.first,
+              entry.second,
+              /*has_parse_time=*/false,
+              total.bytes,
+              out);
+  }
+}
+
+}  // namespace internal_profile_save
+}  // namespace tools
+}  // namespace principia
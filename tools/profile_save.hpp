@@ -0,0 +1,29 @@
+﻿
+#pragma once
+
+#include <experimental/filesystem>
+#include <ostream>
+
+namespace principia {
+namespace tools {
+namespace internal_profile_save {
+
+// Loads the plugin serialized in the file at |path| and writes to |out| a CSV
+// giving the size of its structures and the time it takes to parse them: the
+// top-level fields of the plugin, the histories, predictions, flight plans and
+// parts of each vessel, the trajectories of each celestial with their
+// Chebyshev series, the state of the ephemeris integrator, the histories of
+// the pile-ups, and the message types.  All the sizes are those of the
+// uncompressed serialization; the size in the file of the entire save, which
+// may be compressed, is reported in a separate column.  The file may be a KSP
+// save (extension .sfs), a binary serialization (extension .bin) or a
+// hexadecimal serialization (any other extension), compressed or not.
+void ProfileSave(std::experimental::filesystem::path const& path,
+                 std::ostream& out);
+
+}  // namespace internal_profile_save
+
+using internal_profile_save::ProfileSave;
+
+}  // namespace tools
+}  // namespace principia